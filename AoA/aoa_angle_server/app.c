@@ -0,0 +1,519 @@
+/***************************************************************************//**
+ * @file
+ * @brief Central angle estimation server.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "app_log.h"
+#include "app_assert.h"
+#include "mqtt.h"
+#include "aoa.h"
+#include "aoa_util.h"
+#include "aoa_parse.h"
+#include "aoa_trace.h"
+#include "aoa_id_table.h"
+#include "work_pool.h"
+#include "aoa_codec.h"
+#include "aoa_stream.h"
+#include "aoa_outbox.h"
+#include "app_config.h"
+#include "app.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define INVALID_IDX              AOA_ID_TABLE_INVALID
+
+#define USAGE                    "\nUsage: %s [-m <address>[:<port>]] [-c <config>] [-p <port>] [-j <threads>] [-e <json|binary>] [-o <drop-newest|drop-oldest|block>]\n"
+
+// IQ reports of all locators and asset tags.
+#define IQ_TOPIC                 "silabs/aoa/iq/+/+"
+
+// -----------------------------------------------------------------------------
+// Private types
+
+// Angle estimator of a locator and asset tag pair.
+typedef struct {
+  aoa_id_t locator_id;
+  aoa_id_t tag_id;
+  aoa_libitems_t aoa_states;      // owned by the estimation task
+  work_pool_task_t task;          // estimation task
+  pthread_mutex_t lock;           // protects the fields below
+  aoa_codec_iq_t queue[IQ_QUEUE_SIZE];
+  uint32_t queue_head;
+  uint32_t queue_count;
+  uint32_t dropped;               // IQ reports dropped on queue overflow
+  bool scheduled;                 // estimation task queued or running
+} aoa_estimator_t;
+
+typedef struct {
+  aoa_id_t id;
+  aoa_id_table_t tags;            // asset tag ID to estimator index
+} aoa_locator_t;
+
+// -----------------------------------------------------------------------------
+// Private variables
+
+static mqtt_handle_t mqtt_handle = MQTT_DEFAULT_HANDLE;
+
+// Locators and estimators are added by the MQTT and the stream threads.
+static pthread_mutex_t estimator_lock = PTHREAD_MUTEX_INITIALIZER;
+static aoa_locator_t locator_list[MAX_NUM_LOCATORS];
+static uint32_t locator_count = 0;
+static aoa_id_table_t locator_table;
+static aoa_estimator_t *estimator_list[MAX_NUM_ESTIMATORS];
+static uint32_t estimator_count = 0;
+static uint64_t unhandled_count = 0; // IQ reports without an estimator
+
+static uint32_t estimation_thread_count = ESTIMATION_THREAD_COUNT;
+static work_pool_t estimation_pool;
+
+// IQ report stream of the locators, disabled if the port is 0.
+static uint16_t stream_port = AOA_CODEC_IQ_PORT;
+static aoa_stream_server_t stream_server;
+
+// Encoding of the published angles.
+static enum aoa_codec_encoding angle_encoding = AOA_CODEC_ENCODING_JSON;
+
+// Angles are queued by the estimation threads and published on the network
+// thread of the outbox. The MQTT connection of the main thread only receives.
+static aoa_outbox_t outbox;
+static aoa_outbox_policy_t outbox_policy = MQTT_OVERFLOW_POLICY;
+static uint64_t published_count = 0; // angles queued, atomic access
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void parse_config(char *filename);
+static void on_message(mqtt_handle_t *handle, const char *topic, const char *payload);
+static void on_frame(const uint8_t *frame, size_t len, void *context);
+static void receive_iq_report(aoa_codec_iq_t *iq);
+static aoa_estimator_t *get_estimator(const char *locator_id, const char *tag_id);
+static void enqueue_iq_report(aoa_estimator_t *estimator, aoa_codec_iq_t *iq);
+static void process_estimator(work_pool_task_t *task);
+static void publish_angle(aoa_estimator_t *estimator, aoa_angle_t *angle, uint64_t timestamp);
+
+/**************************************************************************//**
+ * Application Init.
+ *****************************************************************************/
+void app_init(int argc, char* argv[])
+{
+  sl_status_t sc;
+  mqtt_status_t rc;
+  int opt;
+  char *port_str = NULL;
+  char *config_file = NULL;
+
+  // Parse command line arguments.
+  while ((opt = getopt(argc, argv, "m:c:p:j:e:o:h")) != -1) {
+    switch (opt) {
+      // MQTT broker connection parameters.
+      case 'm':
+        mqtt_handle.host = strtok(optarg, ":");
+        port_str = strtok(NULL, ":");
+        if (port_str != NULL) {
+          mqtt_handle.port = atoi(port_str);
+        }
+        break;
+
+      // Configuration file.
+      case 'c':
+        config_file = optarg;
+        break;
+
+      // Port of the IQ report stream.
+      case 'p':
+        stream_port = (uint16_t)atoi(optarg);
+        break;
+
+      // Number of estimation threads.
+      case 'j':
+        estimation_thread_count = atoi(optarg);
+        break;
+
+      // Angle encoding.
+      case 'e':
+        if (aoa_codec_parse_encoding(optarg, &angle_encoding) != SL_STATUS_OK) {
+          app_log(USAGE, argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Overflow policy of the outbound MQTT queue.
+      case 'o':
+        if (aoa_outbox_parse_policy(optarg, &outbox_policy) != SL_STATUS_OK) {
+          app_log(USAGE, argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Help.
+      case 'h':
+        app_log(USAGE, argv[0]);
+        exit(EXIT_SUCCESS);
+
+      // Illegal option.
+      default:
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  if (config_file != NULL) {
+    parse_config(config_file);
+  }
+
+  // Thousands of angles per second would flood the log.
+  aoa_log_angles = false;
+
+  sc = aoa_id_table_init(&locator_table, MAX_NUM_LOCATORS);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to init locator table\n",
+             (int)sc);
+
+  if (estimation_thread_count == 0) {
+    estimation_thread_count = work_pool_cpu_count();
+  }
+  sc = work_pool_init(&estimation_pool, estimation_thread_count);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to start estimation threads\n",
+             (int)sc);
+  app_log("Estimation threads: %u\n", estimation_thread_count);
+
+  mqtt_handle.on_message = on_message;
+
+  rc = mqtt_init(&mqtt_handle);
+  app_assert(rc == MQTT_SUCCESS, "MQTT init failed.\n");
+
+  rc = mqtt_subscribe(&mqtt_handle, IQ_TOPIC);
+  app_assert(rc == MQTT_SUCCESS, "Failed to subscribe to topic '%s'.\n", IQ_TOPIC);
+
+  sc = aoa_outbox_start(&outbox, &mqtt_handle, MQTT_QUEUE_SIZE, outbox_policy);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to start MQTT outbox\n",
+             (int)sc);
+  app_log("MQTT outbox: %u messages, %s on overflow\n",
+          outbox.size,
+          aoa_outbox_policy_name(outbox_policy));
+
+  if (stream_port != 0) {
+    sc = aoa_stream_server_start(&stream_server, stream_port, on_frame, NULL);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to listen for IQ report streams on port %u\n",
+               (int)sc,
+               stream_port);
+    app_log("IQ report streams: port %u\n", stream_port);
+  }
+
+  app_log("\nPress Crtl+C to quit\n\n");
+}
+
+/**************************************************************************//**
+ * Application Process Action.
+ *****************************************************************************/
+void app_process_action(void)
+{
+  mqtt_status_t rc;
+
+  rc = mqtt_step(&mqtt_handle);
+  app_assert(rc == MQTT_SUCCESS, "MQTT step failed.\n");
+}
+
+/**************************************************************************//**
+ * Application Deinit.
+ *****************************************************************************/
+void app_deinit(void)
+{
+  uint64_t dropped = 0;
+
+  app_log("Shutting down.\n");
+  if (stream_port != 0) {
+    app_log("IQ report streams: %llu reports received\n",
+            (unsigned long long)stream_server.frames);
+    aoa_stream_server_stop(&stream_server);
+  }
+
+  // Estimate the queued IQ reports, then publish their angles.
+  work_pool_log(&estimation_pool);
+  work_pool_deinit(&estimation_pool);
+  aoa_outbox_stop(&outbox);
+  aoa_outbox_log(&outbox);
+
+  for (uint32_t i = 0; i < estimator_count; i++) {
+    dropped += estimator_list[i]->dropped;
+    aoa_deinit(&estimator_list[i]->aoa_states);
+    pthread_mutex_destroy(&estimator_list[i]->lock);
+    free(estimator_list[i]);
+  }
+  for (uint32_t i = 0; i < locator_count; i++) {
+    aoa_id_table_deinit(&locator_list[i].tags);
+  }
+  aoa_id_table_deinit(&locator_table);
+  app_log("Estimators: %u, angles published: %llu, IQ reports dropped: %llu, unhandled: %llu\n",
+          estimator_count,
+          (unsigned long long)published_count,
+          (unsigned long long)dropped,
+          (unsigned long long)unhandled_count);
+
+  mqtt_deinit(&mqtt_handle);
+}
+
+/**************************************************************************//**
+ * Configuration file parser, only the azimuth mask is used.
+ *****************************************************************************/
+static void parse_config(char *filename)
+{
+  sl_status_t sc;
+  char *buffer;
+
+  buffer = load_file(filename);
+  app_assert(buffer != NULL, "Failed to load file: %s\n", filename);
+
+  sc = aoa_parse_init(buffer);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] aoa_parse_init failed\n",
+             (int)sc);
+
+  sc = aoa_parse_azimuth(&aoa_azimuth_min, &aoa_azimuth_max);
+  app_assert((sc == SL_STATUS_OK) || (sc == SL_STATUS_NOT_FOUND),
+             "[E: 0x%04x] aoa_parse_azimuth failed\n",
+             (int)sc);
+
+  sc = aoa_parse_deinit();
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] aoa_parse_deinit failed\n",
+             (int)sc);
+
+  free(buffer);
+}
+
+/**************************************************************************//**
+ * MQTT message arrived callback.
+ *****************************************************************************/
+static void on_message(mqtt_handle_t *handle, const char *topic, const char *payload)
+{
+  aoa_codec_iq_t iq;
+
+  (void)handle;
+  (void)topic;
+
+  // The IDs of the payload are used, the topic only helps subscribers.
+  if (aoa_codec_decode_iq(payload, &iq) != SL_STATUS_OK) {
+    app_log("Failed to decode IQ report on %s\n", topic);
+    return;
+  }
+  receive_iq_report(&iq);
+}
+
+/**************************************************************************//**
+ * IQ report stream frame callback, called on the stream server thread.
+ *****************************************************************************/
+static void on_frame(const uint8_t *frame, size_t len, void *context)
+{
+  aoa_codec_iq_t iq;
+
+  (void)context;
+
+  if (aoa_codec_iq_unpack(frame, len, &iq) != SL_STATUS_OK) {
+    app_log("Failed to unpack IQ report\n");
+    return;
+  }
+  receive_iq_report(&iq);
+}
+
+/**************************************************************************//**
+ * Pass an IQ report to the estimator of its locator and asset tag.
+ *****************************************************************************/
+static void receive_iq_report(aoa_codec_iq_t *iq)
+{
+  aoa_estimator_t *estimator;
+
+  pthread_mutex_lock(&estimator_lock);
+  estimator = get_estimator(iq->locator_id, iq->tag_id);
+  if (estimator == NULL) {
+    unhandled_count++;
+  }
+  pthread_mutex_unlock(&estimator_lock);
+
+  if (estimator != NULL) {
+    enqueue_iq_report(estimator, iq);
+  }
+}
+
+/**************************************************************************//**
+ * Find the estimator of a locator and asset tag, create it if new.
+ *
+ * @note The estimator lock must be held.
+ * @return Estimator, NULL if out of estimators or locators.
+ *****************************************************************************/
+static aoa_estimator_t *get_estimator(const char *locator_id, const char *tag_id)
+{
+  aoa_locator_t *loc;
+  aoa_estimator_t *estimator;
+  uint32_t loc_idx, idx;
+  sl_status_t sc;
+
+  loc_idx = aoa_id_table_find(&locator_table, locator_id, strlen(locator_id));
+  if (loc_idx == INVALID_IDX) {
+    if ((locator_count == MAX_NUM_LOCATORS)
+        || (aoa_id_table_init(&locator_list[locator_count].tags, INITIAL_NUM_TAGS) != SL_STATUS_OK)) {
+      return NULL;
+    }
+    loc_idx = locator_count;
+    sc = aoa_id_table_add(&locator_table, locator_id, strlen(locator_id), loc_idx);
+    if (sc != SL_STATUS_OK) {
+      aoa_id_table_deinit(&locator_list[loc_idx].tags);
+      return NULL;
+    }
+    aoa_id_copy(locator_list[loc_idx].id, (char *)locator_id);
+    locator_count++;
+    app_log("Locator added: %s\n", locator_id);
+  }
+  loc = &locator_list[loc_idx];
+
+  idx = aoa_id_table_find(&loc->tags, tag_id, strlen(tag_id));
+  if (idx != INVALID_IDX) {
+    return estimator_list[idx];
+  }
+
+  if (estimator_count == MAX_NUM_ESTIMATORS) {
+    return NULL;
+  }
+  estimator = calloc(1, sizeof(aoa_estimator_t));
+  if (estimator == NULL) {
+    return NULL;
+  }
+  if (aoa_id_table_add(&loc->tags, tag_id, strlen(tag_id), estimator_count) != SL_STATUS_OK) {
+    free(estimator);
+    return NULL;
+  }
+  aoa_id_copy(estimator->locator_id, loc->id);
+  aoa_id_copy(estimator->tag_id, (char *)tag_id);
+  aoa_init(&estimator->aoa_states);
+  pthread_mutex_init(&estimator->lock, NULL);
+  estimator->task.function = process_estimator;
+  estimator->task.context = estimator;
+  estimator_list[estimator_count++] = estimator;
+  app_log("Estimator added: %s/%s\n", loc->id, tag_id);
+  return estimator;
+}
+
+/**************************************************************************//**
+ * Queue an IQ report for the estimation task of an estimator.
+ *****************************************************************************/
+static void enqueue_iq_report(aoa_estimator_t *estimator, aoa_codec_iq_t *iq)
+{
+  aoa_codec_iq_t *entry;
+  sl_status_t sc;
+
+  pthread_mutex_lock(&estimator->lock);
+  if (estimator->queue_count == IQ_QUEUE_SIZE) {
+    // Estimation can not keep up, drop the oldest report.
+    estimator->queue_head = (estimator->queue_head + 1) % IQ_QUEUE_SIZE;
+    estimator->queue_count--;
+    estimator->dropped++;
+  }
+  entry = &estimator->queue[(estimator->queue_head + estimator->queue_count) % IQ_QUEUE_SIZE];
+  *entry = *iq;
+  entry->report.samples = entry->samples;
+  estimator->queue_count++;
+  if (!estimator->scheduled) {
+    estimator->scheduled = true;
+    sc = work_pool_submit(&estimation_pool, &estimator->task);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to schedule estimation for %s/%s.\n",
+               (int)sc,
+               estimator->locator_id,
+               estimator->tag_id);
+  }
+  pthread_mutex_unlock(&estimator->lock);
+}
+
+/**************************************************************************//**
+ * Estimation task of an estimator, processes the queued IQ reports.
+ *****************************************************************************/
+static void process_estimator(work_pool_task_t *task)
+{
+  aoa_estimator_t *estimator = task->context;
+  aoa_codec_iq_t iq;
+  aoa_angle_t angle;
+
+  pthread_mutex_lock(&estimator->lock);
+  while (estimator->queue_count > 0) {
+    iq = estimator->queue[estimator->queue_head];
+    iq.report.samples = iq.samples;
+    estimator->queue_head = (estimator->queue_head + 1) % IQ_QUEUE_SIZE;
+    estimator->queue_count--;
+    pthread_mutex_unlock(&estimator->lock);
+    if (aoa_calculate(&estimator->aoa_states, &iq.report, &angle) == SL_STATUS_OK) {
+      publish_angle(estimator, &angle, iq.timestamp);
+    }
+    pthread_mutex_lock(&estimator->lock);
+  }
+  estimator->scheduled = false;
+  pthread_mutex_unlock(&estimator->lock);
+}
+
+/**************************************************************************//**
+ * Publish an angle on the topic of its locator, like the locator itself does.
+ *****************************************************************************/
+static void publish_angle(aoa_estimator_t *estimator, aoa_angle_t *angle, uint64_t timestamp)
+{
+  sl_status_t sc;
+  char *payload;
+  char binary[AOA_CODEC_BINARY_SIZE];
+  const char topic_template[] = AOA_TOPIC_ANGLE_PRINT;
+  char topic[sizeof(topic_template) + sizeof(aoa_id_t) + sizeof(aoa_id_t)];
+
+  snprintf(topic, sizeof(topic), topic_template, estimator->locator_id, estimator->tag_id);
+
+  // Compile payload
+  if (angle_encoding == AOA_CODEC_ENCODING_BINARY) {
+    aoa_codec_angle_to_binary(angle, timestamp, binary, sizeof(binary));
+    payload = binary;
+  } else {
+    aoa_trace_angle_to_string(angle, timestamp, &payload);
+  }
+
+  // Drops are counted by the outbox.
+  sc = aoa_outbox_publish(&outbox, topic, payload, timestamp);
+  if (sc == SL_STATUS_OK) {
+    __atomic_add_fetch(&published_count, 1, __ATOMIC_RELAXED);
+  } else if (sc != SL_STATUS_FULL) {
+    app_log("[E: 0x%04x] Failed to publish to topic '%s'.\n", (int)sc, topic);
+  }
+
+  // Clean up
+  if (payload != binary) {
+    free(payload);
+  }
+}
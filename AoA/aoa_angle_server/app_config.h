@@ -0,0 +1,61 @@
+/***************************************************************************//**
+ * @file
+ * @brief Application configuration values.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef APP_CONFIG_H
+#define APP_CONFIG_H
+
+// The antenna array and the estimator mode are configured in the
+// app_config.h of aoa_locator, shared with the locators.
+
+// Maximum number of locators handled by the application.
+#define MAX_NUM_LOCATORS        256
+
+// Maximum number of estimators, one per locator and asset tag pair. IQ reports
+// of further pairs are dropped.
+#define MAX_NUM_ESTIMATORS      4096
+
+// Initial capacity of the asset tag table of a locator, it grows on demand.
+#define INITIAL_NUM_TAGS        16
+
+// Number of angle estimation threads. Use 0 for one per processor.
+// Can be overridden with the -j command line option.
+#define ESTIMATION_THREAD_COUNT 0
+
+// Number of IQ reports an estimator can queue. The oldest report is dropped
+// on overflow.
+#define IQ_QUEUE_SIZE           4
+
+// Capacity of the outbound MQTT queue and its default overflow policy. The
+// estimation threads queue the angles, a dedicated network thread publishes
+// them. The policy can be overridden with the -o command line option.
+#define MQTT_QUEUE_SIZE         1024
+#define MQTT_OVERFLOW_POLICY    AOA_OUTBOX_DROP_OLDEST
+
+#endif // APP_CONFIG_H
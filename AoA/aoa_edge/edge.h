@@ -0,0 +1,80 @@
+/***************************************************************************//**
+ * @file
+ * @brief Combined locator and multilocator edge application.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef EDGE_H
+#define EDGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "aoa_types.h"
+
+// Multilocator part, the same as of aoa_multilocator.
+void app_init(int argc, char *argv[]);
+void app_process_action(void);
+void app_deinit(void);
+
+/***************************************************************************//**
+ * Initialize the locator part: connect to the NCP target and start the
+ * Bluetooth stack.
+ *
+ * @param[in] argc Number of the locator arguments.
+ * @param[in] argv Locator arguments, the same as of aoa_locator.
+ ******************************************************************************/
+void edge_init(int argc, char *argv[]);
+
+/***************************************************************************//**
+ * Deinitialize the locator part.
+ ******************************************************************************/
+void edge_deinit(void);
+
+/***************************************************************************//**
+ * Receive an angle of the locator running in the same process.
+ *
+ * Implemented by the multilocator part. The angle is passed to the asset tag
+ * without serialization, and the estimation runs on the worker threads.
+ *
+ * @param[in] locator_id Locator ID.
+ * @param[in] tag_id Asset tag ID.
+ * @param[in] angle Angle data.
+ * @param[in] timestamp Capture timestamp.
+ ******************************************************************************/
+void app_on_local_angle(const char *locator_id,
+                        const char *tag_id,
+                        aoa_angle_t *angle,
+                        uint64_t timestamp);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // EDGE_H
@@ -0,0 +1,93 @@
+/***************************************************************************//**
+ * @file
+ * @brief main() function.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "system.h"
+#include "app_signal.h"
+#include "app_log.h"
+#include "edge.h"
+
+#define USAGE "\nUsage: %s <aoa_multilocator arguments> -- <aoa_locator arguments>\n"
+
+// Main loop execution status.
+static volatile bool run = true;
+
+// Custom signal handler.
+static void signal_handler(int sig)
+{
+  (void)sig;
+  run = false;
+}
+
+int main(int argc, char* argv[])
+{
+  int split;
+
+  // The arguments of the locator part follow the "--" separator.
+  for (split = 1; split < argc; split++) {
+    if (strcmp(argv[split], "--") == 0) {
+      break;
+    }
+  }
+  if (split >= argc - 1) {
+    app_log(USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv[split] = argv[0];
+
+  // Set up custom signal handler for user interrupt and termination request.
+  app_signal(SIGINT, signal_handler);
+  app_signal(SIGTERM, signal_handler);
+
+  // Initialize Silicon Labs device, system, service(s) and protocol stack(s).
+  sl_system_init();
+
+  // The multilocator is ready to take angles before the locator starts.
+  app_init(split, argv);
+  optind = 1;
+  edge_init(argc - split, &argv[split]);
+
+  while (run) {
+    // Locator part, angles are handed over to the multilocator part directly.
+    sl_system_process_action();
+
+    // Multilocator part.
+    app_process_action();
+  }
+
+  // Deinitialize the application.
+  edge_deinit();
+  app_deinit();
+
+  return EXIT_SUCCESS;
+}
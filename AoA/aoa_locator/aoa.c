@@ -49,14 +49,7 @@
  **************************************************************************************************/
 float aoa_azimuth_min = AOA_AZIMUTH_MASK_MIN_DEFAULT;
 float aoa_azimuth_max = AOA_AZIMUTH_MASK_MAX_DEFAULT;
-
-/***************************************************************************************************
- * Static Variables
- **************************************************************************************************/
-static float **ref_i_samples;
-static float **ref_q_samples;
-static float **i_samples;
-static float **q_samples;
+bool aoa_log_angles = true;
 
 /***************************************************************************************************
  * Static Function Declarations
@@ -65,23 +58,20 @@ static float **q_samples;
 static enum sl_rtl_error_code aox_process_samples(aoa_libitems_t *aoa_state, aoa_iq_report_t *iq_report, float *azimuth, float *elevation, uint32_t *qa_result);
 static float calc_frequency_from_channel(uint8_t channel);
 static uint32_t allocate_2D_float_buffer(float*** buf, uint32_t rows, uint32_t cols);
-static void get_samples(aoa_iq_report_t *iq_report);
+static void free_2D_float_buffer(float** buf, uint32_t rows);
+static void get_samples(aoa_libitems_t *aoa_state, aoa_iq_report_t *iq_report);
 
 /***************************************************************************************************
  * Public Function Definitions
  **************************************************************************************************/
-void aoa_init_buffers(void)
-{
-  allocate_2D_float_buffer(&ref_i_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
-  allocate_2D_float_buffer(&ref_q_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
-
-  allocate_2D_float_buffer(&i_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
-  allocate_2D_float_buffer(&q_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
-}
-
 void aoa_init(aoa_libitems_t *aoa_state)
 {
   app_log("AoA library init...\n");
+  allocate_2D_float_buffer(&aoa_state->ref_i_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
+  allocate_2D_float_buffer(&aoa_state->ref_q_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
+
+  allocate_2D_float_buffer(&aoa_state->i_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
+  allocate_2D_float_buffer(&aoa_state->q_samples, AOA_NUM_SNAPSHOTS, AOA_NUM_ARRAY_ELEMENTS);
   // Initialize AoX library
   sl_rtl_aox_init(&aoa_state->libitem);
   // Set the number of snapshots - how many times the antennas are scanned during one measurement
@@ -128,8 +118,10 @@ sl_status_t aoa_calculate(aoa_libitems_t *aoa_state, aoa_iq_report_t *iq_report,
     // Calculate distance from RSSI, and calculate a rough position estimation
     sl_rtl_util_rssi2distance(TAG_TX_POWER, iq_report->rssi / 1.0, &angle->distance);
     sl_rtl_util_filter(&aoa_state->util_libitem, angle->distance, &angle->distance);
-    app_log("azimuth: %6.1f  \televation: %6.1f  \trssi: %6.0f  \tch: %2d  \tSequence: %5d  \tDistance: %6.3f  \tIQ sample Quality: %s\n",
-            angle->azimuth, angle->elevation, iq_report->rssi / 1.0, iq_report->channel, iq_report->event_counter, angle->distance, iq_sample_qa_string);
+    if (aoa_log_angles) {
+      app_log("azimuth: %6.1f  \televation: %6.1f  \trssi: %6.0f  \tch: %2d  \tSequence: %5d  \tDistance: %6.3f  \tIQ sample Quality: %s\n",
+              angle->azimuth, angle->elevation, iq_report->rssi / 1.0, iq_report->channel, iq_report->event_counter, angle->distance, iq_sample_qa_string);
+    }
     angle->rssi = iq_report->rssi;
     angle->channel = iq_report->channel;
     angle->sequence = iq_report->event_counter;
@@ -145,16 +137,16 @@ static enum sl_rtl_error_code aox_process_samples(aoa_libitems_t *aoa_state, aoa
 {
   float phase_rotation;
 
-  get_samples(iq_report);
+  get_samples(aoa_state, iq_report);
 
   // Calculate phase rotation from reference IQ samples
-  sl_rtl_aox_calculate_iq_sample_phase_rotation(&aoa_state->libitem, 2.0f, ref_i_samples[0], ref_q_samples[0], AOA_REF_PERIOD_SAMPLES, &phase_rotation);
+  sl_rtl_aox_calculate_iq_sample_phase_rotation(&aoa_state->libitem, 2.0f, aoa_state->ref_i_samples[0], aoa_state->ref_q_samples[0], AOA_REF_PERIOD_SAMPLES, &phase_rotation);
 
   // Provide calculated phase rotation to the estimator
   sl_rtl_aox_set_iq_sample_phase_rotation(&aoa_state->libitem, phase_rotation);
 
   // Estimate Angle of Arrival / Angle of Departure from IQ samples
-  enum sl_rtl_error_code ret = sl_rtl_aox_process(&aoa_state->libitem, i_samples, q_samples, calc_frequency_from_channel(iq_report->channel), azimuth, elevation);
+  enum sl_rtl_error_code ret = sl_rtl_aox_process(&aoa_state->libitem, aoa_state->i_samples, aoa_state->q_samples, calc_frequency_from_channel(iq_report->channel), azimuth, elevation);
 
   // fetch the quality results
   *qa_result = sl_rtl_aox_iq_sample_qa_get_results(&aoa_state->libitem);
@@ -191,6 +183,11 @@ sl_status_t aoa_deinit(aoa_libitems_t *aoa_state)
     retval = SL_STATUS_FAIL;
   }
 
+  free_2D_float_buffer(aoa_state->ref_i_samples, AOA_NUM_SNAPSHOTS);
+  free_2D_float_buffer(aoa_state->ref_q_samples, AOA_NUM_SNAPSHOTS);
+  free_2D_float_buffer(aoa_state->i_samples, AOA_NUM_SNAPSHOTS);
+  free_2D_float_buffer(aoa_state->q_samples, AOA_NUM_SNAPSHOTS);
+
   return retval;
 }
 
@@ -211,8 +208,24 @@ static uint32_t allocate_2D_float_buffer(float*** buf, uint32_t rows, uint32_t c
   return 1;
 }
 
-static void get_samples(aoa_iq_report_t *iq_report)
+static void free_2D_float_buffer(float** buf, uint32_t rows)
+{
+  if (buf == NULL) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < rows; i++) {
+    free(buf[i]);
+  }
+  free(buf);
+}
+
+static void get_samples(aoa_libitems_t *aoa_state, aoa_iq_report_t *iq_report)
 {
+  float **ref_i_samples = aoa_state->ref_i_samples;
+  float **ref_q_samples = aoa_state->ref_q_samples;
+  float **i_samples = aoa_state->i_samples;
+  float **q_samples = aoa_state->q_samples;
   uint32_t index = 0;
   // Write reference IQ samples into the IQ sample buffer (sampled on one antenna)
   for (uint32_t sample = 0; sample < AOA_REF_PERIOD_SAMPLES; ++sample) {
@@ -36,6 +36,7 @@ extern "C" {
 #endif
 
 #include <math.h>
+#include <stdbool.h>
 #include "aoa_types.h"
 #include "sl_bt_api.h"
 #include "sl_rtl_clib_api.h"
@@ -63,6 +64,11 @@ extern "C" {
 typedef struct aoa_libitems {
   sl_rtl_aox_libitem libitem;
   sl_rtl_util_libitem util_libitem;
+  // Sample buffers of the estimator, so that estimators can run in parallel.
+  float **ref_i_samples;
+  float **ref_q_samples;
+  float **i_samples;
+  float **q_samples;
 } aoa_libitems_t;
 
 /***************************************************************************************************
@@ -70,12 +76,12 @@ typedef struct aoa_libitems {
  **************************************************************************************************/
 extern float aoa_azimuth_min;
 extern float aoa_azimuth_max;
+extern bool aoa_log_angles;
 
 /***************************************************************************************************
  * Function Declarations
  **************************************************************************************************/
 
-void aoa_init_buffers(void);
 void aoa_init(aoa_libitems_t *aoa_state);
 sl_status_t aoa_calculate(aoa_libitems_t *aoa_state, aoa_iq_report_t *iq_report, aoa_angle_t *angle);
 sl_status_t aoa_deinit(aoa_libitems_t *aoa_state);
@@ -48,14 +48,33 @@
 #include "aoa_config.h"
 #include "aoa_parse.h"
 #include "aoa_util.h"
-
-#define USAGE "\nUsage: %s -t <wstk_address> | -u <serial_port> [-b <baud_rate>] [-f <flow control: 1(on, default) or 0(off)>] [-m <mqtt_address>[:<port>]] [-c <config>] [-v <verbose_level>]\n"
+#include "aoa_trace.h"
+#include "aoa_shard.h"
+#include "aoa_codec.h"
+#include "aoa_ring.h"
+#include "aoa_stream.h"
+#include "aoa_outbox.h"
+#ifdef AOA_EDGE
+#include "edge.h"
+
+// Locator part of aoa_edge: the angles are handed over to the multilocator
+// part of the process instead of being published. The multilocator part owns
+// the application entry points, the locator part is entered through edge.h.
+#define USAGE "\nUsage: %s ... -- -t <wstk_address> | -u <serial_port> [-b <baud_rate>] [-f <flow control: 1(on, default) or 0(off)>] [-c <config>] [-v <verbose_level>]\n"
+#define OPTIONS "t:u:b:f:c:v:h"
+#else
+#define USAGE "\nUsage: %s -t <wstk_address> | -u <serial_port> [-b <baud_rate>] [-f <flow control: 1(on, default) or 0(off)>] [-m <mqtt_address>[:<port>]] [-c <config>] [-v <verbose_level>] [-s <shard_count>] [-e <json|binary>] [-a <angle_ring>] [-r mqtt|<server_address>[:<port>]] [-o <drop-newest|drop-oldest|block>]\n"
+#define OPTIONS "t:u:b:m:f:i:c:v:s:e:a:r:o:h"
+#endif
 #define DEFAULT_UART_PORT             NULL
 #define DEFAULT_UART_BAUD_RATE        115200
 #define DEFAULT_UART_FLOW_CONTROL     1
 #define DEFAULT_UART_TIMEOUT          100
 #define DEFAULT_TCP_PORT              "4901"
 #define MAX_OPT_LEN                   255
+#define ANGLE_RING_RETRY_US           1000000
+#define IQ_STREAM_BUFFER_SIZE         (64 * 1024)
+#define MQTT_QUEUE_SIZE               1024
 
 SL_BT_API_DEFINE();
 
@@ -63,6 +82,8 @@ static int serial_port_init(char* uartPort, uint32_t uartBaudRate, uint32_t uart
 static void uart_tx_wrapper(uint32_t len, uint8_t *data);
 static void tcp_tx_wrapper(uint32_t len, uint8_t *data);
 static void parse_config(char *filename);
+static void push_ring_angle(aoa_id_t tag_id, aoa_angle_t *angle);
+static void forward_iq_report(aoa_id_t tag_id, aoa_iq_report_t *iq_report);
 
 // Locator ID
 static aoa_id_t locator_id;
@@ -71,21 +92,65 @@ static aoa_id_t locator_id;
 static mqtt_handle_t mqtt_handle = MQTT_DEFAULT_HANDLE;
 static char *mqtt_host = NULL;
 
+// Outbound MQTT messages, published on the network thread of the outbox.
+static aoa_outbox_t outbox;
+static aoa_outbox_policy_t outbox_policy = AOA_OUTBOX_DROP_OLDEST;
+#ifndef AOA_EDGE
+static bool outbox_started = false;
+#endif
+
 // Verbose output
 uint32_t verbose_level;
 
+// BGAPI receive time of the event being processed
+static uint64_t event_timestamp;
+
+#ifdef AOA_EDGE
+// Number of angles handed over to the multilocator part
+static uint64_t local_angle_count = 0;
+#endif
+
+// Number of multilocator shards, angles are published on the topic of the
+// shard of the tag if greater than 1.
+static uint32_t shard_count = 0;
+
+// Encoding of the published angles.
+static enum aoa_codec_encoding angle_encoding = AOA_CODEC_ENCODING_JSON;
+
+// Shared memory angle ring of a multilocator on the same host. If given, the
+// angles are pushed to the ring instead of being published.
+static char *angle_ring_name = NULL;
+static aoa_ring_t angle_ring;
+static uint64_t angle_ring_attempt = 0; // time of the last attach attempt
+static uint64_t angle_ring_checked = 0; // time of the last liveness check
+static uint64_t angle_ring_lost = 0;    // angles without an attached ring
+
+// Raw IQ report forwarding. If enabled, the IQ reports are forwarded to a
+// central angle estimation server instead of being estimated locally, either
+// published on MQTT or sent on a TCP stream.
+static char *iq_forward = NULL;
+static bool iq_stream_enabled = false;
+static aoa_stream_client_t iq_stream;
+
 static char uart_target_port[MAX_OPT_LEN]; // Serail port name of the NCP target
 static char tcp_target_address[MAX_OPT_LEN]; // IP address or host name of the NCP target using TCP connection
 
 /**************************************************************************//**
  * Application Init.
  *****************************************************************************/
+#ifdef AOA_EDGE
+void edge_init(int argc, char *argv[])
+#else
 void app_init(int argc, char *argv[])
+#endif
 {
   int opt;
   uint32_t target_baud_rate = DEFAULT_UART_BAUD_RATE;
   uint32_t target_flow_control = DEFAULT_UART_FLOW_CONTROL;
   char *port_sep;
+  char *iq_host;
+  uint16_t iq_port;
+  sl_status_t sc;
 
   uart_target_port[0] = '\0';
   tcp_target_address[0] = '\0';
@@ -93,16 +158,16 @@ void app_init(int argc, char *argv[])
   aoa_whitelist_init();
 
   //Parse command line arguments
-  while ((opt = getopt(argc, argv, "t:u:b:m:f:i:c:v:h")) != -1) {
+  while ((opt = getopt(argc, argv, OPTIONS)) != -1) {
     switch (opt) {
       case 'c':
         parse_config(optarg);
         break;
       case 'u': //Target port or address.
-        strncpy(uart_target_port, optarg, MAX_OPT_LEN);
+        strncpy(uart_target_port, optarg, MAX_OPT_LEN - 1);
         break;
       case 't': //Target TCP address
-        strncpy(tcp_target_address, optarg, MAX_OPT_LEN);
+        strncpy(tcp_target_address, optarg, MAX_OPT_LEN - 1);
         break;
       case 'f': //Target flow control
         target_flow_control = atol(optarg);
@@ -126,6 +191,27 @@ void app_init(int argc, char *argv[])
       case 'v':
         verbose_level = atol(optarg);
         break;
+      case 's': //Number of multilocator shards
+        shard_count = atol(optarg);
+        break;
+      case 'e': //Angle encoding
+        if (aoa_codec_parse_encoding(optarg, &angle_encoding) != SL_STATUS_OK) {
+          app_log(USAGE, argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'a': //Angle ring of a local multilocator
+        angle_ring_name = optarg;
+        break;
+      case 'r': //Raw IQ report forwarding
+        iq_forward = optarg;
+        break;
+      case 'o': //Overflow policy of the outbound MQTT queue
+        if (aoa_outbox_parse_policy(optarg, &outbox_policy) != SL_STATUS_OK) {
+          app_log(USAGE, argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
       case 'h': //Help!
         app_log(USAGE, argv[0]);
         exit(EXIT_SUCCESS);
@@ -135,6 +221,30 @@ void app_init(int argc, char *argv[])
     }
   }
 
+  // A ring has a single consumer, it cannot serve several shards.
+  if ((angle_ring_name != NULL) && (shard_count > 1)) {
+    app_log("The angle ring cannot be used with shards.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // The angles are estimated by the server, not by this locator.
+  if ((iq_forward != NULL) && ((angle_ring_name != NULL) || (shard_count > 1))) {
+    app_log("IQ report forwarding cannot be used with the angle ring or shards.\n");
+    exit(EXIT_FAILURE);
+  }
+  if ((iq_forward != NULL) && (strcmp(iq_forward, "mqtt") != 0)) {
+    sc = aoa_stream_parse_address(iq_forward, &iq_host, &iq_port, AOA_CODEC_IQ_PORT);
+    if (sc == SL_STATUS_OK) {
+      sc = aoa_stream_client_init(&iq_stream, iq_host, iq_port, IQ_STREAM_BUFFER_SIZE);
+      free(iq_host);
+    }
+    if (sc != SL_STATUS_OK) {
+      app_log("[E: 0x%04x] Failed to initialize IQ report stream %s\n", (int)sc, iq_forward);
+      exit(EXIT_FAILURE);
+    }
+    iq_stream_enabled = true;
+  }
+
   if (uart_target_port[0] != '\0') {
     // Initialise serial communication as non-blocking.
     SL_BT_API_INITIALIZE_NONBLOCK(uart_tx_wrapper, uartRx, uartRxPeek);
@@ -161,9 +271,6 @@ void app_init(int argc, char *argv[])
   // Once the chip successfully boots, boot event should be received.
   sl_bt_system_reset(0);
 
-  // AoA specific init
-  aoa_init_buffers();
-
   init_connection();
 }
 
@@ -176,10 +283,15 @@ void app_init(int argc, char *argv[])
 void sl_bt_on_event(sl_bt_msg_t *evt)
 {
   sl_status_t sc;
+#ifndef AOA_EDGE
   mqtt_status_t rc;
+#endif
   bd_addr address;
   uint8_t address_type;
 
+  // Capture timestamp for the IQ reports.
+  event_timestamp = aoa_trace_timestamp();
+
   // Catch boot event...
   if (SL_BT_MSG_ID(evt->header) == sl_bt_evt_system_boot_id) {
     // Print boot message.
@@ -204,23 +316,42 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
     aoa_address_to_id(address.addr, address_type, locator_id);
 
+#ifdef AOA_EDGE
+    // The multilocator configuration must contain this locator.
+    app_log("Locator ID: %s\n", locator_id);
+#else
     // Connect to the MQTT broker
     mqtt_handle.client_id = locator_id;
     mqtt_handle.on_connect = aoa_on_connect;
     rc = mqtt_init(&mqtt_handle);
     app_assert(rc == MQTT_SUCCESS, "MQTT init failed.\n");
+
+    // The IQ pipeline does not wait for the broker.
+    if (!outbox_started) {
+      sc = aoa_outbox_start(&outbox, &mqtt_handle, MQTT_QUEUE_SIZE, outbox_policy);
+      app_assert(sc == SL_STATUS_OK,
+                 "[E: 0x%04x] Failed to start MQTT outbox\n",
+                 (int)sc);
+      outbox_started = true;
+    }
+#endif
   }
   // ...then call the connection specific event handler.
   app_bt_on_event(evt);
 }
 
+#ifndef AOA_EDGE
 /**************************************************************************//**
  * Application Process Action.
  *****************************************************************************/
 void app_process_action(void)
 {
   mqtt_step(&mqtt_handle);
+  if (iq_stream_enabled) {
+    aoa_stream_client_flush(&iq_stream);
+  }
 }
+#endif
 
 /**************************************************************************//**
  * UART TX Wrapper.
@@ -297,10 +428,33 @@ uint8_t find_service_in_advertisement(uint8_t *advdata, uint8_t advlen, uint8_t
   return ret;
 }
 
+#ifdef AOA_EDGE
+void edge_deinit(void)
+#else
 void app_deinit(void)
+#endif
 {
   app_log("Shutting down.\n");
+#ifdef AOA_EDGE
+  app_log("Local angles: %llu\n", (unsigned long long)local_angle_count);
+#else
+  if (outbox_started) {
+    aoa_outbox_stop(&outbox);
+    aoa_outbox_log(&outbox);
+  }
   mqtt_deinit(&mqtt_handle);
+#endif
+  if (angle_ring_name != NULL) {
+    app_log("Angle ring: %llu angles lost without a multilocator\n",
+            (unsigned long long)angle_ring_lost);
+    aoa_ring_close(&angle_ring);
+  }
+  if (iq_stream_enabled) {
+    app_log("IQ report stream: %llu reports sent, %llu dropped\n",
+            (unsigned long long)iq_stream.sent,
+            (unsigned long long)iq_stream.dropped);
+    aoa_stream_client_deinit(&iq_stream);
+  }
   if (uart_target_port[0] != '\0') {
     uartClose();
   } else if (tcp_target_address[0] != '\0') {
@@ -315,28 +469,151 @@ void app_on_iq_report(conn_properties_t *tag, aoa_iq_report_t *iq_report)
 {
   aoa_angle_t angle;
   aoa_id_t tag_id;
-  mqtt_status_t rc;
+  sl_status_t sc;
   char *payload;
+  char binary[AOA_CODEC_BINARY_SIZE];
   const char topic_template[] = AOA_TOPIC_ANGLE_PRINT;
-  char topic[sizeof(topic_template) + sizeof(aoa_id_t) + sizeof(aoa_id_t)];
+  const char shard_template[] = AOA_SHARD_TOPIC_ANGLE_PRINT;
+  char topic[sizeof(shard_template) + sizeof(aoa_id_t) + sizeof(aoa_id_t) + 10];
+
+  aoa_address_to_id(tag->address.addr, tag->address_type, tag_id);
+  if (iq_forward != NULL) {
+    forward_iq_report(tag_id, iq_report);
+    return;
+  }
 
   if (aoa_calculate(&tag->aoa_states, iq_report, &angle) != SL_STATUS_OK) {
     return;
   }
 
+#ifdef AOA_EDGE
+  // The angle goes straight to the multilocator part, without serialization.
+  app_on_local_angle(locator_id, tag_id, &angle, event_timestamp);
+  local_angle_count++;
+  return;
+#endif
+
+  if (angle_ring_name != NULL) {
+    push_ring_angle(tag_id, &angle);
+    return;
+  }
+
   // Compile topic
-  aoa_address_to_id(tag->address.addr, tag->address_type, tag_id);
-  snprintf(topic, sizeof(topic), topic_template, locator_id, tag_id);
+  if (shard_count > 1) {
+    snprintf(topic, sizeof(topic), shard_template,
+             aoa_shard_of(tag_id, strlen(tag_id), shard_count),
+             locator_id, tag_id);
+  } else {
+    snprintf(topic, sizeof(topic), topic_template, locator_id, tag_id);
+  }
 
   // Compile payload
-  aoa_angle_to_string(&angle, &payload);
+  if (angle_encoding == AOA_CODEC_ENCODING_BINARY) {
+    aoa_codec_angle_to_binary(&angle, event_timestamp, binary, sizeof(binary));
+    payload = binary;
+  } else {
+    aoa_trace_angle_to_string(&angle, event_timestamp, &payload);
+  }
 
   // Send message
-  rc = mqtt_publish(&mqtt_handle, topic, payload);
-  app_assert(rc == MQTT_SUCCESS, "Failed to publish to topic '%s'.\n", topic);
+  // Drops are counted by the outbox.
+  sc = aoa_outbox_publish(&outbox, topic, payload, event_timestamp);
+  app_assert((sc == SL_STATUS_OK) || (sc == SL_STATUS_FULL),
+             "[E: 0x%04x] Failed to publish to topic '%s'.\n",
+             (int)sc,
+             topic);
 
   // Clean up
-  free(payload);
+  if (payload != binary) {
+    free(payload);
+  }
+}
+
+/**************************************************************************//**
+ * Push an angle to the angle ring of the local multilocator.
+ *
+ * The ring is attached on demand, and attached again when the multilocator
+ * restarts or dies. Angles are dropped while no multilocator is running.
+ *****************************************************************************/
+static void push_ring_angle(aoa_id_t tag_id, aoa_angle_t *angle)
+{
+  aoa_ring_record_t record;
+  sl_status_t sc;
+
+  // A multilocator that died cannot mark its ring inactive.
+  if (aoa_ring_active(&angle_ring)
+      && (event_timestamp - angle_ring_checked >= ANGLE_RING_RETRY_US)) {
+    angle_ring_checked = event_timestamp;
+    if (!aoa_ring_alive(&angle_ring)) {
+      app_log("Multilocator of angle ring %s is gone\n", angle_ring_name);
+    }
+  }
+  if (!aoa_ring_active(&angle_ring)) {
+    aoa_ring_close(&angle_ring);
+    if ((angle_ring_attempt != 0)
+        && (event_timestamp - angle_ring_attempt < ANGLE_RING_RETRY_US)) {
+      angle_ring_lost++;
+      return;
+    }
+    angle_ring_attempt = event_timestamp;
+    sc = aoa_ring_attach(&angle_ring, angle_ring_name);
+    if (sc != SL_STATUS_OK) {
+      if (sc != SL_STATUS_NOT_FOUND) {
+        app_log("[E: 0x%04x] Failed to attach to angle ring %s\n",
+                (int)sc,
+                angle_ring_name);
+      }
+      angle_ring_lost++;
+      return;
+    }
+    app_log("Attached to angle ring %s\n", angle_ring_name);
+    angle_ring_checked = event_timestamp;
+  }
+
+  memset(&record, 0, sizeof(record));
+  record.timestamp = event_timestamp;
+  record.angle = *angle;
+  snprintf(record.locator_id, sizeof(record.locator_id), "%s", locator_id);
+  snprintf(record.tag_id, sizeof(record.tag_id), "%s", tag_id);
+  // Overflow is counted by the ring.
+  (void)aoa_ring_push(&angle_ring, &record);
+}
+
+/**************************************************************************//**
+ * Forward an IQ report to the central angle estimation server.
+ *
+ * Reports are dropped while the stream is congested or disconnected, the
+ * server estimates the angle from the next report.
+ *****************************************************************************/
+static void forward_iq_report(aoa_id_t tag_id, aoa_iq_report_t *iq_report)
+{
+  uint8_t packed[AOA_CODEC_IQ_PACKED_SIZE];
+  char payload[AOA_CODEC_IQ_SIZE];
+  const char topic_template[] = AOA_CODEC_TOPIC_IQ_PRINT;
+  char topic[sizeof(topic_template) + sizeof(aoa_id_t) + sizeof(aoa_id_t)];
+  size_t len;
+  sl_status_t sc;
+
+  if (iq_stream_enabled) {
+    if (aoa_codec_iq_pack(iq_report, locator_id, tag_id, event_timestamp,
+                          packed, sizeof(packed), &len) == SL_STATUS_OK) {
+      // Drops are counted by the stream.
+      (void)aoa_stream_client_send(&iq_stream, packed, len);
+    }
+    return;
+  }
+
+  if (aoa_codec_iq_to_binary(iq_report, locator_id, tag_id, event_timestamp,
+                             payload, sizeof(payload)) != SL_STATUS_OK) {
+    return;
+  }
+  snprintf(topic, sizeof(topic), topic_template, locator_id, tag_id);
+  // Drops are counted by the outbox.
+  sc = aoa_outbox_publish(&outbox, topic, payload, event_timestamp);
+  app_assert((sc == SL_STATUS_OK) || (sc == SL_STATUS_FULL),
+             "[E: 0x%04x] Failed to publish to topic '%s'.\n",
+             (int)sc,
+             topic);
 }
 
 static void parse_config(char *filename)
@@ -30,36 +30,97 @@
 
 #include <unistd.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
 #include "app_log.h"
 #include "app_assert.h"
 #include "mqtt.h"
 #include "aoa_util.h"
 #include "aoa_config.h"
 #include "aoa_parse.h"
+#include "aoa_trace.h"
+#include "aoa_id_table.h"
+#include "topic_router.h"
+#include "timer_wheel.h"
+#include "work_pool.h"
+#include "priority_scheduler.h"
+#include "aoa_shard.h"
+#include "aoa_solver.h"
+#include "aoa_record.h"
+#include "aoa_filter.h"
+#include "aoa_codec.h"
+#include "aoa_geofence.h"
+#include "aoa_history.h"
+#include "aoa_snapshot.h"
+#include "aoa_query.h"
+#include "aoa_ring.h"
+#include "aoa_outbox.h"
+#include "cJSON.h"
 #include "sl_rtl_clib_api.h"
 #include "app_config.h"
 #include "app.h"
+#ifdef AOA_EDGE
+#include "edge.h"
+#endif
 
 // Check if the configuration is valid
 #if MAX_NUM_SEQUENCE_IDS > MAX_SEQUENCE_DIFF
 #warning MAX_NUM_SEQUENCE_IDS > MAX_SEQUENCE_DIFF, please check the configuration.
 #endif
+#if MAX_NUM_ZONE_LOCATORS > 32
+#error MAX_NUM_ZONE_LOCATORS exceeds the size of the locator mask.
+#endif
 
 // -----------------------------------------------------------------------------
 // Private macros
 
-#define INVALID_IDX              UINT32_MAX
+#define INVALID_IDX              AOA_ID_TABLE_INVALID
 
 #define CHECK_ERROR(x)           if ((x) != SL_RTL_ERROR_SUCCESS) return (x)
 
-#define USAGE                    "\nUsage: %s -c <config> [-m <address>[:<port>]]\n"
+#define USAGE                    "\nUsage: %s -c <config> [-m <address>[:<port>]] [-t <tag_timeout_s>] [-d <deadline_ms>] [-j <threads>] [-s <index>/<count>] [-e <rtl|native|compare>] [-r <record_file>] [-p <replay_file>] [-x <speed>] [-H <history_file>] [-q <query_socket>] [-L <shm_name>] [-a <angle_ring>] [-o <drop-newest|drop-oldest|block>]\n"
 
 #define ROUND_DIV(num, den)      (((num) + ((den) / 2)) / (den))
 
+// Sequence numbers are 16 bit long.
+#define SEQUENCE_MASK            0xFFFF
+
+// Size of the correlated angle ring. Power of 2 so that the ring index stays
+// continuous when the sequence number wraps around.
+#define SLOT_RING_SIZE           8
+#define SLOT_RING_MASK           (SLOT_RING_SIZE - 1)
+#define SLOT_INDEX(seq)          ((uint32_t)(seq) & SLOT_RING_MASK)
+
+#if MAX_NUM_SEQUENCE_IDS > SLOT_RING_SIZE
+#error MAX_NUM_SEQUENCE_IDS exceeds the size of the correlated angle ring.
+#endif
+
+// Resolution of the correlation deadlines.
+#define DEADLINE_TICK_US         1000
+
+// Longest sleep of the replay while waiting for the next message.
+#define REPLAY_POLL_US           1000
+
+// Maximum number of angles taken from the angle ring per step, so that the
+// deadlines and MQTT are served between the batches.
+#define ANGLE_RING_BATCH         64
+
+// Get the slot of an expired deadline timer.
+#define DEADLINE_TO_SLOT(timer)  ((aoa_correlated_angles_t *)((char *)(timer) - offsetof(aoa_correlated_angles_t, deadline)))
+
+// Number of zones an asset tag keeps handover votes for.
+#define MAX_NUM_ZONE_VOTES       4
+
+// Angle quantization steps.
+#define ANGLE_SCALE              100.0f  // 0.01 degree
+#define DISTANCE_SCALE           100.0f  // 1 cm
+
 enum axis_list {
   AXIS_X,
   AXIS_Y,
@@ -67,29 +128,159 @@ enum axis_list {
   AXIS_COUNT
 };
 
+enum stage_list {
+  STAGE_INGEST,    // routing, parsing and queuing of a message
+  STAGE_CORRELATE, // processing of a queued angle or an expired slot
+  STAGE_ESTIMATE,  // position estimation, part of the correlation
+  STAGE_PUBLISH,   // position publishing, part of the correlation
+  STAGE_ROUTE,     // topic matching, also counted in the ingest
+  STAGE_COUNT
+};
+
+// Priority classes of the estimation scheduler, most urgent first.
+enum priority_list {
+  PRIORITY_CRITICAL,
+  PRIORITY_NORMAL,
+  PRIORITY_LOW,
+  PRIORITY_COUNT
+};
+
+enum solver_list {
+  SOLVER_RTL,     // RTL library estimator
+  SOLVER_NATIVE,  // in-tree least-squares solver
+  SOLVER_COMPARE  // both, RTL positions are published
+};
+
 // -----------------------------------------------------------------------------
 // Private types
 
 typedef struct {
   aoa_id_t id;
   struct sl_rtl_loc_locator_item item;
+  aoa_solver_locator_t pose;
+  uint32_t zone_count;
+  uint32_t zone[MAX_NUM_LOCATOR_ZONES];         // zone list indexes
+  uint32_t zone_loc_idx[MAX_NUM_LOCATOR_ZONES]; // index in the zone
 } aoa_locator_t;
 
 typedef struct {
-  int32_t sequence;
-  int32_t num_angles;
-  aoa_angle_t angles[MAX_NUM_LOCATORS];
-  bool has_angle[MAX_NUM_LOCATORS];
+  aoa_id_t id;
+  uint32_t locator_count;
+  uint32_t locator[MAX_NUM_ZONE_LOCATORS]; // locator list indexes
+  uint32_t expected_angles_count[MAX_NUM_SEQUENCE_IDS];
+  uint32_t provisional_angles_count;
+} aoa_zone_t;
+
+typedef struct {
+  uint32_t zone;
+  uint32_t count; // angles in the current handover window
+} aoa_zone_vote_t;
+
+// Quantized angle data, only the fields used by the estimator.
+typedef struct {
+  int16_t azimuth;   // ANGLE_SCALE units
+  int16_t elevation; // ANGLE_SCALE units
+  uint16_t distance; // DISTANCE_SCALE units
+} aoa_compact_angle_t;
+
+typedef struct {
+  int32_t sequence;       // -1 if the slot is unused
+  uint32_t num_angles;
+  uint32_t locator_mask;  // bit i is set if angles[i] is valid, i is the
+                          // index of the locator in the zone of the tag
+  aoa_trace_span_t span;  // capture time range of the angles
+  uint32_t estimated_angles;     // angles in the last estimate, 0 if none
+  timer_wheel_timer_t deadline;  // deadline mode only, context is the tag
+  aoa_compact_angle_t angles[MAX_NUM_ZONE_LOCATORS];
 } aoa_correlated_angles_t;
 
+typedef struct {
+  aoa_angle_t angle;
+  uint64_t timestamp; // capture time
+  uint64_t arrival;   // arrival time on the application clock
+  uint32_t loc_idx;
+} aoa_angle_message_t;
+
+// Distance statistics of position pairs.
+typedef struct {
+  uint32_t count;
+  double sq_sum;          // sum of the squared distances
+  float max;
+} aoa_distance_stats_t;
+
+// Position solver statistics.
+typedef struct {
+  uint32_t rtl_count;
+  uint32_t native_count;
+  uint32_t native_failed; // solutions failed on ray geometry
+  uint64_t rtl_us;
+  uint64_t native_us;
+  aoa_distance_stats_t diff; // positions estimated by both solvers
+} aoa_solver_stats_t;
+
+// Position publishing policy.
+typedef struct {
+  float deadband;           // m, positions moving less are not published
+  uint64_t min_interval;    // us between published positions
+  uint64_t keepalive;       // us, position is published at least this often
+} aoa_publish_policy_t;
+
+// Published and suppressed positions, published geofence events.
+typedef struct {
+  uint32_t published;
+  uint32_t suppressed;
+  uint32_t geofence_events;
+} aoa_publish_stats_t;
+
+// Processing time of the stages.
+typedef struct {
+  uint64_t us[STAGE_COUNT];
+  uint32_t count[STAGE_COUNT];
+} aoa_stage_stats_t;
+
+// The MQTT thread owns the tag table and queues the angles of the tags. The
+// estimation task of a tag runs on one worker thread at a time, it owns the
+// rest of the tag state.
 typedef struct {
   aoa_id_t id;
-  uint32_t loc_id[MAX_NUM_LOCATORS]; // assigned by RTL lib
+  uint32_t index;                 // index in the asset tag list
+  uint32_t zone;                  // zone of the estimator, INVALID_IDX if none
+  uint32_t loc_id[MAX_NUM_ZONE_LOCATORS]; // assigned by RTL lib
   sl_rtl_loc_libitem loc;
-  sl_rtl_util_libitem filter[AXIS_COUNT];
-  aoa_correlated_angles_t correlated_angles[MAX_NUM_SEQUENCE_IDS];
+  aoa_filter_t filter;            // filter of the published position
+  aoa_filter_t prior_filter;      // filter before the last estimate
+  float prior_time_step;          // time step of the last estimate
+  aoa_correlated_angles_t correlated_angles[SLOT_RING_SIZE]; // indexed by sequence
+  int32_t newest_sequence;        // newest sequence in the ring, -1 if empty
   aoa_position_t position;
-  int32_t oldest_sequence;
+  float velocity[AXIS_COUNT];     // m/s, estimated by the filter
+  aoa_trace_span_t position_span; // capture time range of the position
+  aoa_trace_hist_t latency;       // capture-to-enqueue latency
+  aoa_solver_stats_t solver_stats;
+  aoa_stage_stats_t stage_stats;
+  aoa_distance_stats_t truth_error; // published positions with ground truth
+  aoa_position_t published;       // last published position
+  uint64_t published_time;        // 0 if nothing published yet
+  aoa_publish_stats_t publish_stats;
+  aoa_geofence_state_t geofence_state;
+  uint64_t last_seen;             // arrival time of the last angle
+  int32_t oldest_sequence;        // sequence of the last estimate, -1 if none
+  aoa_zone_vote_t zone_vote[MAX_NUM_ZONE_VOTES];
+  uint32_t zone_vote_total;       // angles in the current handover window
+  uint32_t priority;              // configured priority class
+  uint32_t effective_priority;    // adjusted to the motion, atomic access
+  uint32_t coalesced;             // estimates skipped under overload
+  uint32_t coalesced_run;         // consecutive estimates skipped
+  priority_task_t task;           // estimation task
+  pthread_mutex_t lock;           // protects the fields below
+  aoa_angle_message_t queue[ANGLE_QUEUE_SIZE];
+  uint32_t queue_head;
+  uint32_t queue_count;
+  uint32_t expired_slots;         // slots with expired deadline, bit per slot
+  uint32_t dropped;               // angles dropped on queue overflow
+  uint32_t stale;                 // angles superseded by newer ones
+  aoa_position_t truth[SLOT_RING_SIZE]; // ground truth, indexed by sequence
+  bool scheduled;                 // estimation task queued or running
 } aoa_asset_tag_t;
 
 // -----------------------------------------------------------------------------
@@ -98,32 +289,194 @@ typedef struct {
 static mqtt_handle_t mqtt_handle = MQTT_DEFAULT_HANDLE;
 
 static aoa_locator_t locator_list[MAX_NUM_LOCATORS];
-static aoa_asset_tag_t asset_tag_list[MAX_NUM_TAGS];
+
+// Asset tag table, grows on demand. Unused entries are NULL.
+static aoa_asset_tag_t **asset_tag_list = NULL;
+static uint32_t asset_tag_capacity = 0;
+
+// Stack of unused asset tag table indexes.
+static uint32_t *free_tag_list = NULL;
+static uint32_t free_tag_count = 0;
 
 static uint32_t locator_count = 0;
+
+static aoa_zone_t zone_list[MAX_NUM_ZONES];
+static uint32_t zone_count = 0;
 static uint32_t asset_tag_count = 0;
 
+// Asset tags without angles for this long are evicted, 0 disables eviction.
+static float tag_timeout = TAG_IDLE_TIMEOUT_SEC;
+static uint64_t last_eviction_check = 0;
+
+// Angle topic to locator index router.
+static topic_router_t angle_router;
+
+// Asset tags handled by this instance.
+static aoa_shard_t shard = { 0, 0 };
+
+// ID to list index lookup tables.
+static aoa_id_table_t locator_table;
+static aoa_id_table_t asset_tag_table;
+
 static aoa_id_t multilocator_id = "";
 
-static uint32_t expected_angles_count[MAX_NUM_SEQUENCE_IDS];
+// Correlation deadline, 0 selects the expected angle count based correlation.
+static uint32_t correlation_deadline_ms = CORRELATION_DEADLINE_MS;
+static timer_wheel_t deadline_wheel;
+static pthread_mutex_t deadline_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Position estimation threads.
+static uint32_t estimation_thread_count = ESTIMATION_THREAD_COUNT;
+static work_pool_t estimation_pool;
+
+// Estimation tasks are started in priority order when the workers are busy.
+static priority_scheduler_t estimation_scheduler;
+static aoa_id_table_t priority_table;   // asset tag ID to priority class
+static uint32_t default_priority = PRIORITY_NORMAL;
+static uint64_t coalesced_count = 0;    // of the removed asset tags
+static uint64_t stale_count = 0;        // of the removed asset tags
+static const char *const priority_names[PRIORITY_COUNT] = {
+  "critical",
+  "normal",
+  "low"
+};
+
+// Position solver, statistics of the removed asset tags.
+static enum solver_list solver = SOLVER_RTL;
+static aoa_solver_stats_t solver_stats;
+
+// Processing time of the MQTT thread and of the removed asset tags.
+static aoa_stage_stats_t stage_stats;
+
+// Position error of the removed asset tags.
+static aoa_distance_stats_t truth_error;
+
+// Position publishing policy, statistics of the removed asset tags.
+static aoa_publish_policy_t publish_policy = {
+  .deadband = PUBLISH_DEADBAND_M,
+  .min_interval = PUBLISH_MIN_INTERVAL_MS * 1000ULL,
+  .keepalive = PUBLISH_KEEPALIVE_MS * 1000ULL
+};
+static aoa_publish_stats_t publish_stats;
+
+// Geofences, positions are tested against them after every estimate.
+static aoa_geofence_index_t geofence_index;
+
+// Position history, written by its own thread if a history file is given.
+static aoa_history_t history;
+
+// Latest positions for the query service and the shared memory table, readers
+// never block estimation.
+static aoa_snapshot_t snapshot;
+static aoa_query_server_t query_server;
+
+// Angles of the locators running on the same host.
+static aoa_ring_t angle_ring;
+
+// Recording of the received messages.
+static aoa_record_t recording = { NULL };
+
+// Replay of a recording instead of MQTT. The application clock follows the
+// recorded arrival times from the start of the replay.
+static aoa_record_t replay = { NULL };
+static float replay_speed = REPLAY_SPEED;
+static uint64_t replay_start;       // real time of the replay start
+static uint64_t replay_time;        // application clock, atomic access
+static uint64_t replay_first;       // arrival time of the first message
+static uint64_t replay_arrival;     // arrival time of the pending message
+static const char *replay_topic;    // pending message, NULL if none
+static const char *replay_payload;
+static uint32_t replay_count = 0;   // messages replayed
+static bool replay_finished = false;
+
+// Outbound MQTT messages, published on the network thread of the outbox.
+static aoa_outbox_t outbox;
+static aoa_outbox_policy_t outbox_policy = MQTT_OVERFLOW_POLICY;
 
 // -----------------------------------------------------------------------------
 // Private function declarations
 
 static void parse_config(char *filename);
 static void on_message(mqtt_handle_t *handle, const char *topic, const char *payload);
+static void receive_message(const char *topic, const char *payload, uint64_t arrival, uint64_t capture_shift);
+static void receive_angle(uint32_t loc_idx, const char *tag_id, size_t tag_id_len, aoa_angle_t *angle, uint64_t timestamp, uint64_t arrival, uint64_t start);
+static void receive_ring_angles(void);
+static void receive_binary_angle(char *locator_id, char *tag_id, aoa_angle_t *angle, uint64_t timestamp, uint64_t start);
+static void record_binary_angle(const char *locator_id, const char *tag_id, aoa_angle_t *angle, uint64_t timestamp, uint64_t arrival);
+static uint64_t get_app_time(void);
+static void replay_step(void);
+static void log_replay(uint64_t duration);
+static void add_stage_time(aoa_stage_stats_t *stats, enum stage_list stage, uint64_t start);
+static void add_stage_stats(aoa_stage_stats_t *sum, aoa_stage_stats_t *stats);
+static void log_stage_stats(aoa_stage_stats_t *stats);
+static void log_asset_tag_state(aoa_asset_tag_t *tag);
 static void subscribe_angle(aoa_locator_t *loc);
 static void publish_position(aoa_asset_tag_t *tag);
-static enum sl_rtl_error_code run_estimation(aoa_asset_tag_t *tag, uint32_t slot);
+static uint64_t get_position_time(aoa_asset_tag_t *tag);
+static bool is_publish_due(aoa_asset_tag_t *tag, uint64_t now);
+static void parse_publish_policy(char *buffer);
+static void update_geofences(aoa_asset_tag_t *tag);
+static void leave_geofences(aoa_asset_tag_t *tag);
+static void publish_geofence_event(void *context,
+                                   const aoa_geofence_t *fence,
+                                   enum aoa_geofence_event event);
+static void parse_geofences(char *buffer);
+static void parse_point(cJSON *item, float point[3], const char *fence_id);
+static enum sl_rtl_error_code run_estimation(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot);
+static enum sl_rtl_error_code run_rtl_estimation(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot, float time_step, aoa_position_t *position);
+static enum sl_rtl_error_code run_native_estimation(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot, aoa_position_t *position);
+static float get_time_step(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot);
+static bool is_refinement(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot);
+static void filter_position(aoa_asset_tag_t *tag, float time_step);
+static void add_distance(aoa_distance_stats_t *stats, aoa_position_t *a, aoa_position_t *b);
+static void add_distance_stats(aoa_distance_stats_t *sum, aoa_distance_stats_t *stats);
+static void log_distance_stats(aoa_distance_stats_t *stats, const char *name);
+static void receive_truth(const char *tag_id, const char *payload);
+static void score_position(aoa_asset_tag_t *tag);
+static void add_solver_stats(aoa_solver_stats_t *sum, aoa_solver_stats_t *stats);
+static void log_solver_stats(aoa_solver_stats_t *stats);
+static bool estimate_position(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot, bool newest);
 static enum sl_rtl_error_code init_asset_tag(aoa_asset_tag_t *tag, aoa_id_t id);
-static uint32_t find_asset_tag(aoa_id_t id);
-static uint32_t find_locator(aoa_id_t id);
-static void init_expected_angle_counts(void);
+static void deinit_asset_tag(aoa_asset_tag_t *tag);
+static uint32_t find_asset_tag(const char *id, size_t len);
+static uint32_t add_asset_tag(const char *id, size_t len);
+static void remove_asset_tag(uint32_t tag_idx);
+static sl_status_t grow_asset_tag_list(void);
+static void evict_idle_asset_tags(void);
+static void log_asset_tag_memory(void);
+static void add_angle_route(aoa_locator_t *loc, uint32_t loc_idx);
+static void parse_zones(char *buffer);
+static uint32_t find_locator(const char *id);
+static void add_zone_locator(uint32_t zone_idx, uint32_t loc_idx);
+static void init_expected_angle_counts(aoa_zone_t *zone);
+static uint32_t select_zone(aoa_asset_tag_t *tag, uint32_t loc_idx);
+static void add_zone_vote(aoa_asset_tag_t *tag, uint32_t zone_idx);
+static void hand_over_asset_tag(aoa_asset_tag_t *tag, uint32_t zone_idx);
+static enum sl_rtl_error_code init_estimator(aoa_asset_tag_t *tag, uint32_t zone_idx);
+static void deinit_estimator(aoa_asset_tag_t *tag);
 static void init_correlated_angle_data(aoa_correlated_angles_t* angle);
-static void add_angle_data_to_tag(aoa_asset_tag_t* tag, uint32_t loc_idx, aoa_angle_t* angle);
-static int32_t find_angle_slot(aoa_correlated_angles_t* slots, int32_t sequence);
-static void update_slots(aoa_asset_tag_t* tag, aoa_angle_t* angle, int32_t slot, uint32_t loc_idx);
-static void push_completed_angle_data(aoa_asset_tag_t* tag, int32_t check_idx_from);
+static void enqueue_angle(aoa_asset_tag_t *tag, uint32_t loc_idx, aoa_angle_t *angle, uint64_t timestamp, uint64_t arrival);
+static void remove_stale_angles(aoa_asset_tag_t *tag, uint32_t loc_idx, int32_t sequence);
+static void schedule_asset_tag(aoa_asset_tag_t *tag);
+static void process_asset_tag(priority_task_t *task);
+static void update_priority(aoa_asset_tag_t *tag);
+static bool coalesce_estimate(aoa_asset_tag_t *tag, bool newest);
+static void parse_priorities(char *buffer);
+static void add_angle_data_to_tag(aoa_asset_tag_t* tag, uint32_t loc_idx, aoa_angle_t* angle, uint64_t timestamp, uint64_t arrival);
+static aoa_correlated_angles_t *get_slot(aoa_asset_tag_t* tag, uint32_t age);
+static bool is_slot_complete(aoa_asset_tag_t* tag, uint32_t age);
+static bool advance_slots(aoa_asset_tag_t* tag, int32_t sequence);
+static void update_slot(aoa_correlated_angles_t* slot, aoa_angle_t* angle, uint64_t timestamp, uint32_t loc_idx);
+static void push_completed_angle_data(aoa_asset_tag_t* tag, uint32_t check_age_from);
+static void push_deadline_angle_data(aoa_asset_tag_t* tag, aoa_correlated_angles_t* slot);
+static void on_slot_deadline(timer_wheel_timer_t *timer);
+static void close_expired_slot(aoa_asset_tag_t* tag, aoa_correlated_angles_t* slot);
+static void start_deadline(aoa_correlated_angles_t* slot, uint64_t expiry);
+static void stop_deadline(aoa_correlated_angles_t* slot);
+static bool is_deadline_running(aoa_correlated_angles_t* slot);
+static void advance_deadlines(uint64_t now);
+static void estimate_slot(aoa_asset_tag_t* tag, aoa_correlated_angles_t* slot);
+static void drop_slots(aoa_asset_tag_t* tag, uint32_t from_age);
 static int32_t sequence_diff(uint32_t old_seq, uint32_t new_seq);
 
 /**************************************************************************//**
@@ -131,13 +484,20 @@ static int32_t sequence_diff(uint32_t old_seq, uint32_t new_seq);
  *****************************************************************************/
 void app_init(int argc, char* argv[])
 {
+  sl_status_t sc;
   mqtt_status_t rc;
   int opt;
   char *port_str = NULL;
   char *config_file = NULL;
+  char *record_file = NULL;
+  char *replay_file = NULL;
+  char *history_file = NULL;
+  char *query_socket = NULL;
+  char *shm_name = NULL;
+  char *angle_ring_name = NULL;
 
   // Parse command line arguments.
-  while ((opt = getopt(argc, argv, "c:m:h")) != -1) {
+  while ((opt = getopt(argc, argv, "c:m:t:d:j:s:e:r:p:x:H:q:L:a:o:h")) != -1) {
     switch (opt) {
       // Configuration file.
       case 'c':
@@ -153,6 +513,86 @@ void app_init(int argc, char* argv[])
         }
         break;
 
+      // Asset tag idle timeout.
+      case 't':
+        tag_timeout = atof(optarg);
+        break;
+
+      // Correlation deadline.
+      case 'd':
+        correlation_deadline_ms = atoi(optarg);
+        break;
+
+      // Number of estimation threads.
+      case 'j':
+        estimation_thread_count = atoi(optarg);
+        break;
+
+      // Shard of the asset tags.
+      case 's':
+        if (aoa_shard_parse(optarg, &shard) != SL_STATUS_OK) {
+          app_log(USAGE, argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Position solver.
+      case 'e':
+        if (strcmp(optarg, "rtl") == 0) {
+          solver = SOLVER_RTL;
+        } else if (strcmp(optarg, "native") == 0) {
+          solver = SOLVER_NATIVE;
+        } else if (strcmp(optarg, "compare") == 0) {
+          solver = SOLVER_COMPARE;
+        } else {
+          app_log(USAGE, argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Record the received messages.
+      case 'r':
+        record_file = optarg;
+        break;
+
+      // Replay a recording instead of connecting to MQTT.
+      case 'p':
+        replay_file = optarg;
+        break;
+
+      // Replay speed.
+      case 'x':
+        replay_speed = atof(optarg);
+        break;
+
+      // Position history file.
+      case 'H':
+        history_file = optarg;
+        break;
+
+      // Socket of the query service.
+      case 'q':
+        query_socket = optarg;
+        break;
+
+      // Shared memory position table for local applications.
+      case 'L':
+        shm_name = optarg;
+        break;
+
+      // Shared memory angle ring of the local locators.
+      case 'a':
+        angle_ring_name = optarg;
+        break;
+
+      // Overflow policy of the outbound MQTT queue.
+      case 'o':
+        if (aoa_outbox_parse_policy(optarg, &outbox_policy) != SL_STATUS_OK) {
+          app_log(USAGE, argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
       // Help.
       case 'h':
         app_log(USAGE, argv[0]);
@@ -171,8 +611,117 @@ void app_init(int argc, char* argv[])
     exit(EXIT_FAILURE);
   }
 
+  sc = aoa_id_table_init(&asset_tag_table, INITIAL_NUM_TAGS);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to init asset tag table\n",
+             (int)sc);
+
+  sc = grow_asset_tag_list();
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to allocate asset tag list\n",
+             (int)sc);
+
   parse_config(config_file);
-  init_expected_angle_counts();
+
+  timer_wheel_init(&deadline_wheel,
+                   DEADLINE_TICK_US,
+                   aoa_trace_timestamp(),
+                   on_slot_deadline);
+  if (correlation_deadline_ms > 0) {
+    app_log("Correlation deadline: %u ms, provisional angle count: %u\n",
+            correlation_deadline_ms,
+            PROVISIONAL_NUM_ANGLES);
+  }
+
+  if (estimation_thread_count == 0) {
+    estimation_thread_count = work_pool_cpu_count();
+  }
+  sc = work_pool_init(&estimation_pool, estimation_thread_count);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to start estimation threads\n",
+             (int)sc);
+  app_log("Estimation threads: %u\n", estimation_thread_count);
+  sc = priority_scheduler_init(&estimation_scheduler,
+                               &estimation_pool,
+                               PRIORITY_COUNT,
+                               estimation_thread_count);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to init estimation scheduler\n",
+             (int)sc);
+  if (shard.count > 1) {
+    app_log("Shard %u of %u\n", shard.index, shard.count);
+  }
+  if (solver != SOLVER_RTL) {
+    app_log("Position solver: %s\n",
+            (solver == SOLVER_NATIVE) ? "native" : "compare");
+  }
+
+  if (history_file != NULL) {
+    sc = aoa_history_create(&history,
+                            history_file,
+                            HISTORY_NUM_TAGS,
+                            HISTORY_NUM_BLOCKS);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to open position history %s\n",
+               (int)sc,
+               history_file);
+    app_log("Position history: %s, %u asset tags, %u bytes each\n",
+            history_file,
+            HISTORY_NUM_TAGS,
+            HISTORY_NUM_BLOCKS * AOA_HISTORY_BLOCK_SIZE);
+  }
+
+  if (shm_name != NULL) {
+    sc = aoa_snapshot_init_shared(&snapshot, shm_name, SNAPSHOT_NUM_TAGS);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to create shared memory position table %s\n",
+               (int)sc,
+               shm_name);
+    app_log("Shared memory position table: %s, %u asset tags\n",
+            shm_name,
+            SNAPSHOT_NUM_TAGS);
+  } else if (query_socket != NULL) {
+    sc = aoa_snapshot_init(&snapshot, SNAPSHOT_NUM_TAGS);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to allocate position snapshot\n",
+               (int)sc);
+  }
+
+  if (query_socket != NULL) {
+    sc = aoa_query_start(&query_server, &snapshot, query_socket, QUERY_CELL_SIZE_M);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to start query service on %s\n",
+               (int)sc,
+               query_socket);
+    app_log("Query service: %s, %u asset tags\n", query_socket, SNAPSHOT_NUM_TAGS);
+  }
+
+  if (replay_file != NULL) {
+    sc = aoa_record_open(&replay, replay_file);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to open recording %s\n",
+               (int)sc,
+               replay_file);
+    app_log("Replaying %s at %s\n",
+            replay_file,
+            (replay_speed > 0) ? "recorded speed" : "maximum speed");
+    if (replay_speed > 0) {
+      app_log("Replay speed: %.2f\n", replay_speed);
+    }
+    replay_start = aoa_trace_timestamp();
+    __atomic_store_n(&replay_time, replay_start, __ATOMIC_RELAXED);
+    app_log("\nPress Crtl+C to quit\n\n");
+    return;
+  }
+
+  if (record_file != NULL) {
+    sc = aoa_record_create(&recording, record_file);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to create recording %s\n",
+               (int)sc,
+               record_file);
+    app_log("Recording to %s\n", record_file);
+  }
 
   mqtt_handle.on_message = on_message;
   mqtt_handle.client_id = multilocator_id;
@@ -180,10 +729,29 @@ void app_init(int argc, char* argv[])
   rc = mqtt_init(&mqtt_handle);
   app_assert(rc == MQTT_SUCCESS, "MQTT init failed.\n");
 
+  // Estimation does not wait for the broker.
+  sc = aoa_outbox_start(&outbox, &mqtt_handle, MQTT_QUEUE_SIZE, outbox_policy);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to start MQTT outbox\n",
+             (int)sc);
+  app_log("MQTT outbox: %u messages, %s on overflow\n",
+          outbox.size,
+          aoa_outbox_policy_name(outbox_policy));
+
   for (uint32_t i = 0; i < locator_count; i++) {
     subscribe_angle(&locator_list[i]);
   }
 
+  // Locators on other hosts keep publishing their angles over MQTT.
+  if (angle_ring_name != NULL) {
+    sc = aoa_ring_create(&angle_ring, angle_ring_name, ANGLE_RING_SIZE);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to create angle ring %s\n",
+               (int)sc,
+               angle_ring_name);
+    app_log("Angle ring: %s, %u angles\n", angle_ring_name, angle_ring.capacity);
+  }
+
   app_log("\nPress Crtl+C to quit\n\n");
 }
 
@@ -193,8 +761,27 @@ void app_init(int argc, char* argv[])
 void app_process_action(void)
 {
   mqtt_status_t rc;
-  rc = mqtt_step(&mqtt_handle);
-  app_assert(rc == MQTT_SUCCESS, "MQTT step failed.\n");
+  uint64_t now;
+
+  if (replay.file != NULL) {
+    replay_step();
+  } else {
+    rc = mqtt_step(&mqtt_handle);
+    app_assert(rc == MQTT_SUCCESS, "MQTT step failed.\n");
+    if (angle_ring.header != NULL) {
+      receive_ring_angles();
+    }
+  }
+
+  // Deadlines are checked at least once per step, and on every message.
+  now = get_app_time();
+  advance_deadlines(now);
+
+  if ((tag_timeout > 0)
+      && (now - last_eviction_check >= TAG_EVICTION_INTERVAL_SEC * 1000000ULL)) {
+    last_eviction_check = now;
+    evict_idle_asset_tags();
+  }
 }
 
 /**************************************************************************//**
@@ -202,7 +789,81 @@ void app_process_action(void)
  *****************************************************************************/
 void app_deinit(void)
 {
-  mqtt_deinit(&mqtt_handle);
+  uint64_t replay_end;
+
+  if (replay.file == NULL) {
+    mqtt_deinit(&mqtt_handle);
+  }
+  aoa_record_close(&recording);
+  // Finish the queued estimations before releasing the tags.
+  work_pool_log(&estimation_pool);
+  work_pool_deinit(&estimation_pool);
+  replay_end = aoa_trace_timestamp();
+  if (replay.file == NULL) {
+    aoa_outbox_stop(&outbox);
+    aoa_outbox_log(&outbox);
+  }
+  priority_scheduler_log(&estimation_scheduler, priority_names);
+  priority_scheduler_deinit(&estimation_scheduler);
+  if (history.map != NULL) {
+    aoa_history_close(&history);
+    app_log("Position history: %llu written, %llu dropped\n",
+            (unsigned long long)history.written,
+            (unsigned long long)history.dropped);
+  }
+  if (query_server.started) {
+    app_log("Query service: %llu requests\n",
+            (unsigned long long)query_server.requests);
+    aoa_query_stop(&query_server);
+  }
+  if (angle_ring.header != NULL) {
+    app_log("Angle ring: %llu angles dropped on overflow\n",
+            (unsigned long long)aoa_ring_dropped(&angle_ring));
+    aoa_ring_close(&angle_ring);
+  }
+  topic_router_deinit(&angle_router);
+
+  for (uint32_t i = 0; i < asset_tag_capacity; i++) {
+    if (asset_tag_list[i] != NULL) {
+      if (replay.file != NULL) {
+        log_asset_tag_state(asset_tag_list[i]);
+      }
+      remove_asset_tag(i);
+    }
+  }
+  aoa_id_table_deinit(&locator_table);
+  aoa_id_table_deinit(&asset_tag_table);
+  aoa_id_table_deinit(&priority_table);
+  free(asset_tag_list);
+  free(free_tag_list);
+  log_stage_stats(&stage_stats);
+  log_solver_stats(&solver_stats);
+  log_distance_stats(&truth_error, "Position error");
+  app_log("Positions: %u published, %u suppressed by the publish policy\n",
+          publish_stats.published,
+          publish_stats.suppressed);
+  if (coalesced_count > 0) {
+    app_log("Positions coalesced under overload: %llu\n",
+            (unsigned long long)coalesced_count);
+  }
+  if (stale_count > 0) {
+    app_log("Stale angles coalesced: %llu\n",
+            (unsigned long long)stale_count);
+  }
+  if (geofence_index.count > 0) {
+    app_log("Geofence events: %u\n", publish_stats.geofence_events);
+  }
+  aoa_geofence_deinit(&geofence_index);
+  if (snapshot.dropped > 0) {
+    app_log("Position snapshot: %llu writes beyond %u asset tags dropped\n",
+            (unsigned long long)snapshot.dropped,
+            snapshot.capacity);
+  }
+  aoa_snapshot_deinit(&snapshot);
+  if (replay.file != NULL) {
+    log_replay(replay_end - replay_start);
+    aoa_record_close(&replay);
+  }
 }
 
 /**************************************************************************//**
@@ -217,6 +878,16 @@ static void parse_config(char *filename)
   buffer = load_file(filename);
   app_assert(buffer != NULL, "Failed to load file: %s\n", filename);
 
+  sc = topic_router_init(&angle_router);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to init topic router\n",
+             (int)sc);
+
+  sc = aoa_id_table_init(&locator_table, MAX_NUM_LOCATORS);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to init locator table\n",
+             (int)sc);
+
   sc = aoa_parse_init(buffer);
   app_assert(sc == SL_STATUS_OK,
              "[E: 0x%04x] aoa_parse_init failed\n",
@@ -239,6 +910,13 @@ static void parse_config(char *filename)
               loc->item.orientation_x_axis_degrees,
               loc->item.orientation_y_axis_degrees,
               loc->item.orientation_z_axis_degrees);
+      aoa_solver_locator_init(&loc->pose, &loc->item);
+      sc = aoa_id_table_add(&locator_table, loc->id, strlen(loc->id), locator_count);
+      app_assert(sc == SL_STATUS_OK,
+                 "[E: 0x%04x] Failed to add locator %s\n",
+                 (int)sc,
+                 loc->id);
+      add_angle_route(loc, locator_count);
       ++locator_count;
     } else {
       app_assert(sc == SL_STATUS_NOT_FOUND,
@@ -254,6 +932,11 @@ static void parse_config(char *filename)
              "[E: 0x%04x] aoa_parse_deinit failed\n",
              (int)sc);
 
+  parse_zones(buffer);
+  parse_publish_policy(buffer);
+  parse_geofences(buffer);
+  parse_priorities(buffer);
+
   free(buffer);
 }
 
@@ -262,261 +945,1750 @@ static void parse_config(char *filename)
  *****************************************************************************/
 static void on_message(mqtt_handle_t *handle, const char *topic, const char *payload)
 {
-  int result;
-  aoa_id_t loc_id, tag_id;
-  uint32_t loc_idx, tag_idx;
-  aoa_asset_tag_t *tag;
-  aoa_angle_t angle;
-  enum sl_rtl_error_code sc;
+  sl_status_t sc;
+  uint64_t arrival = aoa_trace_timestamp();
 
   (void)handle;
 
-  // Parse topic.
-  result = sscanf(topic, AOA_TOPIC_ANGLE_SCAN, loc_id, tag_id);
-  app_assert(result == 2, "Failed to parse angle topic: %d.\n", result);
+  if (recording.file != NULL) {
+    sc = aoa_record_write(&recording, arrival, topic, payload);
+    if (sc != SL_STATUS_OK) {
+      app_log("[E: 0x%04x] Failed to record message, recording stopped.\n", (int)sc);
+      aoa_record_close(&recording);
+    }
+  }
+  receive_message(topic, payload, arrival, 0);
+}
+
+/**************************************************************************//**
+ * Process an angle message.
+ *
+ * @param[in] arrival Arrival time on the application clock.
+ * @param[in] capture_shift Added to the capture time of the angle.
+ *****************************************************************************/
+static void receive_message(const char *topic, const char *payload, uint64_t arrival, uint64_t capture_shift)
+{
+  const char *tag_id;
+  size_t tag_id_len;
+  uint32_t loc_idx;
+  aoa_angle_t angle;
+  uint64_t timestamp;
+  uint64_t start = aoa_trace_timestamp();
+  uint64_t route_start;
+
+  // Ground truth of a generated scenario.
+  if (strncmp(topic, AOA_TRACE_TOPIC_TRUTH, sizeof(AOA_TRACE_TOPIC_TRUTH) - 1) == 0) {
+    receive_truth(topic + sizeof(AOA_TRACE_TOPIC_TRUTH) - 1, payload);
+    return;
+  }
+
+  // Find locator, the rest of the topic is the asset tag ID.
+  route_start = aoa_trace_timestamp();
+  loc_idx = topic_router_match(&angle_router, topic, &tag_id);
+  add_stage_time(&stage_stats, STAGE_ROUTE, route_start);
+  if (loc_idx == TOPIC_ROUTER_NO_MATCH) {
+    app_log("Ignoring message on unknown topic '%s'.\n", topic);
+    return;
+  }
+  tag_id_len = strcspn(tag_id, "/");
+  if ((tag_id_len == 0)
+      || (tag_id[tag_id_len] != '\0')
+      || (tag_id_len >= sizeof(aoa_id_t))) {
+    app_log("Ignoring message with invalid asset tag ID '%s'.\n", topic);
+    return;
+  }
+  // Asset tags of other shards are not tracked at all.
+  if (!aoa_shard_owns(&shard, tag_id, tag_id_len)) {
+    return;
+  }
+
+  // Parse payload before allocating an asset tag for it.
+  if (aoa_codec_decode_angle(payload, &angle, &timestamp) != SL_STATUS_OK) {
+    app_log("Ignoring malformed angle on topic '%s'.\n", topic);
+    return;
+  }
+
+  if (timestamp != AOA_TRACE_TIMESTAMP_INVALID) {
+    timestamp += capture_shift;
+  }
+  receive_angle(loc_idx, tag_id, tag_id_len, &angle, timestamp, arrival, start);
+}
 
-  // Find locator.
-  loc_idx = find_locator(loc_id);
-  app_assert(loc_idx != INVALID_IDX, "Failed to find locator %s.\n", loc_id);
+/**************************************************************************//**
+ * Pass an angle of a known locator to its asset tag.
+ *
+ * @param[in] arrival Arrival time on the application clock.
+ * @param[in] start Start of the ingest stage.
+ *****************************************************************************/
+static void receive_angle(uint32_t loc_idx, const char *tag_id, size_t tag_id_len, aoa_angle_t *angle, uint64_t timestamp, uint64_t arrival, uint64_t start)
+{
+  uint32_t tag_idx;
+  aoa_asset_tag_t *tag;
 
   // Find asset tag.
-  tag_idx = find_asset_tag(tag_id);
+  tag_idx = find_asset_tag(tag_id, tag_id_len);
 
   if (tag_idx == INVALID_IDX) {
-    if (asset_tag_count < MAX_NUM_TAGS) {
-      // Add new tag
-      sc = init_asset_tag(&asset_tag_list[asset_tag_count], tag_id);
-      app_assert(sc == SL_RTL_ERROR_SUCCESS,
-                 "[E: 0x%04x] Failed to init asset tag %s.\n", sc, tag_id);
-      app_log("New tag added (%d): %s\n", asset_tag_count, tag_id);
-      tag_idx = asset_tag_count++;
-    } else {
-      app_log("Warning! Maximum number of asset tags reached: %d\n", asset_tag_count);
+    tag_idx = add_asset_tag(tag_id, tag_id_len);
+    if (tag_idx == INVALID_IDX) {
+      app_log("Warning! Failed to allocate asset tag, tag count: %d\n", asset_tag_count);
       // No further procesing possible.
       return;
     }
   }
 
   // Create shortcut.
-  tag = &asset_tag_list[tag_idx];
+  tag = asset_tag_list[tag_idx];
+  tag->last_seen = arrival;
+  advance_deadlines(arrival);
 
-  // Parse payload.
-  aoa_string_to_angle((char *)payload, &angle);
-  add_angle_data_to_tag(tag, loc_idx, &angle);
+  // The estimation runs on the worker threads.
+  enqueue_angle(tag, loc_idx, angle, timestamp, arrival);
+  add_stage_time(&stage_stats, STAGE_INGEST, start);
 }
 
 /**************************************************************************//**
- * Subscribe for angle data published by a given locator.
+ * Process the angles of the angle ring, or wait for them if there are none.
  *****************************************************************************/
-static void subscribe_angle(aoa_locator_t *loc)
+static void receive_ring_angles(void)
 {
-  const char topic_template[] = AOA_TOPIC_ANGLE_PRINT;
-  char topic[sizeof(topic_template) + sizeof(aoa_id_t) + 1];
-  mqtt_status_t rc;
+  aoa_ring_record_t record;
+  uint32_t count;
 
-  snprintf(topic, sizeof(topic), topic_template, loc->id, "#");
+  for (count = 0; count < ANGLE_RING_BATCH; count++) {
+    if (aoa_ring_pop(&angle_ring, &record) != SL_STATUS_OK) {
+      break;
+    }
+    receive_binary_angle(record.locator_id, record.tag_id, &record.angle,
+                         record.timestamp, aoa_trace_timestamp());
+  }
+  if (count == 0) {
+    aoa_ring_wait(&angle_ring, ANGLE_RING_WAIT_US);
+  }
+}
 
-  app_log("Subscribing to topic '%s'.\n", topic);
+#ifdef AOA_EDGE
+/**************************************************************************//**
+ * Receive an angle of the locator running in the same process.
+ *****************************************************************************/
+void app_on_local_angle(const char *locator_id, const char *tag_id, aoa_angle_t *angle, uint64_t timestamp)
+{
+  aoa_id_t loc_id, id;
 
-  rc = mqtt_subscribe(&mqtt_handle, topic);
-  app_assert(rc == MQTT_SUCCESS, "Failed to subscribe to topic '%s'.\n", topic);
+  strncpy(loc_id, locator_id, sizeof(loc_id) - 1);
+  loc_id[sizeof(loc_id) - 1] = '\0';
+  strncpy(id, tag_id, sizeof(id) - 1);
+  id[sizeof(id) - 1] = '\0';
+  receive_binary_angle(loc_id, id, angle, timestamp, aoa_trace_timestamp());
 }
+#endif
 
 /**************************************************************************//**
- * Publish position of a given tag.
+ * Process an angle that arrived in binary form from a local locator.
+ *
+ * Binary angles skip the topic matching and the payload decoding.
+ *
+ * @param[in] locator_id Locator ID, truncated to aoa_id_t in place.
+ * @param[in] tag_id Asset tag ID, truncated to aoa_id_t in place.
+ * @param[in] start Arrival time and start of the ingest stage.
  *****************************************************************************/
-static void publish_position(aoa_asset_tag_t *tag)
+static void receive_binary_angle(char *locator_id, char *tag_id, aoa_angle_t *angle, uint64_t timestamp, uint64_t start)
 {
-  mqtt_status_t rc;
-  char *payload;
-  const char topic_template[] = AOA_TOPIC_POSITION_PRINT;
-  char topic[sizeof(topic_template) + sizeof(aoa_id_t) + sizeof(aoa_id_t)];
+  uint32_t loc_idx;
+  size_t tag_id_len;
 
-  // Compile topic.
-  snprintf(topic, sizeof(topic), topic_template, multilocator_id, tag->id);
+  locator_id[sizeof(aoa_id_t) - 1] = '\0';
+  tag_id[sizeof(aoa_id_t) - 1] = '\0';
+  if (recording.file != NULL) {
+    record_binary_angle(locator_id, tag_id, angle, timestamp, start);
+  }
+  loc_idx = find_locator(locator_id);
+  if (loc_idx == INVALID_IDX) {
+    return;
+  }
+  tag_id_len = strlen(tag_id);
+  if ((tag_id_len == 0) || !aoa_shard_owns(&shard, tag_id, tag_id_len)) {
+    return;
+  }
+  receive_angle(loc_idx, tag_id, tag_id_len, angle, timestamp, start, start);
+}
 
-  // Compile payload.
-  aoa_position_to_string(&tag->position, &payload);
+/**************************************************************************//**
+ * Record a binary angle as if it arrived over MQTT, so that the recording can
+ * be replayed the same way.
+ *****************************************************************************/
+static void record_binary_angle(const char *locator_id, const char *tag_id, aoa_angle_t *angle, uint64_t timestamp, uint64_t arrival)
+{
+  const char topic_template[] = AOA_TOPIC_ANGLE_PRINT;
+  char topic[sizeof(topic_template) + 2 * sizeof(aoa_id_t)];
+  char payload[AOA_CODEC_BINARY_SIZE];
+  sl_status_t sc;
+
+  snprintf(topic, sizeof(topic), topic_template, locator_id, tag_id);
+  aoa_codec_angle_to_binary(angle, timestamp, payload, sizeof(payload));
+  sc = aoa_record_write(&recording, arrival, topic, payload);
+  if (sc != SL_STATUS_OK) {
+    app_log("[E: 0x%04x] Failed to record message, recording stopped.\n", (int)sc);
+    aoa_record_close(&recording);
+  }
+}
 
-  rc = mqtt_publish(&mqtt_handle, topic, payload);
-  app_assert(rc == MQTT_SUCCESS, "Failed to publish to topic '%s'.\n", topic);
+/**************************************************************************//**
+ * Store the ground truth position of an asset tag.
+ *
+ * Ground truth is only kept for the asset tags that already received angles.
+ *****************************************************************************/
+static void receive_truth(const char *tag_id, const char *payload)
+{
+  uint32_t tag_idx;
+  aoa_asset_tag_t *tag;
+  aoa_position_t truth;
 
-  // Clean up.
-  free(payload);
+  tag_idx = find_asset_tag(tag_id, strlen(tag_id));
+  if (tag_idx == INVALID_IDX) {
+    return;
+  }
+  if ((aoa_trace_string_to_truth((char *)payload, &truth) != SL_STATUS_OK)
+      || (truth.sequence < 0)) {
+    return;
+  }
+  tag = asset_tag_list[tag_idx];
+  pthread_mutex_lock(&tag->lock);
+  tag->truth[SLOT_INDEX(truth.sequence)] = truth;
+  pthread_mutex_unlock(&tag->lock);
 }
 
 /**************************************************************************//**
- * Run position estimation algorithm for a given asset tag.
+ * Get the time of the application clock.
+ *
+ * The clock follows the recorded arrival times when replaying a recording.
+ * Safe to call from the estimation threads.
  *****************************************************************************/
-static enum sl_rtl_error_code run_estimation(aoa_asset_tag_t *tag, uint32_t slot)
+static uint64_t get_app_time(void)
 {
-  enum sl_rtl_error_code sc;
-  float time_step;
+  return (replay.file != NULL)
+         ? __atomic_load_n(&replay_time, __ATOMIC_RELAXED)
+         : aoa_trace_timestamp();
+}
 
-  // Feed measurement values into RTL lib.
-  for (uint32_t i = 0; i < locator_count; i++) {
-    if (tag->correlated_angles[slot].has_angle[i]) {
-      sc = sl_rtl_loc_set_locator_measurement(&tag->loc,
-                                              tag->loc_id[i],
-                                              SL_RTL_LOC_LOCATOR_MEASUREMENT_AZIMUTH,
-                                              tag->correlated_angles[slot].angles[i].azimuth);
-      CHECK_ERROR(sc);
+/**************************************************************************//**
+ * Replay the next message of the recording when it is due.
+ *****************************************************************************/
+static void replay_step(void)
+{
+  sl_status_t sc;
+  uint64_t now, elapsed, due;
 
-      sc = sl_rtl_loc_set_locator_measurement(&tag->loc,
-                                              tag->loc_id[i],
-                                              SL_RTL_LOC_LOCATOR_MEASUREMENT_ELEVATION,
-                                              tag->correlated_angles[slot].angles[i].elevation);
-      CHECK_ERROR(sc);
+  if (replay_finished) {
+    usleep(REPLAY_POLL_US);
+    return;
+  }
+  if (replay_topic == NULL) {
+    sc = aoa_record_read(&replay, &replay_arrival, &replay_topic, &replay_payload);
+    if (sc == SL_STATUS_EMPTY) {
+      app_log("Replay finished.\n");
+      replay_finished = true;
+      // Stop the main loop as if interrupted by the user.
+      raise(SIGINT);
+      return;
+    }
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to read recording\n",
+               (int)sc);
+    if (replay_count == 0) {
+      replay_first = replay_arrival;
+    }
+  }
 
-      // Feeding RSSI distance measurement to the RTL library improves location
-      // accuracy when the measured distance is reasonably correct.
-      // If the received signal strength of the incoming signal is altered for any
-      // other reason than the distance between the TX and RX itself, it will lead
-      // to incorrect measurement and it will lead to incorrect position estimates.
-      // For this reason the RSSI distance usage is disabled by default in the
-      // multilocator case.
-      // Single locator mode however always requires the distance measurement in
-      // addition to the angle, please note the if-condition below.
-      // In case the distance estimation should be used in the  multilocator case,
-      // you can enable it by commenting out the condition.
-      if (locator_count == 1) {
-        sc = sl_rtl_loc_set_locator_measurement(&tag->loc,
-                                                tag->loc_id[i],
-                                                SL_RTL_LOC_LOCATOR_MEASUREMENT_DISTANCE,
-                                                tag->correlated_angles[slot].angles[i].distance);
-        CHECK_ERROR(sc);
-      }
+  now = aoa_trace_timestamp();
+  elapsed = replay_arrival - replay_first;
+  if (replay_speed > 0) {
+    due = replay_start + (uint64_t)((double)elapsed / replay_speed);
+    if (now < due) {
+      // Let the clock run between the messages.
+      __atomic_store_n(&replay_time,
+                       replay_start + (uint64_t)((double)(now - replay_start) * replay_speed),
+                       __ATOMIC_RELAXED);
+      usleep((due - now < REPLAY_POLL_US) ? (useconds_t)(due - now) : REPLAY_POLL_US);
+      return;
     }
   }
 
-  // Estimate the time step based on the sequence number.
-  if (sequence_diff(tag->correlated_angles[slot].sequence,
-                    tag->oldest_sequence) == INT_MAX) {
-    time_step = ESTIMATION_INTERVAL_SEC;
+  // Capture times are shifted by the delay of the replay, so that the latency
+  // includes the recorded network delay and the processing of the replay.
+  __atomic_store_n(&replay_time, replay_start + elapsed, __ATOMIC_RELAXED);
+  receive_message(replay_topic, replay_payload, replay_start + elapsed, now - replay_arrival);
+  replay_topic = NULL;
+  replay_count++;
+}
+
+/**************************************************************************//**
+ * Log the throughput of the replay.
+ *
+ * @param[in] duration Real time from the replay start until all messages were
+ *            processed.
+ *****************************************************************************/
+static void log_replay(uint64_t duration)
+{
+  double seconds = duration / 1000000.0;
+
+  if (seconds <= 0) {
+    return;
+  }
+  app_log("Replay: %u messages in %.3f s, %.1f messages/s\n",
+          replay_count,
+          seconds,
+          replay_count / seconds);
+  // Estimates include the positions suppressed by the publish policy.
+  app_log("Replay: %u positions estimated, %.1f positions/s\n",
+          stage_stats.count[STAGE_PUBLISH],
+          stage_stats.count[STAGE_PUBLISH] / seconds);
+  app_log("Replay: %u positions published, %.1f positions/s\n",
+          publish_stats.published,
+          publish_stats.published / seconds);
+}
+
+/**************************************************************************//**
+ * Add the time elapsed since start to a stage.
+ *****************************************************************************/
+static void add_stage_time(aoa_stage_stats_t *stats, enum stage_list stage, uint64_t start)
+{
+  stats->us[stage] += aoa_trace_timestamp() - start;
+  stats->count[stage]++;
+}
+
+/**************************************************************************//**
+ * Accumulate stage statistics.
+ *****************************************************************************/
+static void add_stage_stats(aoa_stage_stats_t *sum, aoa_stage_stats_t *stats)
+{
+  for (enum stage_list i = 0; i < STAGE_COUNT; i++) {
+    sum->us[i] += stats->us[i];
+    sum->count[i] += stats->count[i];
+  }
+}
+
+/**************************************************************************//**
+ * Log stage statistics.
+ *****************************************************************************/
+static void log_stage_stats(aoa_stage_stats_t *stats)
+{
+  static const char *names[STAGE_COUNT] = {
+    "ingest", "correlate", "estimate", "publish", "route"
+  };
+  uint64_t us;
+
+  for (enum stage_list i = 0; i < STAGE_COUNT; i++) {
+    if (stats->count[i] == 0) {
+      continue;
+    }
+    us = stats->us[i];
+    // Estimation and publishing are reported separately.
+    if (i == STAGE_CORRELATE) {
+      us -= stats->us[STAGE_ESTIMATE] + stats->us[STAGE_PUBLISH];
+    }
+    app_log("Stage %s: %u runs, %.3f s total, %.1f us average\n",
+            names[i],
+            stats->count[i],
+            us / 1000000.0,
+            (double)us / stats->count[i]);
+  }
+}
+
+/**************************************************************************//**
+ * Log the state of an asset tag.
+ *****************************************************************************/
+static void log_asset_tag_state(aoa_asset_tag_t *tag)
+{
+  app_log("%s: zone %s, sequence %d, %u positions, last position %.3f %.3f %.3f, velocity %.3f %.3f %.3f\n",
+          tag->id,
+          (tag->zone != INVALID_IDX) ? zone_list[tag->zone].id : "-",
+          tag->newest_sequence,
+          tag->stage_stats.count[STAGE_PUBLISH],
+          tag->position.x,
+          tag->position.y,
+          tag->position.z,
+          tag->velocity[AXIS_X],
+          tag->velocity[AXIS_Y],
+          tag->velocity[AXIS_Z]);
+}
+
+/**************************************************************************//**
+ * Subscribe for angle data published by a given locator.
+ *
+ * In shard mode, the angles that the locator publishes on the topic of the
+ * shard are received as well.
+ *****************************************************************************/
+static void subscribe_angle(aoa_locator_t *loc)
+{
+  const char topic_template[] = AOA_TOPIC_ANGLE_PRINT;
+  const char shard_template[] = AOA_SHARD_TOPIC_ANGLE_PRINT;
+  char topic[sizeof(shard_template) + sizeof(aoa_id_t) + 10];
+  mqtt_status_t rc;
+
+  snprintf(topic, sizeof(topic), topic_template, loc->id, "#");
+
+  app_log("Subscribing to topic '%s'.\n", topic);
+
+  rc = mqtt_subscribe(&mqtt_handle, topic);
+  app_assert(rc == MQTT_SUCCESS, "Failed to subscribe to topic '%s'.\n", topic);
+
+  if (shard.count > 1) {
+    snprintf(topic, sizeof(topic), shard_template, shard.index, loc->id, "#");
+
+    app_log("Subscribing to topic '%s'.\n", topic);
+
+    rc = mqtt_subscribe(&mqtt_handle, topic);
+    app_assert(rc == MQTT_SUCCESS, "Failed to subscribe to topic '%s'.\n", topic);
+  }
+}
+
+/**************************************************************************//**
+ * Publish position of a given tag if the publish policy allows it.
+ *****************************************************************************/
+static void publish_position(aoa_asset_tag_t *tag)
+{
+  sl_status_t sc;
+  char payload[AOA_CODEC_POSITION_SIZE];
+  const char topic_template[] = AOA_TOPIC_POSITION_PRINT;
+  char topic[sizeof(topic_template) + sizeof(aoa_id_t) + sizeof(aoa_id_t)];
+  // The replay clock keeps the policy independent of the replay speed.
+  uint64_t now = get_app_time();
+
+  if (!is_publish_due(tag, now)) {
+    tag->publish_stats.suppressed++;
+    return;
+  }
+  tag->published = tag->position;
+  tag->published_time = now;
+  tag->publish_stats.published++;
+
+  // The history keeps the published positions at their capture time.
+  if (history.map != NULL) {
+    aoa_history_push(&history, tag->id, get_position_time(tag), &tag->position);
+  }
+
+  // Compile topic.
+  snprintf(topic, sizeof(topic), topic_template, multilocator_id, tag->id);
+
+  // Compile payload.
+  sc = aoa_codec_position_to_string(&tag->position, &tag->position_span, payload, sizeof(payload));
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to serialize position of %s\n",
+             (int)sc,
+             tag->id);
+
+  // Replayed positions are compiled but not published.
+  if (replay.file == NULL) {
+    // Drops are counted by the outbox.
+    sc = aoa_outbox_publish(&outbox, topic, payload, tag->position_span.oldest);
+    app_assert((sc == SL_STATUS_OK) || (sc == SL_STATUS_FULL),
+               "[E: 0x%04x] Failed to publish to topic '%s'.\n",
+               (int)sc,
+               topic);
+  }
+
+  // Measure latency from the oldest contributing capture. The outbox measures
+  // it up to the hand-over to the MQTT client.
+  if (tag->position_span.oldest != AOA_TRACE_TIMESTAMP_INVALID) {
+    aoa_trace_hist_add(&tag->latency,
+                       aoa_trace_timestamp() - tag->position_span.oldest);
+  }
+}
+
+/**************************************************************************//**
+ * Get the time of the current position of an asset tag, the newest capture
+ * time of its angles if known.
+ *****************************************************************************/
+static uint64_t get_position_time(aoa_asset_tag_t *tag)
+{
+  if (tag->position_span.newest != AOA_TRACE_TIMESTAMP_INVALID) {
+    return tag->position_span.newest;
+  }
+  return aoa_trace_timestamp();
+}
+
+/**************************************************************************//**
+ * Check the publish policy for the current position of an asset tag.
+ *
+ * The first position is always published. After that, a position is
+ * published when it moved at least the dead-band since the last published one
+ * and the minimum interval has passed, or when the keep-alive interval has
+ * passed.
+ *
+ * @param[in] now Current time.
+ *****************************************************************************/
+static bool is_publish_due(aoa_asset_tag_t *tag, uint64_t now)
+{
+  uint64_t elapsed;
+  float dx, dy, dz;
+
+  if (tag->published_time == 0) {
+    return true;
+  }
+  elapsed = now - tag->published_time;
+  if ((publish_policy.keepalive > 0) && (elapsed >= publish_policy.keepalive)) {
+    return true;
+  }
+  if (elapsed < publish_policy.min_interval) {
+    return false;
+  }
+  dx = tag->position.x - tag->published.x;
+  dy = tag->position.y - tag->published.y;
+  dz = tag->position.z - tag->published.z;
+  return (dx * dx + dy * dy + dz * dz) >= publish_policy.deadband * publish_policy.deadband;
+}
+
+/**************************************************************************//**
+ * Test the current position of an asset tag against the geofences.
+ *****************************************************************************/
+static void update_geofences(aoa_asset_tag_t *tag)
+{
+  float point[AXIS_COUNT] = { tag->position.x, tag->position.y, tag->position.z };
+
+  if (geofence_index.count == 0) {
+    return;
+  }
+  aoa_geofence_update(&geofence_index,
+                      &tag->geofence_state,
+                      point,
+                      get_app_time(),
+                      publish_geofence_event,
+                      tag);
+}
+
+/**************************************************************************//**
+ * Exit all geofences of an asset tag that is about to be removed.
+ *****************************************************************************/
+static void leave_geofences(aoa_asset_tag_t *tag)
+{
+  aoa_geofence_state_t *state = &tag->geofence_state;
+
+  while (state->count > 0) {
+    state->count--;
+    publish_geofence_event(tag,
+                           &geofence_index.fences[state->inside[state->count].fence],
+                           AOA_GEOFENCE_EVENT_EXIT);
+  }
+}
+
+/**************************************************************************//**
+ * Publish a geofence event of an asset tag.
+ *
+ * @param[in] context Asset tag.
+ *****************************************************************************/
+static void publish_geofence_event(void *context,
+                                   const aoa_geofence_t *fence,
+                                   enum aoa_geofence_event event)
+{
+  aoa_asset_tag_t *tag = context;
+  sl_status_t sc;
+  const char topic_template[] = AOA_GEOFENCE_TOPIC_EVENT_PRINT;
+  char topic[sizeof(topic_template) + 3 * sizeof(aoa_id_t)];
+  char payload[AOA_CODEC_POSITION_SIZE];
+
+  tag->publish_stats.geofence_events++;
+  if (replay.file != NULL) {
+    return;
+  }
+
+  snprintf(topic, sizeof(topic), topic_template, multilocator_id, fence->id, tag->id);
+  snprintf(payload,
+           sizeof(payload),
+           "{\"event\":\"%s\",\"x\":%.3f,\"y\":%.3f,\"z\":%.3f,\"sequence\":%d}",
+           aoa_geofence_event_name(event),
+           tag->position.x,
+           tag->position.y,
+           tag->position.z,
+           (int)tag->position.sequence);
+
+  // Drops are counted by the outbox.
+  sc = aoa_outbox_publish(&outbox, topic, payload, tag->position_span.oldest);
+  app_assert((sc == SL_STATUS_OK) || (sc == SL_STATUS_FULL),
+             "[E: 0x%04x] Failed to publish to topic '%s'.\n",
+             (int)sc,
+             topic);
+}
+
+/**************************************************************************//**
+ * Run position estimation algorithm for a given asset tag.
+ *
+ * The RTL tracker cannot take back the measurement of a provisional estimate,
+ * so refinements of a sequence are solved by the stateless native solver.
+ *
+ * @return SL_RTL_ERROR_INCORRECT_MEASUREMENT if the native solver is used and
+ * the rays do not determine the position.
+ *****************************************************************************/
+static enum sl_rtl_error_code run_estimation(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot)
+{
+  enum sl_rtl_error_code sc = SL_RTL_ERROR_SUCCESS;
+  aoa_position_t native;
+  uint64_t start;
+  bool refinement = is_refinement(tag, slot);
+  float time_step = get_time_step(tag, slot);
+
+  tag->position_span = slot->span;
+
+  if ((solver != SOLVER_NATIVE) && !refinement) {
+    start = aoa_trace_timestamp();
+    sc = run_rtl_estimation(tag, slot, time_step, &tag->position);
+    tag->solver_stats.rtl_us += aoa_trace_timestamp() - start;
+    tag->solver_stats.rtl_count++;
+  }
+  if (((solver != SOLVER_RTL) || refinement) && (sc == SL_RTL_ERROR_SUCCESS)) {
+    start = aoa_trace_timestamp();
+    sc = run_native_estimation(tag, slot, &native);
+    tag->solver_stats.native_us += aoa_trace_timestamp() - start;
+    tag->solver_stats.native_count++;
+    if (sc != SL_RTL_ERROR_SUCCESS) {
+      tag->solver_stats.native_failed++;
+    }
+    if ((solver == SOLVER_NATIVE) || refinement) {
+      tag->position = native;
+    } else if (sc == SL_RTL_ERROR_SUCCESS) {
+      add_distance(&tag->solver_stats.diff, &tag->position, &native);
+    } else {
+      // The RTL estimate is still valid.
+      sc = SL_RTL_ERROR_SUCCESS;
+    }
+  }
+  tag->position.sequence = slot->sequence;
+  tag->oldest_sequence = slot->sequence;
+  CHECK_ERROR(sc);
+
+  // Apply filter on the result.
+  filter_position(tag, time_step);
+
+  return SL_RTL_ERROR_SUCCESS;
+}
+
+/**************************************************************************//**
+ * Check if an estimate refines the provisional estimate of the same sequence.
+ *****************************************************************************/
+static bool is_refinement(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot)
+{
+  return sequence_diff(slot->sequence, tag->oldest_sequence) == 0;
+}
+
+/**************************************************************************//**
+ * Get the time elapsed since the previous estimate of an asset tag.
+ *
+ * Refining a provisional estimate of the same sequence results in zero time
+ * step. Otherwise the capture times of the estimates are used if known, and
+ * the sequence numbers if not.
+ *****************************************************************************/
+static float get_time_step(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot)
+{
+  int32_t diff = sequence_diff(slot->sequence, tag->oldest_sequence);
+  uint64_t oldest = tag->position_span.oldest;
+
+  if (diff == INT_MAX) {
+    return ESTIMATION_INTERVAL_SEC;
+  }
+  if (is_refinement(tag, slot)) {
+    return 0;
+  }
+  // Capture times of a replay are shifted to the replay clock, which does not
+  // follow the recorded times when replaying as fast as possible.
+  if ((slot->span.oldest != AOA_TRACE_TIMESTAMP_INVALID)
+      && (oldest != AOA_TRACE_TIMESTAMP_INVALID)
+      && (slot->span.oldest > oldest)
+      && ((replay.file == NULL) || (replay_speed > 0))) {
+    return (float)((double)(slot->span.oldest - oldest) / 1000000.0
+                   * ((replay.file == NULL) ? 1.0 : replay_speed));
+  }
+  return abs(diff) * ESTIMATION_INTERVAL_SEC;
+}
+
+/**************************************************************************//**
+ * Filter the estimated position of an asset tag.
+ *
+ * A refined estimate replaces the measurement of the provisional one: the
+ * update is repeated from the filter state before the provisional estimate,
+ * so that the sequence is not counted twice.
+ *
+ * @param[in] time_step Time since the previous estimate in seconds, zero when
+ *            refining a provisional estimate.
+ *****************************************************************************/
+static void filter_position(aoa_asset_tag_t *tag, float time_step)
+{
+  float measurement[AXIS_COUNT] = {
+    tag->position.x, tag->position.y, tag->position.z
+  };
+
+  if (time_step == 0) {
+    tag->filter = tag->prior_filter;
+    time_step = tag->prior_time_step;
   } else {
-    time_step = abs(sequence_diff(tag->correlated_angles[slot].sequence,
-                                  tag->oldest_sequence)) * ESTIMATION_INTERVAL_SEC;
+    tag->prior_filter = tag->filter;
+    tag->prior_time_step = time_step;
+  }
+  aoa_filter_update(&tag->filter, measurement, time_step);
+  tag->position.x = tag->filter.position[AXIS_X];
+  tag->position.y = tag->filter.position[AXIS_Y];
+  tag->position.z = tag->filter.position[AXIS_Z];
+  memcpy(tag->velocity, tag->filter.velocity, sizeof(tag->velocity));
+  update_priority(tag);
+}
+
+/**************************************************************************//**
+ * Adjust the priority class of an asset tag to its filtered speed.
+ *
+ * Moving asset tags are promoted by one class, stationary ones are demoted by
+ * one class.
+ *****************************************************************************/
+static void update_priority(aoa_asset_tag_t *tag)
+{
+  float speed = sqrtf(tag->velocity[AXIS_X] * tag->velocity[AXIS_X]
+                      + tag->velocity[AXIS_Y] * tag->velocity[AXIS_Y]
+                      + tag->velocity[AXIS_Z] * tag->velocity[AXIS_Z]);
+  uint32_t priority = tag->priority;
+
+  if ((speed >= PRIORITY_MOVING_SPEED_M_S) && (priority > PRIORITY_CRITICAL)) {
+    priority--;
+  } else if ((speed < PRIORITY_STATIONARY_SPEED_M_S) && (priority < PRIORITY_LOW)) {
+    priority++;
+  }
+  __atomic_store_n(&tag->effective_priority, priority, __ATOMIC_RELAXED);
+}
+
+/**************************************************************************//**
+ * Check if the estimate of an asset tag should be skipped.
+ *
+ * Under overload, the lowest priority class only estimates the newest of its
+ * sequences: a sequence is skipped if angles of the tag are already waiting.
+ * After PRIORITY_MAX_COALESCED sequences skipped in a row, the newest complete
+ * sequence is estimated regardless, so that the tag keeps being estimated
+ * under sustained overload. Replays wait for the estimation instead, like they
+ * do on queue overflow.
+ *
+ * @param[in] tag Asset tag.
+ * @param[in] newest true if no younger sequence of the tag is complete.
+ *****************************************************************************/
+static bool coalesce_estimate(aoa_asset_tag_t *tag, bool newest)
+{
+  bool waiting;
+
+  if ((replay.file != NULL)
+      || (__atomic_load_n(&tag->effective_priority, __ATOMIC_RELAXED) != PRIORITY_LOW)
+      || (priority_scheduler_backlog(&estimation_scheduler) == 0)) {
+    return false;
+  }
+  if (tag->coalesced_run >= PRIORITY_MAX_COALESCED) {
+    return !newest;
+  }
+  pthread_mutex_lock(&tag->lock);
+  waiting = (tag->queue_count > 0);
+  pthread_mutex_unlock(&tag->lock);
+  return waiting;
+}
+
+/**************************************************************************//**
+ * Estimate the position of an asset tag with the RTL library.
+ *****************************************************************************/
+static enum sl_rtl_error_code run_rtl_estimation(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot, float time_step, aoa_position_t *position)
+{
+  enum sl_rtl_error_code sc;
+  aoa_zone_t *zone = &zone_list[tag->zone];
+
+  // Feed measurement values into RTL lib.
+  for (uint32_t i = 0; i < zone->locator_count; i++) {
+    if (slot->locator_mask & (1u << i)) {
+      sc = sl_rtl_loc_set_locator_measurement(&tag->loc,
+                                              tag->loc_id[i],
+                                              SL_RTL_LOC_LOCATOR_MEASUREMENT_AZIMUTH,
+                                              slot->angles[i].azimuth / ANGLE_SCALE);
+      CHECK_ERROR(sc);
+
+      sc = sl_rtl_loc_set_locator_measurement(&tag->loc,
+                                              tag->loc_id[i],
+                                              SL_RTL_LOC_LOCATOR_MEASUREMENT_ELEVATION,
+                                              slot->angles[i].elevation / ANGLE_SCALE);
+      CHECK_ERROR(sc);
+
+      // Feeding RSSI distance measurement to the RTL library improves location
+      // accuracy when the measured distance is reasonably correct.
+      // If the received signal strength of the incoming signal is altered for any
+      // other reason than the distance between the TX and RX itself, it will lead
+      // to incorrect measurement and it will lead to incorrect position estimates.
+      // For this reason the RSSI distance usage is disabled by default in the
+      // multilocator case.
+      // Single locator mode however always requires the distance measurement in
+      // addition to the angle, please note the if-condition below.
+      // In case the distance estimation should be used in the  multilocator case,
+      // you can enable it by commenting out the condition.
+      if (zone->locator_count == 1) {
+        sc = sl_rtl_loc_set_locator_measurement(&tag->loc,
+                                                tag->loc_id[i],
+                                                SL_RTL_LOC_LOCATOR_MEASUREMENT_DISTANCE,
+                                                slot->angles[i].distance / DISTANCE_SCALE);
+        CHECK_ERROR(sc);
+      }
+    }
+  }
+
+  // Process new measurements, time step given in seconds.
+  sc = sl_rtl_loc_process(&tag->loc, time_step);
+  CHECK_ERROR(sc);
+
+  // Get results from the estimator.
+  sc = sl_rtl_loc_get_result(&tag->loc, SL_RTL_LOC_RESULT_POSITION_X, &position->x);
+  CHECK_ERROR(sc);
+  sc = sl_rtl_loc_get_result(&tag->loc, SL_RTL_LOC_RESULT_POSITION_Y, &position->y);
+  CHECK_ERROR(sc);
+  sc = sl_rtl_loc_get_result(&tag->loc, SL_RTL_LOC_RESULT_POSITION_Z, &position->z);
+  CHECK_ERROR(sc);
+
+  // Clear measurements.
+  sc = sl_rtl_loc_clear_measurements(&tag->loc);
+  CHECK_ERROR(sc);
+
+  return SL_RTL_ERROR_SUCCESS;
+}
+
+/**************************************************************************//**
+ * Estimate the position of an asset tag with the in-tree solver.
+ *
+ * The position is the weighted least-squares intersection of the angle rays,
+ * the rays of the closer locators weigh more. A single locator zone places the
+ * position on the ray at the measured distance.
+ *
+ * @return SL_RTL_ERROR_INCORRECT_MEASUREMENT if the rays do not determine the
+ * position.
+ *****************************************************************************/
+static enum sl_rtl_error_code run_native_estimation(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot, aoa_position_t *position)
+{
+  aoa_zone_t *zone = &zone_list[tag->zone];
+  aoa_solver_locator_t *pose;
+  aoa_solver_problem_t problem;
+  float direction[3];
+  float distance;
+  float result[3];
+
+  if (zone->locator_count == 1) {
+    pose = &locator_list[zone->locator[0]].pose;
+    aoa_solver_direction(pose,
+                         slot->angles[0].azimuth / ANGLE_SCALE,
+                         slot->angles[0].elevation / ANGLE_SCALE,
+                         direction);
+    distance = slot->angles[0].distance / DISTANCE_SCALE;
+    position->x = pose->origin[AXIS_X] + distance * direction[AXIS_X];
+    position->y = pose->origin[AXIS_Y] + distance * direction[AXIS_Y];
+    position->z = pose->origin[AXIS_Z] + distance * direction[AXIS_Z];
+    return SL_RTL_ERROR_SUCCESS;
+  }
+
+  aoa_solver_init(&problem);
+  for (uint32_t i = 0; i < zone->locator_count; i++) {
+    if (slot->locator_mask & (1u << i)) {
+      aoa_solver_add_ray(&problem,
+                         &locator_list[zone->locator[i]].pose,
+                         slot->angles[i].azimuth / ANGLE_SCALE,
+                         slot->angles[i].elevation / ANGLE_SCALE,
+                         aoa_solver_ray_weight(slot->angles[i].distance / DISTANCE_SCALE));
+    }
+  }
+  aoa_solver_solve(&problem, result);
+  if (isnan(result[AXIS_X])) {
+    return SL_RTL_ERROR_INCORRECT_MEASUREMENT;
+  }
+  position->x = result[AXIS_X];
+  position->y = result[AXIS_Y];
+  position->z = result[AXIS_Z];
+
+  return SL_RTL_ERROR_SUCCESS;
+}
+
+/**************************************************************************//**
+ * Add the distance of two positions to the statistics.
+ *****************************************************************************/
+static void add_distance(aoa_distance_stats_t *stats, aoa_position_t *a, aoa_position_t *b)
+{
+  float dx = a->x - b->x;
+  float dy = a->y - b->y;
+  float dz = a->z - b->z;
+  float sq = dx * dx + dy * dy + dz * dz;
+
+  stats->count++;
+  stats->sq_sum += sq;
+  if (sq > stats->max * stats->max) {
+    stats->max = sqrtf(sq);
+  }
+}
+
+/**************************************************************************//**
+ * Accumulate distance statistics.
+ *****************************************************************************/
+static void add_distance_stats(aoa_distance_stats_t *sum, aoa_distance_stats_t *stats)
+{
+  sum->count += stats->count;
+  sum->sq_sum += stats->sq_sum;
+  if (stats->max > sum->max) {
+    sum->max = stats->max;
+  }
+}
+
+/**************************************************************************//**
+ * Log distance statistics.
+ *****************************************************************************/
+static void log_distance_stats(aoa_distance_stats_t *stats, const char *name)
+{
+  if (stats->count > 0) {
+    app_log("%s: %u positions, %.3f m RMS, %.3f m max\n",
+            name,
+            stats->count,
+            sqrt(stats->sq_sum / stats->count),
+            stats->max);
+  }
+}
+
+/**************************************************************************//**
+ * Accumulate position solver statistics.
+ *****************************************************************************/
+static void add_solver_stats(aoa_solver_stats_t *sum, aoa_solver_stats_t *stats)
+{
+  sum->rtl_count += stats->rtl_count;
+  sum->native_count += stats->native_count;
+  sum->native_failed += stats->native_failed;
+  sum->rtl_us += stats->rtl_us;
+  sum->native_us += stats->native_us;
+  add_distance_stats(&sum->diff, &stats->diff);
+}
+
+/**************************************************************************//**
+ * Log position solver statistics.
+ *****************************************************************************/
+static void log_solver_stats(aoa_solver_stats_t *stats)
+{
+  if (stats->rtl_count > 0) {
+    app_log("RTL solver: %u estimates, %.1f us average\n",
+            stats->rtl_count,
+            (double)stats->rtl_us / stats->rtl_count);
+  }
+  if (stats->native_count > 0) {
+    app_log("Native solver: %u estimates, %u failed, %.1f us average\n",
+            stats->native_count,
+            stats->native_failed,
+            (double)stats->native_us / stats->native_count);
+  }
+  log_distance_stats(&stats->diff, "Solver difference");
+}
+
+/**************************************************************************//**
+ * Estimate and publish the position of an asset tag from a slot.
+ *
+ * Nothing is published if the angles of the slot do not determine the
+ * position.
+ *
+ * @param[in] tag Asset tag.
+ * @param[in] slot Slot to estimate.
+ * @param[in] newest true if no younger slot of the tag is complete.
+ *
+ * @return false if the estimate was skipped under overload.
+ *****************************************************************************/
+static bool estimate_position(aoa_asset_tag_t *tag, aoa_correlated_angles_t *slot, bool newest)
+{
+  enum sl_rtl_error_code sc;
+  uint64_t start = aoa_trace_timestamp();
+  bool native;
+
+  if (coalesce_estimate(tag, newest)) {
+    tag->coalesced++;
+    tag->coalesced_run++;
+    return false;
+  }
+  tag->coalesced_run = 0;
+  native = (solver == SOLVER_NATIVE) || is_refinement(tag, slot);
+  sc = run_estimation(tag, slot);
+  add_stage_time(&tag->stage_stats, STAGE_ESTIMATE, start);
+  if (native && (sc == SL_RTL_ERROR_INCORRECT_MEASUREMENT)) {
+    return true;
+  }
+  app_assert(sc == SL_RTL_ERROR_SUCCESS,
+             "[E: 0x%04x] Position estimation failed for %s.\n", sc, tag->id);
+  start = aoa_trace_timestamp();
+  aoa_snapshot_write(&snapshot, tag->index, tag->id, &tag->position, get_position_time(tag));
+  publish_position(tag);
+  update_geofences(tag);
+  add_stage_time(&tag->stage_stats, STAGE_PUBLISH, start);
+  score_position(tag);
+  return true;
+}
+
+/**************************************************************************//**
+ * Add the error of the published position to the statistics if the ground
+ * truth of its sequence is known.
+ *****************************************************************************/
+static void score_position(aoa_asset_tag_t *tag)
+{
+  aoa_position_t truth;
+
+  pthread_mutex_lock(&tag->lock);
+  truth = tag->truth[SLOT_INDEX(tag->position.sequence)];
+  pthread_mutex_unlock(&tag->lock);
+
+  if (truth.sequence == tag->position.sequence) {
+    add_distance(&tag->truth_error, &tag->position, &truth);
+  }
+}
+
+/**************************************************************************//**
+ * Initialise a new asset tag.
+ *****************************************************************************/
+static enum sl_rtl_error_code init_asset_tag(aoa_asset_tag_t *tag, aoa_id_t id)
+{
+  aoa_id_copy(tag->id, id);
+  memset(&tag->latency, 0, sizeof(tag->latency));
+  memset(&tag->solver_stats, 0, sizeof(tag->solver_stats));
+  memset(&tag->stage_stats, 0, sizeof(tag->stage_stats));
+  memset(&tag->truth_error, 0, sizeof(tag->truth_error));
+  memset(&tag->publish_stats, 0, sizeof(tag->publish_stats));
+  memset(&tag->geofence_state, 0, sizeof(tag->geofence_state));
+  tag->published_time = 0;
+  for (uint32_t i = 0; i < SLOT_RING_SIZE; i++) {
+    tag->truth[i].sequence = -1;
+  }
+  tag->task.function = process_asset_tag;
+  tag->task.context = tag;
+  tag->priority = aoa_id_table_find(&priority_table, id, strlen(id));
+  if (tag->priority == INVALID_IDX) {
+    tag->priority = default_priority;
+  }
+  tag->effective_priority = tag->priority;
+  tag->coalesced = 0;
+  tag->coalesced_run = 0;
+  pthread_mutex_init(&tag->lock, NULL);
+  tag->queue_head = 0;
+  tag->queue_count = 0;
+  tag->expired_slots = 0;
+  tag->dropped = 0;
+  tag->stale = 0;
+  tag->scheduled = false;
+  tag->newest_sequence = -1;
+  tag->oldest_sequence = -1;
+
+  // The position estimator is created for the zone of the first angle.
+  tag->zone = INVALID_IDX;
+  memset(tag->zone_vote, 0, sizeof(tag->zone_vote));
+  tag->zone_vote_total = 0;
+
+  for (uint32_t i = 0; i < SLOT_RING_SIZE; i++) {
+    timer_wheel_timer_init(&tag->correlated_angles[i].deadline, tag);
+    init_correlated_angle_data(&tag->correlated_angles[i]);
+  }
+
+  // The filter starts from the first estimated position.
+  aoa_filter_init(&tag->filter, FILTER_ACCELERATION_NOISE, FILTER_MEASUREMENT_NOISE);
+  tag->prior_filter = tag->filter;
+  tag->prior_time_step = ESTIMATION_INTERVAL_SEC;
+  memset(tag->velocity, 0, sizeof(tag->velocity));
+
+  return SL_RTL_ERROR_SUCCESS;
+}
+
+/**************************************************************************//**
+ * Release resources of an asset tag.
+ *****************************************************************************/
+static void deinit_asset_tag(aoa_asset_tag_t *tag)
+{
+  for (uint32_t i = 0; i < SLOT_RING_SIZE; i++) {
+    stop_deadline(&tag->correlated_angles[i]);
+  }
+  pthread_mutex_destroy(&tag->lock);
+  deinit_estimator(tag);
+}
+
+/**************************************************************************//**
+ * Create the position estimator of an asset tag for the locators of a zone.
+ *****************************************************************************/
+static enum sl_rtl_error_code init_estimator(aoa_asset_tag_t *tag, uint32_t zone_idx)
+{
+  enum sl_rtl_error_code sc;
+  aoa_zone_t *zone = &zone_list[zone_idx];
+
+  // The native solver uses the locator poses only.
+  if (solver == SOLVER_NATIVE) {
+    tag->zone = zone_idx;
+    return SL_RTL_ERROR_SUCCESS;
+  }
+
+  // Initialize RTL library
+  sc = sl_rtl_loc_init(&tag->loc);
+  CHECK_ERROR(sc);
+  tag->zone = zone_idx;
+
+  // Select estimation mode.
+  sc = sl_rtl_loc_set_mode(&tag->loc, ESTIMATION_MODE);
+  CHECK_ERROR(sc);
+
+  // Provide locator configurations to the position estimator.
+  for (uint32_t i = 0; i < zone->locator_count; i++) {
+    sc = sl_rtl_loc_add_locator(&tag->loc,
+                                &locator_list[zone->locator[i]].item,
+                                &tag->loc_id[i]);
+    CHECK_ERROR(sc);
+  }
+
+  // Create position estimator.
+  sc = sl_rtl_loc_create_position_estimator(&tag->loc);
+  CHECK_ERROR(sc);
+
+  return SL_RTL_ERROR_SUCCESS;
+}
+
+/**************************************************************************//**
+ * Release the position estimator of an asset tag.
+ *****************************************************************************/
+static void deinit_estimator(aoa_asset_tag_t *tag)
+{
+  enum sl_rtl_error_code sc;
+
+  if (tag->zone == INVALID_IDX) {
+    return;
+  }
+  if (solver != SOLVER_NATIVE) {
+    sc = sl_rtl_loc_deinit(&tag->loc);
+    if (sc != SL_RTL_ERROR_SUCCESS) {
+      app_log("[E: 0x%04x] Failed to deinit estimator of %s.\n", sc, tag->id);
+    }
+  }
+  tag->zone = INVALID_IDX;
+}
+
+/**************************************************************************//**
+ * Find asset tag in the local list based on its ID.
+ *****************************************************************************/
+static uint32_t find_asset_tag(const char *id, size_t len)
+{
+  return aoa_id_table_find(&asset_tag_table, id, len);
+}
+
+/**************************************************************************//**
+ * Add new asset tag to the local list.
+ *
+ * @return Index of the new asset tag or INVALID_IDX on allocation failure.
+ *****************************************************************************/
+static uint32_t add_asset_tag(const char *id, size_t len)
+{
+  aoa_asset_tag_t *tag;
+  aoa_id_t tag_id;
+  uint32_t tag_idx;
+  enum sl_rtl_error_code sc;
+  sl_status_t status;
+
+  if ((free_tag_count == 0) && (grow_asset_tag_list() != SL_STATUS_OK)) {
+    return INVALID_IDX;
+  }
+  tag = malloc(sizeof(aoa_asset_tag_t));
+  if (tag == NULL) {
+    return INVALID_IDX;
+  }
+  tag_idx = free_tag_list[--free_tag_count];
+
+  memcpy(tag_id, id, len);
+  tag_id[len] = '\0';
+  sc = init_asset_tag(tag, tag_id);
+  app_assert(sc == SL_RTL_ERROR_SUCCESS,
+             "[E: 0x%04x] Failed to init asset tag %s.\n", sc, tag_id);
+  status = aoa_id_table_add(&asset_tag_table, id, len, tag_idx);
+  app_assert(status == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to add asset tag %s.\n", (int)status, tag_id);
+
+  tag->index = tag_idx;
+  asset_tag_list[tag_idx] = tag;
+  asset_tag_count++;
+  app_log("New tag added (%d): %s\n", tag_idx, tag_id);
+  if ((snapshot.capacity > 0) && (tag_idx >= snapshot.capacity)) {
+    app_log("Asset tag %s is beyond the %u asset tags of the position snapshot\n",
+            tag_id,
+            snapshot.capacity);
+  }
+  log_asset_tag_memory();
+
+  return tag_idx;
+}
+
+/**************************************************************************//**
+ * Remove asset tag from the local list and release its resources.
+ *****************************************************************************/
+static void remove_asset_tag(uint32_t tag_idx)
+{
+  aoa_asset_tag_t *tag = asset_tag_list[tag_idx];
+  char name[sizeof(aoa_id_t) + sizeof(" capture to enqueue")];
+
+  snprintf(name, sizeof(name), "%s capture to enqueue", tag->id);
+  aoa_trace_hist_log(&tag->latency, name);
+  add_solver_stats(&solver_stats, &tag->solver_stats);
+  add_stage_stats(&stage_stats, &tag->stage_stats);
+  add_distance_stats(&truth_error, &tag->truth_error);
+  coalesced_count += tag->coalesced;
+  stale_count += tag->stale;
+  publish_stats.published += tag->publish_stats.published;
+  publish_stats.suppressed += tag->publish_stats.suppressed;
+  publish_stats.geofence_events += tag->publish_stats.geofence_events;
+  if (tag->dropped > 0) {
+    app_log("%s: %u angles dropped on queue overflow\n", tag->id, tag->dropped);
+  }
+  if (tag->stale > 0) {
+    app_log("%s: %u stale angles coalesced\n", tag->id, tag->stale);
+  }
+  aoa_id_table_remove(&asset_tag_table, tag->id, strlen(tag->id));
+  aoa_snapshot_clear(&snapshot, tag_idx);
+  deinit_asset_tag(tag);
+  free(tag);
+
+  asset_tag_list[tag_idx] = NULL;
+  free_tag_list[free_tag_count++] = tag_idx;
+  asset_tag_count--;
+}
+
+/**************************************************************************//**
+ * Double the capacity of the asset tag list.
+ *
+ * The list and the free index list are allocated before either is replaced,
+ * so that both keep the same capacity when an allocation fails.
+ *****************************************************************************/
+static sl_status_t grow_asset_tag_list(void)
+{
+  aoa_asset_tag_t **list;
+  uint32_t *free_list;
+  uint32_t capacity;
+
+  capacity = (asset_tag_capacity == 0) ? INITIAL_NUM_TAGS : 2 * asset_tag_capacity;
+
+  list = malloc(capacity * sizeof(aoa_asset_tag_t *));
+  free_list = malloc(capacity * sizeof(uint32_t));
+  if ((list == NULL) || (free_list == NULL)) {
+    free(list);
+    free(free_list);
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  if (asset_tag_capacity > 0) {
+    memcpy(list, asset_tag_list, asset_tag_capacity * sizeof(aoa_asset_tag_t *));
+    memcpy(free_list, free_tag_list, free_tag_count * sizeof(uint32_t));
+  }
+  free(asset_tag_list);
+  free(free_tag_list);
+  asset_tag_list = list;
+  free_tag_list = free_list;
+
+  // Push new indexes in reverse order to hand out the lowest index first.
+  for (uint32_t i = capacity; i > asset_tag_capacity; i--) {
+    asset_tag_list[i - 1] = NULL;
+    free_tag_list[free_tag_count++] = i - 1;
+  }
+  asset_tag_capacity = capacity;
+
+  return SL_STATUS_OK;
+}
+
+/**************************************************************************//**
+ * Remove asset tags that have not received angles for a while.
+ *****************************************************************************/
+static void evict_idle_asset_tags(void)
+{
+  uint64_t now = get_app_time();
+  uint64_t timeout = (uint64_t)(tag_timeout * 1000000.0f);
+  uint32_t evicted = 0;
+  bool scheduled;
+
+  for (uint32_t i = 0; i < asset_tag_capacity; i++) {
+    if ((asset_tag_list[i] == NULL)
+        || (now - asset_tag_list[i]->last_seen <= timeout)) {
+      continue;
+    }
+    // Leave the tag alone while its estimation task is pending.
+    pthread_mutex_lock(&asset_tag_list[i]->lock);
+    scheduled = asset_tag_list[i]->scheduled;
+    pthread_mutex_unlock(&asset_tag_list[i]->lock);
+    if (!scheduled) {
+      app_log("Tag evicted (%d): %s\n", i, asset_tag_list[i]->id);
+      leave_geofences(asset_tag_list[i]);
+      remove_asset_tag(i);
+      evicted++;
+    }
+  }
+  if (evicted > 0) {
+    log_asset_tag_memory();
+  }
+}
+
+/**************************************************************************//**
+ * Log the memory used by the asset tags.
+ *
+ * @note Internal state allocated by the RTL library is not included.
+ *****************************************************************************/
+static void log_asset_tag_memory(void)
+{
+  size_t per_tag = sizeof(aoa_asset_tag_t);
+  size_t table = asset_tag_capacity * (sizeof(aoa_asset_tag_t *) + sizeof(uint32_t))
+                 + asset_tag_table.size * sizeof(aoa_id_table_entry_t);
+
+  app_log("Asset tags: %u, capacity: %u, memory per tag: %u bytes, total: %u bytes\n",
+          asset_tag_count,
+          asset_tag_capacity,
+          (unsigned)per_tag,
+          (unsigned)(asset_tag_count * per_tag + table));
+}
+
+/**************************************************************************//**
+ * Register the angle topic prefix of a locator in the topic router.
+ *****************************************************************************/
+static void add_angle_route(aoa_locator_t *loc, uint32_t loc_idx)
+{
+  const char topic_template[] = AOA_TOPIC_ANGLE_PRINT;
+  const char shard_template[] = AOA_SHARD_TOPIC_ANGLE_PRINT;
+  char prefix[sizeof(shard_template) + sizeof(aoa_id_t) + 10];
+  sl_status_t sc;
+
+  // Empty asset tag ID leaves the "<prefix>/<locator>/" part of the topic.
+  snprintf(prefix, sizeof(prefix), topic_template, loc->id, "");
+
+  sc = topic_router_add(&angle_router, prefix, loc_idx);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to add route for locator %s\n",
+             (int)sc,
+             loc->id);
+
+  if (shard.count > 1) {
+    snprintf(prefix, sizeof(prefix), shard_template, shard.index, loc->id, "");
+
+    sc = topic_router_add(&angle_router, prefix, loc_idx);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to add shard route for locator %s\n",
+               (int)sc,
+               loc->id);
+  }
+}
+
+/**************************************************************************//**
+ * Zone configuration parser.
+ *
+ * Zones are listed in the optional "zones" array of the configuration file:
+ * "zones": [{ "id": "<zone>", "locators": ["<locator>", ...] }, ...]
+ * Without zones, all locators make up a single zone.
+ *****************************************************************************/
+static void parse_zones(char *buffer)
+{
+  cJSON *root, *zones, *item, *id, *locators, *loc_item;
+  uint32_t loc_idx;
+
+  root = cJSON_Parse(buffer);
+  app_assert(root != NULL, "Failed to parse zones\n");
+
+  zones = cJSON_GetObjectItem(root, "zones");
+  if (zones == NULL) {
+    aoa_id_copy(zone_list[0].id, multilocator_id);
+    zone_count = 1;
+    for (loc_idx = 0; loc_idx < locator_count; loc_idx++) {
+      add_zone_locator(0, loc_idx);
+    }
+  } else {
+    app_assert(cJSON_IsArray(zones), "Invalid zone list\n");
+    cJSON_ArrayForEach(item, zones) {
+      app_assert(zone_count < MAX_NUM_ZONES, "Too many zones\n");
+      id = cJSON_GetObjectItem(item, "id");
+      locators = cJSON_GetObjectItem(item, "locators");
+      app_assert(cJSON_IsString(id)
+                 && (strlen(id->valuestring) < sizeof(aoa_id_t))
+                 && cJSON_IsArray(locators),
+                 "Invalid zone configuration\n");
+      strcpy(zone_list[zone_count].id, id->valuestring);
+      zone_count++;
+      cJSON_ArrayForEach(loc_item, locators) {
+        app_assert(cJSON_IsString(loc_item),
+                   "Invalid locator in zone %s\n",
+                   id->valuestring);
+        loc_idx = find_locator(loc_item->valuestring);
+        app_assert(loc_idx != INVALID_IDX,
+                   "Unknown locator %s in zone %s\n",
+                   loc_item->valuestring,
+                   id->valuestring);
+        add_zone_locator(zone_count - 1, loc_idx);
+      }
+    }
+  }
+  cJSON_Delete(root);
+
+  for (uint32_t i = 0; i < zone_count; i++) {
+    init_expected_angle_counts(&zone_list[i]);
+    app_log("Zone added: id: %s, locators: %u\n",
+            zone_list[i].id,
+            zone_list[i].locator_count);
+  }
+  for (loc_idx = 0; loc_idx < locator_count; loc_idx++) {
+    if (locator_list[loc_idx].zone_count == 0) {
+      app_log("Warning! Locator %s is not part of any zone.\n",
+              locator_list[loc_idx].id);
+    }
+  }
+}
+
+/**************************************************************************//**
+ * Parse the position publishing policy.
+ *
+ * Members of the optional "publish" object override the defaults:
+ * "deadband_m", "min_interval_ms" and "keepalive_ms".
+ *****************************************************************************/
+static void parse_publish_policy(char *buffer)
+{
+  cJSON *root, *publish, *item;
+
+  root = cJSON_Parse(buffer);
+  app_assert(root != NULL, "Failed to parse publish policy\n");
+
+  publish = cJSON_GetObjectItem(root, "publish");
+  if (publish != NULL) {
+    app_assert(cJSON_IsObject(publish), "Invalid publish policy\n");
+    item = cJSON_GetObjectItem(publish, "deadband_m");
+    if (cJSON_IsNumber(item)) {
+      publish_policy.deadband = (float)item->valuedouble;
+    }
+    item = cJSON_GetObjectItem(publish, "min_interval_ms");
+    if (cJSON_IsNumber(item)) {
+      publish_policy.min_interval = (uint64_t)(item->valuedouble * 1000.0);
+    }
+    item = cJSON_GetObjectItem(publish, "keepalive_ms");
+    if (cJSON_IsNumber(item)) {
+      publish_policy.keepalive = (uint64_t)(item->valuedouble * 1000.0);
+    }
   }
+  cJSON_Delete(root);
 
-  // Process new measurements, time step given in seconds.
-  sc = sl_rtl_loc_process(&tag->loc, time_step);
-  tag->oldest_sequence = tag->correlated_angles[slot].sequence;
+  app_log("Publish policy: dead-band %.3f m, minimum interval %.1f ms, keep-alive %.1f ms\n",
+          publish_policy.deadband,
+          publish_policy.min_interval / 1000.0,
+          publish_policy.keepalive / 1000.0);
+}
 
-  CHECK_ERROR(sc);
+/**************************************************************************//**
+ * Parse the geofences.
+ *
+ * Each item of the optional "geofences" array is either a box with "min" and
+ * "max" corners, or a polygon with "vertices" in the xy plane between "z_min"
+ * and "z_max". The optional "dwell_ms" enables the dwell event.
+ *****************************************************************************/
+static void parse_geofences(char *buffer)
+{
+  cJSON *root, *fences, *item, *id, *vertices, *vertex, *value;
+  sl_status_t sc;
+  float min[AXIS_COUNT], max[AXIS_COUNT];
+  float (*list)[2];
+  uint32_t count;
+  uint64_t dwell;
 
-  // Get results from the estimator.
-  sc = sl_rtl_loc_get_result(&tag->loc, SL_RTL_LOC_RESULT_POSITION_X, &tag->position.x);
-  CHECK_ERROR(sc);
-  sc = sl_rtl_loc_get_result(&tag->loc, SL_RTL_LOC_RESULT_POSITION_Y, &tag->position.y);
-  CHECK_ERROR(sc);
-  sc = sl_rtl_loc_get_result(&tag->loc, SL_RTL_LOC_RESULT_POSITION_Z, &tag->position.z);
-  CHECK_ERROR(sc);
+  aoa_geofence_init(&geofence_index);
 
-  // Apply filter on the result.
-  sc = sl_rtl_util_filter(&tag->filter[AXIS_X], tag->position.x, &tag->position.x);
-  CHECK_ERROR(sc);
-  sc = sl_rtl_util_filter(&tag->filter[AXIS_Y], tag->position.y, &tag->position.y);
-  CHECK_ERROR(sc);
-  sc = sl_rtl_util_filter(&tag->filter[AXIS_Z], tag->position.z, &tag->position.z);
-  CHECK_ERROR(sc);
+  root = cJSON_Parse(buffer);
+  app_assert(root != NULL, "Failed to parse geofences\n");
 
-  // Clear measurements.
-  sc = sl_rtl_loc_clear_measurements(&tag->loc);
-  CHECK_ERROR(sc);
+  fences = cJSON_GetObjectItem(root, "geofences");
+  if (fences == NULL) {
+    cJSON_Delete(root);
+    return;
+  }
+  app_assert(cJSON_IsArray(fences), "Invalid geofence list\n");
+  cJSON_ArrayForEach(item, fences) {
+    id = cJSON_GetObjectItem(item, "id");
+    app_assert(cJSON_IsString(id), "Invalid geofence configuration\n");
+    value = cJSON_GetObjectItem(item, "dwell_ms");
+    dwell = cJSON_IsNumber(value) ? (uint64_t)(value->valuedouble * 1000.0) : 0;
+
+    vertices = cJSON_GetObjectItem(item, "vertices");
+    if (vertices == NULL) {
+      parse_point(cJSON_GetObjectItem(item, "min"), min, id->valuestring);
+      parse_point(cJSON_GetObjectItem(item, "max"), max, id->valuestring);
+      sc = aoa_geofence_add_box(&geofence_index, id->valuestring, min, max, dwell);
+    } else {
+      app_assert(cJSON_IsArray(vertices),
+                 "Invalid vertices in geofence %s\n",
+                 id->valuestring);
+      count = (uint32_t)cJSON_GetArraySize(vertices);
+      list = malloc((count > 0 ? count : 1) * sizeof(*list));
+      app_assert(list != NULL, "Failed to allocate geofence vertices\n");
+      count = 0;
+      cJSON_ArrayForEach(vertex, vertices) {
+        parse_point(vertex, min, id->valuestring);
+        list[count][0] = min[AXIS_X];
+        list[count][1] = min[AXIS_Y];
+        count++;
+      }
+      value = cJSON_GetObjectItem(item, "z_min");
+      min[AXIS_Z] = cJSON_IsNumber(value) ? (float)value->valuedouble : -INFINITY;
+      value = cJSON_GetObjectItem(item, "z_max");
+      max[AXIS_Z] = cJSON_IsNumber(value) ? (float)value->valuedouble : INFINITY;
+      sc = aoa_geofence_add_polygon(&geofence_index,
+                                    id->valuestring,
+                                    (const float (*)[2])list,
+                                    count,
+                                    min[AXIS_Z],
+                                    max[AXIS_Z],
+                                    dwell);
+      free(list);
+    }
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Invalid geofence %s\n",
+               (int)sc,
+               id->valuestring);
+  }
+  cJSON_Delete(root);
 
-  return SL_RTL_ERROR_SUCCESS;
+  sc = aoa_geofence_build(&geofence_index, GEOFENCE_CELL_SIZE_M);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to build geofence index\n",
+             (int)sc);
+  app_log("Geofences: %u, grid: %u x %u cells of %.2f m\n",
+          geofence_index.count,
+          geofence_index.columns,
+          geofence_index.rows,
+          geofence_index.cell_size);
 }
 
 /**************************************************************************//**
- * Initialise a new asset tag.
+ * Parse the priority classes of the asset tags.
+ *
+ * The optional "priorities" object has an array of asset tag IDs for each of
+ * the "critical", "normal" and "low" classes, and the "default" class of the
+ * other asset tags.
  *****************************************************************************/
-static enum sl_rtl_error_code init_asset_tag(aoa_asset_tag_t *tag, aoa_id_t id)
+static void parse_priorities(char *buffer)
 {
-  enum sl_rtl_error_code sc;
-
-  aoa_id_copy(tag->id, id);
+  cJSON *root, *priorities, *item, *tags;
+  uint32_t count = 0;
+  sl_status_t sc;
 
-  // Initialize RTL library
-  sc = sl_rtl_loc_init(&tag->loc);
-  CHECK_ERROR(sc);
+  sc = aoa_id_table_init(&priority_table, INITIAL_NUM_TAGS);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to init priority table\n",
+             (int)sc);
 
-  // Select estimation mode.
-  sc = sl_rtl_loc_set_mode(&tag->loc, ESTIMATION_MODE);
-  CHECK_ERROR(sc);
+  root = cJSON_Parse(buffer);
+  app_assert(root != NULL, "Failed to parse priorities\n");
 
-  // Provide locator configurations to the position estimator.
-  for (uint32_t i = 0; i < locator_count; i++) {
-    sc = sl_rtl_loc_add_locator(&tag->loc, &locator_list[i].item, &tag->loc_id[i]);
-    CHECK_ERROR(sc);
+  priorities = cJSON_GetObjectItem(root, "priorities");
+  if (priorities == NULL) {
+    cJSON_Delete(root);
+    return;
   }
-  for (uint32_t i = 0; i < MAX_NUM_SEQUENCE_IDS; i++) {
-    init_correlated_angle_data(&tag->correlated_angles[i]);
+  app_assert(cJSON_IsObject(priorities), "Invalid priorities\n");
+  for (uint32_t i = 0; i < PRIORITY_COUNT; i++) {
+    tags = cJSON_GetObjectItem(priorities, priority_names[i]);
+    if (tags == NULL) {
+      continue;
+    }
+    app_assert(cJSON_IsArray(tags), "Invalid %s priority list\n", priority_names[i]);
+    cJSON_ArrayForEach(item, tags) {
+      app_assert(cJSON_IsString(item)
+                 && (strlen(item->valuestring) < sizeof(aoa_id_t)),
+                 "Invalid asset tag in %s priority list\n",
+                 priority_names[i]);
+      sc = aoa_id_table_add(&priority_table,
+                            item->valuestring,
+                            strlen(item->valuestring),
+                            i);
+      app_assert(sc == SL_STATUS_OK,
+                 "[E: 0x%04x] Failed to add priority of %s\n",
+                 (int)sc,
+                 item->valuestring);
+      count++;
+    }
+  }
+  item = cJSON_GetObjectItem(priorities, "default");
+  if (item != NULL) {
+    app_assert(cJSON_IsString(item), "Invalid default priority\n");
+    for (default_priority = 0; default_priority < PRIORITY_COUNT; default_priority++) {
+      if (strcmp(item->valuestring, priority_names[default_priority]) == 0) {
+        break;
+      }
+    }
+    app_assert(default_priority < PRIORITY_COUNT,
+               "Invalid default priority %s\n",
+               item->valuestring);
   }
+  cJSON_Delete(root);
 
-  // Create position estimator.
-  sc = sl_rtl_loc_create_position_estimator(&tag->loc);
-  CHECK_ERROR(sc);
+  app_log("Priorities: %u asset tags configured, default %s\n",
+          count,
+          priority_names[default_priority]);
+}
 
-  // Initialize util functions.
-  for (enum axis_list i = 0; i < AXIS_COUNT; i++) {
-    sc = sl_rtl_util_init(&tag->filter[i]);
-    CHECK_ERROR(sc);
-    // Set position filtering parameter for every axis.
-    sc = sl_rtl_util_set_parameter(&tag->filter[i],
-                                   SL_RTL_UTIL_PARAMETER_AMOUNT_OF_FILTERING,
-                                   FILTERING_AMOUNT);
-    CHECK_ERROR(sc);
+/**************************************************************************//**
+ * Parse a point given as an object of "x", "y" and optional "z" members.
+ *****************************************************************************/
+static void parse_point(cJSON *item, float point[3], const char *fence_id)
+{
+  cJSON *x = cJSON_GetObjectItem(item, "x");
+  cJSON *y = cJSON_GetObjectItem(item, "y");
+  cJSON *z = cJSON_GetObjectItem(item, "z");
+
+  app_assert(cJSON_IsNumber(x) && cJSON_IsNumber(y),
+             "Invalid point in geofence %s\n",
+             fence_id);
+  point[AXIS_X] = (float)x->valuedouble;
+  point[AXIS_Y] = (float)y->valuedouble;
+  point[AXIS_Z] = cJSON_IsNumber(z) ? (float)z->valuedouble : 0.0f;
+}
+
+/**************************************************************************//**
+ * Find locator in the locator list based on its ID.
+ *****************************************************************************/
+static uint32_t find_locator(const char *id)
+{
+  return aoa_id_table_find(&locator_table, id, strlen(id));
+}
+
+/**************************************************************************//**
+ * Add a locator to a zone.
+ *****************************************************************************/
+static void add_zone_locator(uint32_t zone_idx, uint32_t loc_idx)
+{
+  aoa_zone_t *zone = &zone_list[zone_idx];
+  aoa_locator_t *loc = &locator_list[loc_idx];
+
+  for (uint32_t i = 0; i < loc->zone_count; i++) {
+    if (loc->zone[i] == zone_idx) {
+      return;
+    }
   }
+  app_assert(zone->locator_count < MAX_NUM_ZONE_LOCATORS,
+             "Too many locators in zone %s\n",
+             zone->id);
+  app_assert(loc->zone_count < MAX_NUM_LOCATOR_ZONES,
+             "Locator %s is part of too many zones\n",
+             loc->id);
+
+  loc->zone[loc->zone_count] = zone_idx;
+  loc->zone_loc_idx[loc->zone_count] = zone->locator_count;
+  loc->zone_count++;
+  zone->locator[zone->locator_count++] = loc_idx;
+}
 
-  return SL_RTL_ERROR_SUCCESS;
+/**************************************************************************//**
+ * Initialize expected angle counts of a zone.
+ *
+ * The expected number of angles depends on the age of the slot, i.e. on the
+ * distance of its sequence number from the newest sequence number of the tag.
+ * A more recent slot expects more angles, while an older slot requires less
+ * angles.
+ * This function implements a linear connection, thus the newest slot expects
+ * an angle from all locators, while the oldest slot needs only 2 locators.
+ *****************************************************************************/
+static void init_expected_angle_counts(aoa_zone_t *zone)
+{
+  uint32_t count = zone->locator_count;
+  uint32_t coeff = (count < 2) ? 0 : (count - 2);
+  for (int i = 0; i < MAX_NUM_SEQUENCE_IDS; i++) {
+    zone->expected_angles_count[i] = count - ROUND_DIV(i * coeff, MAX_NUM_SEQUENCE_IDS - 1);
+  }
+  zone->provisional_angles_count = (count < PROVISIONAL_NUM_ANGLES)
+                                   ? count : PROVISIONAL_NUM_ANGLES;
 }
 
 /**************************************************************************//**
- * Find asset tag in the local list based on its ID.
+ * Select the zone of the position estimator of an asset tag.
+ *
+ * Every angle votes for the zones of its locator. At the end of a handover
+ * window, the tag is handed over to the most voted zone if that got
+ * ZONE_HANDOVER_RATIO times more votes than the current zone.
+ *
+ * @return Index of the locator in the selected zone, INVALID_IDX if the
+ *         locator is not part of it.
  *****************************************************************************/
-static uint32_t find_asset_tag(aoa_id_t id)
+static uint32_t select_zone(aoa_asset_tag_t *tag, uint32_t loc_idx)
 {
-  uint32_t retval = INVALID_IDX;
+  aoa_locator_t *loc = &locator_list[loc_idx];
+  aoa_zone_vote_t *vote;
+  uint32_t best = INVALID_IDX;
+  uint32_t best_count = 0;
+  uint32_t current_count = 0;
+  enum sl_rtl_error_code sc;
+
+  if (loc->zone_count == 0) {
+    return INVALID_IDX;
+  }
+  if (tag->zone == INVALID_IDX) {
+    sc = init_estimator(tag, loc->zone[0]);
+    app_assert(sc == SL_RTL_ERROR_SUCCESS,
+               "[E: 0x%04x] Failed to init estimator of %s.\n", sc, tag->id);
+  }
+
+  for (uint32_t i = 0; i < loc->zone_count; i++) {
+    add_zone_vote(tag, loc->zone[i]);
+  }
+  if (++tag->zone_vote_total >= ZONE_HANDOVER_WINDOW) {
+    for (uint32_t i = 0; i < MAX_NUM_ZONE_VOTES; i++) {
+      vote = &tag->zone_vote[i];
+      if (vote->count == 0) {
+        continue;
+      }
+      if (vote->zone == tag->zone) {
+        current_count = vote->count;
+      }
+      if (vote->count > best_count) {
+        best = vote->zone;
+        best_count = vote->count;
+      }
+    }
+    if ((best != tag->zone) && (best_count >= ZONE_HANDOVER_RATIO * current_count)) {
+      hand_over_asset_tag(tag, best);
+    }
+    memset(tag->zone_vote, 0, sizeof(tag->zone_vote));
+    tag->zone_vote_total = 0;
+  }
 
-  for (uint32_t i = 0; (i < asset_tag_count) && (retval == INVALID_IDX); i++) {
-    if (aoa_id_compare(asset_tag_list[i].id, id) == 0) {
-      retval = i;
+  for (uint32_t i = 0; i < loc->zone_count; i++) {
+    if (loc->zone[i] == tag->zone) {
+      return loc->zone_loc_idx[i];
     }
   }
-  return retval;
+  return INVALID_IDX;
 }
 
 /**************************************************************************//**
- * Find locator in the local list based on its ID.
+ * Count an angle for a zone, replace the least voted zone if needed.
  *****************************************************************************/
-static uint32_t find_locator(aoa_id_t id)
+static void add_zone_vote(aoa_asset_tag_t *tag, uint32_t zone_idx)
 {
-  uint32_t retval = INVALID_IDX;
+  aoa_zone_vote_t *vote = &tag->zone_vote[0];
 
-  for (uint32_t i = 0; (i < locator_count) && (retval == INVALID_IDX); i++) {
-    if (aoa_id_compare(locator_list[i].id, id) == 0) {
-      retval = i;
+  for (uint32_t i = 0; i < MAX_NUM_ZONE_VOTES; i++) {
+    if ((tag->zone_vote[i].count > 0) && (tag->zone_vote[i].zone == zone_idx)) {
+      tag->zone_vote[i].count++;
+      return;
+    }
+    if (tag->zone_vote[i].count < vote->count) {
+      vote = &tag->zone_vote[i];
     }
   }
-  return retval;
+  vote->zone = zone_idx;
+  vote->count = 1;
 }
 
 /**************************************************************************//**
- * Initialize expected angle counts.
+ * Move the position estimator of an asset tag to another zone.
  *
- * The expected number of angles depends on the slot index. A slot with smaller
- * index (i.e. with more recent sequence number) expects more angles, while a
- * slot with higher index (i.e. with older sequence number) requires less
- * angles.
- * This function implements a linear connection, thus the first slot expects
- * an angle from all locators, while the last slot needs only 2 locators.
+ * Pending angles of the old zone are dropped, the position filter is kept
+ * to avoid a jump in the published position.
  *****************************************************************************/
-static void init_expected_angle_counts(void)
+static void hand_over_asset_tag(aoa_asset_tag_t *tag, uint32_t zone_idx)
 {
-  uint32_t coeff = (locator_count < 2) ? 0 : (locator_count - 2);
-  for (int i = 0; i < MAX_NUM_SEQUENCE_IDS; i++) {
-    expected_angles_count[i] = locator_count - ROUND_DIV(i * coeff, MAX_NUM_SEQUENCE_IDS - 1);
+  enum sl_rtl_error_code sc;
+
+  app_log("Tag %s handed over: %s -> %s\n",
+          tag->id,
+          zone_list[tag->zone].id,
+          zone_list[zone_idx].id);
+
+  deinit_estimator(tag);
+  for (uint32_t i = 0; i < SLOT_RING_SIZE; i++) {
+    init_correlated_angle_data(&tag->correlated_angles[i]);
   }
+  tag->newest_sequence = -1;
+  tag->oldest_sequence = -1;
+
+  sc = init_estimator(tag, zone_idx);
+  app_assert(sc == SL_RTL_ERROR_SUCCESS,
+             "[E: 0x%04x] Failed to init estimator of %s.\n", sc, tag->id);
 }
 
 /**************************************************************************//**
@@ -526,85 +2698,429 @@ static void init_correlated_angle_data(aoa_correlated_angles_t* angle)
 {
   angle->num_angles = 0;
   angle->sequence = -1;
-  memset(angle->has_angle, 0, MAX_NUM_LOCATORS);
+  angle->locator_mask = 0;
+  angle->estimated_angles = 0;
+  aoa_trace_span_init(&angle->span);
+  stop_deadline(angle);
 }
 
 /**************************************************************************//**
- * Add angle data to asset tag.
+ * Queue angle data for the estimation task of an asset tag.
  *****************************************************************************/
-static void add_angle_data_to_tag(aoa_asset_tag_t* tag, uint32_t loc_idx, aoa_angle_t* angle)
+static void enqueue_angle(aoa_asset_tag_t *tag, uint32_t loc_idx, aoa_angle_t *angle, uint64_t timestamp, uint64_t arrival)
 {
-  // Drop stored data that are considered too old.
-  for (int i = 0; i < MAX_NUM_SEQUENCE_IDS; i++) {
-    if (sequence_diff(tag->correlated_angles[i].sequence, angle->sequence) == INT_MAX) {
-      for (int k = i; k < MAX_NUM_SEQUENCE_IDS; k++) {
-        init_correlated_angle_data(&tag->correlated_angles[k]);
+  aoa_angle_message_t *msg;
+
+  pthread_mutex_lock(&tag->lock);
+  // A replay waits for the estimation instead of dropping angles.
+  while ((replay.file != NULL) && (tag->queue_count == ANGLE_QUEUE_SIZE)) {
+    pthread_mutex_unlock(&tag->lock);
+    sched_yield();
+    pthread_mutex_lock(&tag->lock);
+  }
+  if (replay.file == NULL) {
+    remove_stale_angles(tag, loc_idx, angle->sequence);
+  }
+  if (tag->queue_count == ANGLE_QUEUE_SIZE) {
+    // Estimation can not keep up, drop the oldest angle.
+    tag->queue_head = (tag->queue_head + 1) % ANGLE_QUEUE_SIZE;
+    tag->queue_count--;
+    tag->dropped++;
+  }
+  msg = &tag->queue[(tag->queue_head + tag->queue_count) % ANGLE_QUEUE_SIZE];
+  msg->angle = *angle;
+  msg->timestamp = timestamp;
+  msg->arrival = arrival;
+  msg->loc_idx = loc_idx;
+  tag->queue_count++;
+  schedule_asset_tag(tag);
+  pthread_mutex_unlock(&tag->lock);
+}
+
+/**************************************************************************//**
+ * Remove the queued angles superseded by a new angle of a locator.
+ *
+ * A queued angle of the same locator at least ANGLE_COALESCE_WINDOW sequences
+ * older than the new one means that the estimation has fallen behind. Its
+ * sequence and all older ones are stale: they are removed from the queue of
+ * every locator, so that the estimation continues with the newest angles.
+ *
+ * @note The lock of the tag must be held.
+ *****************************************************************************/
+static void remove_stale_angles(aoa_asset_tag_t *tag, uint32_t loc_idx, int32_t sequence)
+{
+  aoa_angle_message_t *msg;
+  int32_t diff;
+  int32_t stale = INT_MAX; // newest stale sequence as a difference to the new
+  uint32_t count = 0;
+
+  if (ANGLE_COALESCE_WINDOW == 0) {
+    return;
+  }
+  for (uint32_t i = 0; i < tag->queue_count; i++) {
+    msg = &tag->queue[(tag->queue_head + i) % ANGLE_QUEUE_SIZE];
+    diff = sequence_diff(msg->angle.sequence, sequence);
+    if ((msg->loc_idx == loc_idx) && (diff != INT_MAX)
+        && (diff >= ANGLE_COALESCE_WINDOW) && (diff < stale)) {
+      stale = diff;
+    }
+  }
+  if (stale == INT_MAX) {
+    return;
+  }
+  // Compact the queue, keeping the order of the remaining angles.
+  for (uint32_t i = 0; i < tag->queue_count; i++) {
+    msg = &tag->queue[(tag->queue_head + i) % ANGLE_QUEUE_SIZE];
+    diff = sequence_diff(msg->angle.sequence, sequence);
+    if ((diff != INT_MAX) && (diff >= stale)) {
+      continue;
+    }
+    tag->queue[(tag->queue_head + count) % ANGLE_QUEUE_SIZE] = *msg;
+    count++;
+  }
+  tag->stale += tag->queue_count - count;
+  tag->queue_count = count;
+}
+
+/**************************************************************************//**
+ * Submit the estimation task of an asset tag unless already submitted.
+ *
+ * @note The lock of the tag must be held.
+ *****************************************************************************/
+static void schedule_asset_tag(aoa_asset_tag_t *tag)
+{
+  sl_status_t sc;
+
+  if (!tag->scheduled) {
+    tag->scheduled = true;
+    sc = priority_scheduler_submit(&estimation_scheduler,
+                                   &tag->task,
+                                   __atomic_load_n(&tag->effective_priority, __ATOMIC_RELAXED));
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to schedule estimation for %s.\n",
+               (int)sc,
+               tag->id);
+  }
+}
+
+/**************************************************************************//**
+ * Estimation task of an asset tag, processes the queued angles and deadlines.
+ *****************************************************************************/
+static void process_asset_tag(priority_task_t *task)
+{
+  aoa_asset_tag_t *tag = task->context;
+  aoa_angle_message_t msg;
+  uint32_t expired;
+  uint64_t start;
+
+  pthread_mutex_lock(&tag->lock);
+  while ((tag->queue_count > 0) || (tag->expired_slots != 0)) {
+    start = aoa_trace_timestamp();
+    if (tag->expired_slots != 0) {
+      expired = tag->expired_slots;
+      tag->expired_slots = 0;
+      pthread_mutex_unlock(&tag->lock);
+      for (uint32_t i = 0; i < SLOT_RING_SIZE; i++) {
+        if (expired & (1u << i)) {
+          close_expired_slot(tag, &tag->correlated_angles[i]);
+        }
       }
-      break;
+    } else {
+      msg = tag->queue[tag->queue_head];
+      tag->queue_head = (tag->queue_head + 1) % ANGLE_QUEUE_SIZE;
+      tag->queue_count--;
+      pthread_mutex_unlock(&tag->lock);
+      add_angle_data_to_tag(tag, msg.loc_idx, &msg.angle, msg.timestamp, msg.arrival);
     }
+    add_stage_time(&tag->stage_stats, STAGE_CORRELATE, start);
+    pthread_mutex_lock(&tag->lock);
   }
-  // Find the correct slot.
-  int32_t angle_slot = find_angle_slot(tag->correlated_angles, angle->sequence);
-  // Update with / insert new data
-  update_slots(tag, angle, angle_slot, loc_idx);
-  // Push if some of the slots have completed
-  push_completed_angle_data(tag, angle_slot);
+  tag->scheduled = false;
+  pthread_mutex_unlock(&tag->lock);
 }
 
 /**************************************************************************//**
- * Find angle slot.
+ * Add angle data to asset tag.
  *****************************************************************************/
-static int32_t find_angle_slot(aoa_correlated_angles_t* slots, int32_t sequence)
+static void add_angle_data_to_tag(aoa_asset_tag_t* tag, uint32_t loc_idx, aoa_angle_t* angle, uint64_t timestamp, uint64_t arrival)
 {
-  for (uint32_t i = 0; i < MAX_NUM_SEQUENCE_IDS; i++) {
-    if (sequence == slots[i].sequence) {
-      return i;
+  int32_t age;
+  aoa_correlated_angles_t *slot;
+
+  // Continue with the index of the locator in the zone of the tag.
+  loc_idx = select_zone(tag, loc_idx);
+  if (loc_idx == INVALID_IDX) {
+    return;
+  }
+
+  // Drop angles that belong to an already estimated sequence, except for a
+  // provisionally estimated sequence that is still waiting for refinement.
+  slot = &tag->correlated_angles[SLOT_INDEX(angle->sequence)];
+  age = sequence_diff(angle->sequence, tag->oldest_sequence);
+  if ((age != INT_MAX) && (age >= 0)
+      && ((age > 0) || (slot->sequence != angle->sequence))) {
+    return;
+  }
+  // Move the ring forward if the angle is the newest, drop it if too old.
+  if (!advance_slots(tag, angle->sequence)) {
+    return;
+  }
+  age = sequence_diff(angle->sequence, tag->newest_sequence);
+
+  if (slot->sequence != angle->sequence) {
+    init_correlated_angle_data(slot);
+    slot->sequence = angle->sequence;
+  }
+  update_slot(slot, angle, timestamp, loc_idx);
+
+  if (correlation_deadline_ms > 0) {
+    // The deadline starts with the arrival of the first angle.
+    if (slot->num_angles == 1) {
+      start_deadline(slot, arrival + correlation_deadline_ms * 1000ULL);
     }
+    push_deadline_angle_data(tag, slot);
+  } else {
+    // Push if some of the slots have completed
+    push_completed_angle_data(tag, age);
   }
-  return 0;
 }
 
 /**************************************************************************//**
- * Update slots.
+ * Get the slot of a given age, NULL if the slot is unused.
  *****************************************************************************/
-static void update_slots(aoa_asset_tag_t* tag, aoa_angle_t* angle, int32_t slot, uint32_t loc_idx)
+static aoa_correlated_angles_t *get_slot(aoa_asset_tag_t* tag, uint32_t age)
 {
-  if (slot >= 0) {
-    // If the selected slot has not matched with the angle then insert it.
-    if (tag->correlated_angles[slot].sequence != angle->sequence) {
-      for (int i = MAX_NUM_SEQUENCE_IDS - 1; i > slot; i--) {
-        tag->correlated_angles[i] = tag->correlated_angles[i - 1];
-      }
-      init_correlated_angle_data(&tag->correlated_angles[slot]);
-      tag->correlated_angles[slot].sequence = angle->sequence;
+  int32_t sequence = (tag->newest_sequence - age) & SEQUENCE_MASK;
+  aoa_correlated_angles_t *slot = &tag->correlated_angles[SLOT_INDEX(sequence)];
+
+  return (slot->sequence == sequence) ? slot : NULL;
+}
+
+/**************************************************************************//**
+ * Check if the slot of a given age has all the angles expected at its age.
+ *****************************************************************************/
+static bool is_slot_complete(aoa_asset_tag_t* tag, uint32_t age)
+{
+  aoa_correlated_angles_t *slot = get_slot(tag, age);
+
+  return (slot != NULL)
+         && (slot->num_angles >= zone_list[tag->zone].expected_angles_count[age]);
+}
+
+/**************************************************************************//**
+ * Move the newest sequence of the ring forward.
+ *
+ * Slots that are reused for the new sequences are cleared. The whole ring is
+ * cleared if the new sequence is too far from the stored ones.
+ *
+ * @return false if the sequence is too old to be stored.
+ *****************************************************************************/
+static bool advance_slots(aoa_asset_tag_t* tag, int32_t sequence)
+{
+  int32_t diff = sequence_diff(tag->newest_sequence, sequence);
+
+  if (diff == INT_MAX) {
+    // Stored data are considered too old.
+    for (uint32_t i = 0; i < SLOT_RING_SIZE; i++) {
+      init_correlated_angle_data(&tag->correlated_angles[i]);
     }
-    tag->correlated_angles[slot].angles[loc_idx] = *angle;
-    tag->correlated_angles[slot].has_angle[loc_idx] = true;
-    tag->correlated_angles[slot].num_angles++;
+    tag->newest_sequence = sequence;
+  } else if (diff > 0) {
+    for (int32_t i = 1; (i <= diff) && (i <= SLOT_RING_SIZE); i++) {
+      init_correlated_angle_data(&tag->correlated_angles[SLOT_INDEX(tag->newest_sequence + i)]);
+    }
+    tag->newest_sequence = sequence;
+  } else if (-diff >= MAX_NUM_SEQUENCE_IDS) {
+    return false;
+  }
+  return true;
+}
+
+/**************************************************************************//**
+ * Store angle data in a slot.
+ *****************************************************************************/
+static void update_slot(aoa_correlated_angles_t* slot, aoa_angle_t* angle, uint64_t timestamp, uint32_t loc_idx)
+{
+  float distance;
+
+  // A repeated angle from the same locator overwrites the previous one.
+  if ((slot->locator_mask & (1u << loc_idx)) == 0) {
+    slot->locator_mask |= 1u << loc_idx;
+    slot->num_angles++;
   }
+  slot->angles[loc_idx].azimuth = (int16_t)lroundf(angle->azimuth * ANGLE_SCALE);
+  slot->angles[loc_idx].elevation = (int16_t)lroundf(angle->elevation * ANGLE_SCALE);
+  distance = angle->distance * DISTANCE_SCALE;
+  slot->angles[loc_idx].distance = (distance < UINT16_MAX) ? (uint16_t)lroundf(distance) : UINT16_MAX;
+  aoa_trace_span_add(&slot->span, timestamp);
 }
 
 /**************************************************************************//**
- * Push completed angle data to the estimatorand publish to MQTT.
+ * Push completed angle data to the estimator and publish to MQTT.
+ *
+ * Only slots not younger than the updated one are checked, younger slots have
+ * not changed and their expected angle counts are the same.
  *****************************************************************************/
-static void push_completed_angle_data(aoa_asset_tag_t* tag, int32_t check_idx_from)
+static void push_completed_angle_data(aoa_asset_tag_t* tag, uint32_t check_age_from)
 {
-  int32_t last_updated_index = MAX_NUM_SEQUENCE_IDS;
+  int32_t newest_age = -1;
+
+  for (int32_t age = (int32_t)check_age_from; age < MAX_NUM_SEQUENCE_IDS; age++) {
+    if (is_slot_complete(tag, age)) {
+      newest_age = age;
+      break;
+    }
+  }
+  if (newest_age < 0) {
+    return;
+  }
+
   // Check start from the oldest slots to keep in order and complete as many
   // slots as possible.
-  if (check_idx_from >= 0) {
-    for (int i = MAX_NUM_SEQUENCE_IDS - 1; i >= check_idx_from; i--) {
-      if (tag->correlated_angles[i].num_angles == expected_angles_count[i]) {
-        enum sl_rtl_error_code sc = run_estimation(tag, i);
-        app_assert(sc == SL_RTL_ERROR_SUCCESS,
-                   "[E: 0x%04x] Position estimation failed for %s.\n", sc, tag->id);
-        publish_position(tag);
-        tag->oldest_sequence = tag->correlated_angles[i].sequence;
-        last_updated_index = i;
-      }
+  for (int32_t age = MAX_NUM_SEQUENCE_IDS - 1; age >= newest_age; age--) {
+    if (is_slot_complete(tag, age)) {
+      estimate_position(tag, get_slot(tag, age), age == newest_age);
     }
-    for (; last_updated_index < MAX_NUM_SEQUENCE_IDS; last_updated_index++) {
-      init_correlated_angle_data(&tag->correlated_angles[last_updated_index]);
+  }
+  // Drop the estimated slots and the older ones.
+  drop_slots(tag, newest_age);
+}
+
+/**************************************************************************//**
+ * Push angle data of a slot to the estimator in deadline mode.
+ *
+ * A provisional position is published as soon as the slot has enough angles.
+ * The slot is refined and closed when all locators have reported, otherwise
+ * its deadline does the same.
+ *****************************************************************************/
+static void push_deadline_angle_data(aoa_asset_tag_t* tag, aoa_correlated_angles_t* slot)
+{
+  aoa_zone_t *zone = &zone_list[tag->zone];
+
+  if (slot->num_angles == zone->locator_count) {
+    estimate_slot(tag, slot);
+    drop_slots(tag, sequence_diff(slot->sequence, tag->newest_sequence));
+  } else if ((slot->estimated_angles == 0)
+             && (slot->num_angles >= zone->provisional_angles_count)) {
+    estimate_slot(tag, slot);
+  }
+}
+
+/**************************************************************************//**
+ * Deadline of a slot expired, pass it to the estimation task of the tag.
+ *
+ * @note Called on the MQTT thread with the deadline lock held.
+ *****************************************************************************/
+static void on_slot_deadline(timer_wheel_timer_t *timer)
+{
+  aoa_asset_tag_t *tag = timer->context;
+  uint32_t index = (uint32_t)(DEADLINE_TO_SLOT(timer) - tag->correlated_angles);
+
+  pthread_mutex_lock(&tag->lock);
+  tag->expired_slots |= 1u << index;
+  schedule_asset_tag(tag);
+  pthread_mutex_unlock(&tag->lock);
+}
+
+/**************************************************************************//**
+ * Publish the angles of an expired slot received so far.
+ *****************************************************************************/
+static void close_expired_slot(aoa_asset_tag_t* tag, aoa_correlated_angles_t* slot)
+{
+  // The slot might have been closed or reused since the deadline expired.
+  if ((slot->num_angles == 0) || is_deadline_running(slot)) {
+    return;
+  }
+  if (slot->num_angles >= zone_list[tag->zone].provisional_angles_count) {
+    estimate_slot(tag, slot);
+  }
+  drop_slots(tag, sequence_diff(slot->sequence, tag->newest_sequence));
+}
+
+/**************************************************************************//**
+ * Start the deadline of a slot.
+ *****************************************************************************/
+static void start_deadline(aoa_correlated_angles_t* slot, uint64_t expiry)
+{
+  pthread_mutex_lock(&deadline_lock);
+  timer_wheel_start(&deadline_wheel, &slot->deadline, expiry);
+  pthread_mutex_unlock(&deadline_lock);
+}
+
+/**************************************************************************//**
+ * Stop the deadline of a slot.
+ *****************************************************************************/
+static void stop_deadline(aoa_correlated_angles_t* slot)
+{
+  // Deadlines are never started otherwise.
+  if (correlation_deadline_ms == 0) {
+    return;
+  }
+  pthread_mutex_lock(&deadline_lock);
+  timer_wheel_stop(&deadline_wheel, &slot->deadline);
+  pthread_mutex_unlock(&deadline_lock);
+}
+
+/**************************************************************************//**
+ * Check if the deadline of a slot is running.
+ *****************************************************************************/
+static bool is_deadline_running(aoa_correlated_angles_t* slot)
+{
+  bool running;
+
+  pthread_mutex_lock(&deadline_lock);
+  running = timer_wheel_is_running(&slot->deadline);
+  pthread_mutex_unlock(&deadline_lock);
+  return running;
+}
+
+/**************************************************************************//**
+ * Process the expired deadlines.
+ *****************************************************************************/
+static void advance_deadlines(uint64_t now)
+{
+  if (correlation_deadline_ms == 0) {
+    return;
+  }
+  pthread_mutex_lock(&deadline_lock);
+  timer_wheel_advance(&deadline_wheel, now);
+  pthread_mutex_unlock(&deadline_lock);
+}
+
+/**************************************************************************//**
+ * Estimate and publish position from a slot if it has new angles.
+ *****************************************************************************/
+static void estimate_slot(aoa_asset_tag_t* tag, aoa_correlated_angles_t* slot)
+{
+  int32_t age;
+
+  if (slot->num_angles <= slot->estimated_angles) {
+    return;
+  }
+  // A skipped slot is estimated when it is refined or closed.
+  if (!estimate_position(tag, slot, true)) {
+    return;
+  }
+  slot->estimated_angles = slot->num_angles;
+
+  // Estimates are made in sequence order, older slots are not usable anymore.
+  age = sequence_diff(slot->sequence, tag->newest_sequence);
+  if ((age != INT_MAX) && (age >= 0) && (age + 1 < MAX_NUM_SEQUENCE_IDS)) {
+    drop_slots(tag, age + 1);
+  }
+}
+
+/**************************************************************************//**
+ * Clear the slots not younger than a given age.
+ *****************************************************************************/
+static void drop_slots(aoa_asset_tag_t* tag, uint32_t from_age)
+{
+  aoa_correlated_angles_t *slot;
+
+  for (uint32_t age = from_age; age < MAX_NUM_SEQUENCE_IDS; age++) {
+    slot = get_slot(tag, age);
+    if (slot != NULL) {
+      init_correlated_angle_data(slot);
     }
   }
 }
@@ -617,9 +3133,16 @@ static void push_completed_angle_data(aoa_asset_tag_t* tag, int32_t check_idx_fr
  *****************************************************************************/
 static int32_t sequence_diff(uint32_t old_seq, uint32_t new_seq)
 {
-  // Sequence is 16 bit long, so if the new sequence is smaller than the old
-  // one, it might overflowed.
-  int32_t result = old_seq <= new_seq ? new_seq - old_seq : -(65536 + new_seq - old_seq);
+  int32_t result;
+
+  if ((old_seq > SEQUENCE_MASK) || (new_seq > SEQUENCE_MASK)) {
+    return INT_MAX;
+  }
+  // Sequence is 16 bit long, take the shorter way around the overflow.
+  result = (int32_t)((new_seq - old_seq) & SEQUENCE_MASK);
+  if (result > SEQUENCE_MASK / 2) {
+    result -= SEQUENCE_MASK + 1;
+  }
   if (abs(result) > MAX_SEQUENCE_DIFF) {
     result = INT_MAX;
   }
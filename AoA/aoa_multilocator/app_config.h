@@ -32,14 +32,67 @@
 #define APP_CONFIG_H
 
 // Maximum number of locators handled by the application.
-#define MAX_NUM_LOCATORS        6
+#define MAX_NUM_LOCATORS        256
 
-// Maximum number of asset tags handled by the application.
-#define MAX_NUM_TAGS            50
+// Maximum number of zones. Each zone has its own set of locators.
+#define MAX_NUM_ZONES           64
+
+// Maximum number of locators in a zone. Asset tags are estimated using the
+// locators of a single zone.
+#define MAX_NUM_ZONE_LOCATORS   6
+
+// Maximum number of zones a locator can be part of.
+#define MAX_NUM_LOCATOR_ZONES   4
+
+// Number of angles that a zone handover decision is based on.
+#define ZONE_HANDOVER_WINDOW    32
+
+// An asset tag is handed over to a zone that received this many times more
+// angles than its current zone within a handover window.
+#define ZONE_HANDOVER_RATIO     2
+
+// Initial capacity of the asset tag table, it grows on demand.
+#define INITIAL_NUM_TAGS        50
+
+// Asset tags without angles for this long are evicted.
+// Can be overridden with the -t command line option. Use 0 to disable.
+#define TAG_IDLE_TIMEOUT_SEC    60.0f
+
+// Interval of checking for idle asset tags in seconds.
+#define TAG_EVICTION_INTERVAL_SEC 1
+
+// Number of position estimation threads. Use 0 for one per processor.
+// Can be overridden with the -j command line option.
+#define ESTIMATION_THREAD_COUNT 0
+
+// Number of angles an asset tag can queue for estimation. The oldest angle is
+// dropped on overflow.
+#define ANGLE_QUEUE_SIZE        16
+
+// Queued angles are stale when a locator reports an angle of the asset tag
+// this many sequences newer. The stale sequences are removed from the queue,
+// so that the estimation catches up with the newest angles after a backlog
+// instead of processing the history. Use 0 to disable.
+#define ANGLE_COALESCE_WINDOW   2
+
+// Speed of replaying a recording relative to the recorded arrival times.
+// Can be overridden with the -x command line option. Use 0 to replay as fast
+// as possible.
+#define REPLAY_SPEED            1.0f
 
 // Maximum number of incomplete sequence ids.
 #define MAX_NUM_SEQUENCE_IDS    6
 
+// Correlation deadline in milliseconds. When non-zero, the angles of a sequence
+// are estimated at the latest this long after the first of them arrived,
+// instead of waiting for the expected angle counts.
+// Can be overridden with the -d command line option. Use 0 to disable.
+#define CORRELATION_DEADLINE_MS 0
+
+// Number of angles of a sequence required for a provisional position in
+// deadline mode. The position is refined when the rest of the angles arrive.
+#define PROVISIONAL_NUM_ANGLES  2
+
 // Maximum sequence range where data does not reset.
 #define MAX_SEQUENCE_DIFF       20
 
@@ -50,7 +103,64 @@
 // This value should approximate the time interval between two consecutive CTEs.
 #define ESTIMATION_INTERVAL_SEC 0.1f
 
-// Filter weight applied on the location coordinates. Ranges from 0 to 1.
-#define FILTERING_AMOUNT        0.1f
+// Position publishing policy, can be overridden in the "publish" object of
+// the configuration file. A position is published when it moved at least
+// the dead-band since the last published position, but not more often than
+// the minimum interval. The position of a static asset tag is still published
+// after the keep-alive interval. Use 0 to disable the keep-alive.
+#define PUBLISH_DEADBAND_M      0.1f
+#define PUBLISH_MIN_INTERVAL_MS 50
+#define PUBLISH_KEEPALIVE_MS    5000
+
+// Requested edge length of the geofence grid cells in meters. Positions are
+// only tested against the geofences overlapping their cell.
+#define GEOFENCE_CELL_SIZE_M    1.0f
+
+// Size of the position history file given with the -H command line option.
+// A block of 256 bytes holds about 40 positions of a moving asset tag. When
+// all asset tag slots are in use, the least recently updated one is reused.
+#define HISTORY_NUM_TAGS        256
+#define HISTORY_NUM_BLOCKS      1024
+
+// Number of asset tags in the position snapshot served by the query service
+// of the -q command line option and by the shared memory table of the -L
+// command line option. The asset tag list grows past it, the asset tags above
+// are logged when added and their position updates are counted as dropped.
+#define SNAPSHOT_NUM_TAGS       8192
+
+// Edge length of the spatial index cells of the query service in meters.
+#define QUERY_CELL_SIZE_M       2.0f
+
+// Number of angles in the shared memory angle ring of the -a command line
+// option, and the longest wait for the next angle of the ring in microseconds.
+// MQTT is served between the waits.
+#define ANGLE_RING_SIZE         4096
+#define ANGLE_RING_WAIT_US      1000
+
+// Capacity of the outbound MQTT queue and its default overflow policy. The
+// messages are published on a dedicated network thread, so that estimation
+// does not wait for the broker. The policy can be overridden with the -o
+// command line option.
+#define MQTT_QUEUE_SIZE         1024
+#define MQTT_OVERFLOW_POLICY    AOA_OUTBOX_DROP_OLDEST
+
+// Speed limits of the estimation priority classes in m/s. Asset tags moving
+// faster than the first are promoted by one class, asset tags moving slower
+// than the second are demoted by one class. The classes are configured in the
+// "priorities" object of the configuration file.
+#define PRIORITY_MOVING_SPEED_M_S     0.5f
+#define PRIORITY_STATIONARY_SPEED_M_S 0.05f
+
+// Maximum number of consecutive estimates of a lowest class asset tag skipped
+// under overload. The next estimate runs regardless of the backlog.
+#define PRIORITY_MAX_COALESCED  4
+
+// Standard deviation of the asset tag acceleration in m/s^2 assumed by the
+// position filter. Higher values follow changes of the velocity faster.
+#define FILTER_ACCELERATION_NOISE 1.0f
+
+// Standard deviation of the estimated positions in meters assumed by the
+// position filter. Higher values smooth the positions more.
+#define FILTER_MEASUREMENT_NOISE  0.3f
 
 #endif // APP_CONFIG_H
@@ -0,0 +1,235 @@
+/***************************************************************************//**
+ * @file
+ * @brief Priority scheduler in front of a work pool.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "app_log.h"
+#include "app_assert.h"
+#include "priority_scheduler.h"
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void run_task(work_pool_task_t *work);
+static sl_status_t start_task(priority_scheduler_t *scheduler, priority_task_t *task);
+static priority_task_t *pop_task(priority_scheduler_t *scheduler);
+
+/***************************************************************************//**
+ * Initialize a scheduler.
+ ******************************************************************************/
+sl_status_t priority_scheduler_init(priority_scheduler_t *scheduler,
+                                    work_pool_t *pool,
+                                    uint32_t class_count,
+                                    uint32_t limit)
+{
+  if ((class_count == 0) || (class_count > PRIORITY_SCHEDULER_MAX_CLASSES)
+      || (limit == 0)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  memset(scheduler, 0, sizeof(*scheduler));
+  scheduler->pool = pool;
+  scheduler->class_count = class_count;
+  scheduler->limit = limit;
+  pthread_mutex_init(&scheduler->lock, NULL);
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Release the resources of a scheduler.
+ ******************************************************************************/
+void priority_scheduler_deinit(priority_scheduler_t *scheduler)
+{
+  pthread_mutex_destroy(&scheduler->lock);
+}
+
+/***************************************************************************//**
+ * Submit a task.
+ ******************************************************************************/
+sl_status_t priority_scheduler_submit(priority_scheduler_t *scheduler,
+                                      priority_task_t *task,
+                                      uint32_t priority)
+{
+  sl_status_t sc = SL_STATUS_OK;
+
+  if (priority >= scheduler->class_count) {
+    priority = scheduler->class_count - 1;
+  }
+  task->work.function = run_task;
+  task->work.context = task;
+  task->scheduler = scheduler;
+  task->priority = priority;
+  task->ready = aoa_trace_timestamp();
+  task->next = NULL;
+
+  pthread_mutex_lock(&scheduler->lock);
+  scheduler->stats[priority].submitted++;
+  if (scheduler->running < scheduler->limit) {
+    sc = start_task(scheduler, task);
+  } else {
+    // Defer the task until a worker finishes.
+    if (scheduler->tail[priority] != NULL) {
+      scheduler->tail[priority]->next = task;
+    } else {
+      scheduler->head[priority] = task;
+    }
+    scheduler->tail[priority] = task;
+    scheduler->backlog++;
+    scheduler->stats[priority].deferred++;
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+  return sc;
+}
+
+/***************************************************************************//**
+ * Get the number of deferred tasks.
+ ******************************************************************************/
+uint32_t priority_scheduler_backlog(priority_scheduler_t *scheduler)
+{
+  return __atomic_load_n(&scheduler->backlog, __ATOMIC_RELAXED);
+}
+
+/***************************************************************************//**
+ * Log the queue latency of the priority classes.
+ ******************************************************************************/
+void priority_scheduler_log(priority_scheduler_t *scheduler,
+                            const char *const *names)
+{
+  char name[64];
+
+  pthread_mutex_lock(&scheduler->lock);
+  for (uint32_t i = 0; i < scheduler->class_count; i++) {
+    if (scheduler->stats[i].submitted == 0) {
+      continue;
+    }
+    app_log("Priority %s: %llu tasks, %llu deferred, %llu aged\n",
+            names[i],
+            (unsigned long long)scheduler->stats[i].submitted,
+            (unsigned long long)scheduler->stats[i].deferred,
+            (unsigned long long)scheduler->stats[i].aged);
+    snprintf(name, sizeof(name), "Priority %s queue", names[i]);
+    aoa_trace_hist_log(&scheduler->stats[i].latency, name);
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+/***************************************************************************//**
+ * Work pool task, runs a task and starts the most urgent deferred one.
+ ******************************************************************************/
+static void run_task(work_pool_task_t *work)
+{
+  priority_task_t *task = work->context;
+  priority_scheduler_t *scheduler = task->scheduler;
+  priority_task_t *next;
+  sl_status_t sc;
+
+  pthread_mutex_lock(&scheduler->lock);
+  aoa_trace_hist_add(&scheduler->stats[task->priority].latency,
+                     aoa_trace_timestamp() - task->ready);
+  pthread_mutex_unlock(&scheduler->lock);
+
+  // The task may be submitted again from here on.
+  task->function(task);
+
+  pthread_mutex_lock(&scheduler->lock);
+  scheduler->running--;
+  next = pop_task(scheduler);
+  if (next != NULL) {
+    sc = start_task(scheduler, next);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to start deferred task\n",
+               (int)sc);
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+/***************************************************************************//**
+ * Hand a task over to the work pool.
+ *
+ * @note The lock of the scheduler must be held.
+ ******************************************************************************/
+static sl_status_t start_task(priority_scheduler_t *scheduler, priority_task_t *task)
+{
+  sl_status_t sc;
+
+  sc = work_pool_submit(scheduler->pool, &task->work);
+  if (sc == SL_STATUS_OK) {
+    scheduler->running++;
+  }
+  return sc;
+}
+
+/***************************************************************************//**
+ * Remove the next deferred task to start.
+ *
+ * The oldest task that has waited PRIORITY_SCHEDULER_AGING_US goes first,
+ * otherwise the oldest task of the most urgent class.
+ *
+ * @note The lock of the scheduler must be held.
+ ******************************************************************************/
+static priority_task_t *pop_task(priority_scheduler_t *scheduler)
+{
+  uint64_t now = aoa_trace_timestamp();
+  uint32_t urgent = scheduler->class_count;
+  uint32_t aged = scheduler->class_count;
+  uint32_t i;
+  priority_task_t *task;
+
+  for (i = 0; i < scheduler->class_count; i++) {
+    task = scheduler->head[i];
+    if (task == NULL) {
+      continue;
+    }
+    if (urgent == scheduler->class_count) {
+      urgent = i;
+    }
+    // The head is the oldest task of its class.
+    if ((now - task->ready >= PRIORITY_SCHEDULER_AGING_US)
+        && ((aged == scheduler->class_count)
+            || (task->ready < scheduler->head[aged]->ready))) {
+      aged = i;
+    }
+  }
+  if (urgent == scheduler->class_count) {
+    return NULL;
+  }
+  i = urgent;
+  if ((aged != scheduler->class_count) && (aged != urgent)) {
+    i = aged;
+    scheduler->stats[i].aged++;
+  }
+
+  task = scheduler->head[i];
+  scheduler->head[i] = task->next;
+  if (scheduler->head[i] == NULL) {
+    scheduler->tail[i] = NULL;
+  }
+  scheduler->backlog--;
+  return task;
+}
@@ -0,0 +1,162 @@
+/***************************************************************************//**
+ * @file
+ * @brief Priority scheduler in front of a work pool.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef PRIORITY_SCHEDULER_H
+#define PRIORITY_SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sl_status.h"
+#include "aoa_trace.h"
+#include "work_pool.h"
+
+// Maximum number of priority classes. Class 0 is the most urgent.
+#define PRIORITY_SCHEDULER_MAX_CLASSES  4
+
+// Waiting time in microseconds after which a deferred task is started before
+// the more urgent classes, so that a saturated pool does not starve the less
+// urgent ones.
+#define PRIORITY_SCHEDULER_AGING_US     200000
+
+typedef struct priority_scheduler_s priority_scheduler_t;
+typedef struct priority_task_s priority_task_t;
+
+typedef void (*priority_task_function_t)(priority_task_t *task);
+
+// Task to be embedded in the structure it belongs to. A task must not be
+// submitted again before its function has been called.
+struct priority_task_s {
+  priority_task_function_t function;
+  void *context;
+  // Private fields.
+  work_pool_task_t work;    // submitted to the work pool
+  priority_scheduler_t *scheduler;
+  priority_task_t *next;    // next deferred task of the class
+  uint32_t priority;
+  uint64_t ready;           // submission time
+};
+
+// Per class statistics.
+typedef struct {
+  aoa_trace_hist_t latency; // submission to start of the task
+  uint64_t submitted;
+  uint64_t deferred;        // tasks that waited for a free worker
+  uint64_t aged;            // deferred tasks started ahead of more urgent ones
+} priority_scheduler_stats_t;
+
+struct priority_scheduler_s {
+  work_pool_t *pool;
+  uint32_t class_count;
+  uint32_t limit;           // maximum number of tasks in the work pool
+  pthread_mutex_t lock;     // protects the fields below
+  uint32_t running;         // tasks in the work pool
+  uint32_t backlog;         // deferred tasks
+  priority_task_t *head[PRIORITY_SCHEDULER_MAX_CLASSES];
+  priority_task_t *tail[PRIORITY_SCHEDULER_MAX_CLASSES];
+  priority_scheduler_stats_t stats[PRIORITY_SCHEDULER_MAX_CLASSES];
+};
+
+/***************************************************************************//**
+ * Initialize a scheduler.
+ *
+ * At most limit tasks are handed over to the work pool at a time, further
+ * tasks are deferred. When a task finishes, the oldest deferred task of the
+ * most urgent class takes its place, so urgent tasks do not queue behind less
+ * urgent ones. A deferred task that has waited PRIORITY_SCHEDULER_AGING_US
+ * is started first regardless of its class, which bounds the waiting time of
+ * the less urgent classes while the urgent ones keep the workers busy. Use the
+ * number of workers as the limit to keep them busy.
+ *
+ * @param[out] scheduler Scheduler.
+ * @param[in] pool Work pool running the tasks.
+ * @param[in] class_count Number of priority classes.
+ * @param[in] limit Maximum number of tasks in the work pool.
+ *
+ * @retval SL_STATUS_OK Scheduler initialized.
+ * @retval SL_STATUS_INVALID_PARAMETER Invalid class count or limit.
+ ******************************************************************************/
+sl_status_t priority_scheduler_init(priority_scheduler_t *scheduler,
+                                    work_pool_t *pool,
+                                    uint32_t class_count,
+                                    uint32_t limit);
+
+/***************************************************************************//**
+ * Release the resources of a scheduler.
+ *
+ * The work pool must have run all tasks, which also runs the deferred ones.
+ *
+ * @param[in] scheduler Scheduler.
+ ******************************************************************************/
+void priority_scheduler_deinit(priority_scheduler_t *scheduler);
+
+/***************************************************************************//**
+ * Submit a task.
+ *
+ * @param[in] scheduler Scheduler.
+ * @param[in] task Task to run.
+ * @param[in] priority Priority class of the task, clamped to the class count.
+ *
+ * @retval SL_STATUS_OK Task queued or deferred.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t priority_scheduler_submit(priority_scheduler_t *scheduler,
+                                      priority_task_t *task,
+                                      uint32_t priority);
+
+/***************************************************************************//**
+ * Get the number of deferred tasks.
+ *
+ * A non-zero backlog means that the tasks arrive faster than the workers run
+ * them.
+ *
+ * @param[in] scheduler Scheduler.
+ * @return Number of tasks waiting for a free worker.
+ ******************************************************************************/
+uint32_t priority_scheduler_backlog(priority_scheduler_t *scheduler);
+
+/***************************************************************************//**
+ * Log the queue latency of the priority classes.
+ *
+ * @param[in] scheduler Scheduler.
+ * @param[in] names Name of each class.
+ ******************************************************************************/
+void priority_scheduler_log(priority_scheduler_t *scheduler,
+                            const char *const *names);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // PRIORITY_SCHEDULER_H
@@ -0,0 +1,178 @@
+/***************************************************************************//**
+ * @file
+ * @brief Hashed timer wheel.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "timer_wheel.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define WHEEL_MASK          (TIMER_WHEEL_SIZE - 1)
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void unlink_timer(timer_wheel_timer_t *timer);
+static void expire_bucket(timer_wheel_t *wheel, uint32_t index, uint64_t tick);
+
+/***************************************************************************//**
+ * Initialize a timer wheel.
+ ******************************************************************************/
+void timer_wheel_init(timer_wheel_t *wheel,
+                      uint32_t tick_us,
+                      uint64_t now_us,
+                      timer_wheel_callback_t callback)
+{
+  for (uint32_t i = 0; i < TIMER_WHEEL_SIZE; i++) {
+    wheel->bucket[i].next = &wheel->bucket[i];
+    wheel->bucket[i].prev = &wheel->bucket[i];
+  }
+  wheel->tick_us = tick_us;
+  wheel->tick = now_us / tick_us;
+  wheel->count = 0;
+  wheel->callback = callback;
+}
+
+/***************************************************************************//**
+ * Initialize a timer in stopped state.
+ ******************************************************************************/
+void timer_wheel_timer_init(timer_wheel_timer_t *timer, void *context)
+{
+  timer->next = NULL;
+  timer->prev = NULL;
+  timer->expiry = 0;
+  timer->context = context;
+}
+
+/***************************************************************************//**
+ * Start or restart a timer.
+ ******************************************************************************/
+void timer_wheel_start(timer_wheel_t *wheel,
+                       timer_wheel_timer_t *timer,
+                       uint64_t expiry_us)
+{
+  timer_wheel_timer_t *head;
+
+  timer_wheel_stop(wheel, timer);
+
+  // Round up to never expire early, and never schedule into the past.
+  timer->expiry = (expiry_us + wheel->tick_us - 1) / wheel->tick_us;
+  if (timer->expiry <= wheel->tick) {
+    timer->expiry = wheel->tick + 1;
+  }
+
+  head = &wheel->bucket[timer->expiry & WHEEL_MASK];
+  timer->next = head;
+  timer->prev = head->prev;
+  head->prev->next = timer;
+  head->prev = timer;
+  wheel->count++;
+}
+
+/***************************************************************************//**
+ * Stop a timer.
+ ******************************************************************************/
+void timer_wheel_stop(timer_wheel_t *wheel, timer_wheel_timer_t *timer)
+{
+  if (timer_wheel_is_running(timer)) {
+    unlink_timer(timer);
+    wheel->count--;
+  }
+}
+
+/***************************************************************************//**
+ * Check if a timer is running.
+ ******************************************************************************/
+bool timer_wheel_is_running(timer_wheel_timer_t *timer)
+{
+  return timer->next != NULL;
+}
+
+/***************************************************************************//**
+ * Advance the timer wheel and call the callback for the expired timers.
+ ******************************************************************************/
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_us)
+{
+  uint64_t now = now_us / wheel->tick_us;
+
+  // Visiting each bucket once is enough, however long the gap is.
+  if (now - wheel->tick > TIMER_WHEEL_SIZE) {
+    wheel->tick = now - TIMER_WHEEL_SIZE;
+  }
+  while ((wheel->tick < now) && (wheel->count > 0)) {
+    wheel->tick++;
+    expire_bucket(wheel, wheel->tick & WHEEL_MASK, now);
+  }
+  wheel->tick = now;
+}
+
+/***************************************************************************//**
+ * Remove a timer from its bucket.
+ ******************************************************************************/
+static void unlink_timer(timer_wheel_timer_t *timer)
+{
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = NULL;
+  timer->prev = NULL;
+}
+
+/***************************************************************************//**
+ * Fire the expired timers of a bucket.
+ ******************************************************************************/
+static void expire_bucket(timer_wheel_t *wheel, uint32_t index, uint64_t tick)
+{
+  timer_wheel_timer_t *head = &wheel->bucket[index];
+  timer_wheel_timer_t expired;
+  timer_wheel_timer_t *timer;
+
+  // Collect expired timers first, the callbacks may modify the bucket.
+  expired.next = &expired;
+  expired.prev = &expired;
+  timer = head->next;
+  while (timer != head) {
+    timer_wheel_timer_t *next = timer->next;
+    if (timer->expiry <= tick) {
+      unlink_timer(timer);
+      timer->next = &expired;
+      timer->prev = expired.prev;
+      expired.prev->next = timer;
+      expired.prev = timer;
+    }
+    timer = next;
+  }
+
+  while (expired.next != &expired) {
+    timer = expired.next;
+    unlink_timer(timer);
+    wheel->count--;
+    wheel->callback(timer);
+  }
+}
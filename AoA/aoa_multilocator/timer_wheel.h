@@ -0,0 +1,128 @@
+/***************************************************************************//**
+ * @file
+ * @brief Hashed timer wheel.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Number of buckets, must be a power of 2. Timers further than this many ticks
+// in the future stay in their bucket for multiple rounds.
+#define TIMER_WHEEL_SIZE  256
+
+typedef struct timer_wheel_timer_s timer_wheel_timer_t;
+
+typedef void (*timer_wheel_callback_t)(timer_wheel_timer_t *timer);
+
+// Timer to be embedded in the structure it belongs to.
+struct timer_wheel_timer_s {
+  timer_wheel_timer_t *next;
+  timer_wheel_timer_t *prev;
+  uint64_t expiry; // tick
+  void *context;
+};
+
+typedef struct {
+  timer_wheel_timer_t bucket[TIMER_WHEEL_SIZE]; // list heads
+  uint64_t tick;      // last processed tick
+  uint32_t tick_us;   // tick length in microseconds
+  uint32_t count;     // number of running timers
+  timer_wheel_callback_t callback;
+} timer_wheel_t;
+
+/***************************************************************************//**
+ * Initialize a timer wheel.
+ *
+ * @param[out] wheel Timer wheel.
+ * @param[in] tick_us Resolution of the timer wheel in microseconds.
+ * @param[in] now_us Current time in microseconds.
+ * @param[in] callback Function called on timer expiry.
+ ******************************************************************************/
+void timer_wheel_init(timer_wheel_t *wheel,
+                      uint32_t tick_us,
+                      uint64_t now_us,
+                      timer_wheel_callback_t callback);
+
+/***************************************************************************//**
+ * Initialize a timer in stopped state.
+ *
+ * @param[out] timer Timer.
+ * @param[in] context User context.
+ ******************************************************************************/
+void timer_wheel_timer_init(timer_wheel_timer_t *timer, void *context);
+
+/***************************************************************************//**
+ * Start or restart a timer.
+ *
+ * @param[in] wheel Timer wheel.
+ * @param[in] timer Timer.
+ * @param[in] expiry_us Expiry time in microseconds.
+ ******************************************************************************/
+void timer_wheel_start(timer_wheel_t *wheel,
+                       timer_wheel_timer_t *timer,
+                       uint64_t expiry_us);
+
+/***************************************************************************//**
+ * Stop a timer. Stopping a stopped timer has no effect.
+ *
+ * @param[in] wheel Timer wheel.
+ * @param[in] timer Timer.
+ ******************************************************************************/
+void timer_wheel_stop(timer_wheel_t *wheel, timer_wheel_timer_t *timer);
+
+/***************************************************************************//**
+ * Check if a timer is running.
+ *
+ * @param[in] timer Timer.
+ * @return true if the timer is running.
+ ******************************************************************************/
+bool timer_wheel_is_running(timer_wheel_timer_t *timer);
+
+/***************************************************************************//**
+ * Advance the timer wheel and call the callback for the expired timers.
+ *
+ * Expired timers are stopped before their callback is called, so the callback
+ * is allowed to restart or stop any timer.
+ *
+ * @param[in] wheel Timer wheel.
+ * @param[in] now_us Current time in microseconds.
+ ******************************************************************************/
+void timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_us);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // TIMER_WHEEL_H
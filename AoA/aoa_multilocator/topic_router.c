@@ -0,0 +1,175 @@
+/***************************************************************************//**
+ * @file
+ * @brief Prefix trie based MQTT topic router.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include "topic_router.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define ROOT_NODE      0
+#define NO_NODE        0
+#define INITIAL_SIZE   64
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static uint32_t find_child(topic_router_t *router, uint32_t node, char c);
+static uint32_t add_child(topic_router_t *router, uint32_t node, char c);
+
+/***************************************************************************//**
+ * Initialize a topic router.
+ ******************************************************************************/
+sl_status_t topic_router_init(topic_router_t *router)
+{
+  router->nodes = malloc(INITIAL_SIZE * sizeof(topic_router_node_t));
+  if (router->nodes == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  router->size = INITIAL_SIZE;
+  router->count = 1;
+  router->nodes[ROOT_NODE].child = NO_NODE;
+  router->nodes[ROOT_NODE].sibling = NO_NODE;
+  router->nodes[ROOT_NODE].value = TOPIC_ROUTER_NO_MATCH;
+  router->nodes[ROOT_NODE].c = '\0';
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Release resources of a topic router.
+ ******************************************************************************/
+void topic_router_deinit(topic_router_t *router)
+{
+  free(router->nodes);
+  router->nodes = NULL;
+  router->count = 0;
+  router->size = 0;
+}
+
+/***************************************************************************//**
+ * Register a topic prefix.
+ ******************************************************************************/
+sl_status_t topic_router_add(topic_router_t *router,
+                             const char *prefix,
+                             uint32_t value)
+{
+  uint32_t node = ROOT_NODE;
+  uint32_t next;
+
+  if ((prefix[0] == '\0') || (value == TOPIC_ROUTER_NO_MATCH)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  for (const char *c = prefix; *c != '\0'; c++) {
+    if (router->nodes[node].value != TOPIC_ROUTER_NO_MATCH) {
+      // An existing prefix would shadow the new one.
+      return SL_STATUS_ALREADY_EXISTS;
+    }
+    next = find_child(router, node, *c);
+    if (next == NO_NODE) {
+      next = add_child(router, node, *c);
+      if (next == NO_NODE) {
+        return SL_STATUS_ALLOCATION_FAILED;
+      }
+    }
+    node = next;
+  }
+
+  if ((router->nodes[node].value != TOPIC_ROUTER_NO_MATCH)
+      || (router->nodes[node].child != NO_NODE)) {
+    return SL_STATUS_ALREADY_EXISTS;
+  }
+  router->nodes[node].value = value;
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Match a topic against the registered prefixes.
+ ******************************************************************************/
+uint32_t topic_router_match(topic_router_t *router,
+                            const char *topic,
+                            const char **rest)
+{
+  uint32_t node = ROOT_NODE;
+
+  for (const char *c = topic; *c != '\0'; c++) {
+    node = find_child(router, node, *c);
+    if (node == NO_NODE) {
+      return TOPIC_ROUTER_NO_MATCH;
+    }
+    if (router->nodes[node].value != TOPIC_ROUTER_NO_MATCH) {
+      *rest = c + 1;
+      return router->nodes[node].value;
+    }
+  }
+  return TOPIC_ROUTER_NO_MATCH;
+}
+
+/***************************************************************************//**
+ * Find the child of a node with the given character.
+ ******************************************************************************/
+static uint32_t find_child(topic_router_t *router, uint32_t node, char c)
+{
+  uint32_t child = router->nodes[node].child;
+
+  while ((child != NO_NODE) && (router->nodes[child].c != c)) {
+    child = router->nodes[child].sibling;
+  }
+  return child;
+}
+
+/***************************************************************************//**
+ * Add a new child to a node.
+ ******************************************************************************/
+static uint32_t add_child(topic_router_t *router, uint32_t node, char c)
+{
+  topic_router_node_t *nodes;
+  uint32_t child;
+
+  if (router->count == router->size) {
+    nodes = realloc(router->nodes, 2 * router->size * sizeof(topic_router_node_t));
+    if (nodes == NULL) {
+      return NO_NODE;
+    }
+    router->nodes = nodes;
+    router->size *= 2;
+  }
+
+  child = router->count++;
+  router->nodes[child].c = c;
+  router->nodes[child].child = NO_NODE;
+  router->nodes[child].value = TOPIC_ROUTER_NO_MATCH;
+  router->nodes[child].sibling = router->nodes[node].child;
+  router->nodes[node].child = child;
+
+  return child;
+}
@@ -0,0 +1,105 @@
+/***************************************************************************//**
+ * @file
+ * @brief Prefix trie based MQTT topic router.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sl_status.h"
+
+// Value returned when a topic does not match any registered prefix.
+#define TOPIC_ROUTER_NO_MATCH  UINT32_MAX
+
+typedef struct {
+  uint32_t child;   // index of the first child node, 0 if none
+  uint32_t sibling; // index of the next sibling node, 0 if none
+  uint32_t value;   // value of the prefix ending at this node
+  char c;
+} topic_router_node_t;
+
+typedef struct {
+  topic_router_node_t *nodes; // node 0 is the root
+  uint32_t count;
+  uint32_t size;
+} topic_router_t;
+
+/***************************************************************************//**
+ * Initialize a topic router.
+ *
+ * @param[out] router Topic router.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t topic_router_init(topic_router_t *router);
+
+/***************************************************************************//**
+ * Release resources of a topic router.
+ *
+ * @param[in] router Topic router.
+ ******************************************************************************/
+void topic_router_deinit(topic_router_t *router);
+
+/***************************************************************************//**
+ * Register a topic prefix.
+ *
+ * A registered prefix must not be the prefix of another registered prefix.
+ *
+ * @param[in] router Topic router.
+ * @param[in] prefix Topic prefix, e.g. "silabs/aoa/angle/<locator>/".
+ * @param[in] value Value returned when a topic matches the prefix.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t topic_router_add(topic_router_t *router,
+                             const char *prefix,
+                             uint32_t value);
+
+/***************************************************************************//**
+ * Match a topic against the registered prefixes.
+ *
+ * The topic is walked only once, unknown topics are rejected at the first
+ * character that does not match any prefix.
+ *
+ * @param[in] router Topic router.
+ * @param[in] topic Topic string.
+ * @param[out] rest Remaining part of the topic after the matching prefix.
+ * @return Value of the matching prefix or TOPIC_ROUTER_NO_MATCH.
+ ******************************************************************************/
+uint32_t topic_router_match(topic_router_t *router,
+                            const char *topic,
+                            const char **rest);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // TOPIC_ROUTER_H
@@ -0,0 +1,963 @@
+/***************************************************************************//**
+ * @file
+ * @brief AoA synthetic scenario generator.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <pthread.h>
+#include "app_log.h"
+#include "app_assert.h"
+#include "mqtt.h"
+#include "aoa_util.h"
+#include "aoa_parse.h"
+#include "aoa_trace.h"
+#include "aoa_solver.h"
+#include "aoa_record.h"
+#include "aoa_codec.h"
+#include "aoa_query.h"
+#include "app_config.h"
+#include "app.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define USAGE                    "\nUsage: %s -c <config> [-m <address>[:<port>] | -o <record_file>] [-n <tags>] [-f <cte_rate_hz>] [-d <duration_s>] [-a <angle_noise_deg>] [-l <loss>] [-j <jitter_ms>] [-r <range_m>] [-s <seed>] [-e <json|binary>]\n       %s -c <config> -Q <query_socket> [-n <tags>] [-d <duration_s>]\n       %s -B <angles>\n"
+
+// Sequence numbers are 16 bit long.
+#define SEQUENCE_MASK            0xFFFF
+
+// Locator index of a ground truth message.
+#define TRUTH_IDX                UINT32_MAX
+
+// Longest sleep while waiting for the next message.
+#define POLL_US                  1000
+
+#define NUM_CHANNELS             37
+
+enum axis_list {
+  AXIS_X,
+  AXIS_Y,
+  AXIS_Z,
+  AXIS_COUNT
+};
+
+// -----------------------------------------------------------------------------
+// Private types
+
+typedef struct {
+  aoa_id_t id;
+  struct sl_rtl_loc_locator_item item;
+  aoa_solver_locator_t pose;
+} aoa_locator_t;
+
+typedef struct {
+  aoa_id_t id;
+  float position[AXIS_COUNT];
+  float waypoint[AXIS_COUNT];
+  uint64_t phase;     // CTE time from the start of the period
+  int32_t sequence;
+} aoa_tag_t;
+
+// Query load connection.
+typedef struct {
+  pthread_t thread;
+  const char *path;   // socket of the query service
+  uint64_t random;    // state of the random generator
+  uint64_t end;       // end of the load
+  uint64_t tag_count; // asset tag queries
+  uint64_t near_count; // near queries
+  uint64_t errors;
+  uint64_t latency;   // sum of the query latencies in microseconds
+  uint64_t max_latency;
+} aoa_query_load_t;
+
+// Message waiting for its arrival time.
+typedef struct {
+  uint64_t arrival;
+  uint64_t capture;
+  uint32_t tag_idx;
+  uint32_t loc_idx;   // TRUTH_IDX for ground truth
+  union {
+    aoa_angle_t angle;
+    aoa_position_t truth;
+  } data;
+} aoa_message_t;
+
+// -----------------------------------------------------------------------------
+// Private variables
+
+static mqtt_handle_t mqtt_handle = MQTT_DEFAULT_HANDLE;
+static char client_id[] = "aoa_scenario";
+
+static aoa_locator_t locator_list[MAX_NUM_LOCATORS];
+static uint32_t locator_count = 0;
+
+static aoa_tag_t *tag_list = NULL;
+static uint32_t tag_count = TAG_COUNT;
+
+// Scenario parameters.
+static float cte_rate = CTE_RATE_HZ;
+static float duration = SCENARIO_DURATION_SEC;
+static float angle_noise = ANGLE_NOISE_DEG;
+static float angle_loss = ANGLE_LOSS;
+static float jitter_ms = MESSAGE_JITTER_MS;
+static float locator_range = LOCATOR_RANGE_M;
+static uint64_t random_state = RANDOM_SEED;
+
+// Area of the waypoints.
+static float site_min[AXIS_COUNT];
+static float site_max[AXIS_COUNT];
+
+// Messages ordered by arrival time in a binary heap.
+static aoa_message_t *message_heap = NULL;
+static uint32_t message_count = 0;
+static uint32_t message_capacity = 0;
+
+// Encoding of the angle messages.
+static enum aoa_codec_encoding angle_encoding = AOA_CODEC_ENCODING_JSON;
+
+// Output recording, MQTT is used if not open.
+static aoa_record_t recording = { NULL };
+
+static uint64_t start_time;
+static uint64_t cte_period_us;
+static uint64_t next_period;        // start of the next CTE period
+static bool generating = true;
+static bool finished = false;
+
+// Statistics.
+static uint32_t period_count = 0;
+static uint32_t angle_count = 0;
+static uint32_t lost_count = 0;
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void parse_config(char *filename);
+static void init_tags(void);
+static void move_tag(aoa_tag_t *tag, float time_step);
+static void random_waypoint(aoa_tag_t *tag);
+static void generate_period(uint64_t period_start);
+static void push_message(aoa_message_t *msg);
+static void pop_message(aoa_message_t *msg);
+static void send_message(aoa_message_t *msg);
+static void finish(void);
+static void run_benchmark(uint32_t count);
+static void run_query_load(const char *path);
+static void *run_query_connection(void *arg);
+static uint64_t random_next(void);
+static uint64_t random_next_state(uint64_t *state);
+static float random_uniform(void);
+static float random_gauss(void);
+
+/**************************************************************************//**
+ * Application Init.
+ *****************************************************************************/
+void app_init(int argc, char* argv[])
+{
+  sl_status_t sc;
+  mqtt_status_t rc;
+  int opt;
+  char *port_str = NULL;
+  char *config_file = NULL;
+  char *record_file = NULL;
+  char *query_socket = NULL;
+
+  // Parse command line arguments.
+  while ((opt = getopt(argc, argv, "c:m:o:n:f:d:a:l:j:r:s:e:B:Q:h")) != -1) {
+    switch (opt) {
+      // Configuration file.
+      case 'c':
+        config_file = optarg;
+        break;
+
+      // MQTT broker connection parameters.
+      case 'm':
+        mqtt_handle.host = strtok(optarg, ":");
+        port_str = strtok(NULL, ":");
+        if (port_str != NULL) {
+          mqtt_handle.port = atoi(port_str);
+        }
+        break;
+
+      // Write a recording instead of publishing.
+      case 'o':
+        record_file = optarg;
+        break;
+
+      // Number of asset tags.
+      case 'n':
+        tag_count = atoi(optarg);
+        break;
+
+      // CTE rate.
+      case 'f':
+        cte_rate = atof(optarg);
+        break;
+
+      // Scenario length.
+      case 'd':
+        duration = atof(optarg);
+        break;
+
+      // Angle noise.
+      case 'a':
+        angle_noise = atof(optarg);
+        break;
+
+      // Angle loss probability.
+      case 'l':
+        angle_loss = atof(optarg);
+        break;
+
+      // Arrival jitter.
+      case 'j':
+        jitter_ms = atof(optarg);
+        break;
+
+      // Locator range.
+      case 'r':
+        locator_range = atof(optarg);
+        break;
+
+      // Random seed.
+      case 's':
+        random_state = strtoull(optarg, NULL, 0);
+        break;
+
+      // Angle encoding.
+      case 'e':
+        if (aoa_codec_parse_encoding(optarg, &angle_encoding) != SL_STATUS_OK) {
+          app_log(USAGE, argv[0], argv[0], argv[0]);
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Benchmark the angle decoders.
+      case 'B':
+        run_benchmark(atoi(optarg));
+        exit(EXIT_SUCCESS);
+
+      // Load the query service of a multilocator.
+      case 'Q':
+        query_socket = optarg;
+        break;
+
+      // Help.
+      case 'h':
+        app_log(USAGE, argv[0], argv[0], argv[0]);
+        exit(EXIT_SUCCESS);
+
+      // Illegal option.
+      default:
+        app_log(USAGE, argv[0], argv[0], argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  // Configuration file is mandatory, a recording must end.
+  if ((config_file == NULL)
+      || (cte_rate <= 0)
+      || (tag_count == 0)
+      || ((record_file != NULL) && (duration <= 0))) {
+    app_log(USAGE, argv[0], argv[0], argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  // The generator state must not be zero.
+  if (random_state == 0) {
+    random_state = RANDOM_SEED;
+  }
+
+  parse_config(config_file);
+  init_tags();
+
+  if (query_socket != NULL) {
+    app_assert(duration > 0, "Query load needs a duration\n");
+    run_query_load(query_socket);
+    exit(EXIT_SUCCESS);
+  }
+
+  app_log("Asset tags: %u, CTE rate: %.1f Hz, duration: %.1f s\n",
+          tag_count,
+          cte_rate,
+          duration);
+  app_log("Angle noise: %.2f deg, loss: %.3f, jitter: %.1f ms, range: %.1f m\n",
+          angle_noise,
+          angle_loss,
+          jitter_ms,
+          locator_range);
+
+  if (record_file != NULL) {
+    sc = aoa_record_create(&recording, record_file);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to create recording %s\n",
+               (int)sc,
+               record_file);
+    app_log("Recording to %s\n", record_file);
+  } else {
+    mqtt_handle.client_id = client_id;
+    rc = mqtt_init(&mqtt_handle);
+    app_assert(rc == MQTT_SUCCESS, "MQTT init failed.\n");
+  }
+
+  start_time = aoa_trace_timestamp();
+  cte_period_us = (uint64_t)(1000000.0f / cte_rate);
+  next_period = start_time;
+
+  app_log("\nPress Crtl+C to quit\n\n");
+}
+
+/**************************************************************************//**
+ * Application Process Action.
+ *****************************************************************************/
+void app_process_action(void)
+{
+  mqtt_status_t rc;
+  uint64_t now, next;
+  aoa_message_t msg;
+
+  if (finished) {
+    usleep(POLL_US);
+    return;
+  }
+
+  if (recording.file != NULL) {
+    // Recordings are generated as fast as possible, the time of the scenario
+    // jumps from period to period.
+    now = generating ? next_period : UINT64_MAX;
+  } else {
+    rc = mqtt_step(&mqtt_handle);
+    app_assert(rc == MQTT_SUCCESS, "MQTT step failed.\n");
+    now = aoa_trace_timestamp();
+  }
+
+  // Messages are sent in arrival order.
+  while ((message_count > 0) && (message_heap[0].arrival <= now)) {
+    pop_message(&msg);
+    send_message(&msg);
+  }
+
+  if (generating && (next_period <= now)) {
+    generate_period(next_period);
+    next_period += cte_period_us;
+    if ((duration > 0)
+        && (next_period - start_time >= (uint64_t)(duration * 1000000.0f))) {
+      generating = false;
+    }
+    return;
+  }
+
+  if (!generating && (message_count == 0)) {
+    finish();
+    return;
+  }
+
+  // Wait for the next period or message.
+  next = generating ? next_period : UINT64_MAX;
+  if ((message_count > 0) && (message_heap[0].arrival < next)) {
+    next = message_heap[0].arrival;
+  }
+  if (next > now) {
+    usleep((next - now < POLL_US) ? (useconds_t)(next - now) : POLL_US);
+  }
+}
+
+/**************************************************************************//**
+ * Application Deinit.
+ *****************************************************************************/
+void app_deinit(void)
+{
+  double seconds = (aoa_trace_timestamp() - start_time) / 1000000.0;
+
+  if (recording.file == NULL) {
+    mqtt_deinit(&mqtt_handle);
+  }
+  aoa_record_close(&recording);
+
+  app_log("Generated %u CTE periods, %u angles, %u angles lost, in %.3f s\n",
+          period_count,
+          angle_count,
+          lost_count,
+          seconds);
+  if (seconds > 0) {
+    app_log("Angle rate: %.1f angles/s\n", angle_count / seconds);
+  }
+  free(tag_list);
+  free(message_heap);
+}
+
+/**************************************************************************//**
+ * Configuration file parser.
+ *****************************************************************************/
+static void parse_config(char *filename)
+{
+  sl_status_t sc;
+  char *buffer;
+  aoa_id_t multilocator_id;
+  aoa_locator_t *loc;
+
+  buffer = load_file(filename);
+  app_assert(buffer != NULL, "Failed to load file: %s\n", filename);
+
+  sc = aoa_parse_init(buffer);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] aoa_parse_init failed\n",
+             (int)sc);
+
+  sc = aoa_parse_multilocator(multilocator_id);
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] aoa_parse_multilocator failed\n",
+             (int)sc);
+
+  do {
+    loc = &locator_list[locator_count];
+    sc = aoa_parse_locator(loc->id, &loc->item);
+    if (sc == SL_STATUS_OK) {
+      aoa_solver_locator_init(&loc->pose, &loc->item);
+      ++locator_count;
+    } else {
+      app_assert(sc == SL_STATUS_NOT_FOUND,
+                 "[E: 0x%04x] aoa_parse_locator failed\n",
+                 (int)sc);
+    }
+  } while ((locator_count < MAX_NUM_LOCATORS) && (sc == SL_STATUS_OK));
+
+  app_assert(locator_count > 0, "No locators in %s\n", filename);
+  app_log("Locator count: %d\n", locator_count);
+
+  sc = aoa_parse_deinit();
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] aoa_parse_deinit failed\n",
+             (int)sc);
+
+  free(buffer);
+}
+
+/**************************************************************************//**
+ * Place the asset tags randomly on the site.
+ *****************************************************************************/
+static void init_tags(void)
+{
+  aoa_tag_t *tag;
+
+  // Bounding box of the locators.
+  for (enum axis_list i = 0; i < AXIS_COUNT; i++) {
+    site_min[i] = locator_list[0].pose.origin[i];
+    site_max[i] = locator_list[0].pose.origin[i];
+  }
+  for (uint32_t i = 1; i < locator_count; i++) {
+    for (enum axis_list j = 0; j < AXIS_COUNT; j++) {
+      site_min[j] = fminf(site_min[j], locator_list[i].pose.origin[j]);
+      site_max[j] = fmaxf(site_max[j], locator_list[i].pose.origin[j]);
+    }
+  }
+  site_min[AXIS_X] -= SITE_MARGIN_M;
+  site_min[AXIS_Y] -= SITE_MARGIN_M;
+  site_max[AXIS_X] += SITE_MARGIN_M;
+  site_max[AXIS_Y] += SITE_MARGIN_M;
+  site_min[AXIS_Z] = TAG_HEIGHT_M;
+  site_max[AXIS_Z] = TAG_HEIGHT_M;
+
+  tag_list = malloc(tag_count * sizeof(aoa_tag_t));
+  app_assert(tag_list != NULL, "Failed to allocate asset tags\n");
+
+  for (uint32_t i = 0; i < tag_count; i++) {
+    tag = &tag_list[i];
+    snprintf(tag->id, sizeof(tag->id), "sim-tag-%05u", i);
+    random_waypoint(tag);
+    memcpy(tag->position, tag->waypoint, sizeof(tag->position));
+    random_waypoint(tag);
+    tag->phase = (uint64_t)(random_uniform() * 1000000.0f / cte_rate);
+    tag->sequence = (int32_t)(random_next() & SEQUENCE_MASK);
+  }
+}
+
+/**************************************************************************//**
+ * Move an asset tag towards its waypoint.
+ *****************************************************************************/
+static void move_tag(aoa_tag_t *tag, float time_step)
+{
+  float diff[AXIS_COUNT];
+  float distance = 0.0f;
+  float step = TAG_SPEED_MPS * time_step;
+
+  for (enum axis_list i = 0; i < AXIS_COUNT; i++) {
+    diff[i] = tag->waypoint[i] - tag->position[i];
+    distance += diff[i] * diff[i];
+  }
+  distance = sqrtf(distance);
+
+  if (distance <= step) {
+    memcpy(tag->position, tag->waypoint, sizeof(tag->position));
+    random_waypoint(tag);
+    return;
+  }
+  for (enum axis_list i = 0; i < AXIS_COUNT; i++) {
+    tag->position[i] += diff[i] * step / distance;
+  }
+}
+
+/**************************************************************************//**
+ * Select a new waypoint for an asset tag.
+ *****************************************************************************/
+static void random_waypoint(aoa_tag_t *tag)
+{
+  for (enum axis_list i = 0; i < AXIS_COUNT; i++) {
+    tag->waypoint[i] = site_min[i] + random_uniform() * (site_max[i] - site_min[i]);
+  }
+}
+
+/**************************************************************************//**
+ * Generate the CTEs of all asset tags in a period.
+ *
+ * The ground truth of a CTE arrives before its angles.
+ *****************************************************************************/
+static void generate_period(uint64_t period_start)
+{
+  aoa_tag_t *tag;
+  aoa_message_t msg;
+  aoa_angle_t *angle = &msg.data.angle;
+  float azimuth, elevation, distance;
+  float delay_us = MESSAGE_DELAY_MS * 1000.0f;
+  float jitter_us = jitter_ms * 1000.0f;
+
+  for (uint32_t i = 0; i < tag_count; i++) {
+    tag = &tag_list[i];
+    move_tag(tag, 1.0f / cte_rate);
+
+    msg.capture = period_start + tag->phase;
+    msg.tag_idx = i;
+
+    msg.arrival = msg.capture;
+    msg.loc_idx = TRUTH_IDX;
+    msg.data.truth.x = tag->position[AXIS_X];
+    msg.data.truth.y = tag->position[AXIS_Y];
+    msg.data.truth.z = tag->position[AXIS_Z];
+    msg.data.truth.sequence = tag->sequence;
+    push_message(&msg);
+
+    for (uint32_t j = 0; j < locator_count; j++) {
+      aoa_solver_angles(&locator_list[j].pose,
+                        tag->position,
+                        &azimuth,
+                        &elevation,
+                        &distance);
+      if ((locator_range > 0) && (distance > locator_range)) {
+        continue;
+      }
+      if (random_uniform() < angle_loss) {
+        lost_count++;
+        continue;
+      }
+      angle->azimuth = azimuth + angle_noise * random_gauss();
+      if (angle->azimuth > 180.0f) {
+        angle->azimuth -= 360.0f;
+      } else if (angle->azimuth <= -180.0f) {
+        angle->azimuth += 360.0f;
+      }
+      angle->elevation = fmaxf(-90.0f, fminf(90.0f, elevation + angle_noise * random_gauss()));
+      angle->distance = fmaxf(0.0f, distance * (1.0f + DISTANCE_NOISE_RATIO * random_gauss()));
+      angle->rssi = (int8_t)lroundf(RSSI_AT_1M - 10.0f * PATH_LOSS_EXPONENT * log10f(fmaxf(distance, 0.1f)));
+      angle->channel = (uint8_t)(tag->sequence % NUM_CHANNELS);
+      angle->sequence = tag->sequence;
+      msg.arrival = msg.capture + (uint64_t)(delay_us + jitter_us * random_uniform());
+      msg.loc_idx = j;
+      push_message(&msg);
+      angle_count++;
+    }
+    tag->sequence = (tag->sequence + 1) & SEQUENCE_MASK;
+  }
+  period_count++;
+}
+
+/**************************************************************************//**
+ * Add a message to the heap.
+ *****************************************************************************/
+static void push_message(aoa_message_t *msg)
+{
+  aoa_message_t *heap;
+  uint32_t capacity;
+  uint32_t i, parent;
+
+  if (message_count == message_capacity) {
+    capacity = (message_capacity > 0) ? 2 * message_capacity : 1024;
+    heap = realloc(message_heap, capacity * sizeof(aoa_message_t));
+    app_assert(heap != NULL, "Failed to allocate message heap\n");
+    message_heap = heap;
+    message_capacity = capacity;
+  }
+
+  // Sift up.
+  i = message_count++;
+  while (i > 0) {
+    parent = (i - 1) / 2;
+    if (message_heap[parent].arrival <= msg->arrival) {
+      break;
+    }
+    message_heap[i] = message_heap[parent];
+    i = parent;
+  }
+  message_heap[i] = *msg;
+}
+
+/**************************************************************************//**
+ * Remove the earliest message from the heap.
+ *****************************************************************************/
+static void pop_message(aoa_message_t *msg)
+{
+  aoa_message_t *last;
+  uint32_t i = 0, child;
+
+  *msg = message_heap[0];
+  last = &message_heap[--message_count];
+
+  // Sift down.
+  while ((child = 2 * i + 1) < message_count) {
+    if ((child + 1 < message_count)
+        && (message_heap[child + 1].arrival < message_heap[child].arrival)) {
+      child++;
+    }
+    if (last->arrival <= message_heap[child].arrival) {
+      break;
+    }
+    message_heap[i] = message_heap[child];
+    i = child;
+  }
+  message_heap[i] = *last;
+}
+
+/**************************************************************************//**
+ * Publish or record a message.
+ *****************************************************************************/
+static void send_message(aoa_message_t *msg)
+{
+  sl_status_t sc;
+  mqtt_status_t rc;
+  const char angle_template[] = AOA_TOPIC_ANGLE_PRINT;
+  char topic[sizeof(angle_template) + sizeof(aoa_id_t) + sizeof(aoa_id_t)];
+  char *payload;
+  char binary[AOA_CODEC_BINARY_SIZE];
+
+  if (msg->loc_idx == TRUTH_IDX) {
+    snprintf(topic, sizeof(topic), AOA_TRACE_TOPIC_TRUTH_PRINT, tag_list[msg->tag_idx].id);
+    sc = aoa_trace_truth_to_string(&msg->data.truth, &payload);
+  } else {
+    snprintf(topic,
+             sizeof(topic),
+             angle_template,
+             locator_list[msg->loc_idx].id,
+             tag_list[msg->tag_idx].id);
+    if (angle_encoding == AOA_CODEC_ENCODING_BINARY) {
+      sc = aoa_codec_angle_to_binary(&msg->data.angle, msg->capture, binary, sizeof(binary));
+      payload = binary;
+    } else {
+      sc = aoa_trace_angle_to_string(&msg->data.angle, msg->capture, &payload);
+    }
+  }
+  app_assert(sc == SL_STATUS_OK,
+             "[E: 0x%04x] Failed to serialize message\n",
+             (int)sc);
+
+  if (recording.file != NULL) {
+    sc = aoa_record_write(&recording, msg->arrival, topic, payload);
+    app_assert(sc == SL_STATUS_OK,
+               "[E: 0x%04x] Failed to write recording\n",
+               (int)sc);
+  } else {
+    rc = mqtt_publish(&mqtt_handle, topic, payload);
+    app_assert(rc == MQTT_SUCCESS, "Failed to publish to topic '%s'.\n", topic);
+  }
+  if (payload != binary) {
+    free(payload);
+  }
+}
+
+/**************************************************************************//**
+ * End of the scenario.
+ *****************************************************************************/
+static void finish(void)
+{
+  app_log("Scenario finished.\n");
+  finished = true;
+  // Stop the main loop as if interrupted by the user.
+  raise(SIGINT);
+}
+
+/**************************************************************************//**
+ * Compare the decoding time of the angle payload encodings.
+ *
+ * The JSON payloads are decoded both with cJSON, as the locator example does,
+ * and with the allocation free decoder of the multilocator.
+ *
+ * @param[in] count Number of random angles.
+ *****************************************************************************/
+static void run_benchmark(uint32_t count)
+{
+  char **json;
+  char (*binary)[AOA_CODEC_BINARY_SIZE];
+  aoa_angle_t angle;
+  uint64_t timestamp, start, elapsed[3];
+  size_t json_size = 0, binary_size = 0;
+  uint32_t mismatch = 0;
+  aoa_angle_t decoded[3];
+  uint64_t decoded_timestamp[3];
+  sl_status_t sc;
+  const char *name[3] = { "cJSON", "JSON", "binary" };
+
+  app_assert(count > 0, "Invalid angle count\n");
+  json = malloc(count * sizeof(*json));
+  binary = malloc(count * sizeof(*binary));
+  app_assert((json != NULL) && (binary != NULL), "Failed to allocate payloads\n");
+
+  // Angles are quantized like the binary encoding, so that all decoders
+  // give the same result.
+  timestamp = aoa_trace_timestamp();
+  for (uint32_t i = 0; i < count; i++) {
+    angle.azimuth = roundf(random_uniform() * 36000.0f - 18000.0f) / AOA_CODEC_ANGLE_SCALE;
+    angle.elevation = roundf(random_uniform() * 18000.0f - 9000.0f) / AOA_CODEC_ANGLE_SCALE;
+    angle.distance = roundf(random_uniform() * 2000.0f) / AOA_CODEC_DISTANCE_SCALE;
+    angle.rssi = (int8_t)(RSSI_AT_1M - 40.0f * random_uniform());
+    angle.channel = (uint8_t)(i % NUM_CHANNELS);
+    angle.sequence = (int32_t)(i & SEQUENCE_MASK);
+    timestamp += 1000;
+    sc = aoa_trace_angle_to_string(&angle, timestamp, &json[i]);
+    app_assert(sc == SL_STATUS_OK, "[E: 0x%04x] Failed to serialize angle\n", (int)sc);
+    sc = aoa_codec_angle_to_binary(&angle, timestamp, binary[i], sizeof(binary[i]));
+    app_assert(sc == SL_STATUS_OK, "[E: 0x%04x] Failed to serialize angle\n", (int)sc);
+    json_size += strlen(json[i]);
+    binary_size += strlen(binary[i]);
+  }
+
+  start = aoa_trace_timestamp();
+  for (uint32_t i = 0; i < count; i++) {
+    aoa_trace_string_to_angle(json[i], &decoded[0], &decoded_timestamp[0]);
+  }
+  elapsed[0] = aoa_trace_timestamp() - start;
+
+  start = aoa_trace_timestamp();
+  for (uint32_t i = 0; i < count; i++) {
+    aoa_codec_decode_angle(json[i], &decoded[1], &decoded_timestamp[1]);
+  }
+  elapsed[1] = aoa_trace_timestamp() - start;
+
+  start = aoa_trace_timestamp();
+  for (uint32_t i = 0; i < count; i++) {
+    aoa_codec_decode_angle(binary[i], &decoded[2], &decoded_timestamp[2]);
+  }
+  elapsed[2] = aoa_trace_timestamp() - start;
+
+  // Check the decoders against each other.
+  for (uint32_t i = 0; i < count; i++) {
+    aoa_trace_string_to_angle(json[i], &decoded[0], &decoded_timestamp[0]);
+    aoa_codec_decode_angle(json[i], &decoded[1], &decoded_timestamp[1]);
+    aoa_codec_decode_angle(binary[i], &decoded[2], &decoded_timestamp[2]);
+    for (uint32_t j = 1; j < 3; j++) {
+      if ((fabsf(decoded[j].azimuth - decoded[0].azimuth) > 0.5f / AOA_CODEC_ANGLE_SCALE)
+          || (fabsf(decoded[j].elevation - decoded[0].elevation) > 0.5f / AOA_CODEC_ANGLE_SCALE)
+          || (fabsf(decoded[j].distance - decoded[0].distance) > 0.5f / AOA_CODEC_DISTANCE_SCALE)
+          || (decoded[j].rssi != decoded[0].rssi)
+          || (decoded[j].channel != decoded[0].channel)
+          || (decoded[j].sequence != decoded[0].sequence)
+          || (decoded_timestamp[j] != decoded_timestamp[0])) {
+        mismatch++;
+      }
+    }
+  }
+
+  app_log("Decoded %u angles, JSON %.1f bytes, binary %.1f bytes on average\n",
+          count,
+          (double)json_size / count,
+          (double)binary_size / count);
+  for (uint32_t j = 0; j < 3; j++) {
+    app_log("%-6s: %8.1f ns/angle, %5.2fx\n",
+            name[j],
+            elapsed[j] * 1000.0 / count,
+            (elapsed[j] > 0) ? (double)elapsed[0] / elapsed[j] : 0.0);
+  }
+  app_log("Mismatches: %u\n", mismatch);
+
+  for (uint32_t i = 0; i < count; i++) {
+    free(json[i]);
+  }
+  free(json);
+  free(binary);
+}
+
+/**************************************************************************//**
+ * Load the query service of a multilocator with asset tag and near queries.
+ *
+ * The queried asset tags and points are those of the scenario, so the
+ * multilocator should be estimating the same scenario meanwhile.
+ *
+ * @param[in] path Socket of the query service.
+ *****************************************************************************/
+static void run_query_load(const char *path)
+{
+  aoa_query_load_t load[QUERY_LOAD_CONNECTIONS];
+  aoa_query_load_t total;
+  uint64_t start;
+  double seconds;
+
+  memset(load, 0, sizeof(load));
+  memset(&total, 0, sizeof(total));
+  start = aoa_trace_timestamp();
+  for (uint32_t i = 0; i < QUERY_LOAD_CONNECTIONS; i++) {
+    load[i].path = path;
+    load[i].random = random_next() | 1;
+    load[i].end = start + (uint64_t)(duration * 1000000.0f);
+    app_assert(pthread_create(&load[i].thread, NULL, run_query_connection, &load[i]) == 0,
+               "Failed to start query load thread\n");
+  }
+  for (uint32_t i = 0; i < QUERY_LOAD_CONNECTIONS; i++) {
+    pthread_join(load[i].thread, NULL);
+    total.tag_count += load[i].tag_count;
+    total.near_count += load[i].near_count;
+    total.errors += load[i].errors;
+    total.latency += load[i].latency;
+    if (load[i].max_latency > total.max_latency) {
+      total.max_latency = load[i].max_latency;
+    }
+  }
+  seconds = (aoa_trace_timestamp() - start) / 1000000.0;
+
+  app_log("Query load: %u connections, %.1f s\n", QUERY_LOAD_CONNECTIONS, seconds);
+  app_log("Asset tag queries: %llu, near queries: %llu, errors: %llu\n",
+          (unsigned long long)total.tag_count,
+          (unsigned long long)total.near_count,
+          (unsigned long long)total.errors);
+  if (total.tag_count + total.near_count > 0) {
+    app_log("Throughput: %.0f queries/s, latency: %.1f us average, %llu us max\n",
+            (total.tag_count + total.near_count) / seconds,
+            (double)total.latency / (total.tag_count + total.near_count),
+            (unsigned long long)total.max_latency);
+  }
+}
+
+/**************************************************************************//**
+ * Query load of a connection, alternates asset tag and near queries.
+ *****************************************************************************/
+static void *run_query_connection(void *arg)
+{
+  aoa_query_load_t *load = arg;
+  char target[128];
+  char body[QUERY_LOAD_BODY_SIZE];
+  uint64_t start, latency;
+  float point[2];
+  int status;
+  int fd;
+  sl_status_t sc;
+
+  sc = aoa_query_connect(load->path, &fd);
+  if (sc != SL_STATUS_OK) {
+    app_log("[E: 0x%04x] Failed to connect to %s\n", (int)sc, load->path);
+    load->errors++;
+    return NULL;
+  }
+  while ((start = aoa_trace_timestamp()) < load->end) {
+    if ((load->tag_count + load->near_count) % 2 == 0) {
+      snprintf(target,
+               sizeof(target),
+               "/tags/%s",
+               tag_list[random_next_state(&load->random) % tag_count].id);
+      load->tag_count++;
+    } else {
+      for (enum axis_list i = AXIS_X; i <= AXIS_Y; i++) {
+        point[i] = site_min[i] + (site_max[i] - site_min[i])
+                   * (float)(random_next_state(&load->random) >> 40) / (float)(1 << 24);
+      }
+      snprintf(target,
+               sizeof(target),
+               "/near?x=%.2f&y=%.2f&r=%.2f",
+               point[AXIS_X],
+               point[AXIS_Y],
+               QUERY_LOAD_RADIUS_M);
+      load->near_count++;
+    }
+    sc = aoa_query_request(fd, target, &status, body, sizeof(body));
+    if (sc != SL_STATUS_OK) {
+      load->errors++;
+      break;
+    }
+    // Unknown asset tags are not counted as errors, the multilocator may not
+    // have estimated them yet.
+    if ((status != 200) && (status != 404)) {
+      load->errors++;
+    }
+    latency = aoa_trace_timestamp() - start;
+    load->latency += latency;
+    if (latency > load->max_latency) {
+      load->max_latency = latency;
+    }
+  }
+  aoa_query_disconnect(fd);
+  return NULL;
+}
+
+/**************************************************************************//**
+ * Get the next 64 bit random number, xorshift64*.
+ *****************************************************************************/
+static uint64_t random_next(void)
+{
+  return random_next_state(&random_state);
+}
+
+/**************************************************************************//**
+ * Get the next 64 bit random number of a generator state.
+ *****************************************************************************/
+static uint64_t random_next_state(uint64_t *state)
+{
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**************************************************************************//**
+ * Get a uniformly distributed random number in the [0, 1) range.
+ *****************************************************************************/
+static float random_uniform(void)
+{
+  return (float)(random_next() >> 40) / (float)(1 << 24);
+}
+
+/**************************************************************************//**
+ * Get a normally distributed random number, zero mean and unit deviation.
+ *****************************************************************************/
+static float random_gauss(void)
+{
+  // Box-Muller transform, 1 - u avoids the logarithm of zero.
+  float u = 1.0f - random_uniform();
+  float v = random_uniform();
+
+  return sqrtf(-2.0f * logf(u)) * cosf(6.28318530718f * v);
+}
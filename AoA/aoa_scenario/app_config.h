@@ -0,0 +1,91 @@
+/***************************************************************************//**
+ * @file
+ * @brief Application configuration values.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef APP_CONFIG_H
+#define APP_CONFIG_H
+
+// Maximum number of locators handled by the application.
+#define MAX_NUM_LOCATORS        256
+
+// Number of simulated asset tags.
+// Can be overridden with the -n command line option.
+#define TAG_COUNT               10
+
+// CTE rate of the asset tags in Hz.
+// Can be overridden with the -f command line option.
+#define CTE_RATE_HZ             10.0f
+
+// Length of the scenario in seconds.
+// Can be overridden with the -d command line option. Use 0 to run until
+// interrupted, not allowed when writing a recording.
+#define SCENARIO_DURATION_SEC   60.0f
+
+// Standard deviation of the angle noise in degrees.
+// Can be overridden with the -a command line option.
+#define ANGLE_NOISE_DEG         2.0f
+
+// Standard deviation of the distance noise relative to the distance.
+#define DISTANCE_NOISE_RATIO    0.1f
+
+// Probability of losing an angle.
+// Can be overridden with the -l command line option.
+#define ANGLE_LOSS              0.05f
+
+// Delay from the capture to the arrival of an angle, and the maximum of the
+// random jitter added to it. Jitter reorders the angles of the locators.
+// The jitter can be overridden with the -j command line option.
+#define MESSAGE_DELAY_MS        1.0f
+#define MESSAGE_JITTER_MS       5.0f
+
+// Locators only measure asset tags within this distance.
+// Can be overridden with the -r command line option. Use 0 for no limit.
+#define LOCATOR_RANGE_M         0.0f
+
+// Asset tags move between random waypoints within the bounding box of the
+// locators, extended by the site margin.
+#define TAG_SPEED_MPS           1.0f
+#define TAG_HEIGHT_M            1.0f
+#define SITE_MARGIN_M           2.0f
+
+// Received signal strength model.
+#define RSSI_AT_1M              -45.0f
+#define PATH_LOSS_EXPONENT      2.0f
+
+// Query load of the -Q command line option: number of connections, radius of
+// the near queries and the size of the response buffer.
+#define QUERY_LOAD_CONNECTIONS  4
+#define QUERY_LOAD_RADIUS_M     3.0f
+#define QUERY_LOAD_BODY_SIZE    4096
+
+// Seed of the random generator.
+// Can be overridden with the -s command line option.
+#define RANDOM_SEED             1
+
+#endif // APP_CONFIG_H
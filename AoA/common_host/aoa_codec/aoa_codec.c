@@ -0,0 +1,710 @@
+/***************************************************************************//**
+ * @file
+ * @brief Allocation free angle payload codec.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <float.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "aoa_codec.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+// Packed binary angle: azimuth (int16), elevation (int16), distance (uint16),
+// rssi (int8), channel (uint8), sequence (int32), timestamp (uint64).
+#define PACKED_SIZE          20
+
+// COBS adds one code byte per 254 data bytes, at least one.
+#define COBS_MAX_SIZE(n)     ((n) + (n) / 254 + 1)
+
+// Decimal numbers with up to this many digits are converted without strtod.
+// The digits fit in 64 bits, the result is within one unit in the last place
+// of double precision. Floats printed as double have 17 digits.
+#define FAST_NUMBER_DIGITS   19
+
+#define IS_DIGIT(c)          (((c) >= '0') && ((c) <= '9'))
+#define IS_SPACE(c)          (((c) == ' ') || ((c) == '\t') || ((c) == '\n') || ((c) == '\r'))
+
+// Angle members decoded from JSON.
+enum member_list {
+  MEMBER_AZIMUTH,
+  MEMBER_ELEVATION,
+  MEMBER_DISTANCE,
+  MEMBER_RSSI,
+  MEMBER_CHANNEL,
+  MEMBER_SEQUENCE,
+  MEMBER_TIMESTAMP,
+  MEMBER_COUNT
+};
+
+// -----------------------------------------------------------------------------
+// Private variables
+
+static const char *member_names[MEMBER_COUNT] = {
+  "azimuth",
+  "elevation",
+  "distance",
+  "rssi",
+  "channel",
+  "sequence",
+  "timestamp"
+};
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+static sl_status_t cobs_decode(const uint8_t *in,
+                               uint8_t *out,
+                               size_t size,
+                               size_t *len);
+static sl_status_t decode_binary(const char *payload,
+                                 aoa_angle_t *angle,
+                                 uint64_t *timestamp);
+static sl_status_t decode_json(const char *payload,
+                               aoa_angle_t *angle,
+                               uint64_t *timestamp);
+static const char *parse_number(const char *p, double *value);
+static double saturate(double value, double min, double max);
+static const char *skip_space(const char *p);
+static const char *skip_string(const char *p);
+static const char *skip_value(const char *p);
+static int find_member(const char *name, size_t len);
+static int32_t quantize(float value, float scale, int32_t min, int32_t max);
+
+/***************************************************************************//**
+ * Parse encoding name.
+ ******************************************************************************/
+sl_status_t aoa_codec_parse_encoding(const char *str,
+                                     enum aoa_codec_encoding *encoding)
+{
+  if (strcmp(str, "json") == 0) {
+    *encoding = AOA_CODEC_ENCODING_JSON;
+  } else if (strcmp(str, "binary") == 0) {
+    *encoding = AOA_CODEC_ENCODING_BINARY;
+  } else {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Convert angle and its capture timestamp to binary payload.
+ ******************************************************************************/
+sl_status_t aoa_codec_angle_to_binary(const aoa_angle_t *angle,
+                                      uint64_t timestamp,
+                                      char *buffer,
+                                      size_t size)
+{
+  uint8_t packed[PACKED_SIZE];
+  uint8_t *out = (uint8_t *)buffer;
+  size_t len;
+  int32_t value;
+
+  if (size < 1 + COBS_MAX_SIZE(PACKED_SIZE) + 1) {
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+
+  value = quantize(angle->azimuth, AOA_CODEC_ANGLE_SCALE, INT16_MIN, INT16_MAX);
+  packed[0] = (uint8_t)value;
+  packed[1] = (uint8_t)(value >> 8);
+  value = quantize(angle->elevation, AOA_CODEC_ANGLE_SCALE, INT16_MIN, INT16_MAX);
+  packed[2] = (uint8_t)value;
+  packed[3] = (uint8_t)(value >> 8);
+  value = quantize(angle->distance, AOA_CODEC_DISTANCE_SCALE, 0, UINT16_MAX);
+  packed[4] = (uint8_t)value;
+  packed[5] = (uint8_t)(value >> 8);
+  packed[6] = (uint8_t)angle->rssi;
+  packed[7] = angle->channel;
+  for (int i = 0; i < 4; i++) {
+    packed[8 + i] = (uint8_t)((uint32_t)angle->sequence >> (8 * i));
+  }
+  for (int i = 0; i < 8; i++) {
+    packed[12 + i] = (uint8_t)(timestamp >> (8 * i));
+  }
+
+  out[0] = AOA_CODEC_BINARY_MARKER;
+  len = cobs_encode(packed, PACKED_SIZE, &out[1]);
+  out[1 + len] = '\0';
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Get the encoding of an angle payload.
+ ******************************************************************************/
+enum aoa_codec_encoding aoa_codec_get_encoding(const char *payload)
+{
+  if ((uint8_t)payload[0] == AOA_CODEC_BINARY_MARKER) {
+    return AOA_CODEC_ENCODING_BINARY;
+  }
+  return AOA_CODEC_ENCODING_JSON;
+}
+
+/***************************************************************************//**
+ * Convert angle payload to angle and its capture timestamp.
+ ******************************************************************************/
+sl_status_t aoa_codec_decode_angle(const char *payload,
+                                   aoa_angle_t *angle,
+                                   uint64_t *timestamp)
+{
+  if (aoa_codec_get_encoding(payload) == AOA_CODEC_ENCODING_BINARY) {
+    return decode_binary(payload + 1, angle, timestamp);
+  }
+  return decode_json(payload, angle, timestamp);
+}
+
+/***************************************************************************//**
+ * Convert position and its capture time range to JSON payload.
+ ******************************************************************************/
+sl_status_t aoa_codec_position_to_string(const aoa_position_t *position,
+                                         const aoa_trace_span_t *span,
+                                         char *buffer,
+                                         size_t size)
+{
+  int len = snprintf(buffer,
+                     size,
+                     "{\"x\":%.3f,\"y\":%.3f,\"z\":%.3f,"
+                     "\"timestamp_oldest\":%llu,\"timestamp_newest\":%llu}",
+                     position->x,
+                     position->y,
+                     position->z,
+                     (unsigned long long)span->oldest,
+                     (unsigned long long)span->newest);
+
+  if ((len < 0) || ((size_t)len >= size)) {
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Pack IQ report with its origin and capture timestamp.
+ ******************************************************************************/
+sl_status_t aoa_codec_iq_pack(const aoa_iq_report_t *iq_report,
+                              const char *locator_id,
+                              const char *tag_id,
+                              uint64_t timestamp,
+                              uint8_t *buffer,
+                              size_t size,
+                              size_t *len)
+{
+  size_t locator_id_len = strnlen(locator_id, AOA_ID_MAX_SIZE - 1);
+  size_t tag_id_len = strnlen(tag_id, AOA_ID_MAX_SIZE - 1);
+  size_t pos = 0;
+
+  if (size < 15 + locator_id_len + tag_id_len + iq_report->length) {
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+
+  for (int i = 0; i < 8; i++) {
+    buffer[pos++] = (uint8_t)(timestamp >> (8 * i));
+  }
+  buffer[pos++] = (uint8_t)iq_report->event_counter;
+  buffer[pos++] = (uint8_t)(iq_report->event_counter >> 8);
+  buffer[pos++] = (uint8_t)iq_report->rssi;
+  buffer[pos++] = iq_report->channel;
+  buffer[pos++] = (uint8_t)locator_id_len;
+  memcpy(&buffer[pos], locator_id, locator_id_len);
+  pos += locator_id_len;
+  buffer[pos++] = (uint8_t)tag_id_len;
+  memcpy(&buffer[pos], tag_id, tag_id_len);
+  pos += tag_id_len;
+  buffer[pos++] = iq_report->length;
+  memcpy(&buffer[pos], iq_report->samples, iq_report->length);
+  pos += iq_report->length;
+
+  *len = pos;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Unpack IQ report packed by aoa_codec_iq_pack.
+ ******************************************************************************/
+sl_status_t aoa_codec_iq_unpack(const uint8_t *buffer,
+                                size_t len,
+                                aoa_codec_iq_t *iq)
+{
+  size_t pos = 0, id_len;
+
+  if (len < 15) {
+    return SL_STATUS_FAIL;
+  }
+
+  iq->timestamp = 0;
+  for (int i = 7; i >= 0; i--) {
+    iq->timestamp = (iq->timestamp << 8) | buffer[i];
+  }
+  pos = 8;
+  iq->report.event_counter = (uint16_t)(buffer[pos] | (buffer[pos + 1] << 8));
+  pos += 2;
+  iq->report.rssi = (int8_t)buffer[pos++];
+  iq->report.channel = buffer[pos++];
+
+  // The fixed fields guarantee that the length bytes can be read.
+  id_len = buffer[pos++];
+  if ((id_len >= AOA_ID_MAX_SIZE) || (pos + id_len + 2 > len)) {
+    return SL_STATUS_FAIL;
+  }
+  memcpy(iq->locator_id, &buffer[pos], id_len);
+  iq->locator_id[id_len] = '\0';
+  pos += id_len;
+
+  id_len = buffer[pos++];
+  if ((id_len >= AOA_ID_MAX_SIZE) || (pos + id_len + 1 > len)) {
+    return SL_STATUS_FAIL;
+  }
+  memcpy(iq->tag_id, &buffer[pos], id_len);
+  iq->tag_id[id_len] = '\0';
+  pos += id_len;
+
+  iq->report.length = buffer[pos++];
+  if (pos + iq->report.length != len) {
+    return SL_STATUS_FAIL;
+  }
+  memcpy(iq->samples, &buffer[pos], iq->report.length);
+  iq->report.samples = iq->samples;
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Convert IQ report with its origin and capture timestamp to binary payload.
+ ******************************************************************************/
+sl_status_t aoa_codec_iq_to_binary(const aoa_iq_report_t *iq_report,
+                                   const char *locator_id,
+                                   const char *tag_id,
+                                   uint64_t timestamp,
+                                   char *buffer,
+                                   size_t size)
+{
+  uint8_t packed[AOA_CODEC_IQ_PACKED_SIZE];
+  uint8_t *out = (uint8_t *)buffer;
+  size_t len;
+  sl_status_t sc;
+
+  sc = aoa_codec_iq_pack(iq_report, locator_id, tag_id, timestamp,
+                         packed, sizeof(packed), &len);
+  if (sc != SL_STATUS_OK) {
+    return sc;
+  }
+  if (size < 1 + COBS_MAX_SIZE(len) + 1) {
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+
+  out[0] = AOA_CODEC_IQ_MARKER;
+  len = cobs_encode(packed, len, &out[1]);
+  out[1 + len] = '\0';
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Convert binary IQ report payload to IQ report.
+ ******************************************************************************/
+sl_status_t aoa_codec_decode_iq(const char *payload, aoa_codec_iq_t *iq)
+{
+  uint8_t packed[AOA_CODEC_IQ_PACKED_SIZE];
+  size_t len;
+
+  if ((uint8_t)payload[0] != AOA_CODEC_IQ_MARKER) {
+    return SL_STATUS_FAIL;
+  }
+  if (cobs_decode((const uint8_t *)payload + 1, packed, sizeof(packed), &len)
+      != SL_STATUS_OK) {
+    return SL_STATUS_FAIL;
+  }
+  return aoa_codec_iq_unpack(packed, len, iq);
+}
+
+/***************************************************************************//**
+ * COBS encode data: each code byte gives the distance to the next zero byte.
+ *
+ * @return Length of the encoded data, at most COBS_MAX_SIZE(len).
+ ******************************************************************************/
+static size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+  size_t code_idx = 0, out_len = 1;
+
+  for (size_t i = 0; i < len; i++) {
+    if (in[i] != 0) {
+      out[out_len++] = in[i];
+    }
+    if ((in[i] == 0) || (out_len - code_idx == 0xFF)) {
+      out[code_idx] = (uint8_t)(out_len - code_idx);
+      code_idx = out_len++;
+    }
+  }
+  out[code_idx] = (uint8_t)(out_len - code_idx);
+
+  return out_len;
+}
+
+/***************************************************************************//**
+ * Decode NUL terminated COBS data.
+ *
+ * @retval SL_STATUS_OK Data decoded.
+ * @retval SL_STATUS_FAIL Malformed data or output buffer too small.
+ ******************************************************************************/
+static sl_status_t cobs_decode(const uint8_t *in,
+                               uint8_t *out,
+                               size_t size,
+                               size_t *len)
+{
+  size_t out_len = 0;
+  uint8_t code;
+
+  // The terminating NUL ends the COBS frame.
+  while (*in != 0) {
+    code = *in++;
+    for (uint8_t i = 1; i < code; i++) {
+      if ((*in == 0) || (out_len == size)) {
+        return SL_STATUS_FAIL;
+      }
+      out[out_len++] = *in++;
+    }
+    // The zero byte of the last block is implicit.
+    if ((code != 0xFF) && (*in != 0)) {
+      if (out_len == size) {
+        return SL_STATUS_FAIL;
+      }
+      out[out_len++] = 0;
+    }
+  }
+
+  *len = out_len;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Decode COBS encoded binary angle.
+ ******************************************************************************/
+static sl_status_t decode_binary(const char *payload,
+                                 aoa_angle_t *angle,
+                                 uint64_t *timestamp)
+{
+  uint8_t packed[PACKED_SIZE];
+  size_t len;
+
+  if ((cobs_decode((const uint8_t *)payload, packed, PACKED_SIZE, &len)
+       != SL_STATUS_OK)
+      || (len != PACKED_SIZE)) {
+    return SL_STATUS_FAIL;
+  }
+
+  angle->azimuth = (int16_t)(packed[0] | (packed[1] << 8)) / AOA_CODEC_ANGLE_SCALE;
+  angle->elevation = (int16_t)(packed[2] | (packed[3] << 8)) / AOA_CODEC_ANGLE_SCALE;
+  angle->distance = (uint16_t)(packed[4] | (packed[5] << 8)) / AOA_CODEC_DISTANCE_SCALE;
+  angle->rssi = (int8_t)packed[6];
+  angle->channel = packed[7];
+  angle->sequence = (int32_t)((uint32_t)packed[8]
+                              | ((uint32_t)packed[9] << 8)
+                              | ((uint32_t)packed[10] << 16)
+                              | ((uint32_t)packed[11] << 24));
+  *timestamp = 0;
+  for (int i = 7; i >= 0; i--) {
+    *timestamp = (*timestamp << 8) | packed[12 + i];
+  }
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Decode JSON angle in a single pass.
+ ******************************************************************************/
+static sl_status_t decode_json(const char *payload,
+                               aoa_angle_t *angle,
+                               uint64_t *timestamp)
+{
+  double value[MEMBER_COUNT] = { 0.0, 0.0, 0.0, 0.0, 0.0, -1.0, AOA_TRACE_TIMESTAMP_INVALID };
+  bool found[MEMBER_COUNT] = { false };
+  const char *p = skip_space(payload);
+  const char *name, *end;
+  int member;
+
+  if (*p++ != '{') {
+    return SL_STATUS_FAIL;
+  }
+  p = skip_space(p);
+  if (*p == '}') {
+    p++;
+  } else {
+    for (;;) {
+      // Member name.
+      name = p + 1;
+      p = skip_string(p);
+      if (p == NULL) {
+        return SL_STATUS_FAIL;
+      }
+      member = find_member(name, p - name - 1);
+      p = skip_space(p);
+      if (*p++ != ':') {
+        return SL_STATUS_FAIL;
+      }
+      p = skip_space(p);
+
+      // Member value, only the first occurrence of a member is used.
+      if ((member >= 0) && !found[member]
+          && ((*p == '-') || IS_DIGIT(*p))) {
+        end = parse_number(p, &value[member]);
+        if (end == NULL) {
+          return SL_STATUS_FAIL;
+        }
+        found[member] = true;
+        p = end;
+      } else {
+        p = skip_value(p);
+        if (p == NULL) {
+          return SL_STATUS_FAIL;
+        }
+      }
+
+      p = skip_space(p);
+      if (*p == '}') {
+        p++;
+        break;
+      }
+      if (*p++ != ',') {
+        return SL_STATUS_FAIL;
+      }
+      p = skip_space(p);
+    }
+  }
+  if (*skip_space(p) != '\0') {
+    return SL_STATUS_FAIL;
+  }
+
+  // Out of range values saturate, converting them would be undefined.
+  angle->azimuth = (float)saturate(value[MEMBER_AZIMUTH], -FLT_MAX, FLT_MAX);
+  angle->elevation = (float)saturate(value[MEMBER_ELEVATION], -FLT_MAX, FLT_MAX);
+  angle->distance = (float)saturate(value[MEMBER_DISTANCE], -FLT_MAX, FLT_MAX);
+  angle->rssi = (int8_t)saturate(value[MEMBER_RSSI], INT8_MIN, INT8_MAX);
+  angle->channel = (uint8_t)saturate(value[MEMBER_CHANNEL], 0, UINT8_MAX);
+  angle->sequence = (int32_t)saturate(value[MEMBER_SEQUENCE], INT32_MIN, INT32_MAX);
+  // Locators without tracing support do not send a timestamp. Timestamps out
+  // of range are invalid as well.
+  if ((value[MEMBER_TIMESTAMP] < 0.0)
+      || (value[MEMBER_TIMESTAMP] >= (double)UINT64_MAX)) {
+    *timestamp = AOA_TRACE_TIMESTAMP_INVALID;
+  } else {
+    *timestamp = (uint64_t)value[MEMBER_TIMESTAMP];
+  }
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Limit a number to a range.
+ ******************************************************************************/
+static double saturate(double value, double min, double max)
+{
+  if (value < min) {
+    return min;
+  }
+  if (value > max) {
+    return max;
+  }
+  return value;
+}
+
+/***************************************************************************//**
+ * Parse JSON number.
+ *
+ * @return Position after the number, NULL if malformed or not finite.
+ ******************************************************************************/
+static const char *parse_number(const char *p, double *value)
+{
+  static const double power_of_ten[FAST_NUMBER_DIGITS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+    1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19
+  };
+  const char *start = p;
+  char *end;
+  uint64_t digits = 0;
+  uint32_t digit_count = 0, fraction_count = 0;
+  bool negative = (*p == '-');
+
+  if (negative) {
+    p++;
+  }
+  // JSON numbers start with a digit, strtod would also take "nan" or "inf".
+  if (!IS_DIGIT(*p)) {
+    return NULL;
+  }
+  while (IS_DIGIT(*p)) {
+    digits = digits * 10 + (uint64_t)(*p++ - '0');
+    digit_count++;
+  }
+  if (*p == '.') {
+    p++;
+    while (IS_DIGIT(*p)) {
+      digits = digits * 10 + (uint64_t)(*p++ - '0');
+      digit_count++;
+      fraction_count++;
+    }
+  }
+  if ((digit_count == 0) || (digit_count > FAST_NUMBER_DIGITS)
+      || (*p == 'e') || (*p == 'E')) {
+    // Exponent or too many digits, digits may have overflowed.
+    *value = strtod(start, &end);
+    return ((end != start) && isfinite(*value)) ? end : NULL;
+  }
+  *value = (double)digits / power_of_ten[fraction_count];
+  if (negative) {
+    *value = -*value;
+  }
+  return p;
+}
+
+/***************************************************************************//**
+ * Skip JSON whitespace.
+ ******************************************************************************/
+static const char *skip_space(const char *p)
+{
+  while (IS_SPACE(*p)) {
+    p++;
+  }
+  return p;
+}
+
+/***************************************************************************//**
+ * Skip JSON string.
+ *
+ * @return Position after the closing quote, NULL if malformed.
+ ******************************************************************************/
+static const char *skip_string(const char *p)
+{
+  if (*p++ != '"') {
+    return NULL;
+  }
+  while (*p != '"') {
+    if (*p == '\0') {
+      return NULL;
+    }
+    if ((*p == '\\') && (*++p == '\0')) {
+      return NULL;
+    }
+    p++;
+  }
+  return p + 1;
+}
+
+/***************************************************************************//**
+ * Skip JSON value of any type.
+ *
+ * Nested containers are only checked for balanced brackets.
+ *
+ * @return Position after the value, NULL if malformed.
+ ******************************************************************************/
+static const char *skip_value(const char *p)
+{
+  uint32_t depth = 0;
+
+  do {
+    switch (*p) {
+      case '\0':
+        return NULL;
+      case '"':
+        p = skip_string(p);
+        if (p == NULL) {
+          return NULL;
+        }
+        break;
+      case '{':
+      case '[':
+        depth++;
+        p++;
+        break;
+      case '}':
+      case ']':
+        if (depth == 0) {
+          return NULL;
+        }
+        depth--;
+        p++;
+        break;
+      default:
+        // Number or literal, ends at a delimiter.
+        if ((depth == 0) && ((*p == ',') || IS_SPACE(*p))) {
+          return NULL;
+        }
+        do {
+          p++;
+        } while ((*p != '\0') && (*p != ',') && (*p != '}') && (*p != ']')
+                 && (*p != '"') && !IS_SPACE(*p));
+        break;
+    }
+    if (depth > 0) {
+      p = skip_space(p);
+      if ((*p == ',') || (*p == ':')) {
+        p++;
+        p = skip_space(p);
+      }
+    }
+  } while (depth > 0);
+
+  return p;
+}
+
+/***************************************************************************//**
+ * Find an angle member by name.
+ *
+ * @return Member index, -1 if not an angle member.
+ ******************************************************************************/
+static int find_member(const char *name, size_t len)
+{
+  for (int i = 0; i < MEMBER_COUNT; i++) {
+    if ((strncmp(member_names[i], name, len) == 0)
+        && (member_names[i][len] == '\0')) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/***************************************************************************//**
+ * Quantize a value to a clamped integer.
+ ******************************************************************************/
+static int32_t quantize(float value, float scale, int32_t min, int32_t max)
+{
+  float scaled = roundf(value * scale);
+
+  if (!(scaled >= min)) {
+    return min;
+  }
+  if (scaled > max) {
+    return max;
+  }
+  return (int32_t)scaled;
+}
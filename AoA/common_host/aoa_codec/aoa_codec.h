@@ -0,0 +1,252 @@
+/***************************************************************************//**
+ * @file
+ * @brief Allocation free angle payload codec.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_CODEC_H
+#define AOA_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+#include "aoa_trace.h"
+
+// First byte of a binary angle payload. JSON payloads start with whitespace
+// or '{', so the encodings can share the angle topic.
+#define AOA_CODEC_BINARY_MARKER    0x81
+
+// Buffer size needed for a binary angle payload, including the terminating
+// NUL. The payload contains no other zero byte, so it can be handled as a
+// string.
+#define AOA_CODEC_BINARY_SIZE      24
+
+// Buffer size needed for a position payload, including the terminating NUL.
+#define AOA_CODEC_POSITION_SIZE    256
+
+// First byte of a binary IQ report payload.
+#define AOA_CODEC_IQ_MARKER        0x82
+
+// Raw IQ report topic: locator ID, asset tag ID.
+#define AOA_CODEC_TOPIC_IQ_PRINT   "silabs/aoa/iq/%s/%s"
+
+// Default TCP port of raw IQ report streams.
+#define AOA_CODEC_IQ_PORT          4902
+
+// Maximum number of IQ samples in a report.
+#define AOA_CODEC_IQ_MAX_SAMPLES   255
+
+// Buffer size needed for any packed IQ report.
+#define AOA_CODEC_IQ_PACKED_SIZE   (15 + 2 * (AOA_ID_MAX_SIZE - 1) + AOA_CODEC_IQ_MAX_SAMPLES)
+
+// Buffer size needed for any binary IQ report payload, including the
+// terminating NUL.
+#define AOA_CODEC_IQ_SIZE          (AOA_CODEC_IQ_PACKED_SIZE + AOA_CODEC_IQ_PACKED_SIZE / 254 + 3)
+
+// Quantization steps of the binary encoding.
+#define AOA_CODEC_ANGLE_SCALE      100.0f  // 0.01 degree
+#define AOA_CODEC_DISTANCE_SCALE   100.0f  // 1 cm
+
+enum aoa_codec_encoding {
+  AOA_CODEC_ENCODING_JSON,
+  AOA_CODEC_ENCODING_BINARY
+};
+
+// Decoded IQ report with its origin.
+typedef struct {
+  aoa_iq_report_t report; // samples point to the samples member
+  int8_t samples[AOA_CODEC_IQ_MAX_SAMPLES];
+  aoa_id_t locator_id;
+  aoa_id_t tag_id;
+  uint64_t timestamp;
+} aoa_codec_iq_t;
+
+/***************************************************************************//**
+ * Parse encoding name.
+ *
+ * @param[in] str Encoding name, "json" or "binary".
+ * @param[out] encoding Encoding.
+ *
+ * @retval SL_STATUS_OK Name is valid.
+ * @retval SL_STATUS_INVALID_PARAMETER Unknown name.
+ ******************************************************************************/
+sl_status_t aoa_codec_parse_encoding(const char *str,
+                                     enum aoa_codec_encoding *encoding);
+
+/***************************************************************************//**
+ * Convert angle and its capture timestamp to binary payload.
+ *
+ * The fields are packed into a fixed little endian layout and COBS encoded to
+ * eliminate zero bytes.
+ *
+ * @param[in] angle Angle data.
+ * @param[in] timestamp Capture timestamp.
+ * @param[out] buffer Payload, NUL terminated.
+ * @param[in] size Size of the buffer, at least AOA_CODEC_BINARY_SIZE.
+ *
+ * @retval SL_STATUS_OK Payload created.
+ * @retval SL_STATUS_WOULD_OVERFLOW Buffer is too small.
+ ******************************************************************************/
+sl_status_t aoa_codec_angle_to_binary(const aoa_angle_t *angle,
+                                      uint64_t timestamp,
+                                      char *buffer,
+                                      size_t size);
+
+/***************************************************************************//**
+ * Get the encoding of an angle payload.
+ *
+ * @param[in] payload Payload, NUL terminated.
+ * @return Encoding of the payload.
+ ******************************************************************************/
+enum aoa_codec_encoding aoa_codec_get_encoding(const char *payload);
+
+/***************************************************************************//**
+ * Convert angle payload to angle and its capture timestamp.
+ *
+ * Both the binary and the JSON encoding are accepted. JSON is decoded in a
+ * single pass without building a document tree, members not used by the
+ * angle are skipped. Missing members get the same default values as with
+ * aoa_trace_string_to_angle. No memory is allocated.
+ *
+ * @param[in] payload Payload, NUL terminated.
+ * @param[out] angle Angle data.
+ * @param[out] timestamp Capture timestamp, invalid if not present.
+ *
+ * @retval SL_STATUS_OK Angle decoded.
+ * @retval SL_STATUS_FAIL Malformed payload.
+ ******************************************************************************/
+sl_status_t aoa_codec_decode_angle(const char *payload,
+                                   aoa_angle_t *angle,
+                                   uint64_t *timestamp);
+
+/***************************************************************************//**
+ * Convert position and its capture time range to JSON payload.
+ *
+ * Same members as aoa_trace_position_to_string, the coordinates are given in
+ * millimeter resolution. No memory is allocated.
+ *
+ * @param[in] position Position data.
+ * @param[in] span Capture time range of the contributing angles.
+ * @param[out] buffer Payload, NUL terminated.
+ * @param[in] size Size of the buffer, AOA_CODEC_POSITION_SIZE is enough for
+ *            any position.
+ *
+ * @retval SL_STATUS_OK Payload created.
+ * @retval SL_STATUS_WOULD_OVERFLOW Buffer is too small.
+ ******************************************************************************/
+sl_status_t aoa_codec_position_to_string(const aoa_position_t *position,
+                                         const aoa_trace_span_t *span,
+                                         char *buffer,
+                                         size_t size);
+
+/***************************************************************************//**
+ * Pack IQ report with its origin and capture timestamp.
+ *
+ * Little endian layout: timestamp (uint64), event counter (uint16), rssi
+ * (int8), channel (uint8), locator ID and asset tag ID (uint8 length and
+ * characters each), sample count (uint8) and samples (int8). The packed report
+ * may contain zero bytes, see aoa_codec_iq_to_binary for a string payload.
+ *
+ * @param[in] iq_report IQ report.
+ * @param[in] locator_id Locator ID, NUL terminated.
+ * @param[in] tag_id Asset tag ID, NUL terminated.
+ * @param[in] timestamp Capture timestamp.
+ * @param[out] buffer Packed report.
+ * @param[in] size Size of the buffer, AOA_CODEC_IQ_PACKED_SIZE is enough for
+ *            any report.
+ * @param[out] len Length of the packed report.
+ *
+ * @retval SL_STATUS_OK Report packed.
+ * @retval SL_STATUS_WOULD_OVERFLOW Buffer is too small.
+ ******************************************************************************/
+sl_status_t aoa_codec_iq_pack(const aoa_iq_report_t *iq_report,
+                              const char *locator_id,
+                              const char *tag_id,
+                              uint64_t timestamp,
+                              uint8_t *buffer,
+                              size_t size,
+                              size_t *len);
+
+/***************************************************************************//**
+ * Unpack IQ report packed by aoa_codec_iq_pack.
+ *
+ * @param[in] buffer Packed report.
+ * @param[in] len Length of the packed report.
+ * @param[out] iq Decoded report.
+ *
+ * @retval SL_STATUS_OK Report unpacked.
+ * @retval SL_STATUS_FAIL Malformed report.
+ ******************************************************************************/
+sl_status_t aoa_codec_iq_unpack(const uint8_t *buffer,
+                                size_t len,
+                                aoa_codec_iq_t *iq);
+
+/***************************************************************************//**
+ * Convert IQ report with its origin and capture timestamp to binary payload.
+ *
+ * The packed report is COBS encoded after an AOA_CODEC_IQ_MARKER byte, like
+ * the binary angle payload.
+ *
+ * @param[in] iq_report IQ report.
+ * @param[in] locator_id Locator ID, NUL terminated.
+ * @param[in] tag_id Asset tag ID, NUL terminated.
+ * @param[in] timestamp Capture timestamp.
+ * @param[out] buffer Payload, NUL terminated.
+ * @param[in] size Size of the buffer, AOA_CODEC_IQ_SIZE is enough for any
+ *            report.
+ *
+ * @retval SL_STATUS_OK Payload created.
+ * @retval SL_STATUS_WOULD_OVERFLOW Buffer is too small.
+ ******************************************************************************/
+sl_status_t aoa_codec_iq_to_binary(const aoa_iq_report_t *iq_report,
+                                   const char *locator_id,
+                                   const char *tag_id,
+                                   uint64_t timestamp,
+                                   char *buffer,
+                                   size_t size);
+
+/***************************************************************************//**
+ * Convert binary IQ report payload to IQ report.
+ *
+ * @param[in] payload Payload, NUL terminated.
+ * @param[out] iq Decoded report.
+ *
+ * @retval SL_STATUS_OK Report decoded.
+ * @retval SL_STATUS_FAIL Malformed payload.
+ ******************************************************************************/
+sl_status_t aoa_codec_decode_iq(const char *payload, aoa_codec_iq_t *iq);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_CODEC_H
@@ -0,0 +1,91 @@
+/***************************************************************************//**
+ * @file
+ * @brief Constant velocity position filter.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "aoa_filter.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+// Velocity variance before the first velocity measurement, (m/s)^2.
+#define INITIAL_VELOCITY_VARIANCE  4.0f
+
+/***************************************************************************//**
+ * Initialize a filter.
+ ******************************************************************************/
+void aoa_filter_init(aoa_filter_t *filter,
+                     float acceleration_noise,
+                     float measurement_noise)
+{
+  memset(filter, 0, sizeof(*filter));
+  filter->q = acceleration_noise * acceleration_noise;
+  filter->r = measurement_noise * measurement_noise;
+}
+
+/***************************************************************************//**
+ * Update a filter with a position measurement.
+ ******************************************************************************/
+void aoa_filter_update(aoa_filter_t *filter,
+                       const float measurement[3],
+                       float time_step)
+{
+  float dt = (time_step > 0) ? time_step : 0;
+  float s, k0, k1, p00, p01, p11;
+  float innovation[3];
+
+  if (!filter->initialized) {
+    memcpy(filter->position, measurement, sizeof(filter->position));
+    memset(filter->velocity, 0, sizeof(filter->velocity));
+    filter->p00 = filter->r;
+    filter->p01 = 0;
+    filter->p11 = INITIAL_VELOCITY_VARIANCE;
+    filter->initialized = true;
+    return;
+  }
+
+  // Predict: x' = F x, P' = F P F^T + Q for F = [1 dt; 0 1].
+  p00 = filter->p00 + dt * (2 * filter->p01 + dt * filter->p11)
+        + filter->q * dt * dt * dt / 3;
+  p01 = filter->p01 + dt * filter->p11 + filter->q * dt * dt / 2;
+  p11 = filter->p11 + filter->q * dt;
+
+  // Update with the position measurement, H = [1 0].
+  s = p00 + filter->r;
+  k0 = p00 / s;
+  k1 = p01 / s;
+  for (int i = 0; i < 3; i++) {
+    innovation[i] = measurement[i] - (filter->position[i] + dt * filter->velocity[i]);
+    filter->position[i] += dt * filter->velocity[i] + k0 * innovation[i];
+    filter->velocity[i] += k1 * innovation[i];
+  }
+  filter->p00 = (1 - k0) * p00;
+  filter->p01 = (1 - k0) * p01;
+  filter->p11 = p11 - k1 * p01;
+}
@@ -0,0 +1,86 @@
+/***************************************************************************//**
+ * @file
+ * @brief Constant velocity position filter.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_FILTER_H
+#define AOA_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+// Kalman filter of a position moving with constant velocity, disturbed by
+// white noise acceleration. The axes are filtered with the same noise
+// parameters, so they share one covariance matrix and one gain, and the state
+// of the three axes is updated together.
+typedef struct {
+  float position[3];
+  float velocity[3];
+  float p00;                // position variance
+  float p01;                // position-velocity covariance
+  float p11;                // velocity variance
+  float q;                  // acceleration noise spectral density
+  float r;                  // measurement variance
+  bool initialized;         // false until the first measurement
+} aoa_filter_t;
+
+/***************************************************************************//**
+ * Initialize a filter.
+ *
+ * @param[out] filter Filter.
+ * @param[in] acceleration_noise Standard deviation of the acceleration in
+ *            m/s^2, higher values follow maneuvers faster.
+ * @param[in] measurement_noise Standard deviation of the position
+ *            measurements in m, higher values smooth more.
+ ******************************************************************************/
+void aoa_filter_init(aoa_filter_t *filter,
+                     float acceleration_noise,
+                     float measurement_noise);
+
+/***************************************************************************//**
+ * Update a filter with a position measurement.
+ *
+ * The first measurement sets the position with zero velocity.
+ *
+ * @param[in,out] filter Filter.
+ * @param[in] measurement Measured position.
+ * @param[in] time_step Time since the previous measurement in seconds, zero
+ *            when refining the previous measurement.
+ ******************************************************************************/
+void aoa_filter_update(aoa_filter_t *filter,
+                       const float measurement[3],
+                       float time_step);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_FILTER_H
@@ -0,0 +1,429 @@
+/***************************************************************************//**
+ * @file
+ * @brief Grid indexed geofences.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "aoa_geofence.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define INITIAL_CAPACITY  16
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static sl_status_t add_fence(aoa_geofence_index_t *index,
+                             const char *id,
+                             uint64_t dwell,
+                             aoa_geofence_t **fence);
+static void get_cell_range(const aoa_geofence_index_t *index,
+                           const aoa_geofence_t *fence,
+                           uint32_t range[4]);
+static uint32_t find_presence(const aoa_geofence_state_t *state, uint32_t fence);
+
+/***************************************************************************//**
+ * Initialize an empty geofence index.
+ ******************************************************************************/
+void aoa_geofence_init(aoa_geofence_index_t *index)
+{
+  memset(index, 0, sizeof(*index));
+}
+
+/***************************************************************************//**
+ * Release resources of a geofence index.
+ ******************************************************************************/
+void aoa_geofence_deinit(aoa_geofence_index_t *index)
+{
+  free(index->fences);
+  free(index->vertices);
+  free(index->cell_start);
+  free(index->cell_items);
+  memset(index, 0, sizeof(*index));
+}
+
+/***************************************************************************//**
+ * Add a box geofence.
+ ******************************************************************************/
+sl_status_t aoa_geofence_add_box(aoa_geofence_index_t *index,
+                                 const char *id,
+                                 const float min[3],
+                                 const float max[3],
+                                 uint64_t dwell)
+{
+  sl_status_t sc;
+  aoa_geofence_t *fence;
+
+  for (int i = 0; i < 3; i++) {
+    if (!(min[i] < max[i])) {
+      return SL_STATUS_INVALID_PARAMETER;
+    }
+  }
+  sc = add_fence(index, id, dwell, &fence);
+  if (sc != SL_STATUS_OK) {
+    return sc;
+  }
+  memcpy(fence->min, min, sizeof(fence->min));
+  memcpy(fence->max, max, sizeof(fence->max));
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Add a polygon geofence, extended vertically between two heights.
+ ******************************************************************************/
+sl_status_t aoa_geofence_add_polygon(aoa_geofence_index_t *index,
+                                     const char *id,
+                                     const float (*vertices)[2],
+                                     uint32_t vertex_count,
+                                     float z_min,
+                                     float z_max,
+                                     uint64_t dwell)
+{
+  sl_status_t sc;
+  aoa_geofence_t *fence;
+  float (*list)[2];
+  uint32_t capacity;
+
+  if ((vertex_count < 3) || !(z_min < z_max)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (index->vertex_count + vertex_count > index->vertex_capacity) {
+    capacity = (index->vertex_capacity == 0) ? INITIAL_CAPACITY : index->vertex_capacity;
+    while (index->vertex_count + vertex_count > capacity) {
+      capacity *= 2;
+    }
+    list = realloc(index->vertices, capacity * sizeof(*list));
+    if (list == NULL) {
+      return SL_STATUS_ALLOCATION_FAILED;
+    }
+    index->vertices = list;
+    index->vertex_capacity = capacity;
+  }
+  sc = add_fence(index, id, dwell, &fence);
+  if (sc != SL_STATUS_OK) {
+    return sc;
+  }
+
+  fence->vertex_offset = index->vertex_count;
+  fence->vertex_count = vertex_count;
+  memcpy(index->vertices[index->vertex_count], vertices, vertex_count * sizeof(*vertices));
+  index->vertex_count += vertex_count;
+
+  fence->min[0] = fence->max[0] = vertices[0][0];
+  fence->min[1] = fence->max[1] = vertices[0][1];
+  for (uint32_t i = 1; i < vertex_count; i++) {
+    fence->min[0] = fminf(fence->min[0], vertices[i][0]);
+    fence->max[0] = fmaxf(fence->max[0], vertices[i][0]);
+    fence->min[1] = fminf(fence->min[1], vertices[i][1]);
+    fence->max[1] = fmaxf(fence->max[1], vertices[i][1]);
+  }
+  fence->min[2] = z_min;
+  fence->max[2] = z_max;
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Build the grid index after all geofences are added.
+ ******************************************************************************/
+sl_status_t aoa_geofence_build(aoa_geofence_index_t *index, float cell_size)
+{
+  float min[2], max[2];
+  uint32_t range[4];
+  uint32_t cell_count, item_count = 0;
+  uint32_t *cursor;
+
+  free(index->cell_start);
+  free(index->cell_items);
+  index->cell_start = NULL;
+  index->cell_items = NULL;
+  index->columns = 0;
+  index->rows = 0;
+  if (index->count == 0) {
+    return SL_STATUS_OK;
+  }
+
+  // The grid covers the bounding box of all geofences.
+  min[0] = index->fences[0].min[0];
+  min[1] = index->fences[0].min[1];
+  max[0] = index->fences[0].max[0];
+  max[1] = index->fences[0].max[1];
+  for (uint32_t i = 1; i < index->count; i++) {
+    for (int j = 0; j < 2; j++) {
+      min[j] = fminf(min[j], index->fences[i].min[j]);
+      max[j] = fmaxf(max[j], index->fences[i].max[j]);
+    }
+  }
+  index->origin[0] = min[0];
+  index->origin[1] = min[1];
+  index->cell_size = (cell_size > 0) ? cell_size : 1.0f;
+  for (;;) {
+    index->columns = (uint32_t)((max[0] - min[0]) / index->cell_size) + 1;
+    index->rows = (uint32_t)((max[1] - min[1]) / index->cell_size) + 1;
+    if ((uint64_t)index->columns * index->rows <= AOA_GEOFENCE_MAX_CELLS) {
+      break;
+    }
+    index->cell_size *= 2;
+  }
+  cell_count = index->columns * index->rows;
+
+  index->cell_start = calloc(cell_count + 1, sizeof(uint32_t));
+  if (index->cell_start == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+
+  // Count the geofences of each cell, then place them.
+  for (uint32_t i = 0; i < index->count; i++) {
+    get_cell_range(index, &index->fences[i], range);
+    for (uint32_t row = range[1]; row <= range[3]; row++) {
+      for (uint32_t col = range[0]; col <= range[2]; col++) {
+        index->cell_start[row * index->columns + col + 1]++;
+        item_count++;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < cell_count; i++) {
+    index->cell_start[i + 1] += index->cell_start[i];
+  }
+  index->cell_items = malloc(item_count * sizeof(uint32_t));
+  cursor = malloc(cell_count * sizeof(uint32_t));
+  if ((index->cell_items == NULL) || (cursor == NULL)) {
+    free(cursor);
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  memcpy(cursor, index->cell_start, cell_count * sizeof(uint32_t));
+  for (uint32_t i = 0; i < index->count; i++) {
+    get_cell_range(index, &index->fences[i], range);
+    for (uint32_t row = range[1]; row <= range[3]; row++) {
+      for (uint32_t col = range[0]; col <= range[2]; col++) {
+        index->cell_items[cursor[row * index->columns + col]++] = i;
+      }
+    }
+  }
+  free(cursor);
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Check if a point is inside a geofence.
+ ******************************************************************************/
+bool aoa_geofence_contains(const aoa_geofence_index_t *index,
+                           const aoa_geofence_t *fence,
+                           const float point[3])
+{
+  const float (*v)[2];
+  bool inside = false;
+  uint32_t j;
+
+  for (int i = 0; i < 3; i++) {
+    if ((point[i] < fence->min[i]) || (point[i] > fence->max[i])) {
+      return false;
+    }
+  }
+  if (fence->vertex_count == 0) {
+    return true;
+  }
+
+  // Count the edges crossing the ray from the point towards +x.
+  v = (const float (*)[2])index->vertices[fence->vertex_offset];
+  j = fence->vertex_count - 1;
+  for (uint32_t i = 0; i < fence->vertex_count; j = i++) {
+    if (((v[i][1] > point[1]) != (v[j][1] > point[1]))
+        && (point[0] < v[i][0] + (point[1] - v[i][1]) * (v[j][0] - v[i][0]) / (v[j][1] - v[i][1]))) {
+      inside = !inside;
+    }
+  }
+  return inside;
+}
+
+/***************************************************************************//**
+ * Update the geofence state of an object with its new position.
+ ******************************************************************************/
+void aoa_geofence_update(const aoa_geofence_index_t *index,
+                         aoa_geofence_state_t *state,
+                         const float point[3],
+                         uint64_t time,
+                         aoa_geofence_callback_t callback,
+                         void *context)
+{
+  uint32_t current[AOA_GEOFENCE_MAX_INSIDE];
+  uint32_t current_count = 0;
+  uint32_t col, row, cell, fence;
+  bool found;
+  float x, y;
+
+  // Collect the geofences containing the point.
+  if (index->cell_start != NULL) {
+    x = (point[0] - index->origin[0]) / index->cell_size;
+    y = (point[1] - index->origin[1]) / index->cell_size;
+    if ((x >= 0) && (y >= 0) && (x < index->columns) && (y < index->rows)) {
+      col = (uint32_t)x;
+      row = (uint32_t)y;
+      cell = row * index->columns + col;
+      for (uint32_t i = index->cell_start[cell];
+           (i < index->cell_start[cell + 1]) && (current_count < AOA_GEOFENCE_MAX_INSIDE);
+           i++) {
+        fence = index->cell_items[i];
+        if (aoa_geofence_contains(index, &index->fences[fence], point)) {
+          current[current_count++] = fence;
+        }
+      }
+    }
+  }
+
+  // Exit the geofences not containing the point anymore.
+  for (uint32_t i = 0; i < state->count;) {
+    found = false;
+    for (uint32_t j = 0; j < current_count; j++) {
+      if (current[j] == state->inside[i].fence) {
+        found = true;
+        break;
+      }
+    }
+    if (found) {
+      i++;
+      continue;
+    }
+    callback(context, &index->fences[state->inside[i].fence], AOA_GEOFENCE_EVENT_EXIT);
+    state->inside[i] = state->inside[--state->count];
+  }
+
+  // Enter the new ones.
+  for (uint32_t j = 0; j < current_count; j++) {
+    if (find_presence(state, current[j]) < state->count) {
+      continue;
+    }
+    if (state->count == AOA_GEOFENCE_MAX_INSIDE) {
+      break;
+    }
+    state->inside[state->count].fence = current[j];
+    state->inside[state->count].enter_time = time;
+    state->inside[state->count].dwell_reported = false;
+    state->count++;
+    callback(context, &index->fences[current[j]], AOA_GEOFENCE_EVENT_ENTER);
+  }
+
+  // Report dwelling once per visit.
+  for (uint32_t i = 0; i < state->count; i++) {
+    const aoa_geofence_t *f = &index->fences[state->inside[i].fence];
+    if (!state->inside[i].dwell_reported
+        && (f->dwell > 0)
+        && (time - state->inside[i].enter_time >= f->dwell)) {
+      state->inside[i].dwell_reported = true;
+      callback(context, f, AOA_GEOFENCE_EVENT_DWELL);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Get the name of a geofence event.
+ ******************************************************************************/
+const char *aoa_geofence_event_name(enum aoa_geofence_event event)
+{
+  switch (event) {
+    case AOA_GEOFENCE_EVENT_ENTER:
+      return "enter";
+    case AOA_GEOFENCE_EVENT_EXIT:
+      return "exit";
+    case AOA_GEOFENCE_EVENT_DWELL:
+      return "dwell";
+    default:
+      return "unknown";
+  }
+}
+
+/***************************************************************************//**
+ * Append a geofence to the list.
+ ******************************************************************************/
+static sl_status_t add_fence(aoa_geofence_index_t *index,
+                             const char *id,
+                             uint64_t dwell,
+                             aoa_geofence_t **fence)
+{
+  aoa_geofence_t *list;
+  uint32_t capacity;
+
+  if (strlen(id) >= sizeof(aoa_id_t)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (index->count == index->capacity) {
+    capacity = (index->capacity == 0) ? INITIAL_CAPACITY : 2 * index->capacity;
+    list = realloc(index->fences, capacity * sizeof(*list));
+    if (list == NULL) {
+      return SL_STATUS_ALLOCATION_FAILED;
+    }
+    index->fences = list;
+    index->capacity = capacity;
+  }
+  *fence = &index->fences[index->count++];
+  memset(*fence, 0, sizeof(**fence));
+  strcpy((*fence)->id, id);
+  (*fence)->dwell = dwell;
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Get the grid cells overlapped by the bounding box of a geofence.
+ *
+ * @param[out] range First column, first row, last column, last row.
+ ******************************************************************************/
+static void get_cell_range(const aoa_geofence_index_t *index,
+                           const aoa_geofence_t *fence,
+                           uint32_t range[4])
+{
+  for (int i = 0; i < 2; i++) {
+    uint32_t limit = (i == 0) ? index->columns : index->rows;
+    uint32_t first = (uint32_t)((fence->min[i] - index->origin[i]) / index->cell_size);
+    uint32_t last = (uint32_t)((fence->max[i] - index->origin[i]) / index->cell_size);
+    range[i] = (first < limit) ? first : limit - 1;
+    range[i + 2] = (last < limit) ? last : limit - 1;
+  }
+}
+
+/***************************************************************************//**
+ * Find a geofence in the state of an object.
+ *
+ * @return Index in the state, state->count if not found.
+ ******************************************************************************/
+static uint32_t find_presence(const aoa_geofence_state_t *state, uint32_t fence)
+{
+  uint32_t i;
+
+  for (i = 0; i < state->count; i++) {
+    if (state->inside[i].fence == fence) {
+      break;
+    }
+  }
+  return i;
+}
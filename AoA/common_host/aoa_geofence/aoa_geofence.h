@@ -0,0 +1,222 @@
+/***************************************************************************//**
+ * @file
+ * @brief Grid indexed geofences.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_GEOFENCE_H
+#define AOA_GEOFENCE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+
+// Geofence event topic: multilocator ID, geofence ID, asset tag ID.
+#define AOA_GEOFENCE_TOPIC_EVENT_PRINT  "silabs/aoa/geofence/%s/%s/%s"
+
+// Number of geofences an object can be inside at the same time. Further
+// geofences are ignored until the object leaves one of them.
+#define AOA_GEOFENCE_MAX_INSIDE  16
+
+// Upper limit of the grid cells, the cell size is increased if needed.
+#define AOA_GEOFENCE_MAX_CELLS   (1u << 20)
+
+enum aoa_geofence_event {
+  AOA_GEOFENCE_EVENT_ENTER,
+  AOA_GEOFENCE_EVENT_EXIT,
+  AOA_GEOFENCE_EVENT_DWELL
+};
+
+// Geofence, box or vertical prism over a polygon.
+typedef struct {
+  aoa_id_t id;
+  float min[3];             // bounding box
+  float max[3];
+  uint32_t vertex_offset;   // first vertex of the polygon
+  uint32_t vertex_count;    // 0 for a box
+  uint64_t dwell;           // us, 0 disables the dwell event
+} aoa_geofence_t;
+
+// Geofences with a uniform grid index in the xy plane. Each cell lists the
+// geofences whose bounding box overlaps it, in compressed row format.
+typedef struct {
+  aoa_geofence_t *fences;
+  uint32_t count;
+  uint32_t capacity;
+  float (*vertices)[2];
+  uint32_t vertex_count;
+  uint32_t vertex_capacity;
+  float origin[2];          // corner of the grid
+  float cell_size;
+  uint32_t columns;
+  uint32_t rows;
+  uint32_t *cell_start;     // first item of each cell, columns * rows + 1
+  uint32_t *cell_items;     // geofence indexes
+} aoa_geofence_index_t;
+
+// Geofence an object is inside.
+typedef struct {
+  uint32_t fence;
+  uint64_t enter_time;
+  bool dwell_reported;
+} aoa_geofence_presence_t;
+
+// Geofence state of an object.
+typedef struct {
+  uint32_t count;
+  aoa_geofence_presence_t inside[AOA_GEOFENCE_MAX_INSIDE];
+} aoa_geofence_state_t;
+
+/***************************************************************************//**
+ * Geofence event callback.
+ *
+ * @param[in] context Context given to aoa_geofence_update.
+ * @param[in] fence Geofence.
+ * @param[in] event Event type.
+ ******************************************************************************/
+typedef void (*aoa_geofence_callback_t)(void *context,
+                                        const aoa_geofence_t *fence,
+                                        enum aoa_geofence_event event);
+
+/***************************************************************************//**
+ * Initialize an empty geofence index.
+ *
+ * @param[out] index Geofence index.
+ ******************************************************************************/
+void aoa_geofence_init(aoa_geofence_index_t *index);
+
+/***************************************************************************//**
+ * Release resources of a geofence index.
+ *
+ * @param[in] index Geofence index.
+ ******************************************************************************/
+void aoa_geofence_deinit(aoa_geofence_index_t *index);
+
+/***************************************************************************//**
+ * Add a box geofence.
+ *
+ * @param[in] index Geofence index, not built yet.
+ * @param[in] id Geofence ID.
+ * @param[in] min Minimum corner.
+ * @param[in] max Maximum corner.
+ * @param[in] dwell Dwell time in us, 0 disables the dwell event.
+ *
+ * @retval SL_STATUS_OK Geofence added.
+ * @retval SL_STATUS_INVALID_PARAMETER Empty box.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t aoa_geofence_add_box(aoa_geofence_index_t *index,
+                                 const char *id,
+                                 const float min[3],
+                                 const float max[3],
+                                 uint64_t dwell);
+
+/***************************************************************************//**
+ * Add a polygon geofence, extended vertically between two heights.
+ *
+ * @param[in] index Geofence index, not built yet.
+ * @param[in] id Geofence ID.
+ * @param[in] vertices Vertices of the polygon in the xy plane.
+ * @param[in] vertex_count Number of vertices, at least 3.
+ * @param[in] z_min Bottom of the geofence.
+ * @param[in] z_max Top of the geofence.
+ * @param[in] dwell Dwell time in us, 0 disables the dwell event.
+ *
+ * @retval SL_STATUS_OK Geofence added.
+ * @retval SL_STATUS_INVALID_PARAMETER Too few vertices or empty height range.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t aoa_geofence_add_polygon(aoa_geofence_index_t *index,
+                                     const char *id,
+                                     const float (*vertices)[2],
+                                     uint32_t vertex_count,
+                                     float z_min,
+                                     float z_max,
+                                     uint64_t dwell);
+
+/***************************************************************************//**
+ * Build the grid index after all geofences are added.
+ *
+ * @param[in] index Geofence index.
+ * @param[in] cell_size Requested edge length of the grid cells.
+ *
+ * @retval SL_STATUS_OK Index built.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t aoa_geofence_build(aoa_geofence_index_t *index, float cell_size);
+
+/***************************************************************************//**
+ * Check if a point is inside a geofence.
+ *
+ * @param[in] index Geofence index.
+ * @param[in] fence Geofence.
+ * @param[in] point Point.
+ * @return true if the point is inside.
+ ******************************************************************************/
+bool aoa_geofence_contains(const aoa_geofence_index_t *index,
+                           const aoa_geofence_t *fence,
+                           const float point[3]);
+
+/***************************************************************************//**
+ * Update the geofence state of an object with its new position.
+ *
+ * Only the geofences listed in the grid cell of the point are tested.
+ * Events are reported in exit, enter, dwell order.
+ *
+ * @param[in] index Built geofence index, not modified.
+ * @param[in,out] state Geofence state of the object, zero initialized before
+ *                the first update.
+ * @param[in] point Position of the object.
+ * @param[in] time Time of the position in us.
+ * @param[in] callback Called for each event.
+ * @param[in] context Passed to the callback.
+ ******************************************************************************/
+void aoa_geofence_update(const aoa_geofence_index_t *index,
+                         aoa_geofence_state_t *state,
+                         const float point[3],
+                         uint64_t time,
+                         aoa_geofence_callback_t callback,
+                         void *context);
+
+/***************************************************************************//**
+ * Get the name of a geofence event.
+ *
+ * @param[in] event Event type.
+ * @return Event name.
+ ******************************************************************************/
+const char *aoa_geofence_event_name(enum aoa_geofence_event event);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_GEOFENCE_H
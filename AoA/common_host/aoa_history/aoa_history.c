@@ -0,0 +1,747 @@
+/***************************************************************************//**
+ * @file
+ * @brief Memory-mapped position history of asset tags.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "aoa_history.h"
+#include "aoa_varint.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define HEADER_SIZE       64
+#define SLOT_HEADER_SIZE  ((sizeof(slot_header_t) + 63) & ~(size_t)63)
+#define BLOCK_DATA_SIZE   (AOA_HISTORY_BLOCK_SIZE - sizeof(block_header_t))
+
+// Time, x, y, z and sequence differences.
+#define FIELD_COUNT       5
+#define MAX_RECORD_SIZE   (FIELD_COUNT * AOA_VARINT_MAX_SIZE)
+
+// Upper limit of the positions in a block, each difference takes at least one
+// byte per field.
+#define MAX_BLOCK_ENTRIES (1 + BLOCK_DATA_SIZE / FIELD_COUNT)
+
+// Number of times a query is repeated when the slot is reused meanwhile.
+#define MAX_QUERY_ATTEMPTS 3
+
+// The writer publishes the mapped data to concurrent readers with release
+// stores, readers take acquire loads and check that the block number did not
+// change while they copied the block.
+#define LOAD(ptr)         __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+
+// -----------------------------------------------------------------------------
+// Private types
+
+typedef struct {
+  char magic[sizeof(AOA_HISTORY_MAGIC) - 1];
+  uint8_t version;
+  uint8_t reserved;
+  uint32_t id_size;
+  uint32_t tag_count;
+  uint32_t block_count;
+  uint32_t block_size;
+} file_header_t;
+
+typedef struct {
+  uint32_t generation;  // odd while the slot is reassigned
+  uint32_t reserved;
+  uint64_t blocks;      // number of blocks started
+  uint64_t last_time;   // last position, in time resolution units
+  int32_t last[FIELD_COUNT - 1]; // last x, y, z and sequence
+  aoa_id_t id;          // empty if the slot is free
+} slot_header_t;
+
+typedef struct {
+  uint64_t number;      // block number in the slot from 1, 0 while rewritten
+  uint64_t time;        // first position, in time resolution units
+  int32_t first[FIELD_COUNT - 1]; // first x, y, z and sequence
+  uint32_t used;        // number of difference bytes
+  uint32_t reserved;
+} block_header_t;
+
+typedef struct {
+  block_header_t header;
+  uint8_t data[BLOCK_DATA_SIZE];
+} block_t;
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static sl_status_t map_file(const char *filename,
+                            bool writable,
+                            size_t size,
+                            uint8_t **map,
+                            size_t *mapped);
+static void unmap_file(uint8_t *map, size_t size);
+static size_t get_file_size(uint32_t tag_count, uint32_t block_count);
+static bool is_header_valid(const file_header_t *header);
+static slot_header_t *get_slot(aoa_history_t *history, uint32_t index);
+static block_t *get_block(aoa_history_t *history,
+                          slot_header_t *slot,
+                          uint64_t number);
+static void *run_writer(void *arg);
+static void write_entry(aoa_history_t *history, aoa_history_pending_t *item);
+static uint32_t assign_slot(aoa_history_t *history, const char *id);
+static int32_t quantize(float value, float resolution);
+static sl_status_t query(aoa_history_t *history,
+                         const char *id,
+                         uint64_t from,
+                         uint64_t to,
+                         aoa_history_entry_t *entries,
+                         uint32_t max,
+                         uint32_t *count);
+static bool copy_block(block_t *block, uint64_t number, block_t *copy);
+static uint32_t decode_block(const block_t *block, aoa_history_entry_t *entries);
+
+/***************************************************************************//**
+ * Open or create a history file for writing and start its writer thread.
+ ******************************************************************************/
+sl_status_t aoa_history_create(aoa_history_t *history,
+                               const char *filename,
+                               uint32_t tag_count,
+                               uint32_t block_count)
+{
+  sl_status_t sc;
+  file_header_t *header;
+  slot_header_t *slot;
+  size_t size;
+
+  memset(history, 0, sizeof(*history));
+  if ((tag_count == 0) || (block_count == 0)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  size = get_file_size(tag_count, block_count);
+  if (size == 0) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  sc = map_file(filename, true, size, &history->map, &history->size);
+  if (sc != SL_STATUS_OK) {
+    return sc;
+  }
+  history->tag_count = tag_count;
+  history->block_count = block_count;
+  history->writable = true;
+
+  // Continue the history of a file with the same layout.
+  header = (file_header_t *)history->map;
+  if (!is_header_valid(header)
+      || (header->tag_count != tag_count)
+      || (header->block_count != block_count)) {
+    memset(history->map, 0, size);
+    memcpy(header->magic, AOA_HISTORY_MAGIC, sizeof(header->magic));
+    header->version = AOA_HISTORY_VERSION;
+    header->id_size = sizeof(aoa_id_t);
+    header->tag_count = tag_count;
+    header->block_count = block_count;
+    header->block_size = AOA_HISTORY_BLOCK_SIZE;
+  }
+
+  sc = aoa_id_table_init(&history->slots, tag_count);
+  if (sc != SL_STATUS_OK) {
+    unmap_file(history->map, history->size);
+    history->map = NULL;
+    return sc;
+  }
+  for (uint32_t i = 0; i < tag_count; i++) {
+    slot = get_slot(history, i);
+    if (slot->generation % 2 != 0) {
+      // The previous writer stopped while reassigning the slot.
+      memset(slot, 0, sizeof(*slot));
+    }
+    slot->id[sizeof(aoa_id_t) - 1] = '\0';
+    if (slot->id[0] != '\0') {
+      aoa_id_table_add(&history->slots, slot->id, strlen(slot->id), i);
+      history->slot_count = i + 1;
+    }
+  }
+
+  pthread_mutex_init(&history->lock, NULL);
+  pthread_cond_init(&history->wakeup, NULL);
+  if (pthread_create(&history->thread, NULL, run_writer, history) != 0) {
+    pthread_cond_destroy(&history->wakeup);
+    pthread_mutex_destroy(&history->lock);
+    aoa_id_table_deinit(&history->slots);
+    unmap_file(history->map, history->size);
+    history->map = NULL;
+    return SL_STATUS_FAIL;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Open a history file for reading.
+ ******************************************************************************/
+sl_status_t aoa_history_open(aoa_history_t *history, const char *filename)
+{
+  sl_status_t sc;
+  file_header_t *header;
+
+  memset(history, 0, sizeof(*history));
+  sc = map_file(filename, false, 0, &history->map, &history->size);
+  if (sc != SL_STATUS_OK) {
+    return sc;
+  }
+  header = (file_header_t *)history->map;
+  if ((history->size < HEADER_SIZE)
+      || !is_header_valid(header)
+      || (get_file_size(header->tag_count, header->block_count) == 0)
+      || (get_file_size(header->tag_count, header->block_count) > history->size)) {
+    aoa_history_close(history);
+    return SL_STATUS_INVALID_TYPE;
+  }
+  history->tag_count = header->tag_count;
+  history->block_count = header->block_count;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Queue a position to be written by the writer thread.
+ ******************************************************************************/
+sl_status_t aoa_history_push(aoa_history_t *history,
+                             const char *id,
+                             uint64_t time,
+                             const aoa_position_t *position)
+{
+  aoa_history_pending_t *item;
+  sl_status_t sc = SL_STATUS_OK;
+
+  pthread_mutex_lock(&history->lock);
+  if (history->pending == AOA_HISTORY_QUEUE_SIZE) {
+    history->dropped++;
+    sc = SL_STATUS_FULL;
+  } else {
+    item = &history->queue[(history->head + history->pending) % AOA_HISTORY_QUEUE_SIZE];
+    strncpy(item->id, id, sizeof(item->id) - 1);
+    item->id[sizeof(item->id) - 1] = '\0';
+    item->entry.time = time;
+    item->entry.position = *position;
+    if (history->pending++ == 0) {
+      pthread_cond_signal(&history->wakeup);
+    }
+  }
+  pthread_mutex_unlock(&history->lock);
+  return sc;
+}
+
+/***************************************************************************//**
+ * Get the last positions of an asset tag.
+ ******************************************************************************/
+sl_status_t aoa_history_last(aoa_history_t *history,
+                             const char *id,
+                             aoa_history_entry_t *entries,
+                             uint32_t max,
+                             uint32_t *count)
+{
+  return query(history, id, 0, UINT64_MAX, entries, max, count);
+}
+
+/***************************************************************************//**
+ * Get the positions of an asset tag in a time range.
+ ******************************************************************************/
+sl_status_t aoa_history_range(aoa_history_t *history,
+                              const char *id,
+                              uint64_t from,
+                              uint64_t to,
+                              aoa_history_entry_t *entries,
+                              uint32_t max,
+                              uint32_t *count)
+{
+  return query(history, id, from, to, entries, max, count);
+}
+
+/***************************************************************************//**
+ * Close a history.
+ ******************************************************************************/
+void aoa_history_close(aoa_history_t *history)
+{
+  if (history->map == NULL) {
+    return;
+  }
+  if (history->writable) {
+    pthread_mutex_lock(&history->lock);
+    history->stop = true;
+    pthread_cond_signal(&history->wakeup);
+    pthread_mutex_unlock(&history->lock);
+    pthread_join(history->thread, NULL);
+    pthread_cond_destroy(&history->wakeup);
+    pthread_mutex_destroy(&history->lock);
+    aoa_id_table_deinit(&history->slots);
+  }
+  unmap_file(history->map, history->size);
+  history->map = NULL;
+  history->size = 0;
+}
+
+/***************************************************************************//**
+ * Map a file into memory.
+ *
+ * @param[in] filename File to map.
+ * @param[in] writable Map for writing, the file is created or resized to the
+ *            given size. Otherwise the whole file is mapped read only.
+ * @param[in] size Size to map for writing.
+ * @param[out] map Mapped file.
+ * @param[out] mapped Size of the mapped file.
+ ******************************************************************************/
+static sl_status_t map_file(const char *filename,
+                            bool writable,
+                            size_t size,
+                            uint8_t **map,
+                            size_t *mapped)
+{
+#ifdef _WIN32
+  HANDLE file, mapping;
+  LARGE_INTEGER file_size;
+  void *view = NULL;
+
+  file = CreateFileA(filename,
+                     writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                     FILE_SHARE_READ | FILE_SHARE_WRITE,
+                     NULL,
+                     writable ? OPEN_ALWAYS : OPEN_EXISTING,
+                     FILE_ATTRIBUTE_NORMAL,
+                     NULL);
+  if (file == INVALID_HANDLE_VALUE) {
+    return SL_STATUS_IO;
+  }
+  if (!writable) {
+    if (!GetFileSizeEx(file, &file_size) || (file_size.QuadPart == 0)) {
+      CloseHandle(file);
+      return SL_STATUS_IO;
+    }
+    size = (size_t)file_size.QuadPart;
+  }
+  // A writable mapping larger than the file extends the file.
+  mapping = CreateFileMappingA(file,
+                               NULL,
+                               writable ? PAGE_READWRITE : PAGE_READONLY,
+                               (DWORD)((uint64_t)size >> 32),
+                               (DWORD)size,
+                               NULL);
+  if (mapping != NULL) {
+    view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+    CloseHandle(mapping);
+  }
+  CloseHandle(file);
+  if (view == NULL) {
+    return SL_STATUS_IO;
+  }
+  *map = view;
+#else
+  struct stat st;
+  void *view;
+  int fd;
+
+  fd = open(filename, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+  if (fd < 0) {
+    return SL_STATUS_IO;
+  }
+  if (writable) {
+    if (ftruncate(fd, (off_t)size) != 0) {
+      close(fd);
+      return SL_STATUS_IO;
+    }
+  } else {
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0)) {
+      close(fd);
+      return SL_STATUS_IO;
+    }
+    size = (size_t)st.st_size;
+  }
+  view = mmap(NULL,
+              size,
+              writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+              MAP_SHARED,
+              fd,
+              0);
+  close(fd);
+  if (view == MAP_FAILED) {
+    return SL_STATUS_IO;
+  }
+  *map = view;
+#endif
+  *mapped = size;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Unmap a file mapped with map_file.
+ ******************************************************************************/
+static void unmap_file(uint8_t *map, size_t size)
+{
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(map);
+#else
+  munmap(map, size);
+#endif
+}
+
+/***************************************************************************//**
+ * Get the size of a history file.
+ *
+ * @return Size in bytes, 0 if it does not fit in memory.
+ ******************************************************************************/
+static size_t get_file_size(uint32_t tag_count, uint32_t block_count)
+{
+  uint64_t slot_size = SLOT_HEADER_SIZE + (uint64_t)block_count * AOA_HISTORY_BLOCK_SIZE;
+  uint64_t size = HEADER_SIZE + (uint64_t)tag_count * slot_size;
+
+  if ((tag_count == 0) || (block_count == 0) || (size > SIZE_MAX)) {
+    return 0;
+  }
+  return (size_t)size;
+}
+
+/***************************************************************************//**
+ * Check that a file header belongs to a history file of this version.
+ ******************************************************************************/
+static bool is_header_valid(const file_header_t *header)
+{
+  return (memcmp(header->magic, AOA_HISTORY_MAGIC, sizeof(header->magic)) == 0)
+         && (header->version == AOA_HISTORY_VERSION)
+         && (header->id_size == sizeof(aoa_id_t))
+         && (header->block_size == AOA_HISTORY_BLOCK_SIZE);
+}
+
+/***************************************************************************//**
+ * Get a slot header by index.
+ ******************************************************************************/
+static slot_header_t *get_slot(aoa_history_t *history, uint32_t index)
+{
+  size_t slot_size = SLOT_HEADER_SIZE
+                     + (size_t)history->block_count * AOA_HISTORY_BLOCK_SIZE;
+
+  return (slot_header_t *)&history->map[HEADER_SIZE + index * slot_size];
+}
+
+/***************************************************************************//**
+ * Get the ring position of a block by its number.
+ ******************************************************************************/
+static block_t *get_block(aoa_history_t *history,
+                          slot_header_t *slot,
+                          uint64_t number)
+{
+  uint8_t *blocks = (uint8_t *)slot + SLOT_HEADER_SIZE;
+
+  return (block_t *)&blocks[((number - 1) % history->block_count) * AOA_HISTORY_BLOCK_SIZE];
+}
+
+/***************************************************************************//**
+ * Writer thread, writes the queued positions until the history is closed.
+ ******************************************************************************/
+static void *run_writer(void *arg)
+{
+  aoa_history_t *history = arg;
+  aoa_history_pending_t item;
+
+  pthread_mutex_lock(&history->lock);
+  for (;;) {
+    while ((history->pending == 0) && !history->stop) {
+      pthread_cond_wait(&history->wakeup, &history->lock);
+    }
+    if (history->pending == 0) {
+      break;
+    }
+    item = history->queue[history->head];
+    history->head = (history->head + 1) % AOA_HISTORY_QUEUE_SIZE;
+    history->pending--;
+    pthread_mutex_unlock(&history->lock);
+    write_entry(history, &item);
+    pthread_mutex_lock(&history->lock);
+  }
+  pthread_mutex_unlock(&history->lock);
+  return NULL;
+}
+
+/***************************************************************************//**
+ * Append a position to the slot of its asset tag.
+ ******************************************************************************/
+static void write_entry(aoa_history_t *history, aoa_history_pending_t *item)
+{
+  slot_header_t *slot;
+  block_t *block = NULL;
+  uint8_t record[MAX_RECORD_SIZE];
+  int32_t value[FIELD_COUNT - 1];
+  uint64_t time = item->entry.time / AOA_HISTORY_TIME_RESOLUTION;
+  uint64_t number;
+  int64_t diff;
+  size_t len;
+
+  slot = get_slot(history, assign_slot(history, item->id));
+  value[0] = quantize(item->entry.position.x, AOA_HISTORY_RESOLUTION);
+  value[1] = quantize(item->entry.position.y, AOA_HISTORY_RESOLUTION);
+  value[2] = quantize(item->entry.position.z, AOA_HISTORY_RESOLUTION);
+  value[3] = item->entry.position.sequence;
+
+  if (slot->blocks > 0) {
+    // Times are kept monotonic within a slot, range queries rely on it.
+    if (time < slot->last_time) {
+      time = slot->last_time;
+    }
+    len = aoa_varint_encode(time - slot->last_time, record);
+    for (uint32_t i = 0; i < FIELD_COUNT - 1; i++) {
+      diff = (int64_t)value[i] - slot->last[i];
+      len += aoa_varint_encode(((uint64_t)diff << 1) ^ (uint64_t)(diff >> 63), &record[len]);
+    }
+    block = get_block(history, slot, slot->blocks);
+    if (block->header.used + len <= BLOCK_DATA_SIZE) {
+      memcpy(&block->data[block->header.used], record, len);
+      STORE(&block->header.used, block->header.used + (uint32_t)len);
+    } else {
+      block = NULL;
+    }
+  }
+
+  if (block == NULL) {
+    // Start a new block with an absolute position, overwriting the oldest.
+    number = slot->blocks + 1;
+    block = get_block(history, slot, number);
+    STORE(&block->header.number, 0);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    block->header.time = time;
+    memcpy(block->header.first, value, sizeof(value));
+    block->header.used = 0;
+    STORE(&block->header.number, number);
+    STORE(&slot->blocks, number);
+  }
+  slot->last_time = time;
+  memcpy(slot->last, value, sizeof(value));
+  history->written++;
+}
+
+/***************************************************************************//**
+ * Get the slot of an asset tag, assigning one if needed.
+ ******************************************************************************/
+static uint32_t assign_slot(aoa_history_t *history, const char *id)
+{
+  slot_header_t *slot;
+  size_t len = strlen(id);
+  uint32_t index = aoa_id_table_find(&history->slots, id, len);
+
+  if (index != AOA_ID_TABLE_INVALID) {
+    return index;
+  }
+
+  if (history->slot_count < history->tag_count) {
+    index = history->slot_count++;
+  } else {
+    // Reuse the slot of the asset tag not updated for the longest time.
+    index = 0;
+    for (uint32_t i = 1; i < history->tag_count; i++) {
+      if (get_slot(history, i)->last_time < get_slot(history, index)->last_time) {
+        index = i;
+      }
+    }
+  }
+  slot = get_slot(history, index);
+  if (slot->id[0] != '\0') {
+    aoa_id_table_remove(&history->slots, slot->id, strlen(slot->id));
+  }
+
+  // Readers detect the reassignment from the generation change.
+  STORE(&slot->generation, slot->generation + 1);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memset(slot->id, 0, sizeof(slot->id));
+  memcpy(slot->id, id, len);
+  slot->last_time = 0;
+  STORE(&slot->blocks, 0);
+  STORE(&slot->generation, slot->generation + 1);
+
+  aoa_id_table_add(&history->slots, id, len, index);
+  return index;
+}
+
+/***************************************************************************//**
+ * Quantize a coordinate, saturating at the limits of the stored range.
+ ******************************************************************************/
+static int32_t quantize(float value, float resolution)
+{
+  double q = round((double)value / resolution);
+
+  if (q != q) {
+    return 0;
+  }
+  if (q > INT32_MAX) {
+    return INT32_MAX;
+  }
+  if (q < INT32_MIN) {
+    return INT32_MIN;
+  }
+  return (int32_t)q;
+}
+
+/***************************************************************************//**
+ * Get the newest positions of an asset tag in a time range.
+ *
+ * Blocks are visited from the newest, and decoded only if they may overlap
+ * the time range.
+ ******************************************************************************/
+static sl_status_t query(aoa_history_t *history,
+                         const char *id,
+                         uint64_t from,
+                         uint64_t to,
+                         aoa_history_entry_t *entries,
+                         uint32_t max,
+                         uint32_t *count)
+{
+  slot_header_t *slot = NULL;
+  block_t copy;
+  aoa_history_entry_t decoded[MAX_BLOCK_ENTRIES];
+  uint32_t generation, decoded_count, total;
+  uint64_t blocks, number;
+
+  *count = 0;
+  for (uint32_t i = 0; i < history->tag_count; i++) {
+    if (strncmp(get_slot(history, i)->id, id, sizeof(aoa_id_t)) == 0) {
+      slot = get_slot(history, i);
+      break;
+    }
+  }
+  if (slot == NULL) {
+    return SL_STATUS_NOT_FOUND;
+  }
+
+  for (uint32_t attempt = 0; attempt < MAX_QUERY_ATTEMPTS; attempt++) {
+    generation = LOAD(&slot->generation);
+    if (generation % 2 != 0) {
+      continue;
+    }
+    if (strncmp(slot->id, id, sizeof(aoa_id_t)) != 0) {
+      return SL_STATUS_NOT_FOUND;
+    }
+
+    // Fill the output from its end, newest position last.
+    total = 0;
+    blocks = LOAD(&slot->blocks);
+    for (number = blocks;
+         (number > 0) && (number + history->block_count > blocks) && (total < max);
+         number--) {
+      if (!copy_block(get_block(history, slot, number), number, &copy)) {
+        // Overwritten meanwhile, the older blocks are gone as well.
+        break;
+      }
+      if (copy.header.time * AOA_HISTORY_TIME_RESOLUTION > to) {
+        continue;
+      }
+      decoded_count = decode_block(&copy, decoded);
+      for (uint32_t j = decoded_count; (j > 0) && (total < max); j--) {
+        if ((decoded[j - 1].time >= from) && (decoded[j - 1].time <= to)) {
+          entries[max - 1 - total] = decoded[j - 1];
+          total++;
+        }
+      }
+      if (copy.header.time * AOA_HISTORY_TIME_RESOLUTION < from) {
+        break;
+      }
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->generation, __ATOMIC_RELAXED) == generation) {
+      memmove(entries, &entries[max - total], total * sizeof(*entries));
+      *count = total;
+      return SL_STATUS_OK;
+    }
+  }
+  return SL_STATUS_ABORT;
+}
+
+/***************************************************************************//**
+ * Copy a block that may be rewritten concurrently.
+ *
+ * @return true if the copy is consistent and belongs to the given number.
+ ******************************************************************************/
+static bool copy_block(block_t *block, uint64_t number, block_t *copy)
+{
+  uint32_t used;
+
+  if (LOAD(&block->header.number) != number) {
+    return false;
+  }
+  used = LOAD(&block->header.used);
+  if (used > BLOCK_DATA_SIZE) {
+    return false;
+  }
+  memcpy(&copy->header, &block->header, sizeof(copy->header));
+  memcpy(copy->data, block->data, used);
+  copy->header.used = used;
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(&block->header.number, __ATOMIC_RELAXED) == number;
+}
+
+/***************************************************************************//**
+ * Decode the positions of a block.
+ *
+ * @param[out] entries Positions, at least MAX_BLOCK_ENTRIES.
+ * @return Number of positions decoded.
+ ******************************************************************************/
+static uint32_t decode_block(const block_t *block, aoa_history_entry_t *entries)
+{
+  uint64_t time = block->header.time;
+  int32_t value[FIELD_COUNT - 1];
+  uint64_t diff[FIELD_COUNT];
+  size_t offset = 0, len;
+  uint32_t count = 0;
+
+  memcpy(value, block->header.first, sizeof(value));
+  for (;;) {
+    entries[count].time = time * AOA_HISTORY_TIME_RESOLUTION;
+    entries[count].position.x = value[0] * AOA_HISTORY_RESOLUTION;
+    entries[count].position.y = value[1] * AOA_HISTORY_RESOLUTION;
+    entries[count].position.z = value[2] * AOA_HISTORY_RESOLUTION;
+    entries[count].position.sequence = value[3];
+    count++;
+    if ((offset >= block->header.used) || (count == MAX_BLOCK_ENTRIES)) {
+      return count;
+    }
+    for (uint32_t i = 0; i < FIELD_COUNT; i++) {
+      len = aoa_varint_decode(&block->data[offset], block->header.used - offset, &diff[i]);
+      if (len == 0) {
+        // Truncated record, keep the positions decoded so far.
+        return count;
+      }
+      offset += len;
+    }
+    time += diff[0];
+    for (uint32_t i = 0; i < FIELD_COUNT - 1; i++) {
+      value[i] = (int32_t)(uint32_t)((uint64_t)value[i]
+                                     + ((diff[i + 1] >> 1) ^ (0 - (diff[i + 1] & 1))));
+    }
+  }
+}
@@ -0,0 +1,213 @@
+/***************************************************************************//**
+ * @file
+ * @brief Memory-mapped position history of asset tags.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_HISTORY_H
+#define AOA_HISTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+#include "aoa_id_table.h"
+
+// A history file is a header followed by a fixed number of asset tag slots.
+// Each slot is a ring of fixed size blocks. A block starts with an absolute
+// position, the following positions are the LEB128 varint differences from
+// the previous one: time, zigzag encoded x, y, z and sequence. The file uses
+// the byte order of the host.
+#define AOA_HISTORY_MAGIC       "AOAHIS"
+#define AOA_HISTORY_VERSION     1
+
+// Size of a block in bytes.
+#define AOA_HISTORY_BLOCK_SIZE  256
+
+// Resolution of the stored coordinates in meters.
+#define AOA_HISTORY_RESOLUTION  0.001f
+
+// Resolution of the stored timestamps in microseconds.
+#define AOA_HISTORY_TIME_RESOLUTION 1000
+
+// Number of positions waiting for the writer thread. Positions are dropped
+// when the queue is full.
+#define AOA_HISTORY_QUEUE_SIZE  1024
+
+typedef struct {
+  uint64_t time;           // microseconds
+  aoa_position_t position;
+} aoa_history_entry_t;
+
+typedef struct {
+  aoa_id_t id;
+  aoa_history_entry_t entry;
+} aoa_history_pending_t;
+
+typedef struct {
+  uint8_t *map;            // mapped file, NULL if closed
+  size_t size;             // size of the mapped file
+  uint32_t tag_count;      // number of asset tag slots
+  uint32_t block_count;    // number of blocks per slot
+  bool writable;
+  // Writer only, owned by the writer thread.
+  aoa_id_table_t slots;    // asset tag ID to slot index
+  uint32_t slot_count;     // number of slots ever assigned
+  uint64_t written;        // number of positions written
+  pthread_t thread;
+  pthread_mutex_t lock;    // protects the fields below
+  pthread_cond_t wakeup;
+  aoa_history_pending_t queue[AOA_HISTORY_QUEUE_SIZE];
+  uint32_t head;           // oldest pending position
+  uint32_t pending;        // number of pending positions
+  bool stop;
+  uint64_t dropped;        // number of positions dropped on queue overflow
+} aoa_history_t;
+
+/***************************************************************************//**
+ * Open or create a history file for writing and start its writer thread.
+ *
+ * An existing file of the same layout is continued, otherwise the file is
+ * cleared.
+ *
+ * @param[out] history History.
+ * @param[in] filename History file.
+ * @param[in] tag_count Number of asset tags with history. When all slots are
+ *            in use, the slot of the asset tag not updated for the longest
+ *            time is reused.
+ * @param[in] block_count Number of blocks per asset tag.
+ *
+ * @retval SL_STATUS_OK History opened.
+ * @retval SL_STATUS_INVALID_PARAMETER Zero tag or block count.
+ * @retval SL_STATUS_IO Failed to open or map the file.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ * @retval SL_STATUS_FAIL Failed to start the writer thread.
+ ******************************************************************************/
+sl_status_t aoa_history_create(aoa_history_t *history,
+                               const char *filename,
+                               uint32_t tag_count,
+                               uint32_t block_count);
+
+/***************************************************************************//**
+ * Open a history file for reading.
+ *
+ * The file can be read while another process is writing it.
+ *
+ * @param[out] history History.
+ * @param[in] filename History file.
+ *
+ * @retval SL_STATUS_OK History opened.
+ * @retval SL_STATUS_IO Failed to open or map the file.
+ * @retval SL_STATUS_INVALID_TYPE The file is not a history file.
+ ******************************************************************************/
+sl_status_t aoa_history_open(aoa_history_t *history, const char *filename);
+
+/***************************************************************************//**
+ * Queue a position to be written by the writer thread.
+ *
+ * Does not block on file access, safe to call from any thread.
+ *
+ * @param[in] history History opened with aoa_history_create.
+ * @param[in] id Asset tag ID.
+ * @param[in] time Time of the position in microseconds.
+ * @param[in] position Position of the asset tag.
+ *
+ * @retval SL_STATUS_OK Position queued.
+ * @retval SL_STATUS_FULL Queue is full, the position is dropped.
+ ******************************************************************************/
+sl_status_t aoa_history_push(aoa_history_t *history,
+                             const char *id,
+                             uint64_t time,
+                             const aoa_position_t *position);
+
+/***************************************************************************//**
+ * Get the last positions of an asset tag.
+ *
+ * @param[in] history History.
+ * @param[in] id Asset tag ID.
+ * @param[out] entries Positions, oldest first.
+ * @param[in] max Maximum number of positions.
+ * @param[out] count Number of positions returned.
+ *
+ * @retval SL_STATUS_OK Positions returned.
+ * @retval SL_STATUS_NOT_FOUND No history for the asset tag.
+ * @retval SL_STATUS_ABORT The slot was reused by another asset tag during the
+ *         query.
+ ******************************************************************************/
+sl_status_t aoa_history_last(aoa_history_t *history,
+                             const char *id,
+                             aoa_history_entry_t *entries,
+                             uint32_t max,
+                             uint32_t *count);
+
+/***************************************************************************//**
+ * Get the positions of an asset tag in a time range.
+ *
+ * Only the blocks overlapping the time range are decoded. If the range has
+ * more positions than requested, the newest ones are returned.
+ *
+ * @param[in] history History.
+ * @param[in] id Asset tag ID.
+ * @param[in] from Start of the time range in microseconds, inclusive.
+ * @param[in] to End of the time range in microseconds, inclusive.
+ * @param[out] entries Positions, oldest first.
+ * @param[in] max Maximum number of positions.
+ * @param[out] count Number of positions returned.
+ *
+ * @retval SL_STATUS_OK Positions returned.
+ * @retval SL_STATUS_NOT_FOUND No history for the asset tag.
+ * @retval SL_STATUS_ABORT The slot was reused by another asset tag during the
+ *         query.
+ ******************************************************************************/
+sl_status_t aoa_history_range(aoa_history_t *history,
+                              const char *id,
+                              uint64_t from,
+                              uint64_t to,
+                              aoa_history_entry_t *entries,
+                              uint32_t max,
+                              uint32_t *count);
+
+/***************************************************************************//**
+ * Close a history.
+ *
+ * A writer writes the queued positions before its thread stops.
+ *
+ * @param[in,out] history History.
+ ******************************************************************************/
+void aoa_history_close(aoa_history_t *history);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_HISTORY_H
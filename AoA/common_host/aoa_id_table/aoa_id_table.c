@@ -0,0 +1,240 @@
+/***************************************************************************//**
+ * @file
+ * @brief Hash table mapping AoA IDs to small integers.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "aoa_id_table.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define ENTRY_EMPTY      0
+#define ENTRY_USED       1
+#define ENTRY_REMOVED    2
+
+#define MIN_SIZE         16
+
+// Keep the load factor (including removed entries) below 1/2.
+#define NEEDS_GROW(t)    (2 * ((t)->count + (t)->tombstones + 1) > (t)->size)
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME        16777619u
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static uint32_t hash_id(const char *id, size_t len);
+static aoa_id_table_entry_t *lookup(aoa_id_table_t *table,
+                                    const char *id,
+                                    size_t len,
+                                    uint32_t hash);
+static sl_status_t resize(aoa_id_table_t *table, uint32_t size);
+
+/***************************************************************************//**
+ * Initialize an ID table.
+ ******************************************************************************/
+sl_status_t aoa_id_table_init(aoa_id_table_t *table, uint32_t capacity)
+{
+  uint32_t size = MIN_SIZE;
+
+  while (size < 2 * capacity) {
+    size <<= 1;
+  }
+  table->entries = NULL;
+  table->size = 0;
+  table->count = 0;
+  table->tombstones = 0;
+
+  return resize(table, size);
+}
+
+/***************************************************************************//**
+ * Release resources of an ID table.
+ ******************************************************************************/
+void aoa_id_table_deinit(aoa_id_table_t *table)
+{
+  free(table->entries);
+  table->entries = NULL;
+  table->size = 0;
+  table->count = 0;
+  table->tombstones = 0;
+}
+
+/***************************************************************************//**
+ * Add an ID to the table.
+ ******************************************************************************/
+sl_status_t aoa_id_table_add(aoa_id_table_t *table,
+                             const char *id,
+                             size_t len,
+                             uint32_t value)
+{
+  sl_status_t sc;
+  uint32_t hash;
+  uint32_t mask;
+  uint32_t i;
+
+  if (len >= sizeof(aoa_id_t)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  hash = hash_id(id, len);
+  if (lookup(table, id, len, hash) != NULL) {
+    return SL_STATUS_ALREADY_EXISTS;
+  }
+
+  if (NEEDS_GROW(table)) {
+    // Only grow if the table is really full, otherwise just drop tombstones.
+    sc = resize(table, (2 * (table->count + 1) > table->size / 2)
+                ? table->size * 2 : table->size);
+    if (sc != SL_STATUS_OK) {
+      return sc;
+    }
+  }
+
+  mask = table->size - 1;
+  for (i = hash & mask; table->entries[i].state == ENTRY_USED; i = (i + 1) & mask) {
+  }
+  if (table->entries[i].state == ENTRY_REMOVED) {
+    table->tombstones--;
+  }
+  memcpy(table->entries[i].id, id, len);
+  table->entries[i].id[len] = '\0';
+  table->entries[i].hash = hash;
+  table->entries[i].value = value;
+  table->entries[i].state = ENTRY_USED;
+  table->count++;
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Remove an ID from the table.
+ ******************************************************************************/
+sl_status_t aoa_id_table_remove(aoa_id_table_t *table,
+                                const char *id,
+                                size_t len)
+{
+  aoa_id_table_entry_t *entry = lookup(table, id, len, hash_id(id, len));
+
+  if (entry == NULL) {
+    return SL_STATUS_NOT_FOUND;
+  }
+  entry->state = ENTRY_REMOVED;
+  table->count--;
+  table->tombstones++;
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Find an ID in the table.
+ ******************************************************************************/
+uint32_t aoa_id_table_find(aoa_id_table_t *table, const char *id, size_t len)
+{
+  aoa_id_table_entry_t *entry = lookup(table, id, len, hash_id(id, len));
+
+  if (entry == NULL) {
+    return AOA_ID_TABLE_INVALID;
+  }
+  return entry->value;
+}
+
+/***************************************************************************//**
+ * Calculate FNV-1a hash of an ID.
+ ******************************************************************************/
+static uint32_t hash_id(const char *id, size_t len)
+{
+  uint32_t hash = FNV_OFFSET_BASIS;
+
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (uint8_t)id[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+/***************************************************************************//**
+ * Find the entry of an ID using linear probing.
+ ******************************************************************************/
+static aoa_id_table_entry_t *lookup(aoa_id_table_t *table,
+                                    const char *id,
+                                    size_t len,
+                                    uint32_t hash)
+{
+  uint32_t mask = table->size - 1;
+  aoa_id_table_entry_t *entry;
+
+  if (len >= sizeof(aoa_id_t)) {
+    return NULL;
+  }
+
+  for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+    entry = &table->entries[i];
+    if (entry->state == ENTRY_EMPTY) {
+      return NULL;
+    }
+    if ((entry->state == ENTRY_USED)
+        && (entry->hash == hash)
+        && (memcmp(entry->id, id, len) == 0)
+        && (entry->id[len] == '\0')) {
+      return entry;
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Rehash all used entries into a new entry array.
+ ******************************************************************************/
+static sl_status_t resize(aoa_id_table_t *table, uint32_t size)
+{
+  aoa_id_table_entry_t *entries;
+  uint32_t mask = size - 1;
+  uint32_t k;
+
+  entries = calloc(size, sizeof(aoa_id_table_entry_t));
+  if (entries == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+
+  for (uint32_t i = 0; i < table->size; i++) {
+    if (table->entries[i].state == ENTRY_USED) {
+      for (k = table->entries[i].hash & mask; entries[k].state == ENTRY_USED; k = (k + 1) & mask) {
+      }
+      entries[k] = table->entries[i];
+    }
+  }
+
+  free(table->entries);
+  table->entries = entries;
+  table->size = size;
+  table->tombstones = 0;
+
+  return SL_STATUS_OK;
+}
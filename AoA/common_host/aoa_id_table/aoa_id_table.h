@@ -0,0 +1,116 @@
+/***************************************************************************//**
+ * @file
+ * @brief Hash table mapping AoA IDs to small integers.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_ID_TABLE_H
+#define AOA_ID_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+
+// Value returned when an ID is not found in the table.
+#define AOA_ID_TABLE_INVALID  UINT32_MAX
+
+typedef struct {
+  aoa_id_t id;
+  uint32_t hash;
+  uint32_t value;
+  uint8_t state;
+} aoa_id_table_entry_t;
+
+typedef struct {
+  aoa_id_table_entry_t *entries;
+  uint32_t size;  // number of entries, always a power of 2
+  uint32_t count; // number of used entries
+  uint32_t tombstones; // number of removed entries
+} aoa_id_table_t;
+
+/***************************************************************************//**
+ * Initialize an ID table.
+ *
+ * @param[out] table ID table.
+ * @param[in] capacity Expected number of IDs, the table grows when exceeded.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t aoa_id_table_init(aoa_id_table_t *table, uint32_t capacity);
+
+/***************************************************************************//**
+ * Release resources of an ID table.
+ *
+ * @param[in] table ID table.
+ ******************************************************************************/
+void aoa_id_table_deinit(aoa_id_table_t *table);
+
+/***************************************************************************//**
+ * Add an ID to the table.
+ *
+ * @param[in] table ID table.
+ * @param[in] id ID string, not necessarily null terminated.
+ * @param[in] len Length of the ID string.
+ * @param[in] value Integer assigned to the ID.
+ * @return SL_STATUS_ALREADY_EXISTS if the ID is already in the table.
+ ******************************************************************************/
+sl_status_t aoa_id_table_add(aoa_id_table_t *table,
+                             const char *id,
+                             size_t len,
+                             uint32_t value);
+
+/***************************************************************************//**
+ * Remove an ID from the table.
+ *
+ * @param[in] table ID table.
+ * @param[in] id ID string, not necessarily null terminated.
+ * @param[in] len Length of the ID string.
+ * @return SL_STATUS_NOT_FOUND if the ID is not in the table.
+ ******************************************************************************/
+sl_status_t aoa_id_table_remove(aoa_id_table_t *table,
+                                const char *id,
+                                size_t len);
+
+/***************************************************************************//**
+ * Find an ID in the table.
+ *
+ * @param[in] table ID table.
+ * @param[in] id ID string, not necessarily null terminated.
+ * @param[in] len Length of the ID string.
+ * @return Integer assigned to the ID or AOA_ID_TABLE_INVALID.
+ ******************************************************************************/
+uint32_t aoa_id_table_find(aoa_id_table_t *table, const char *id, size_t len);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_ID_TABLE_H
@@ -0,0 +1,444 @@
+/***************************************************************************//**
+ * @file
+ * @brief Non-blocking MQTT publishing on a dedicated network thread.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "app_log.h"
+#include "aoa_outbox.h"
+
+#define LOAD(ptr)         __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define STORE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#define ADD(ptr, value)   __atomic_add_fetch(ptr, value, __ATOMIC_RELAXED)
+
+static const char *policy_names[AOA_OUTBOX_POLICY_COUNT] = {
+  "drop-newest",
+  "drop-oldest",
+  "block"
+};
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void *network_thread(void *arg);
+static void wait_for_message(aoa_outbox_t *outbox);
+static void wake_network_thread(aoa_outbox_t *outbox);
+static aoa_outbox_cell_t *claim_free_cell(aoa_outbox_t *outbox);
+static aoa_outbox_cell_t *claim_message(aoa_outbox_t *outbox);
+static void release_cell(aoa_outbox_t *outbox, aoa_outbox_cell_t *cell);
+static void release_outbox(aoa_outbox_t *outbox);
+
+/***************************************************************************//**
+ * Parse overflow policy.
+ ******************************************************************************/
+sl_status_t aoa_outbox_parse_policy(const char *str, aoa_outbox_policy_t *policy)
+{
+  for (uint32_t i = 0; i < AOA_OUTBOX_POLICY_COUNT; i++) {
+    if (strcmp(str, policy_names[i]) == 0) {
+      *policy = (aoa_outbox_policy_t)i;
+      return SL_STATUS_OK;
+    }
+  }
+  return SL_STATUS_INVALID_PARAMETER;
+}
+
+/***************************************************************************//**
+ * Get the name of an overflow policy.
+ ******************************************************************************/
+const char *aoa_outbox_policy_name(aoa_outbox_policy_t policy)
+{
+  if (policy >= AOA_OUTBOX_POLICY_COUNT) {
+    return "unknown";
+  }
+  return policy_names[policy];
+}
+
+/***************************************************************************//**
+ * Connect to the broker and start the network thread.
+ ******************************************************************************/
+sl_status_t aoa_outbox_start(aoa_outbox_t *outbox,
+                             const mqtt_handle_t *config,
+                             uint32_t size,
+                             aoa_outbox_policy_t policy)
+{
+  mqtt_handle_t handle = MQTT_DEFAULT_HANDLE;
+  size_t len;
+
+  memset(outbox, 0, sizeof(*outbox));
+  outbox->policy = policy;
+  outbox->size = 2;
+  while (outbox->size < size) {
+    outbox->size *= 2;
+  }
+  outbox->cells = malloc(outbox->size * sizeof(aoa_outbox_cell_t));
+  if (outbox->cells == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  for (uint32_t i = 0; i < outbox->size; i++) {
+    outbox->cells[i].sequence = i;
+    outbox->cells[i].message.topic = outbox->cells[i].message.data;
+  }
+
+  if (config->client_id != NULL) {
+    len = strlen(config->client_id) + sizeof(AOA_OUTBOX_CLIENT_SUFFIX);
+    outbox->client_id = malloc(len);
+    if (outbox->client_id == NULL) {
+      free(outbox->cells);
+      return SL_STATUS_ALLOCATION_FAILED;
+    }
+    snprintf(outbox->client_id, len, "%s%s", config->client_id, AOA_OUTBOX_CLIENT_SUFFIX);
+  }
+  handle.host = config->host;
+  handle.port = config->port;
+  handle.client_id = outbox->client_id;
+  outbox->handle = handle;
+  if (mqtt_init(&outbox->handle) != MQTT_SUCCESS) {
+    free(outbox->client_id);
+    free(outbox->cells);
+    return SL_STATUS_FAIL;
+  }
+
+  pthread_mutex_init(&outbox->lock, NULL);
+  pthread_cond_init(&outbox->wakeup, NULL);
+  if (pthread_create(&outbox->thread, NULL, network_thread, outbox) != 0) {
+    mqtt_deinit(&outbox->handle);
+    release_outbox(outbox);
+    return SL_STATUS_FAIL;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Publish the queued messages, then stop the network thread and disconnect.
+ ******************************************************************************/
+void aoa_outbox_stop(aoa_outbox_t *outbox)
+{
+  if (outbox->cells == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&outbox->lock);
+  STORE(&outbox->stop, true);
+  pthread_cond_signal(&outbox->wakeup);
+  pthread_mutex_unlock(&outbox->lock);
+  pthread_join(outbox->thread, NULL);
+
+  mqtt_deinit(&outbox->handle);
+  release_outbox(outbox);
+}
+
+/***************************************************************************//**
+ * Queue a message for publishing.
+ ******************************************************************************/
+sl_status_t aoa_outbox_publish(aoa_outbox_t *outbox,
+                               const char *topic,
+                               const char *payload,
+                               uint64_t capture)
+{
+  aoa_outbox_message_t *message;
+  aoa_outbox_cell_t *cell, *oldest;
+  size_t topic_len = strlen(topic) + 1;
+  size_t payload_len = strlen(payload) + 1;
+  char *data = NULL;
+  uint32_t depth, max_depth;
+  bool blocked = false;
+
+  if (topic_len + payload_len > AOA_OUTBOX_MESSAGE_SIZE) {
+    data = malloc(topic_len + payload_len);
+    if (data == NULL) {
+      return SL_STATUS_ALLOCATION_FAILED;
+    }
+    ADD(&outbox->oversized, 1);
+  }
+
+  while ((cell = claim_free_cell(outbox)) == NULL) {
+    switch (outbox->policy) {
+      case AOA_OUTBOX_DROP_NEWEST:
+        free(data);
+        ADD(&outbox->dropped, 1);
+        return SL_STATUS_FULL;
+      case AOA_OUTBOX_DROP_OLDEST:
+        // The network thread may take the oldest message first.
+        oldest = claim_message(outbox);
+        if (oldest != NULL) {
+          release_cell(outbox, oldest);
+          ADD(&outbox->dropped, 1);
+        }
+        break;
+      default:
+        if (!blocked) {
+          blocked = true;
+          ADD(&outbox->blocked, 1);
+        }
+        wake_network_thread(outbox);
+        usleep(AOA_OUTBOX_BLOCK_US);
+        break;
+    }
+  }
+
+  // The cell belongs to this publisher until its sequence is advanced.
+  message = &cell->message;
+  message->topic = (data != NULL) ? data : message->data;
+  memcpy(message->topic, topic, topic_len);
+  message->payload = message->topic + topic_len;
+  memcpy(message->payload, payload, payload_len);
+  message->timestamp = aoa_trace_timestamp();
+  message->capture = capture;
+  STORE(&cell->sequence, __atomic_load_n(&cell->sequence, __ATOMIC_RELAXED) + 1);
+  ADD(&outbox->queued, 1);
+
+  depth = aoa_outbox_depth(outbox);
+  max_depth = __atomic_load_n(&outbox->max_depth, __ATOMIC_RELAXED);
+  while ((depth > max_depth)
+         && !__atomic_compare_exchange_n(&outbox->max_depth, &max_depth, depth,
+                                         true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+
+  wake_network_thread(outbox);
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Get the number of queued messages.
+ ******************************************************************************/
+uint32_t aoa_outbox_depth(aoa_outbox_t *outbox)
+{
+  // The dequeue position never passes the enqueue position loaded after it.
+  uint32_t dequeue = LOAD(&outbox->dequeue);
+  uint32_t depth = LOAD(&outbox->enqueue) - dequeue;
+
+  return (depth < outbox->size) ? depth : outbox->size;
+}
+
+/***************************************************************************//**
+ * Log the queue depth, the publish latencies and the message counters.
+ ******************************************************************************/
+void aoa_outbox_log(aoa_outbox_t *outbox)
+{
+  app_log("MQTT outbox: %llu queued, %llu published, %llu failed, "
+          "%llu dropped, %llu publishers blocked, %llu oversized, policy %s\n",
+          (unsigned long long)outbox->queued,
+          (unsigned long long)outbox->published,
+          (unsigned long long)outbox->failed,
+          (unsigned long long)outbox->dropped,
+          (unsigned long long)outbox->blocked,
+          (unsigned long long)outbox->oversized,
+          aoa_outbox_policy_name(outbox->policy));
+  app_log("MQTT outbox depth: mean %.1f, max %u\n",
+          (outbox->published + outbox->failed > 0)
+          ? (double)outbox->depth_sum / (double)(outbox->published + outbox->failed)
+          : 0.0,
+          outbox->max_depth);
+  aoa_trace_hist_log(&outbox->latency, "MQTT publish");
+  if (outbox->end_to_end.count > 0) {
+    aoa_trace_hist_log(&outbox->end_to_end, "MQTT capture to publish");
+  }
+}
+
+/***************************************************************************//**
+ * Network thread main loop.
+ *
+ * Publishes the queued messages and steps the MQTT client. A slow broker or a
+ * reconnection only delays this thread. Failed publishes are counted, the
+ * client reconnects in its step.
+ ******************************************************************************/
+static void *network_thread(void *arg)
+{
+  aoa_outbox_t *outbox = arg;
+  aoa_outbox_message_t *message;
+  aoa_outbox_cell_t *cell;
+  uint32_t batch = 0;
+  uint64_t now;
+  mqtt_status_t rc;
+
+  for (;;) {
+    cell = claim_message(outbox);
+    if (cell != NULL) {
+      // Published from the cell, which stays claimed until then.
+      message = &cell->message;
+      outbox->depth_sum += aoa_outbox_depth(outbox) + 1;
+      rc = mqtt_publish(&outbox->handle, message->topic, message->payload);
+      if (rc == MQTT_SUCCESS) {
+        outbox->published++;
+      } else {
+        outbox->failed++;
+      }
+      now = aoa_trace_timestamp();
+      aoa_trace_hist_add(&outbox->latency, now - message->timestamp);
+      if (message->capture != AOA_TRACE_TIMESTAMP_INVALID) {
+        aoa_trace_hist_add(&outbox->end_to_end, now - message->capture);
+      }
+      release_cell(outbox, cell);
+      if (++batch < AOA_OUTBOX_STEP_BATCH) {
+        continue;
+      }
+    } else if (LOAD(&outbox->stop)) {
+      // Run down the queue before stopping.
+      break;
+    } else {
+      wait_for_message(outbox);
+    }
+    batch = 0;
+    (void)mqtt_step(&outbox->handle);
+  }
+  return NULL;
+}
+
+/***************************************************************************//**
+ * Wait for a message for at most AOA_OUTBOX_STEP_US.
+ ******************************************************************************/
+static void wait_for_message(aoa_outbox_t *outbox)
+{
+  struct timespec deadline;
+
+  pthread_mutex_lock(&outbox->lock);
+  __atomic_store_n(&outbox->idle, true, __ATOMIC_SEQ_CST);
+  if ((__atomic_load_n(&outbox->enqueue, __ATOMIC_SEQ_CST) == LOAD(&outbox->dequeue))
+      && !LOAD(&outbox->stop)) {
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += AOA_OUTBOX_STEP_US * 1000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&outbox->wakeup, &outbox->lock, &deadline);
+  }
+  __atomic_store_n(&outbox->idle, false, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&outbox->lock);
+}
+
+/***************************************************************************//**
+ * Wake up the network thread if it is waiting for a message.
+ ******************************************************************************/
+static void wake_network_thread(aoa_outbox_t *outbox)
+{
+  // Pairs with the idle flag and queue check of wait_for_message.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&outbox->idle, __ATOMIC_RELAXED)) {
+    pthread_mutex_lock(&outbox->lock);
+    pthread_cond_signal(&outbox->wakeup);
+    pthread_mutex_unlock(&outbox->lock);
+  }
+}
+
+/***************************************************************************//**
+ * Claim a free cell of the queue for a new message.
+ *
+ * Each cell holds the queue position it is ready for: a free cell its enqueue
+ * position, a filled cell its enqueue position + 1. The positions are claimed
+ * by compare-and-swap, so any number of threads can push and pop. The claimer
+ * fills the cell and advances its sequence to hand it over.
+ *
+ * @return NULL if the queue is full.
+ ******************************************************************************/
+static aoa_outbox_cell_t *claim_free_cell(aoa_outbox_t *outbox)
+{
+  uint32_t pos = __atomic_load_n(&outbox->enqueue, __ATOMIC_RELAXED);
+  aoa_outbox_cell_t *cell;
+  int32_t diff;
+
+  for (;;) {
+    cell = &outbox->cells[pos & (outbox->size - 1)];
+    diff = (int32_t)(LOAD(&cell->sequence) - pos);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&outbox->enqueue, &pos, pos + 1, true,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return cell;
+      }
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = __atomic_load_n(&outbox->enqueue, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Claim the cell of the oldest message in the queue.
+ *
+ * The cell must be released with release_cell after using its message.
+ *
+ * @return NULL if the queue is empty.
+ ******************************************************************************/
+static aoa_outbox_cell_t *claim_message(aoa_outbox_t *outbox)
+{
+  uint32_t pos = __atomic_load_n(&outbox->dequeue, __ATOMIC_RELAXED);
+  aoa_outbox_cell_t *cell;
+  int32_t diff;
+
+  for (;;) {
+    cell = &outbox->cells[pos & (outbox->size - 1)];
+    diff = (int32_t)(LOAD(&cell->sequence) - (pos + 1));
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&outbox->dequeue, &pos, pos + 1, true,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return cell;
+      }
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = __atomic_load_n(&outbox->dequeue, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Hand a claimed message cell over to the enqueue position of the next round.
+ ******************************************************************************/
+static void release_cell(aoa_outbox_t *outbox, aoa_outbox_cell_t *cell)
+{
+  aoa_outbox_message_t *message = &cell->message;
+  uint32_t pos = __atomic_load_n(&cell->sequence, __ATOMIC_RELAXED) - 1;
+
+  if (message->topic != message->data) {
+    free(message->topic);
+    message->topic = message->data;
+  }
+  STORE(&cell->sequence, pos + outbox->size);
+}
+
+/***************************************************************************//**
+ * Release the resources of an outbox with no running network thread.
+ ******************************************************************************/
+static void release_outbox(aoa_outbox_t *outbox)
+{
+  aoa_outbox_cell_t *cell;
+
+  while ((cell = claim_message(outbox)) != NULL) {
+    release_cell(outbox, cell);
+  }
+  pthread_cond_destroy(&outbox->wakeup);
+  pthread_mutex_destroy(&outbox->lock);
+  free(outbox->cells);
+  outbox->cells = NULL;
+  free(outbox->client_id);
+  outbox->client_id = NULL;
+}
@@ -0,0 +1,201 @@
+/***************************************************************************//**
+ * @file
+ * @brief Non-blocking MQTT publishing on a dedicated network thread.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_OUTBOX_H
+#define AOA_OUTBOX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sl_status.h"
+#include "mqtt.h"
+#include "aoa_trace.h"
+
+// Suffix of the client ID of the outbound MQTT connection.
+#define AOA_OUTBOX_CLIENT_SUFFIX  "-out"
+
+// Longest idle time of the network thread between MQTT steps in microseconds.
+#define AOA_OUTBOX_STEP_US        10000
+
+// Number of messages published between MQTT steps while the queue is busy.
+#define AOA_OUTBOX_STEP_BATCH     64
+
+// Delay between attempts of a blocked publisher in microseconds.
+#define AOA_OUTBOX_BLOCK_US       100
+
+// Storage of the topic and the payload in each queue cell, including their
+// terminating NULs. Longer messages are allocated separately.
+#define AOA_OUTBOX_MESSAGE_SIZE   512
+
+// Handling of messages published to a full queue.
+typedef enum {
+  AOA_OUTBOX_DROP_NEWEST,   // drop the published message
+  AOA_OUTBOX_DROP_OLDEST,   // drop the oldest queued message
+  AOA_OUTBOX_BLOCK,         // wait for the network thread
+  AOA_OUTBOX_POLICY_COUNT
+} aoa_outbox_policy_t;
+
+typedef struct {
+  uint64_t timestamp;       // time of queueing
+  uint64_t capture;         // capture time of the content, or invalid
+  char *topic;              // in data, or allocated if the message is too long
+  char *payload;            // follows the topic
+  char data[AOA_OUTBOX_MESSAGE_SIZE];
+} aoa_outbox_message_t;
+
+typedef struct {
+  uint32_t sequence;        // position the cell is ready for, atomic access
+  aoa_outbox_message_t message;
+} aoa_outbox_cell_t;
+
+// Bounded lock-free queue of messages, any thread can publish. The network
+// thread owns a separate MQTT connection: the connection of the application
+// keeps serving the subscriptions on the application thread.
+typedef struct {
+  mqtt_handle_t handle;     // outbound connection
+  char *client_id;
+  aoa_outbox_policy_t policy;
+  aoa_outbox_cell_t *cells;
+  uint32_t size;            // power of 2
+  uint32_t enqueue;         // next position to fill, atomic access
+  uint32_t dequeue;         // next position to publish, atomic access
+  pthread_t thread;
+  pthread_mutex_t lock;     // protects the wakeup of the network thread
+  pthread_cond_t wakeup;
+  bool idle;                // network thread waits for wakeup, atomic access
+  bool stop;                // atomic access
+  // Statistics, atomic access.
+  uint64_t queued;          // messages accepted
+  uint64_t dropped;         // messages dropped on overflow
+  uint64_t blocked;         // publishers waiting for free space
+  uint64_t oversized;       // messages too long for a cell
+  uint32_t max_depth;       // highest number of queued messages
+  // Statistics of the network thread.
+  uint64_t published;       // messages handed over to the MQTT client
+  uint64_t failed;          // publish failures
+  uint64_t depth_sum;       // sum of the queue depths at publishing
+  aoa_trace_hist_t latency; // time from queueing to publishing
+  aoa_trace_hist_t end_to_end; // time from capture to publishing
+} aoa_outbox_t;
+
+/***************************************************************************//**
+ * Parse overflow policy.
+ *
+ * @param[in] str "drop-newest", "drop-oldest" or "block".
+ * @param[out] policy Overflow policy.
+ *
+ * @retval SL_STATUS_OK Policy is valid.
+ * @retval SL_STATUS_INVALID_PARAMETER Unknown policy.
+ ******************************************************************************/
+sl_status_t aoa_outbox_parse_policy(const char *str, aoa_outbox_policy_t *policy);
+
+/***************************************************************************//**
+ * Get the name of an overflow policy.
+ *
+ * @param[in] policy Overflow policy.
+ *
+ * @return Name of the policy.
+ ******************************************************************************/
+const char *aoa_outbox_policy_name(aoa_outbox_policy_t policy);
+
+/***************************************************************************//**
+ * Connect to the broker and start the network thread.
+ *
+ * The outbound connection uses the broker of the application connection, and
+ * its client ID with AOA_OUTBOX_CLIENT_SUFFIX appended.
+ *
+ * @param[out] outbox Outbox.
+ * @param[in] config Connection parameters of the application.
+ * @param[in] size Queue capacity, rounded up to a power of 2.
+ * @param[in] policy Overflow policy.
+ *
+ * @retval SL_STATUS_OK Network thread started.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ * @retval SL_STATUS_FAIL Failed to connect or to start the thread.
+ ******************************************************************************/
+sl_status_t aoa_outbox_start(aoa_outbox_t *outbox,
+                             const mqtt_handle_t *config,
+                             uint32_t size,
+                             aoa_outbox_policy_t policy);
+
+/***************************************************************************//**
+ * Publish the queued messages, then stop the network thread and disconnect.
+ *
+ * @param[in] outbox Outbox.
+ ******************************************************************************/
+void aoa_outbox_stop(aoa_outbox_t *outbox);
+
+/***************************************************************************//**
+ * Queue a message for publishing.
+ *
+ * Never waits for the broker. Only the AOA_OUTBOX_BLOCK policy waits for the
+ * network thread when the queue is full. The message is copied into the
+ * queue, only messages longer than AOA_OUTBOX_MESSAGE_SIZE are allocated.
+ *
+ * @param[in] outbox Outbox.
+ * @param[in] topic Topic.
+ * @param[in] payload NUL terminated payload.
+ * @param[in] capture Capture time of the content for the end-to-end latency,
+ *                    or AOA_TRACE_TIMESTAMP_INVALID.
+ *
+ * @retval SL_STATUS_OK Message queued.
+ * @retval SL_STATUS_FULL Message dropped on overflow.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t aoa_outbox_publish(aoa_outbox_t *outbox,
+                               const char *topic,
+                               const char *payload,
+                               uint64_t capture);
+
+/***************************************************************************//**
+ * Get the number of queued messages.
+ *
+ * @param[in] outbox Outbox.
+ *
+ * @return Number of messages waiting for the network thread.
+ ******************************************************************************/
+uint32_t aoa_outbox_depth(aoa_outbox_t *outbox);
+
+/***************************************************************************//**
+ * Log the queue depth, the publish latencies and the message counters.
+ *
+ * @param[in] outbox Stopped outbox.
+ ******************************************************************************/
+void aoa_outbox_log(aoa_outbox_t *outbox);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_OUTBOX_H
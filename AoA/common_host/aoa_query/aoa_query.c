@@ -0,0 +1,1037 @@
+/***************************************************************************//**
+ * @file
+ * @brief Local position query service of the multilocator.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#include "aoa_trace.h"
+#include "aoa_query.h"
+
+#ifndef _WIN32
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define INVALID_ENTRY     UINT32_MAX
+
+// Closed connections fail with EPIPE instead of raising SIGPIPE.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL      0
+#endif
+
+// Cells are limited to this range, far away positions share the border cells.
+#define MAX_CELL          1000000000.0f
+
+#define INITIAL_BUFFER_SIZE 1024
+#define RESPONSE_HEADER   "HTTP/1.1 %d %s\r\n" \
+                          "Content-Type: application/json\r\n" \
+                          "Content-Length: %u\r\n\r\n"
+#define ENTRY_FORMAT      "{\"id\":\"%s\",\"x\":%.3f,\"y\":%.3f,\"z\":%.3f," \
+                          "\"sequence\":%d,\"timestamp\":%llu"
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void *run_server(void *arg);
+static void accept_clients(aoa_query_server_t *server);
+static void receive_requests(aoa_query_server_t *server, aoa_query_client_t *client);
+static void send_response(aoa_query_client_t *client);
+static void close_client(aoa_query_client_t *client);
+static void handle_request(aoa_query_server_t *server,
+                           aoa_query_client_t *client,
+                           char *request);
+static void find_tag(aoa_query_server_t *server, aoa_query_client_t *client, const char *id);
+static void find_near(aoa_query_server_t *server, aoa_query_client_t *client, const char *query);
+static void find_in_box(aoa_query_server_t *server, aoa_query_client_t *client, const char *query);
+static uint32_t search_cells(aoa_query_server_t *server,
+                             const float min[2],
+                             const float max[2],
+                             bool (*match)(const float *, aoa_query_result_t *),
+                             const float *args);
+static bool match_near(const float *args, aoa_query_result_t *result);
+static bool match_box(const float *args, aoa_query_result_t *result);
+static int compare_distance(const void *a, const void *b);
+static void write_entry(aoa_query_buffer_t *body, const aoa_query_result_t *result, bool distance);
+static void write_results(aoa_query_server_t *server,
+                          aoa_query_client_t *client,
+                          uint32_t count,
+                          bool distance);
+static void write_response(aoa_query_client_t *client, int status, const char *body);
+static void append(aoa_query_buffer_t *buffer, const char *format, ...);
+static bool get_param(const char *query, const char *name, float *value);
+static const char *find_text(const char *text, const char *pattern);
+static void refresh_index(aoa_query_server_t *server, bool force);
+static void link_item(aoa_query_server_t *server, uint32_t index);
+static void unlink_item(aoa_query_server_t *server, uint32_t index);
+static int32_t get_cell(float coordinate, float cell_size);
+static uint32_t hash_cell(const int32_t cell[2]);
+
+/***************************************************************************//**
+ * Start the query service.
+ ******************************************************************************/
+sl_status_t aoa_query_start(aoa_query_server_t *server,
+                            aoa_snapshot_t *snapshot,
+                            const char *path,
+                            float cell_size)
+{
+  struct sockaddr_un address;
+  uint32_t bucket_count = 1;
+
+  memset(server, 0, sizeof(*server));
+  server->listen_fd = -1;
+  server->wake_fd[0] = -1;
+  server->wake_fd[1] = -1;
+  for (uint32_t i = 0; i < AOA_QUERY_MAX_CLIENTS; i++) {
+    server->clients[i].fd = -1;
+  }
+  server->started = true;
+  if ((strlen(path) >= sizeof(address.sun_path)) || !(cell_size > 0)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  server->snapshot = snapshot;
+  server->cell_size = cell_size;
+
+  // One bucket per entry on average.
+  while (bucket_count < snapshot->capacity) {
+    bucket_count *= 2;
+  }
+  server->bucket_mask = bucket_count - 1;
+  server->path = strdup(path);
+  server->items = calloc(snapshot->capacity, sizeof(*server->items));
+  server->buckets = malloc(bucket_count * sizeof(*server->buckets));
+  server->results = malloc(snapshot->capacity * sizeof(*server->results));
+  if ((server->path == NULL)
+      || (server->items == NULL)
+      || (server->buckets == NULL)
+      || (server->results == NULL)
+      || (aoa_id_table_init(&server->ids, snapshot->capacity) != SL_STATUS_OK)) {
+    aoa_query_stop(server);
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  for (uint32_t i = 0; i < bucket_count; i++) {
+    server->buckets[i] = INVALID_ENTRY;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  unlink(path);
+  server->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if ((server->listen_fd < 0)
+      || (bind(server->listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+      || (listen(server->listen_fd, AOA_QUERY_MAX_CLIENTS) != 0)
+      || (fcntl(server->listen_fd, F_SETFL, O_NONBLOCK) != 0)
+      || (pipe(server->wake_fd) != 0)
+      || (pthread_create(&server->thread, NULL, run_server, server) != 0)) {
+    aoa_query_stop(server);
+    return SL_STATUS_FAIL;
+  }
+  server->running = true;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Stop the query service and remove its socket.
+ ******************************************************************************/
+void aoa_query_stop(aoa_query_server_t *server)
+{
+  if (!server->started) {
+    return;
+  }
+  if (server->running) {
+    if (write(server->wake_fd[1], "", 1) == 1) {
+      pthread_join(server->thread, NULL);
+    }
+    server->running = false;
+  }
+  for (uint32_t i = 0; i < AOA_QUERY_MAX_CLIENTS; i++) {
+    close_client(&server->clients[i]);
+  }
+  if (server->listen_fd >= 0) {
+    close(server->listen_fd);
+    unlink(server->path);
+    server->listen_fd = -1;
+  }
+  for (uint32_t i = 0; i < 2; i++) {
+    if (server->wake_fd[i] >= 0) {
+      close(server->wake_fd[i]);
+      server->wake_fd[i] = -1;
+    }
+  }
+  aoa_id_table_deinit(&server->ids);
+  free(server->path);
+  free(server->items);
+  free(server->buckets);
+  free(server->results);
+  free(server->body.data);
+  memset(&server->body, 0, sizeof(server->body));
+  server->path = NULL;
+  server->items = NULL;
+  server->buckets = NULL;
+  server->results = NULL;
+  server->started = false;
+}
+
+/***************************************************************************//**
+ * Connect to a query service.
+ ******************************************************************************/
+sl_status_t aoa_query_connect(const char *path, int *fd)
+{
+  struct sockaddr_un address;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    return SL_STATUS_FAIL;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+  *fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (*fd < 0) {
+    return SL_STATUS_FAIL;
+  }
+  if (connect(*fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+    close(*fd);
+    *fd = -1;
+    return SL_STATUS_FAIL;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Send a request on a connection and wait for the response.
+ ******************************************************************************/
+sl_status_t aoa_query_request(int fd,
+                              const char *target,
+                              int *status,
+                              char *body,
+                              size_t size)
+{
+  char buffer[AOA_QUERY_REQUEST_SIZE];
+  char *end;
+  const char *length;
+  size_t received = 0, header_len, content_len, copied;
+  ssize_t len;
+  int request_len;
+
+  request_len = snprintf(buffer, sizeof(buffer), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", target);
+  if ((request_len < 0) || ((size_t)request_len >= sizeof(buffer))) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (send(fd, buffer, (size_t)request_len, MSG_NOSIGNAL) != request_len) {
+    return SL_STATUS_IO;
+  }
+
+  // Read the header.
+  for (;;) {
+    len = recv(fd, &buffer[received], sizeof(buffer) - 1 - received, 0);
+    if (len <= 0) {
+      return SL_STATUS_IO;
+    }
+    received += (size_t)len;
+    buffer[received] = '\0';
+    end = strstr(buffer, "\r\n\r\n");
+    if (end != NULL) {
+      break;
+    }
+    if (received == sizeof(buffer) - 1) {
+      return SL_STATUS_INVALID_PARAMETER;
+    }
+  }
+  header_len = (size_t)(end - buffer) + 4;
+  length = find_text(buffer, "Content-Length:");
+  if ((sscanf(buffer, "HTTP/1.%*d %d", status) != 1) || (length == NULL) || (length > end)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  content_len = strtoul(length + strlen("Content-Length:"), NULL, 10);
+
+  // Body bytes already received, then the rest.
+  copied = received - header_len;
+  if (copied > content_len) {
+    // Responses are only pipelined by the caller.
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (size > 0) {
+    memcpy(body, &buffer[header_len], (copied < size - 1) ? copied : size - 1);
+  }
+  while (copied < content_len) {
+    len = recv(fd, buffer, ((content_len - copied) < sizeof(buffer)) ? (content_len - copied) : sizeof(buffer), 0);
+    if (len <= 0) {
+      return SL_STATUS_IO;
+    }
+    if (copied < size - 1) {
+      memcpy(&body[copied], buffer, ((size_t)len < size - 1 - copied) ? (size_t)len : size - 1 - copied);
+    }
+    copied += (size_t)len;
+  }
+  if (size > 0) {
+    body[(content_len < size - 1) ? content_len : size - 1] = '\0';
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Close a connection.
+ ******************************************************************************/
+void aoa_query_disconnect(int fd)
+{
+  close(fd);
+}
+
+/***************************************************************************//**
+ * Service thread, serves the connections until woken up to stop.
+ ******************************************************************************/
+static void *run_server(void *arg)
+{
+  aoa_query_server_t *server = arg;
+  struct pollfd fds[AOA_QUERY_MAX_CLIENTS + 2];
+  aoa_query_client_t *polled[AOA_QUERY_MAX_CLIENTS];
+  aoa_query_client_t *client;
+  nfds_t count;
+
+  for (;;) {
+    fds[0].fd = server->wake_fd[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = server->listen_fd;
+    fds[1].events = POLLIN;
+    count = 2;
+    for (uint32_t i = 0; i < AOA_QUERY_MAX_CLIENTS; i++) {
+      client = &server->clients[i];
+      if (client->fd >= 0) {
+        // Requests are not read while a response is pending.
+        fds[count].fd = client->fd;
+        fds[count].events = (client->response.size > 0) ? POLLOUT : POLLIN;
+        polled[count - 2] = client;
+        count++;
+      }
+    }
+    if (poll(fds, count, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[0].revents != 0) {
+      break;
+    }
+    for (nfds_t i = 2; i < count; i++) {
+      client = polled[i - 2];
+      if (fds[i].revents & POLLOUT) {
+        send_response(client);
+      } else if (fds[i].revents != 0) {
+        receive_requests(server, client);
+      }
+    }
+    if (fds[1].revents & POLLIN) {
+      accept_clients(server);
+    }
+  }
+  return NULL;
+}
+
+/***************************************************************************//**
+ * Accept the pending connections, refuse them when all clients are in use.
+ ******************************************************************************/
+static void accept_clients(aoa_query_server_t *server)
+{
+  aoa_query_client_t *client;
+  int fd;
+
+  while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0) {
+    client = NULL;
+    for (uint32_t i = 0; i < AOA_QUERY_MAX_CLIENTS; i++) {
+      if (server->clients[i].fd < 0) {
+        client = &server->clients[i];
+        break;
+      }
+    }
+    if ((client == NULL) || (fcntl(fd, F_SETFL, O_NONBLOCK) != 0)) {
+      close(fd);
+      continue;
+    }
+    client->fd = fd;
+    client->received = 0;
+    client->sent = 0;
+    client->close = false;
+  }
+}
+
+/***************************************************************************//**
+ * Read from a client and answer its complete requests.
+ ******************************************************************************/
+static void receive_requests(aoa_query_server_t *server, aoa_query_client_t *client)
+{
+  ssize_t len;
+  char *end;
+  size_t request_len;
+
+  len = recv(client->fd,
+             &client->request[client->received],
+             sizeof(client->request) - 1 - client->received,
+             0);
+  if (len <= 0) {
+    if ((len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))) {
+      return;
+    }
+    close_client(client);
+    return;
+  }
+  client->received += (size_t)len;
+  client->request[client->received] = '\0';
+
+  // Pipelined requests are answered in one response buffer.
+  while (!client->close
+         && ((end = strstr(client->request, "\r\n\r\n")) != NULL)) {
+    *end = '\0';
+    request_len = (size_t)(end - client->request) + 4;
+    handle_request(server, client, client->request);
+    client->received -= request_len;
+    memmove(client->request, &client->request[request_len], client->received + 1);
+  }
+  if (client->received == sizeof(client->request) - 1) {
+    write_response(client, 431, "{\"error\":\"request too large\"}");
+    client->close = true;
+  }
+  send_response(client);
+}
+
+/***************************************************************************//**
+ * Send the pending response of a client.
+ ******************************************************************************/
+static void send_response(aoa_query_client_t *client)
+{
+  ssize_t len;
+
+  if (client->response.failed) {
+    close_client(client);
+    return;
+  }
+  while (client->sent < client->response.size) {
+    len = send(client->fd,
+               &client->response.data[client->sent],
+               client->response.size - client->sent,
+               MSG_NOSIGNAL);
+    if (len < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+        return;
+      }
+      close_client(client);
+      return;
+    }
+    client->sent += (size_t)len;
+  }
+  client->response.size = 0;
+  client->sent = 0;
+  if (client->close) {
+    close_client(client);
+  }
+}
+
+/***************************************************************************//**
+ * Close a client connection.
+ ******************************************************************************/
+static void close_client(aoa_query_client_t *client)
+{
+  if (client->fd >= 0) {
+    close(client->fd);
+    client->fd = -1;
+  }
+  free(client->response.data);
+  memset(&client->response, 0, sizeof(client->response));
+  client->sent = 0;
+  client->received = 0;
+}
+
+/***************************************************************************//**
+ * Answer a request.
+ *
+ * @param[in] request Request header, NUL terminated.
+ ******************************************************************************/
+static void handle_request(aoa_query_server_t *server,
+                           aoa_query_client_t *client,
+                           char *request)
+{
+  char *target, *version, *query;
+
+  server->requests++;
+  target = strchr(request, ' ');
+  version = (target != NULL) ? strchr(target + 1, ' ') : NULL;
+  if ((strncmp(request, "GET ", 4) != 0) || (version == NULL)) {
+    write_response(client, 400, "{\"error\":\"bad request\"}");
+    client->close = true;
+    return;
+  }
+  *version++ = '\0';
+  target++;
+  if ((strncmp(version, "HTTP/1.0", 8) == 0)
+      || (find_text(version, "\r\nConnection: close") != NULL)) {
+    client->close = true;
+  }
+
+  query = strchr(target, '?');
+  if (query != NULL) {
+    *query++ = '\0';
+  } else {
+    query = "";
+  }
+  if (strncmp(target, "/tags/", 6) == 0) {
+    find_tag(server, client, &target[6]);
+  } else if (strcmp(target, "/near") == 0) {
+    find_near(server, client, query);
+  } else if (strcmp(target, "/box") == 0) {
+    find_in_box(server, client, query);
+  } else {
+    write_response(client, 404, "{\"error\":\"not found\"}");
+  }
+}
+
+/***************************************************************************//**
+ * Answer the latest position of an asset tag.
+ ******************************************************************************/
+static void find_tag(aoa_query_server_t *server, aoa_query_client_t *client, const char *id)
+{
+  aoa_query_result_t *result = &server->results[0];
+  uint32_t index;
+
+  refresh_index(server, false);
+  index = aoa_id_table_find(&server->ids, id, strlen(id));
+  if ((index == AOA_ID_TABLE_INVALID)
+      || !aoa_snapshot_read(server->snapshot, index, &result->entry)
+      || (strcmp(result->entry.id, id) != 0)) {
+    // The asset tag may be newer than the index.
+    refresh_index(server, true);
+    index = aoa_id_table_find(&server->ids, id, strlen(id));
+    if ((index == AOA_ID_TABLE_INVALID)
+        || !aoa_snapshot_read(server->snapshot, index, &result->entry)
+        || (strcmp(result->entry.id, id) != 0)) {
+      write_response(client, 404, "{\"error\":\"unknown asset tag\"}");
+      return;
+    }
+  }
+  server->body.size = 0;
+  write_entry(&server->body, result, false);
+  write_response(client, 200, server->body.data);
+}
+
+/***************************************************************************//**
+ * Answer the asset tags within a radius, nearest first.
+ ******************************************************************************/
+static void find_near(aoa_query_server_t *server, aoa_query_client_t *client, const char *query)
+{
+  // x, y, z, radius, z given
+  float args[5] = { 0, 0, 0, 0, 0 };
+  float min[2], max[2];
+  uint32_t count;
+
+  if (!get_param(query, "x", &args[0])
+      || !get_param(query, "y", &args[1])
+      || !get_param(query, "r", &args[3])
+      || !(args[3] >= 0)) {
+    write_response(client, 400, "{\"error\":\"x, y and r are required\"}");
+    return;
+  }
+  args[4] = get_param(query, "z", &args[2]) ? 1.0f : 0.0f;
+  for (uint32_t i = 0; i < 2; i++) {
+    min[i] = args[i] - args[3];
+    max[i] = args[i] + args[3];
+  }
+  count = search_cells(server, min, max, match_near, args);
+  qsort(server->results, count, sizeof(*server->results), compare_distance);
+  write_results(server, client, count, true);
+}
+
+/***************************************************************************//**
+ * Answer the asset tags within a box.
+ ******************************************************************************/
+static void find_in_box(aoa_query_server_t *server, aoa_query_client_t *client, const char *query)
+{
+  // x0, y0, z0, x1, y1, z1
+  float args[6] = { 0, 0, -INFINITY, 0, 0, INFINITY };
+  uint32_t count;
+
+  if (!get_param(query, "x0", &args[0])
+      || !get_param(query, "y0", &args[1])
+      || !get_param(query, "x1", &args[3])
+      || !get_param(query, "y1", &args[4])) {
+    write_response(client, 400, "{\"error\":\"x0, y0, x1 and y1 are required\"}");
+    return;
+  }
+  get_param(query, "z0", &args[2]);
+  get_param(query, "z1", &args[5]);
+  for (uint32_t i = 0; i < 3; i++) {
+    if (args[i] > args[i + 3]) {
+      float swap = args[i];
+      args[i] = args[i + 3];
+      args[i + 3] = swap;
+    }
+  }
+  count = search_cells(server, &args[0], &args[3], match_box, args);
+  write_results(server, client, count, false);
+}
+
+/***************************************************************************//**
+ * Collect the asset tags of the cells overlapping an area in the xy plane.
+ *
+ * Falls back to testing every entry when the area has more cells than there
+ * are indexed entries.
+ *
+ * @param[in] match Test of the latest position of a candidate.
+ * @return Number of results.
+ ******************************************************************************/
+static uint32_t search_cells(aoa_query_server_t *server,
+                             const float min[2],
+                             const float max[2],
+                             bool (*match)(const float *, aoa_query_result_t *),
+                             const float *args)
+{
+  aoa_query_result_t *result;
+  int32_t first[2], last[2], cell[2];
+  uint32_t count = 0;
+  uint64_t cell_count;
+
+  refresh_index(server, false);
+  for (uint32_t i = 0; i < 2; i++) {
+    first[i] = get_cell(min[i], server->cell_size);
+    last[i] = get_cell(max[i], server->cell_size);
+  }
+  cell_count = (uint64_t)((int64_t)last[0] - first[0] + 1)
+               * (uint64_t)((int64_t)last[1] - first[1] + 1);
+
+  if (cell_count > server->indexed) {
+    for (uint32_t i = 0; i < server->snapshot->capacity; i++) {
+      result = &server->results[count];
+      if (server->items[i].indexed
+          && aoa_snapshot_read(server->snapshot, i, &result->entry)
+          && match(args, result)) {
+        count++;
+      }
+    }
+    return count;
+  }
+
+  for (cell[0] = first[0]; cell[0] <= last[0]; cell[0]++) {
+    for (cell[1] = first[1]; cell[1] <= last[1]; cell[1]++) {
+      for (uint32_t i = server->buckets[hash_cell(cell) & server->bucket_mask];
+           i != INVALID_ENTRY;
+           i = server->items[i].next) {
+        // Other cells hashed to the same bucket are skipped.
+        if ((server->items[i].cell[0] != cell[0])
+            || (server->items[i].cell[1] != cell[1])) {
+          continue;
+        }
+        result = &server->results[count];
+        if (aoa_snapshot_read(server->snapshot, i, &result->entry)
+            && match(args, result)) {
+          count++;
+        }
+      }
+    }
+  }
+  return count;
+}
+
+/***************************************************************************//**
+ * Test the distance of a position from a point.
+ *
+ * @param[in] args x, y, z, radius, non-zero if z is given.
+ ******************************************************************************/
+static bool match_near(const float *args, aoa_query_result_t *result)
+{
+  float dx = result->entry.position.x - args[0];
+  float dy = result->entry.position.y - args[1];
+  float dz = (args[4] != 0) ? result->entry.position.z - args[2] : 0.0f;
+
+  result->distance = sqrtf(dx * dx + dy * dy + dz * dz);
+  return result->distance <= args[3];
+}
+
+/***************************************************************************//**
+ * Test if a position is within a box.
+ *
+ * @param[in] args x0, y0, z0, x1, y1, z1.
+ ******************************************************************************/
+static bool match_box(const float *args, aoa_query_result_t *result)
+{
+  return (result->entry.position.x >= args[0]) && (result->entry.position.x <= args[3])
+         && (result->entry.position.y >= args[1]) && (result->entry.position.y <= args[4])
+         && (result->entry.position.z >= args[2]) && (result->entry.position.z <= args[5]);
+}
+
+/***************************************************************************//**
+ * Order results by distance.
+ ******************************************************************************/
+static int compare_distance(const void *a, const void *b)
+{
+  float da = ((const aoa_query_result_t *)a)->distance;
+  float db = ((const aoa_query_result_t *)b)->distance;
+
+  return (da > db) - (da < db);
+}
+
+/***************************************************************************//**
+ * Write an asset tag object.
+ ******************************************************************************/
+static void write_entry(aoa_query_buffer_t *body, const aoa_query_result_t *result, bool distance)
+{
+  append(body,
+         ENTRY_FORMAT,
+         result->entry.id,
+         result->entry.position.x,
+         result->entry.position.y,
+         result->entry.position.z,
+         (int)result->entry.position.sequence,
+         (unsigned long long)result->entry.timestamp);
+  if (distance) {
+    append(body, ",\"distance\":%.3f", result->distance);
+  }
+  append(body, "}");
+}
+
+/***************************************************************************//**
+ * Answer the list of results.
+ ******************************************************************************/
+static void write_results(aoa_query_server_t *server,
+                          aoa_query_client_t *client,
+                          uint32_t count,
+                          bool distance)
+{
+  server->body.size = 0;
+  append(&server->body, "{\"tags\":[");
+  for (uint32_t i = 0; i < count; i++) {
+    if (i > 0) {
+      append(&server->body, ",");
+    }
+    write_entry(&server->body, &server->results[i], distance);
+  }
+  append(&server->body, "]}");
+  write_response(client, 200, server->body.data);
+}
+
+/***************************************************************************//**
+ * Append a response to the pending bytes of a client.
+ ******************************************************************************/
+static void write_response(aoa_query_client_t *client, int status, const char *body)
+{
+  const char *reason;
+
+  switch (status) {
+    case 200:
+      reason = "OK";
+      break;
+    case 400:
+      reason = "Bad Request";
+      break;
+    case 404:
+      reason = "Not Found";
+      break;
+    default:
+      reason = "Request Header Fields Too Large";
+      break;
+  }
+  if (body == NULL) {
+    // The body could not be allocated.
+    client->response.failed = true;
+    return;
+  }
+  append(&client->response, RESPONSE_HEADER "%s", status, reason, (unsigned)strlen(body), body);
+}
+
+/***************************************************************************//**
+ * Append formatted text to a buffer.
+ ******************************************************************************/
+static void append(aoa_query_buffer_t *buffer, const char *format, ...)
+{
+  va_list args;
+  int len;
+  size_t capacity;
+  char *data;
+
+  if (buffer->failed) {
+    return;
+  }
+  for (;;) {
+    va_start(args, format);
+    len = vsnprintf((buffer->data != NULL) ? &buffer->data[buffer->size] : NULL,
+                    buffer->capacity - buffer->size,
+                    format,
+                    args);
+    va_end(args);
+    if (len < 0) {
+      buffer->failed = true;
+      return;
+    }
+    if (buffer->size + (size_t)len < buffer->capacity) {
+      buffer->size += (size_t)len;
+      return;
+    }
+    capacity = (buffer->capacity == 0) ? INITIAL_BUFFER_SIZE : 2 * buffer->capacity;
+    while (capacity <= buffer->size + (size_t)len) {
+      capacity *= 2;
+    }
+    data = realloc(buffer->data, capacity);
+    if (data == NULL) {
+      buffer->failed = true;
+      return;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+  }
+}
+
+/***************************************************************************//**
+ * Get a number parameter of a query string.
+ *
+ * @return false if the parameter is missing or not a number.
+ ******************************************************************************/
+static bool get_param(const char *query, const char *name, float *value)
+{
+  size_t len = strlen(name);
+  const char *p = query;
+  char *end;
+  double number;
+
+  while (*p != '\0') {
+    if ((strncmp(p, name, len) == 0) && (p[len] == '=')) {
+      number = strtod(&p[len + 1], &end);
+      if ((end == &p[len + 1]) || ((*end != '&') && (*end != '\0')) || !isfinite(number)) {
+        return false;
+      }
+      *value = (float)number;
+      return true;
+    }
+    p = strchr(p, '&');
+    if (p == NULL) {
+      break;
+    }
+    p++;
+  }
+  return false;
+}
+
+/***************************************************************************//**
+ * Find text ignoring the case, header field names are case insensitive.
+ ******************************************************************************/
+static const char *find_text(const char *text, const char *pattern)
+{
+  size_t len = strlen(pattern);
+
+  for (; *text != '\0'; text++) {
+    if (strncasecmp(text, pattern, len) == 0) {
+      return text;
+    }
+  }
+  return NULL;
+}
+
+/***************************************************************************//**
+ * Bring the spatial index up to date with the snapshot.
+ *
+ * Only the entries with a changed version are read.
+ *
+ * @param[in] force Refresh even if the index is recent.
+ ******************************************************************************/
+static void refresh_index(aoa_query_server_t *server, bool force)
+{
+  aoa_query_item_t *item;
+  aoa_snapshot_entry_t entry;
+  uint64_t now = aoa_trace_timestamp();
+  int32_t cell[2];
+  bool used;
+
+  if (!force && (now - server->refreshed < AOA_QUERY_REFRESH_US)) {
+    return;
+  }
+  server->refreshed = now;
+
+  for (uint32_t i = 0; i < server->snapshot->capacity; i++) {
+    item = &server->items[i];
+    if (aoa_snapshot_version(server->snapshot, i) == item->version) {
+      continue;
+    }
+    used = aoa_snapshot_read(server->snapshot, i, &entry);
+    item->version = entry.version;
+
+    if (item->indexed && (!used || (strcmp(item->id, entry.id) != 0))) {
+      aoa_id_table_remove(&server->ids, item->id, strlen(item->id));
+      unlink_item(server, i);
+    }
+    if (!used) {
+      continue;
+    }
+    cell[0] = get_cell(entry.position.x, server->cell_size);
+    cell[1] = get_cell(entry.position.y, server->cell_size);
+    if (!item->indexed) {
+      memcpy(item->id, entry.id, sizeof(item->id));
+      if (aoa_id_table_add(&server->ids, item->id, strlen(item->id), i) != SL_STATUS_OK) {
+        continue;
+      }
+    } else if ((item->cell[0] == cell[0]) && (item->cell[1] == cell[1])) {
+      continue;
+    } else {
+      unlink_item(server, i);
+    }
+    item->cell[0] = cell[0];
+    item->cell[1] = cell[1];
+    link_item(server, i);
+  }
+}
+
+/***************************************************************************//**
+ * Add an entry to the bucket of its cell.
+ ******************************************************************************/
+static void link_item(aoa_query_server_t *server, uint32_t index)
+{
+  aoa_query_item_t *item = &server->items[index];
+  uint32_t *head = &server->buckets[hash_cell(item->cell) & server->bucket_mask];
+
+  item->prev = INVALID_ENTRY;
+  item->next = *head;
+  if (*head != INVALID_ENTRY) {
+    server->items[*head].prev = index;
+  }
+  *head = index;
+  item->indexed = true;
+  server->indexed++;
+}
+
+/***************************************************************************//**
+ * Remove an entry from the bucket of its cell.
+ ******************************************************************************/
+static void unlink_item(aoa_query_server_t *server, uint32_t index)
+{
+  aoa_query_item_t *item = &server->items[index];
+
+  if (item->prev != INVALID_ENTRY) {
+    server->items[item->prev].next = item->next;
+  } else {
+    server->buckets[hash_cell(item->cell) & server->bucket_mask] = item->next;
+  }
+  if (item->next != INVALID_ENTRY) {
+    server->items[item->next].prev = item->prev;
+  }
+  item->indexed = false;
+  server->indexed--;
+}
+
+/***************************************************************************//**
+ * Get the grid cell of a coordinate.
+ ******************************************************************************/
+static int32_t get_cell(float coordinate, float cell_size)
+{
+  float cell = floorf(coordinate / cell_size);
+
+  if (!(cell > -MAX_CELL)) {
+    return (int32_t)-MAX_CELL;
+  }
+  if (cell > MAX_CELL) {
+    return (int32_t)MAX_CELL;
+  }
+  return (int32_t)cell;
+}
+
+/***************************************************************************//**
+ * Hash a grid cell.
+ ******************************************************************************/
+static uint32_t hash_cell(const int32_t cell[2])
+{
+  return ((uint32_t)cell[0] * 73856093u) ^ ((uint32_t)cell[1] * 19349663u);
+}
+
+#else // _WIN32
+
+/***************************************************************************//**
+ * Start the query service.
+ ******************************************************************************/
+sl_status_t aoa_query_start(aoa_query_server_t *server,
+                            aoa_snapshot_t *snapshot,
+                            const char *path,
+                            float cell_size)
+{
+  (void)snapshot;
+  (void)path;
+  (void)cell_size;
+  memset(server, 0, sizeof(*server));
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+/***************************************************************************//**
+ * Stop the query service.
+ ******************************************************************************/
+void aoa_query_stop(aoa_query_server_t *server)
+{
+  (void)server;
+}
+
+/***************************************************************************//**
+ * Connect to a query service.
+ ******************************************************************************/
+sl_status_t aoa_query_connect(const char *path, int *fd)
+{
+  (void)path;
+  *fd = -1;
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+/***************************************************************************//**
+ * Send a request on a connection and wait for the response.
+ ******************************************************************************/
+sl_status_t aoa_query_request(int fd,
+                              const char *target,
+                              int *status,
+                              char *body,
+                              size_t size)
+{
+  (void)fd;
+  (void)target;
+  (void)status;
+  (void)body;
+  (void)size;
+  return SL_STATUS_IO;
+}
+
+/***************************************************************************//**
+ * Close a connection.
+ ******************************************************************************/
+void aoa_query_disconnect(int fd)
+{
+  (void)fd;
+}
+
+#endif // _WIN32
@@ -0,0 +1,190 @@
+/***************************************************************************//**
+ * @file
+ * @brief Local position query service of the multilocator.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_QUERY_H
+#define AOA_QUERY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+#include "aoa_id_table.h"
+#include "aoa_snapshot.h"
+
+// The service speaks HTTP/1.1 on a Unix domain socket, with keep-alive and
+// pipelining. Responses are JSON:
+//   GET /tags/<id>                          latest position of an asset tag
+//   GET /near?x=&y=[&z=]&r=                 asset tags within r meters,
+//                                           nearest first; horizontal
+//                                           distance if z is omitted
+//   GET /box?x0=&y0=&x1=&y1=[&z0=&z1=]      asset tags within a box
+
+// Maximum number of simultaneous connections.
+#define AOA_QUERY_MAX_CLIENTS   64
+
+// Maximum size of a request header.
+#define AOA_QUERY_REQUEST_SIZE  1024
+
+// The spatial index is refreshed from the snapshot when older than this, in
+// microseconds. Candidates are tested with their latest position, but an
+// asset tag may be missed for this long after entering the searched area.
+#define AOA_QUERY_REFRESH_US    10000
+
+// Growing text buffer.
+typedef struct {
+  char *data;
+  size_t size;              // length of the text
+  size_t capacity;
+  bool failed;              // out of memory, text is truncated
+} aoa_query_buffer_t;
+
+typedef struct {
+  int fd;                   // -1 if unused
+  char request[AOA_QUERY_REQUEST_SIZE];
+  size_t received;
+  aoa_query_buffer_t response; // pending response bytes
+  size_t sent;              // response bytes sent
+  bool close;               // close after the response is sent
+} aoa_query_client_t;
+
+// Spatial index state of a snapshot entry.
+typedef struct {
+  aoa_id_t id;
+  uint32_t version;         // snapshot version the state is based on
+  int32_t cell[2];          // grid cell in the xy plane
+  uint32_t next;            // next entry in the bucket
+  uint32_t prev;            // previous entry in the bucket
+  bool indexed;
+} aoa_query_item_t;
+
+typedef struct {
+  aoa_snapshot_entry_t entry;
+  float distance;           // near queries only
+} aoa_query_result_t;
+
+typedef struct {
+  aoa_snapshot_t *snapshot;
+  float cell_size;
+  char *path;
+  int listen_fd;
+  int wake_fd[2];           // wakes up the server thread to stop
+  pthread_t thread;
+  bool started;
+  bool running;             // server thread started
+  // Owned by the server thread.
+  aoa_query_item_t *items;  // one per snapshot entry
+  uint32_t *buckets;        // first entry of the cells hashed to a bucket
+  uint32_t bucket_mask;
+  uint32_t indexed;         // number of indexed entries
+  aoa_id_table_t ids;       // asset tag ID to snapshot entry
+  uint64_t refreshed;       // time of the last index refresh
+  aoa_query_result_t *results;
+  aoa_query_buffer_t body;  // response body being built
+  aoa_query_client_t clients[AOA_QUERY_MAX_CLIENTS];
+  uint64_t requests;        // number of requests served
+} aoa_query_server_t;
+
+/***************************************************************************//**
+ * Start the query service.
+ *
+ * The service thread only reads the snapshot, it never blocks its writers.
+ *
+ * @param[out] server Query service.
+ * @param[in] snapshot Snapshot of the latest positions.
+ * @param[in] path Path of the Unix domain socket, replaced if it exists.
+ * @param[in] cell_size Edge length of the spatial index cells in meters.
+ *
+ * @retval SL_STATUS_OK Service started.
+ * @retval SL_STATUS_INVALID_PARAMETER Invalid path or cell size.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ * @retval SL_STATUS_FAIL Failed to create the socket or the thread.
+ * @retval SL_STATUS_NOT_SUPPORTED Unix domain sockets are not available.
+ ******************************************************************************/
+sl_status_t aoa_query_start(aoa_query_server_t *server,
+                            aoa_snapshot_t *snapshot,
+                            const char *path,
+                            float cell_size);
+
+/***************************************************************************//**
+ * Stop the query service and remove its socket.
+ *
+ * @param[in] server Query service.
+ ******************************************************************************/
+void aoa_query_stop(aoa_query_server_t *server);
+
+/***************************************************************************//**
+ * Connect to a query service.
+ *
+ * @param[in] path Path of the Unix domain socket.
+ * @param[out] fd Connected socket.
+ *
+ * @retval SL_STATUS_OK Connected.
+ * @retval SL_STATUS_FAIL Failed to connect.
+ * @retval SL_STATUS_NOT_SUPPORTED Unix domain sockets are not available.
+ ******************************************************************************/
+sl_status_t aoa_query_connect(const char *path, int *fd);
+
+/***************************************************************************//**
+ * Send a request on a connection and wait for the response.
+ *
+ * @param[in] fd Socket connected with aoa_query_connect.
+ * @param[in] target Request target, e.g. "/near?x=1&y=2&r=3".
+ * @param[out] status HTTP status code.
+ * @param[out] body Response body, truncated and NUL terminated.
+ * @param[in] size Size of the body buffer.
+ *
+ * @retval SL_STATUS_OK Response received.
+ * @retval SL_STATUS_IO Connection failed or closed.
+ * @retval SL_STATUS_INVALID_PARAMETER Malformed response.
+ ******************************************************************************/
+sl_status_t aoa_query_request(int fd,
+                              const char *target,
+                              int *status,
+                              char *body,
+                              size_t size);
+
+/***************************************************************************//**
+ * Close a connection.
+ *
+ * @param[in] fd Socket connected with aoa_query_connect.
+ ******************************************************************************/
+void aoa_query_disconnect(int fd);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_QUERY_H
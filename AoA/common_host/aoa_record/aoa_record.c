@@ -0,0 +1,213 @@
+/***************************************************************************//**
+ * @file
+ * @brief Recording of received MQTT messages.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "aoa_record.h"
+#include "aoa_varint.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define HEADER_SIZE       (sizeof(AOA_RECORD_MAGIC) - 1 + 1)
+
+// Upper limit of a topic or payload length, protects against corrupt files.
+#define MAX_FIELD_SIZE    (1u << 24)
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static sl_status_t read_varint(FILE *file, uint64_t *value);
+
+/***************************************************************************//**
+ * Create a new recording.
+ ******************************************************************************/
+sl_status_t aoa_record_create(aoa_record_t *rec, const char *filename)
+{
+  uint8_t header[HEADER_SIZE];
+
+  rec->file = fopen(filename, "wb");
+  rec->arrival = 0;
+  rec->buffer = NULL;
+  rec->size = 0;
+  if (rec->file == NULL) {
+    return SL_STATUS_IO;
+  }
+  memcpy(header, AOA_RECORD_MAGIC, sizeof(AOA_RECORD_MAGIC) - 1);
+  header[HEADER_SIZE - 1] = AOA_RECORD_VERSION;
+  if (fwrite(header, sizeof(header), 1, rec->file) != 1) {
+    aoa_record_close(rec);
+    return SL_STATUS_IO;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Open a recording for reading.
+ ******************************************************************************/
+sl_status_t aoa_record_open(aoa_record_t *rec, const char *filename)
+{
+  uint8_t header[HEADER_SIZE];
+
+  rec->file = fopen(filename, "rb");
+  rec->arrival = 0;
+  rec->buffer = NULL;
+  rec->size = 0;
+  if (rec->file == NULL) {
+    return SL_STATUS_IO;
+  }
+  if ((fread(header, sizeof(header), 1, rec->file) != 1)
+      || (memcmp(header, AOA_RECORD_MAGIC, sizeof(AOA_RECORD_MAGIC) - 1) != 0)
+      || (header[HEADER_SIZE - 1] != AOA_RECORD_VERSION)) {
+    aoa_record_close(rec);
+    return SL_STATUS_INVALID_TYPE;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Append a message to a recording.
+ ******************************************************************************/
+sl_status_t aoa_record_write(aoa_record_t *rec,
+                             uint64_t arrival,
+                             const char *topic,
+                             const char *payload)
+{
+  uint8_t prefix[3 * AOA_VARINT_MAX_SIZE];
+  size_t topic_len = strlen(topic);
+  size_t payload_len = strlen(payload);
+  size_t len;
+
+  if (arrival < rec->arrival) {
+    arrival = rec->arrival;
+  }
+  len = aoa_varint_encode(arrival - rec->arrival, prefix);
+  len += aoa_varint_encode(topic_len, &prefix[len]);
+  len += aoa_varint_encode(payload_len, &prefix[len]);
+  rec->arrival = arrival;
+
+  if ((fwrite(prefix, 1, len, rec->file) != len)
+      || (fwrite(topic, 1, topic_len, rec->file) != topic_len)
+      || (fwrite(payload, 1, payload_len, rec->file) != payload_len)) {
+    return SL_STATUS_IO;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Read the next message of a recording.
+ ******************************************************************************/
+sl_status_t aoa_record_read(aoa_record_t *rec,
+                            uint64_t *arrival,
+                            const char **topic,
+                            const char **payload)
+{
+  sl_status_t sc;
+  uint64_t delta, topic_len, payload_len;
+  size_t size;
+  char *buffer;
+  int c;
+
+  // A clean end of file is only allowed between messages.
+  c = fgetc(rec->file);
+  if (c == EOF) {
+    return SL_STATUS_EMPTY;
+  }
+  ungetc(c, rec->file);
+
+  sc = read_varint(rec->file, &delta);
+  if (sc == SL_STATUS_OK) {
+    sc = read_varint(rec->file, &topic_len);
+  }
+  if (sc == SL_STATUS_OK) {
+    sc = read_varint(rec->file, &payload_len);
+  }
+  if ((sc != SL_STATUS_OK)
+      || (topic_len > MAX_FIELD_SIZE)
+      || (payload_len > MAX_FIELD_SIZE)) {
+    return SL_STATUS_IO;
+  }
+
+  // Topic and payload are stored NUL terminated one after the other.
+  size = (size_t)topic_len + (size_t)payload_len + 2;
+  if (size > rec->size) {
+    buffer = realloc(rec->buffer, size);
+    if (buffer == NULL) {
+      return SL_STATUS_ALLOCATION_FAILED;
+    }
+    rec->buffer = buffer;
+    rec->size = size;
+  }
+  if ((fread(rec->buffer, 1, (size_t)topic_len, rec->file) != topic_len)
+      || (fread(&rec->buffer[topic_len + 1], 1, (size_t)payload_len, rec->file) != payload_len)) {
+    return SL_STATUS_IO;
+  }
+  rec->buffer[topic_len] = '\0';
+  rec->buffer[topic_len + 1 + payload_len] = '\0';
+
+  rec->arrival += delta;
+  *arrival = rec->arrival;
+  *topic = rec->buffer;
+  *payload = &rec->buffer[topic_len + 1];
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Close a recording.
+ ******************************************************************************/
+void aoa_record_close(aoa_record_t *rec)
+{
+  if (rec->file != NULL) {
+    fclose(rec->file);
+    rec->file = NULL;
+  }
+  free(rec->buffer);
+  rec->buffer = NULL;
+  rec->size = 0;
+}
+
+/***************************************************************************//**
+ * Read an unsigned LEB128 varint.
+ ******************************************************************************/
+static sl_status_t read_varint(FILE *file, uint64_t *value)
+{
+  uint8_t buffer[AOA_VARINT_MAX_SIZE];
+  size_t len = 0;
+  int c;
+
+  do {
+    c = fgetc(file);
+    if (c == EOF) {
+      return SL_STATUS_IO;
+    }
+    buffer[len++] = (uint8_t)c;
+  } while ((c & 0x80) && (len < sizeof(buffer)));
+  return (aoa_varint_decode(buffer, len, value) > 0) ? SL_STATUS_OK : SL_STATUS_IO;
+}
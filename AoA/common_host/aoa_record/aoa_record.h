@@ -0,0 +1,125 @@
+/***************************************************************************//**
+ * @file
+ * @brief Recording of received MQTT messages.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_RECORD_H
+#define AOA_RECORD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include "sl_status.h"
+
+// A recording is a header followed by the messages in arrival order. Each
+// message is the arrival time difference from the previous message in
+// microseconds, the topic length and the payload length as LEB128 varints,
+// followed by the topic and the payload without terminating NULs.
+#define AOA_RECORD_MAGIC    "AOAREC"
+#define AOA_RECORD_VERSION  1
+
+typedef struct {
+  FILE *file;
+  uint64_t arrival; // arrival time of the last message
+  char *buffer;     // topic and payload of the last message read
+  size_t size;      // size of the buffer
+} aoa_record_t;
+
+/***************************************************************************//**
+ * Create a new recording.
+ *
+ * @param[out] rec Recording.
+ * @param[in] filename File to create, overwritten if it exists.
+ *
+ * @retval SL_STATUS_OK Recording created.
+ * @retval SL_STATUS_IO Failed to create the file.
+ ******************************************************************************/
+sl_status_t aoa_record_create(aoa_record_t *rec, const char *filename);
+
+/***************************************************************************//**
+ * Open a recording for reading.
+ *
+ * @param[out] rec Recording.
+ * @param[in] filename File to open.
+ *
+ * @retval SL_STATUS_OK Recording opened.
+ * @retval SL_STATUS_IO Failed to open the file.
+ * @retval SL_STATUS_INVALID_TYPE The file is not a recording.
+ ******************************************************************************/
+sl_status_t aoa_record_open(aoa_record_t *rec, const char *filename);
+
+/***************************************************************************//**
+ * Append a message to a recording.
+ *
+ * @param[in,out] rec Recording created with aoa_record_create.
+ * @param[in] arrival Arrival time in microseconds. Earlier than the previous
+ *            message is recorded as equal.
+ * @param[in] topic Topic of the message.
+ * @param[in] payload Payload of the message.
+ *
+ * @retval SL_STATUS_OK Message written.
+ * @retval SL_STATUS_IO Failed to write the file.
+ ******************************************************************************/
+sl_status_t aoa_record_write(aoa_record_t *rec,
+                             uint64_t arrival,
+                             const char *topic,
+                             const char *payload);
+
+/***************************************************************************//**
+ * Read the next message of a recording.
+ *
+ * @param[in,out] rec Recording opened with aoa_record_open.
+ * @param[out] arrival Arrival time in microseconds.
+ * @param[out] topic Topic of the message, valid until the next read.
+ * @param[out] payload Payload of the message, valid until the next read.
+ *
+ * @retval SL_STATUS_OK Message read.
+ * @retval SL_STATUS_EMPTY End of the recording.
+ * @retval SL_STATUS_IO The recording is truncated or corrupt.
+ * @retval SL_STATUS_ALLOCATION_FAILED Message does not fit in memory.
+ ******************************************************************************/
+sl_status_t aoa_record_read(aoa_record_t *rec,
+                            uint64_t *arrival,
+                            const char **topic,
+                            const char **payload);
+
+/***************************************************************************//**
+ * Close a recording.
+ *
+ * @param[in,out] rec Recording.
+ ******************************************************************************/
+void aoa_record_close(aoa_record_t *rec);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_RECORD_H
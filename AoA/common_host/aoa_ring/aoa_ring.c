@@ -0,0 +1,517 @@
+/***************************************************************************//**
+ * @file
+ * @brief Shared memory angle ring between processes of the same host.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#include "aoa_ring.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define MAGIC         0x52414F41u // "AOAR"
+#define LAYOUT        1
+#define CACHE_LINE    64
+
+// Polling interval of the consumer where futexes are not available.
+#define POLL_US       100
+
+// Set in the turn of a slot while its producer writes the record.
+#define SLOT_BUSY     (1ull << 63)
+
+// A full ring checks if its consumer is alive once per this many drops.
+#define LIVENESS_DROPS 256
+
+// Fields written by different parties are kept on separate cache lines.
+#define CHECK_LAYOUT(name, condition) typedef char name[(condition) ? 1 : -1]
+
+// -----------------------------------------------------------------------------
+// Private types
+
+typedef struct {
+  uint32_t magic;           // written last when the ring is ready
+  uint32_t layout;
+  uint32_t slot_size;
+  uint32_t record_size;
+  uint32_t capacity;
+  uint32_t pid;             // process ID of the consumer
+  uint32_t active;          // cleared when the consumer closes the ring
+  uint32_t reserved;
+  uint8_t padding0[CACHE_LINE - 32];
+  uint64_t head;            // next slot claimed by the producers
+  uint8_t padding1[CACHE_LINE - 8];
+  uint32_t waiting;         // futex word, set while the consumer sleeps
+  uint8_t padding2[CACHE_LINE - 4];
+  uint64_t dropped;         // records dropped on a full ring
+  uint8_t padding3[CACHE_LINE - 8];
+} ring_header_t;
+
+// A slot can be written by the producer of position p when its turn is p, and
+// read by the consumer when its turn is p + 1. The producer marks the turn busy
+// while writing. Reading or skipping it hands it over to position p + capacity.
+typedef struct {
+  uint64_t turn;
+  uint32_t producer;        // process ID of the producer writing the slot
+  uint32_t reserved;
+  aoa_ring_record_t record;
+} ring_slot_t;
+
+CHECK_LAYOUT(check_slot_size, sizeof(ring_slot_t) <= AOA_RING_SLOT_SIZE);
+CHECK_LAYOUT(check_header_size, sizeof(ring_header_t) % CACHE_LINE == 0);
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static ring_slot_t *get_slot(const aoa_ring_t *ring, uint64_t position);
+static bool skip_stalled_slot(aoa_ring_t *ring, ring_slot_t *slot, uint64_t turn);
+static void wake_consumer(ring_header_t *header);
+#ifndef _WIN32
+static bool process_exists(uint32_t pid);
+static uint64_t get_time_us(void);
+#endif
+
+/***************************************************************************//**
+ * Create an empty ring as its consumer.
+ ******************************************************************************/
+sl_status_t aoa_ring_create(aoa_ring_t *ring, const char *name, uint32_t capacity)
+{
+#ifdef _WIN32
+  (void)name;
+  (void)capacity;
+  memset(ring, 0, sizeof(*ring));
+  return SL_STATUS_NOT_SUPPORTED;
+#else
+  ring_header_t *header;
+  uint32_t count = 1;
+  size_t size;
+  void *map;
+  int fd;
+
+  memset(ring, 0, sizeof(*ring));
+  while (count < capacity) {
+    count <<= 1;
+  }
+  size = sizeof(ring_header_t) + (size_t)count * AOA_RING_SLOT_SIZE;
+
+  shm_unlink(name);
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    return SL_STATUS_FAIL;
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    close(fd);
+    shm_unlink(name);
+    return SL_STATUS_FAIL;
+  }
+  map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    shm_unlink(name);
+    return SL_STATUS_FAIL;
+  }
+
+  header = (ring_header_t *)map;
+  header->layout = LAYOUT;
+  header->slot_size = AOA_RING_SLOT_SIZE;
+  header->record_size = sizeof(aoa_ring_record_t);
+  header->capacity = count;
+  header->pid = (uint32_t)getpid();
+  header->active = 1;
+
+  ring->header = header;
+  ring->slots = (uint8_t *)map + sizeof(ring_header_t);
+  ring->capacity = count;
+  ring->size = size;
+  ring->name = name;
+  ring->pid = header->pid;
+  ring->owner = true;
+  for (uint32_t i = 0; i < count; i++) {
+    get_slot(ring, i)->turn = i;
+  }
+  __atomic_store_n(&header->magic, MAGIC, __ATOMIC_RELEASE);
+  return SL_STATUS_OK;
+#endif
+}
+
+/***************************************************************************//**
+ * Attach to the ring of a consumer as a producer.
+ ******************************************************************************/
+sl_status_t aoa_ring_attach(aoa_ring_t *ring, const char *name)
+{
+#ifdef _WIN32
+  (void)name;
+  memset(ring, 0, sizeof(*ring));
+  return SL_STATUS_NOT_SUPPORTED;
+#else
+  ring_header_t *header;
+  struct stat st;
+  sl_status_t sc = SL_STATUS_OK;
+  void *map;
+  int fd;
+
+  memset(ring, 0, sizeof(*ring));
+  fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) {
+    return SL_STATUS_NOT_FOUND;
+  }
+  if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(ring_header_t))) {
+    close(fd);
+    return SL_STATUS_NOT_FOUND;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return SL_STATUS_NOT_FOUND;
+  }
+
+  header = (ring_header_t *)map;
+  if ((__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != MAGIC)
+      || (__atomic_load_n(&header->active, __ATOMIC_RELAXED) == 0)) {
+    sc = SL_STATUS_NOT_FOUND;
+  } else if ((header->layout != LAYOUT)
+             || (header->slot_size != AOA_RING_SLOT_SIZE)
+             || (header->record_size != sizeof(aoa_ring_record_t))
+             || (sizeof(ring_header_t) + (size_t)header->capacity * AOA_RING_SLOT_SIZE
+                 > (size_t)st.st_size)) {
+    sc = SL_STATUS_INVALID_TYPE;
+  }
+  if (sc != SL_STATUS_OK) {
+    munmap(map, (size_t)st.st_size);
+    return sc;
+  }
+  ring->header = header;
+  ring->slots = (uint8_t *)map + sizeof(ring_header_t);
+  ring->capacity = header->capacity;
+  ring->size = (size_t)st.st_size;
+  ring->name = name;
+  ring->inode = (uint64_t)st.st_ino;
+  ring->pid = (uint32_t)getpid();
+  return SL_STATUS_OK;
+#endif
+}
+
+/***************************************************************************//**
+ * Detach from a ring.
+ ******************************************************************************/
+void aoa_ring_close(aoa_ring_t *ring)
+{
+  ring_header_t *header = ring->header;
+
+  if (header == NULL) {
+    return;
+  }
+#ifndef _WIN32
+  if (ring->owner) {
+    __atomic_store_n(&header->active, 0, __ATOMIC_RELEASE);
+    shm_unlink(ring->name);
+  }
+  munmap(header, ring->size);
+#endif
+  memset(ring, 0, sizeof(*ring));
+}
+
+/***************************************************************************//**
+ * Check if the consumer of a ring is still running.
+ ******************************************************************************/
+bool aoa_ring_active(const aoa_ring_t *ring)
+{
+  ring_header_t *header = ring->header;
+
+  return (header != NULL)
+         && (__atomic_load_n(&header->active, __ATOMIC_RELAXED) != 0);
+}
+
+/***************************************************************************//**
+ * Check if the consumer of a ring is still alive.
+ ******************************************************************************/
+bool aoa_ring_alive(aoa_ring_t *ring)
+{
+  ring_header_t *header = ring->header;
+#ifndef _WIN32
+  struct stat st;
+  bool replaced = true;
+  int fd;
+#endif
+
+  if (!aoa_ring_active(ring)) {
+    return false;
+  }
+#ifndef _WIN32
+  if (ring->owner) {
+    return true;
+  }
+  // A restarted consumer replaces the shared memory object.
+  fd = shm_open(ring->name, O_RDONLY, 0);
+  if (fd >= 0) {
+    replaced = (fstat(fd, &st) != 0) || ((uint64_t)st.st_ino != ring->inode);
+    close(fd);
+  }
+  if (replaced || !process_exists(header->pid)) {
+    __atomic_store_n(&header->active, 0, __ATOMIC_RELEASE);
+    return false;
+  }
+#endif
+  return true;
+}
+
+/***************************************************************************//**
+ * Add a record to the ring.
+ ******************************************************************************/
+sl_status_t aoa_ring_push(aoa_ring_t *ring, const aoa_ring_record_t *record)
+{
+  ring_header_t *header = ring->header;
+  ring_slot_t *slot;
+  uint64_t position, turn, dropped;
+
+  position = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+  for (;;) {
+    slot = get_slot(ring, position);
+    turn = __atomic_load_n(&slot->turn, __ATOMIC_ACQUIRE);
+    if (turn == position) {
+      // Claim the slot, a failed exchange loads the current head.
+      if (__atomic_compare_exchange_n(&header->head, &position, position + 1,
+                                      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if ((int64_t)((turn & ~SLOT_BUSY) - position) < 0) {
+      // The consumer did not read this slot in the previous round yet. A
+      // consumer that died leaves the ring full.
+      dropped = __atomic_fetch_add(&header->dropped, 1, __ATOMIC_RELAXED);
+      if ((dropped % LIVENESS_DROPS) == 0) {
+        (void)aoa_ring_alive(ring);
+      }
+      return SL_STATUS_FULL;
+    } else {
+      // Another producer claimed the slot meanwhile.
+      position = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+    }
+  }
+  // The consumer skips the slot if this producer stalls for too long.
+  turn = position;
+  if (!__atomic_compare_exchange_n(&slot->turn, &turn, position | SLOT_BUSY,
+                                   false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    __atomic_fetch_add(&header->dropped, 1, __ATOMIC_RELAXED);
+    return SL_STATUS_FULL;
+  }
+  __atomic_store_n(&slot->producer, ring->pid, __ATOMIC_RELAXED);
+  slot->record = *record;
+  __atomic_store_n(&slot->turn, position + 1, __ATOMIC_RELEASE);
+  wake_consumer(header);
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Remove the oldest record from the ring.
+ ******************************************************************************/
+sl_status_t aoa_ring_pop(aoa_ring_t *ring, aoa_ring_record_t *record)
+{
+  ring_slot_t *slot;
+  uint64_t turn;
+
+  for (;;) {
+    slot = get_slot(ring, ring->tail);
+    turn = __atomic_load_n(&slot->turn, __ATOMIC_ACQUIRE);
+    if (turn == ring->tail + 1) {
+      break;
+    }
+    if (!skip_stalled_slot(ring, slot, turn)) {
+      return SL_STATUS_EMPTY;
+    }
+  }
+  *record = slot->record;
+  __atomic_store_n(&slot->producer, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->turn, ring->tail + ring->capacity, __ATOMIC_RELEASE);
+  ring->tail++;
+  ring->stall = 0;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Wait until a record is available.
+ ******************************************************************************/
+void aoa_ring_wait(aoa_ring_t *ring, uint32_t timeout)
+{
+  ring_header_t *header = ring->header;
+  ring_slot_t *slot = get_slot(ring, ring->tail);
+
+#if defined(__linux__)
+  struct timespec ts;
+
+  // Announce the sleep before the last check, so that a producer either sees
+  // the flag or its record is seen here.
+  __atomic_store_n(&header->waiting, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&slot->turn, __ATOMIC_SEQ_CST) != ring->tail + 1) {
+    ts.tv_sec = timeout / 1000000;
+    ts.tv_nsec = (long)(timeout % 1000000) * 1000;
+    syscall(SYS_futex, &header->waiting, FUTEX_WAIT, 1, &ts, NULL, 0);
+  }
+  __atomic_store_n(&header->waiting, 0, __ATOMIC_RELAXED);
+#else
+  (void)header;
+  while ((timeout > 0)
+         && (__atomic_load_n(&slot->turn, __ATOMIC_ACQUIRE) != ring->tail + 1)) {
+    uint32_t interval = (timeout < POLL_US) ? timeout : POLL_US;
+#ifdef _WIN32
+    Sleep((interval + 999) / 1000);
+#else
+    usleep(interval);
+#endif
+    timeout -= interval;
+  }
+#endif
+}
+
+/***************************************************************************//**
+ * Get the number of dropped records.
+ ******************************************************************************/
+uint64_t aoa_ring_dropped(const aoa_ring_t *ring)
+{
+  ring_header_t *header = ring->header;
+
+  return (header != NULL)
+         ? __atomic_load_n(&header->dropped, __ATOMIC_RELAXED) : 0;
+}
+
+// -----------------------------------------------------------------------------
+// Private functions
+
+/***************************************************************************//**
+ * Get the slot of a position.
+ ******************************************************************************/
+static ring_slot_t *get_slot(const aoa_ring_t *ring, uint64_t position)
+{
+  size_t index = (size_t)(position & (ring->capacity - 1));
+
+  return (ring_slot_t *)((uint8_t *)ring->slots + index * AOA_RING_SLOT_SIZE);
+}
+
+/***************************************************************************//**
+ * Skip the slot at the tail if its producer died before publishing it.
+ *
+ * @param[in] ring Ring of the consumer.
+ * @param[in] slot Slot at the tail.
+ * @param[in] turn Turn of the slot, not readable yet.
+ *
+ * @return true if the slot was skipped.
+ ******************************************************************************/
+static bool skip_stalled_slot(aoa_ring_t *ring, ring_slot_t *slot, uint64_t turn)
+{
+#ifdef _WIN32
+  (void)ring;
+  (void)slot;
+  (void)turn;
+  return false;
+#else
+  ring_header_t *header = ring->header;
+  uint64_t now;
+
+  if ((turn == ring->tail)
+      && (__atomic_load_n(&header->head, __ATOMIC_RELAXED) == ring->tail)) {
+    // Not claimed by any producer, the ring is empty.
+    ring->stall = 0;
+    return false;
+  }
+  now = get_time_us();
+  if (ring->stall == 0) {
+    ring->stall = now;
+    return false;
+  }
+  if (now - ring->stall < AOA_RING_STALL_US) {
+    return false;
+  }
+  // A producer still writing the slot keeps it. One that stalled after
+  // claiming the position notices the skip and drops its record.
+  if (((turn & SLOT_BUSY) != 0)
+      && process_exists(__atomic_load_n(&slot->producer, __ATOMIC_RELAXED))) {
+    return false;
+  }
+  if (!__atomic_compare_exchange_n(&slot->turn, &turn, ring->tail + ring->capacity,
+                                   false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    // Published meanwhile.
+    return false;
+  }
+  __atomic_fetch_add(&header->dropped, 1, __ATOMIC_RELAXED);
+  ring->tail++;
+  ring->stall = 0;
+  return true;
+#endif
+}
+
+/***************************************************************************//**
+ * Wake up the consumer if it sleeps on the futex.
+ ******************************************************************************/
+static void wake_consumer(ring_header_t *header)
+{
+#if defined(__linux__)
+  // Orders the release of the slot before checking the flag, matching the
+  // sequence of aoa_ring_wait.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if ((__atomic_load_n(&header->waiting, __ATOMIC_RELAXED) != 0)
+      && (__atomic_exchange_n(&header->waiting, 0, __ATOMIC_RELAXED) != 0)) {
+    syscall(SYS_futex, &header->waiting, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+#else
+  (void)header;
+#endif
+}
+
+#ifndef _WIN32
+/***************************************************************************//**
+ * Check if a process exists, also if it belongs to another user.
+ ******************************************************************************/
+static bool process_exists(uint32_t pid)
+{
+  return (pid != 0) && ((kill((pid_t)pid, 0) == 0) || (errno == EPERM));
+}
+
+/***************************************************************************//**
+ * Get the monotonic time in microseconds.
+ ******************************************************************************/
+static uint64_t get_time_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+#endif
@@ -0,0 +1,191 @@
+/***************************************************************************//**
+ * @file
+ * @brief Shared memory angle ring between processes of the same host.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_RING_H
+#define AOA_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+
+// Size of a ring slot, a record and the turn counter of the slot fit in two
+// cache lines.
+#define AOA_RING_SLOT_SIZE  128
+
+// Fixed-size binary angle record, the fields are copied as they are, so the
+// producers and the consumer must be built with the same aoa_types.h. This is
+// checked when attaching to a ring.
+typedef struct {
+  uint64_t timestamp;       // capture timestamp
+  aoa_angle_t angle;
+  aoa_id_t locator_id;
+  aoa_id_t tag_id;
+} aoa_ring_record_t;
+
+// Time after which the consumer skips a slot whose producer died before
+// publishing it, in microseconds.
+#define AOA_RING_STALL_US   100000
+
+typedef struct {
+  void *header;             // shared ring header
+  void *slots;
+  uint32_t capacity;        // number of slots, a power of 2
+  uint64_t tail;            // next slot read by the consumer
+  uint64_t stall;           // time since the slot at the tail is unpublished
+  size_t size;              // size of the mapping
+  const char *name;         // shared memory object name
+  uint64_t inode;           // shared memory object mapped by a producer
+  uint32_t pid;             // process ID of the caller
+  bool owner;               // created by the consumer
+} aoa_ring_t;
+
+/***************************************************************************//**
+ * Create an empty ring as its consumer.
+ *
+ * The ring is a bounded multi-producer, single-consumer queue in POSIX shared
+ * memory. A stale object of the same name is replaced, producers attached to
+ * it notice that it is inactive.
+ *
+ * @param[out] ring Ring.
+ * @param[in] name Shared memory object name, e.g. "/aoa_angles". Must stay
+ *                 valid until the ring is closed.
+ * @param[in] capacity Number of records, rounded up to a power of 2.
+ *
+ * @retval SL_STATUS_OK Ring created.
+ * @retval SL_STATUS_FAIL Failed to create or map the shared memory object.
+ * @retval SL_STATUS_NOT_SUPPORTED Not supported on this platform.
+ ******************************************************************************/
+sl_status_t aoa_ring_create(aoa_ring_t *ring, const char *name, uint32_t capacity);
+
+/***************************************************************************//**
+ * Attach to the ring of a consumer as a producer.
+ *
+ * @param[out] ring Ring.
+ * @param[in] name Shared memory object name.
+ *
+ * @retval SL_STATUS_OK Attached.
+ * @retval SL_STATUS_NOT_FOUND The consumer did not create the ring yet.
+ * @retval SL_STATUS_INVALID_TYPE The ring was built with different records.
+ * @retval SL_STATUS_NOT_SUPPORTED Not supported on this platform.
+ ******************************************************************************/
+sl_status_t aoa_ring_attach(aoa_ring_t *ring, const char *name);
+
+/***************************************************************************//**
+ * Detach from a ring, the consumer also marks it inactive and removes it.
+ *
+ * @param[in] ring Ring, may be unused.
+ ******************************************************************************/
+void aoa_ring_close(aoa_ring_t *ring);
+
+/***************************************************************************//**
+ * Check if the consumer of a ring is still running.
+ *
+ * @param[in] ring Ring.
+ *
+ * @return true if the ring is mapped and its consumer did not close it.
+ ******************************************************************************/
+bool aoa_ring_active(const aoa_ring_t *ring);
+
+/***************************************************************************//**
+ * Check if the consumer of a ring is still alive.
+ *
+ * A consumer that dies without closing the ring cannot mark it inactive. In
+ * addition to aoa_ring_active, a producer checks that the consumer process
+ * exists and that the ring was not replaced by a new consumer, and marks the
+ * ring inactive otherwise. Costs a few system calls, meant to be called
+ * periodically. Also called by aoa_ring_push when the ring stays full.
+ *
+ * @param[in] ring Ring.
+ *
+ * @return true if the consumer is alive.
+ ******************************************************************************/
+bool aoa_ring_alive(aoa_ring_t *ring);
+
+/***************************************************************************//**
+ * Add a record to the ring.
+ *
+ * Never blocks, safe to call from any number of threads and processes. Wakes
+ * up the consumer if it is waiting.
+ *
+ * @param[in] ring Ring.
+ * @param[in] record Record.
+ *
+ * @retval SL_STATUS_OK Record added.
+ * @retval SL_STATUS_FULL Ring is full, the record is dropped and counted.
+ ******************************************************************************/
+sl_status_t aoa_ring_push(aoa_ring_t *ring, const aoa_ring_record_t *record);
+
+/***************************************************************************//**
+ * Remove the oldest record from the ring.
+ *
+ * Must only be called by the consumer. A slot that a producer claimed but did
+ * not publish for AOA_RING_STALL_US is skipped and counted as dropped if the
+ * producer died, so that it does not block the ring.
+ *
+ * @param[in] ring Ring.
+ * @param[out] record Record.
+ *
+ * @retval SL_STATUS_OK Record removed.
+ * @retval SL_STATUS_EMPTY No record is available.
+ ******************************************************************************/
+sl_status_t aoa_ring_pop(aoa_ring_t *ring, aoa_ring_record_t *record);
+
+/***************************************************************************//**
+ * Wait until a record is available.
+ *
+ * Must only be called by the consumer. Sleeps on a futex on Linux, polls on
+ * other platforms.
+ *
+ * @param[in] ring Ring.
+ * @param[in] timeout Maximum waiting time in microseconds.
+ ******************************************************************************/
+void aoa_ring_wait(aoa_ring_t *ring, uint32_t timeout);
+
+/***************************************************************************//**
+ * Get the number of records dropped by all producers because of a full ring,
+ * including the records skipped by the consumer.
+ *
+ * @param[in] ring Ring.
+ *
+ * @return Number of dropped records.
+ ******************************************************************************/
+uint64_t aoa_ring_dropped(const aoa_ring_t *ring);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_RING_H
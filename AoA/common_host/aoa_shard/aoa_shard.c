@@ -0,0 +1,97 @@
+/***************************************************************************//**
+ * @file
+ * @brief Distribution of asset tags among multilocator instances.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include "aoa_shard.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME        1099511628211ULL
+
+// Linear congruential generator of the jump consistent hash.
+#define JUMP_MULTIPLIER  2862933555777941757ULL
+
+/***************************************************************************//**
+ * Parse shard parameters.
+ ******************************************************************************/
+sl_status_t aoa_shard_parse(const char *str, aoa_shard_t *shard)
+{
+  char *end;
+  unsigned long index, count;
+
+  index = strtoul(str, &end, 10);
+  if ((end == str) || (*end != '/')) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  str = end + 1;
+  count = strtoul(str, &end, 10);
+  if ((end == str) || (*end != '\0') || (count == 0) || (index >= count)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  shard->index = (uint32_t)index;
+  shard->count = (uint32_t)count;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Get the shard of an asset tag.
+ ******************************************************************************/
+uint32_t aoa_shard_of(const char *id, size_t len, uint32_t count)
+{
+  uint64_t key = FNV_OFFSET_BASIS;
+  int64_t b = -1;
+  int64_t j = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    key ^= (uint8_t)id[i];
+    key *= FNV_PRIME;
+  }
+
+  // Lamping & Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm".
+  while (j < (int64_t)count) {
+    b = j;
+    key = key * JUMP_MULTIPLIER + 1;
+    j = (int64_t)((b + 1) * ((double)(1LL << 31) / (double)((key >> 33) + 1)));
+  }
+  return (b < 0) ? 0 : (uint32_t)b;
+}
+
+/***************************************************************************//**
+ * Check if an asset tag belongs to a shard.
+ ******************************************************************************/
+bool aoa_shard_owns(const aoa_shard_t *shard, const char *id, size_t len)
+{
+  if (shard->count <= 1) {
+    return true;
+  }
+  return aoa_shard_of(id, len, shard->count) == shard->index;
+}
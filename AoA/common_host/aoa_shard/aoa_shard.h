@@ -0,0 +1,91 @@
+/***************************************************************************//**
+ * @file
+ * @brief Distribution of asset tags among multilocator instances.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_SHARD_H
+#define AOA_SHARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sl_status.h"
+
+// Angle topic of a shard: shard index, locator ID, asset tag ID.
+#define AOA_SHARD_TOPIC_ANGLE_PRINT  "silabs/aoa/shard/%u/angle/%s/%s"
+
+typedef struct {
+  uint32_t index;
+  uint32_t count; // 0 or 1 if sharding is disabled
+} aoa_shard_t;
+
+/***************************************************************************//**
+ * Parse shard parameters.
+ *
+ * @param[in] str Shard parameters in "<index>/<count>" format.
+ * @param[out] shard Shard parameters.
+ *
+ * @retval SL_STATUS_OK Parameters are valid.
+ * @retval SL_STATUS_INVALID_PARAMETER Invalid format or index out of range.
+ ******************************************************************************/
+sl_status_t aoa_shard_parse(const char *str, aoa_shard_t *shard);
+
+/***************************************************************************//**
+ * Get the shard of an asset tag.
+ *
+ * Jump consistent hash of the ID: when the shard count grows, only the asset
+ * tags moving to the new shards change their shard.
+ *
+ * @param[in] id Asset tag ID, not necessarily NUL terminated.
+ * @param[in] len Length of the ID.
+ * @param[in] count Number of shards.
+ *
+ * @return Shard index, 0 if count is 0.
+ ******************************************************************************/
+uint32_t aoa_shard_of(const char *id, size_t len, uint32_t count);
+
+/***************************************************************************//**
+ * Check if an asset tag belongs to a shard.
+ *
+ * @param[in] shard Shard parameters.
+ * @param[in] id Asset tag ID, not necessarily NUL terminated.
+ * @param[in] len Length of the ID.
+ *
+ * @return true if the shard owns the asset tag or sharding is disabled.
+ ******************************************************************************/
+bool aoa_shard_owns(const aoa_shard_t *shard, const char *id, size_t len);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_SHARD_H
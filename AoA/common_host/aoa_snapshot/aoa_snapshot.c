@@ -0,0 +1,263 @@
+/***************************************************************************//**
+ * @file
+ * @brief Concurrently readable table of the latest asset tag positions.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <stddef.h>
+#include <time.h>
+#include "aoa_snapshot_reader.h"
+#endif
+#include "aoa_snapshot.h"
+
+#ifndef _WIN32
+// The shared entries must match the layout documented for the readers.
+#define CHECK_LAYOUT(name, condition) typedef char name[(condition) ? 1 : -1]
+CHECK_LAYOUT(check_entry_size,
+             sizeof(aoa_snapshot_entry_t) == sizeof(aoa_snapshot_shared_entry_t));
+CHECK_LAYOUT(check_header_size,
+             sizeof(aoa_snapshot_shared_header_t) == AOA_SNAPSHOT_HEADER_SIZE);
+CHECK_LAYOUT(check_id_size, sizeof(aoa_id_t) == AOA_SNAPSHOT_ID_SIZE);
+CHECK_LAYOUT(check_timestamp,
+             offsetof(aoa_snapshot_entry_t, timestamp)
+             == offsetof(aoa_snapshot_shared_entry_t, timestamp));
+CHECK_LAYOUT(check_position,
+             offsetof(aoa_snapshot_entry_t, position)
+             == offsetof(aoa_snapshot_shared_entry_t, x));
+CHECK_LAYOUT(check_id,
+             offsetof(aoa_snapshot_entry_t, id)
+             == offsetof(aoa_snapshot_shared_entry_t, id));
+#endif
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void begin_write(aoa_snapshot_entry_t *entry);
+static void end_write(aoa_snapshot_entry_t *entry);
+
+/***************************************************************************//**
+ * Allocate an empty snapshot.
+ ******************************************************************************/
+sl_status_t aoa_snapshot_init(aoa_snapshot_t *snapshot, uint32_t capacity)
+{
+  uintptr_t address;
+
+  snapshot->memory = calloc((size_t)capacity + 1, AOA_SNAPSHOT_ENTRY_SIZE);
+  if (snapshot->memory == NULL) {
+    snapshot->entries = NULL;
+    snapshot->capacity = 0;
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  address = ((uintptr_t)snapshot->memory + AOA_SNAPSHOT_ENTRY_SIZE - 1)
+            & ~(uintptr_t)(AOA_SNAPSHOT_ENTRY_SIZE - 1);
+  snapshot->entries = (aoa_snapshot_entry_t *)address;
+  snapshot->capacity = capacity;
+  snapshot->header = NULL;
+  snapshot->size = 0;
+  snapshot->name = NULL;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Create an empty snapshot in POSIX shared memory.
+ ******************************************************************************/
+sl_status_t aoa_snapshot_init_shared(aoa_snapshot_t *snapshot,
+                                     const char *name,
+                                     uint32_t capacity)
+{
+#ifdef _WIN32
+  (void)name;
+  (void)capacity;
+  memset(snapshot, 0, sizeof(*snapshot));
+  return SL_STATUS_NOT_SUPPORTED;
+#else
+  aoa_snapshot_shared_header_t *header;
+  struct timespec now;
+  size_t size;
+  void *map;
+  int fd;
+
+  memset(snapshot, 0, sizeof(*snapshot));
+  size = AOA_SNAPSHOT_HEADER_SIZE + (size_t)capacity * AOA_SNAPSHOT_ENTRY_SIZE;
+
+  // Readers still mapping a stale table keep their copy until they attach
+  // again.
+  shm_unlink(name);
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    return SL_STATUS_FAIL;
+  }
+  if (ftruncate(fd, (off_t)size) != 0) {
+    close(fd);
+    shm_unlink(name);
+    return SL_STATUS_FAIL;
+  }
+  map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    shm_unlink(name);
+    return SL_STATUS_FAIL;
+  }
+
+  // The object is zero filled, all entries are unused.
+  header = (aoa_snapshot_shared_header_t *)map;
+  header->layout = AOA_SNAPSHOT_LAYOUT;
+  header->header_size = AOA_SNAPSHOT_HEADER_SIZE;
+  header->entry_size = AOA_SNAPSHOT_ENTRY_SIZE;
+  header->capacity = capacity;
+  header->pid = (uint32_t)getpid();
+  header->active = 1;
+  clock_gettime(CLOCK_REALTIME, &now);
+  header->created = (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+  __atomic_store_n(&header->magic, AOA_SNAPSHOT_MAGIC, __ATOMIC_RELEASE);
+
+  snapshot->memory = map;
+  snapshot->header = header;
+  snapshot->size = size;
+  snapshot->name = name;
+  snapshot->entries = (aoa_snapshot_entry_t *)((uint8_t *)map + AOA_SNAPSHOT_HEADER_SIZE);
+  snapshot->capacity = capacity;
+  return SL_STATUS_OK;
+#endif
+}
+
+/***************************************************************************//**
+ * Release a snapshot.
+ ******************************************************************************/
+void aoa_snapshot_deinit(aoa_snapshot_t *snapshot)
+{
+#ifndef _WIN32
+  if (snapshot->header != NULL) {
+    aoa_snapshot_shared_header_t *header = snapshot->header;
+    __atomic_store_n(&header->active, 0, __ATOMIC_RELEASE);
+    munmap(snapshot->memory, snapshot->size);
+    shm_unlink(snapshot->name);
+    memset(snapshot, 0, sizeof(*snapshot));
+    return;
+  }
+#endif
+  free(snapshot->memory);
+  snapshot->memory = NULL;
+  snapshot->entries = NULL;
+  snapshot->capacity = 0;
+}
+
+/***************************************************************************//**
+ * Update an entry.
+ ******************************************************************************/
+void aoa_snapshot_write(aoa_snapshot_t *snapshot,
+                        uint32_t index,
+                        const char *id,
+                        const aoa_position_t *position,
+                        uint64_t timestamp)
+{
+  aoa_snapshot_entry_t *entry;
+
+  if (index >= snapshot->capacity) {
+    if (snapshot->capacity > 0) {
+      __atomic_add_fetch(&snapshot->dropped, 1, __ATOMIC_RELAXED);
+    }
+    return;
+  }
+  entry = &snapshot->entries[index];
+  begin_write(entry);
+  entry->timestamp = timestamp;
+  entry->position = *position;
+  if (strncmp(entry->id, id, sizeof(entry->id)) != 0) {
+    strncpy(entry->id, id, sizeof(entry->id) - 1);
+    entry->id[sizeof(entry->id) - 1] = '\0';
+  }
+  end_write(entry);
+}
+
+/***************************************************************************//**
+ * Mark an entry unused.
+ ******************************************************************************/
+void aoa_snapshot_clear(aoa_snapshot_t *snapshot, uint32_t index)
+{
+  aoa_snapshot_entry_t *entry;
+
+  if (index >= snapshot->capacity) {
+    return;
+  }
+  entry = &snapshot->entries[index];
+  begin_write(entry);
+  entry->id[0] = '\0';
+  end_write(entry);
+}
+
+/***************************************************************************//**
+ * Read a consistent copy of an entry.
+ ******************************************************************************/
+bool aoa_snapshot_read(const aoa_snapshot_t *snapshot,
+                       uint32_t index,
+                       aoa_snapshot_entry_t *entry)
+{
+  const aoa_snapshot_entry_t *source = &snapshot->entries[index];
+  uint32_t version;
+
+  for (;;) {
+    version = __atomic_load_n(&source->version, __ATOMIC_ACQUIRE);
+    if (version % 2 == 0) {
+      memcpy(entry, source, sizeof(*entry));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&source->version, __ATOMIC_RELAXED) == version) {
+        break;
+      }
+    }
+  }
+  entry->version = version;
+  return entry->id[0] != '\0';
+}
+
+/***************************************************************************//**
+ * Get the version of an entry.
+ ******************************************************************************/
+uint32_t aoa_snapshot_version(const aoa_snapshot_t *snapshot, uint32_t index)
+{
+  return __atomic_load_n(&snapshot->entries[index].version, __ATOMIC_ACQUIRE);
+}
+
+/***************************************************************************//**
+ * Start writing an entry, readers retry until end_write.
+ ******************************************************************************/
+static void begin_write(aoa_snapshot_entry_t *entry)
+{
+  __atomic_store_n(&entry->version, entry->version + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/***************************************************************************//**
+ * Finish writing an entry.
+ ******************************************************************************/
+static void end_write(aoa_snapshot_entry_t *entry)
+{
+  __atomic_store_n(&entry->version, entry->version + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,161 @@
+/***************************************************************************//**
+ * @file
+ * @brief Concurrently readable table of the latest asset tag positions.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_SNAPSHOT_H
+#define AOA_SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+
+// Entries take a cache line each, so that estimation threads updating
+// neighbouring entries do not share lines. The layout of a shared snapshot is
+// described for readers in aoa_snapshot_reader.h.
+#define AOA_SNAPSHOT_ENTRY_SIZE  64
+
+typedef struct {
+  uint32_t version;         // odd while the entry is written
+  uint32_t reserved;
+  uint64_t timestamp;       // time of the position in microseconds
+  aoa_position_t position;
+  aoa_id_t id;              // empty if the entry is unused
+  uint8_t padding[AOA_SNAPSHOT_ENTRY_SIZE - 32 - sizeof(aoa_id_t)];
+} aoa_snapshot_entry_t;
+
+typedef struct {
+  aoa_snapshot_entry_t *entries; // aligned to AOA_SNAPSHOT_ENTRY_SIZE
+  uint32_t capacity;
+  void *memory;             // allocated block or mapping of the entries
+  void *header;             // table header if shared, NULL otherwise
+  size_t size;              // size of the mapping if shared
+  const char *name;         // shared memory object name if shared
+  uint64_t dropped;         // writes beyond the capacity, atomic access
+} aoa_snapshot_t;
+
+/***************************************************************************//**
+ * Allocate an empty snapshot.
+ *
+ * @param[out] snapshot Snapshot.
+ * @param[in] capacity Number of entries.
+ *
+ * @retval SL_STATUS_OK Snapshot allocated.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t aoa_snapshot_init(aoa_snapshot_t *snapshot, uint32_t capacity);
+
+/***************************************************************************//**
+ * Create an empty snapshot in POSIX shared memory.
+ *
+ * Local applications map the table read-only with aoa_snapshot_reader.h and
+ * read the positions without copies through the broker. A stale object of
+ * the same name is replaced.
+ *
+ * @param[out] snapshot Snapshot.
+ * @param[in] name Shared memory object name, e.g. "/aoa_positions". Must stay
+ *                 valid until the snapshot is released.
+ * @param[in] capacity Number of entries.
+ *
+ * @retval SL_STATUS_OK Snapshot created.
+ * @retval SL_STATUS_FAIL Failed to create or map the shared memory object.
+ * @retval SL_STATUS_NOT_SUPPORTED Not supported on this platform.
+ ******************************************************************************/
+sl_status_t aoa_snapshot_init_shared(aoa_snapshot_t *snapshot,
+                                     const char *name,
+                                     uint32_t capacity);
+
+/***************************************************************************//**
+ * Release a snapshot, a shared one is marked inactive and removed.
+ *
+ * @param[in] snapshot Snapshot.
+ ******************************************************************************/
+void aoa_snapshot_deinit(aoa_snapshot_t *snapshot);
+
+/***************************************************************************//**
+ * Update an entry.
+ *
+ * Never blocks. An entry must only be written by one thread at a time.
+ *
+ * @param[in] snapshot Snapshot.
+ * @param[in] index Entry index. Writes out of range are counted in dropped,
+ *            unless the snapshot is not in use.
+ * @param[in] id Asset tag ID.
+ * @param[in] position Latest position of the asset tag.
+ * @param[in] timestamp Time of the position in microseconds.
+ ******************************************************************************/
+void aoa_snapshot_write(aoa_snapshot_t *snapshot,
+                        uint32_t index,
+                        const char *id,
+                        const aoa_position_t *position,
+                        uint64_t timestamp);
+
+/***************************************************************************//**
+ * Mark an entry unused.
+ *
+ * @param[in] snapshot Snapshot.
+ * @param[in] index Entry index, ignored if out of range.
+ ******************************************************************************/
+void aoa_snapshot_clear(aoa_snapshot_t *snapshot, uint32_t index);
+
+/***************************************************************************//**
+ * Read a consistent copy of an entry.
+ *
+ * Retries while the entry is being written, safe to call from any thread.
+ *
+ * @param[in] snapshot Snapshot.
+ * @param[in] index Entry index.
+ * @param[out] entry Copy of the entry.
+ *
+ * @return true if the entry is in use.
+ ******************************************************************************/
+bool aoa_snapshot_read(const aoa_snapshot_t *snapshot,
+                       uint32_t index,
+                       aoa_snapshot_entry_t *entry);
+
+/***************************************************************************//**
+ * Get the version of an entry, it changes on every write.
+ *
+ * @param[in] snapshot Snapshot.
+ * @param[in] index Entry index.
+ *
+ * @return Version of the entry.
+ ******************************************************************************/
+uint32_t aoa_snapshot_version(const aoa_snapshot_t *snapshot, uint32_t index);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_SNAPSHOT_H
@@ -0,0 +1,261 @@
+/***************************************************************************//**
+ * @file
+ * @brief Reader of the shared memory position table of the multilocator.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+/*
+ * Self-contained header for local applications reading the latest asset tag
+ * positions published by aoa_multilocator with the -L option. Depends only on
+ * POSIX shared memory and the GCC/Clang atomic builtins, link with -lrt on
+ * older glibc versions.
+ *
+ * Example:
+ *
+ *   aoa_snapshot_table_t table;
+ *   aoa_snapshot_shared_entry_t entry;
+ *   uint32_t index;
+ *
+ *   if (aoa_snapshot_attach(&table, "/aoa_positions") == 0
+ *       && aoa_snapshot_find(&table, "ble-pd-0C4314F46CC7", &index)
+ *       && aoa_snapshot_read_entry(&table, index, &entry) > 0) {
+ *     printf("%f %f %f\n", entry.x, entry.y, entry.z);
+ *   }
+ *   aoa_snapshot_detach(&table);
+ *
+ * The index of an asset tag stays valid until its entry is cleared, which is
+ * detected by comparing the ID of the entry read.
+ */
+
+#ifndef AOA_SNAPSHOT_READER_H
+#define AOA_SNAPSHOT_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Identifies the table, and the layout version of the table and the entries.
+#define AOA_SNAPSHOT_MAGIC         0x53414F41u // "AOAS"
+#define AOA_SNAPSHOT_LAYOUT        1
+
+// Size of the table header and of an entry, both are cache line aligned.
+#define AOA_SNAPSHOT_HEADER_SIZE   64
+#define AOA_SNAPSHOT_ENTRY_SIZE    64
+
+// Size of the asset tag ID field including the terminating NUL.
+#define AOA_SNAPSHOT_ID_SIZE       20
+
+// Number of retries while an entry is being written.
+#define AOA_SNAPSHOT_READ_RETRIES  1000
+
+typedef struct {
+  uint32_t magic;           // written last when the table is ready
+  uint32_t layout;
+  uint32_t header_size;
+  uint32_t entry_size;
+  uint32_t capacity;        // number of entries
+  uint32_t pid;             // process ID of the writer
+  uint32_t active;          // cleared when the writer exits normally
+  uint32_t reserved;
+  uint64_t created;         // creation time of the table in microseconds
+  uint8_t padding[AOA_SNAPSHOT_HEADER_SIZE - 40];
+} aoa_snapshot_shared_header_t;
+
+typedef struct {
+  uint32_t version;         // odd while the entry is written
+  uint32_t reserved;
+  uint64_t timestamp;       // time of the position in microseconds
+  float x;                  // position in meters
+  float y;
+  float z;
+  int32_t sequence;
+  char id[AOA_SNAPSHOT_ID_SIZE]; // empty if the entry is unused
+  uint8_t padding[AOA_SNAPSHOT_ENTRY_SIZE - 32 - AOA_SNAPSHOT_ID_SIZE];
+} aoa_snapshot_shared_entry_t;
+
+typedef struct {
+  const aoa_snapshot_shared_header_t *header;
+  const aoa_snapshot_shared_entry_t *entries;
+  uint32_t capacity;
+  size_t size;              // size of the mapping
+} aoa_snapshot_table_t;
+
+/***************************************************************************//**
+ * Map a shared memory position table read-only.
+ *
+ * @param[out] table Table.
+ * @param[in] name Shared memory object name, e.g. "/aoa_positions".
+ *
+ * @return 0 on success, -1 if the table does not exist or is not ready.
+ ******************************************************************************/
+static inline int aoa_snapshot_attach(aoa_snapshot_table_t *table,
+                                      const char *name)
+{
+  const aoa_snapshot_shared_header_t *header;
+  struct stat st;
+  void *map;
+  int fd;
+
+  memset(table, 0, sizeof(*table));
+  fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < AOA_SNAPSHOT_HEADER_SIZE) {
+    close(fd);
+    return -1;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+  header = (const aoa_snapshot_shared_header_t *)map;
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != AOA_SNAPSHOT_MAGIC
+      || header->layout != AOA_SNAPSHOT_LAYOUT
+      || header->header_size != AOA_SNAPSHOT_HEADER_SIZE
+      || header->entry_size != AOA_SNAPSHOT_ENTRY_SIZE
+      || AOA_SNAPSHOT_HEADER_SIZE
+         + (size_t)header->capacity * AOA_SNAPSHOT_ENTRY_SIZE
+         > (size_t)st.st_size) {
+    munmap(map, (size_t)st.st_size);
+    return -1;
+  }
+  table->header = header;
+  table->entries = (const aoa_snapshot_shared_entry_t *)
+                   ((const uint8_t *)map + AOA_SNAPSHOT_HEADER_SIZE);
+  table->capacity = header->capacity;
+  table->size = (size_t)st.st_size;
+  return 0;
+}
+
+/***************************************************************************//**
+ * Unmap a table.
+ *
+ * @param[in] table Table.
+ ******************************************************************************/
+static inline void aoa_snapshot_detach(aoa_snapshot_table_t *table)
+{
+  if (table->header != NULL) {
+    munmap((void *)table->header, table->size);
+  }
+  memset(table, 0, sizeof(*table));
+}
+
+/***************************************************************************//**
+ * Check if the writer of a table is still running.
+ *
+ * A restarted multilocator creates a new table, attach again to follow it.
+ * The flag stays set if the writer crashed, compare the process ID of the
+ * header against the running processes to detect that.
+ *
+ * @param[in] table Table.
+ *
+ * @return Nonzero while the writer keeps the table up to date.
+ ******************************************************************************/
+static inline int aoa_snapshot_active(const aoa_snapshot_table_t *table)
+{
+  return __atomic_load_n(&table->header->active, __ATOMIC_RELAXED) != 0;
+}
+
+/***************************************************************************//**
+ * Read a consistent copy of an entry without locking.
+ *
+ * @param[in] table Table.
+ * @param[in] index Entry index.
+ * @param[out] entry Copy of the entry.
+ *
+ * @return 1 if the entry is in use, 0 if it is unused or the index is out of
+ *         range, -1 if the entry was being written on every retry.
+ ******************************************************************************/
+static inline int aoa_snapshot_read_entry(const aoa_snapshot_table_t *table,
+                                          uint32_t index,
+                                          aoa_snapshot_shared_entry_t *entry)
+{
+  const aoa_snapshot_shared_entry_t *source;
+  uint32_t version;
+
+  if (index >= table->capacity) {
+    return 0;
+  }
+  source = &table->entries[index];
+  for (int retry = 0; retry < AOA_SNAPSHOT_READ_RETRIES; retry++) {
+    version = __atomic_load_n(&source->version, __ATOMIC_ACQUIRE);
+    if (version % 2 == 0) {
+      memcpy(entry, source, sizeof(*entry));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&source->version, __ATOMIC_RELAXED) == version) {
+        entry->version = version;
+        entry->id[AOA_SNAPSHOT_ID_SIZE - 1] = '\0';
+        return entry->id[0] != '\0';
+      }
+    }
+  }
+  return -1;
+}
+
+/***************************************************************************//**
+ * Find the entry of an asset tag by a linear scan.
+ *
+ * @param[in] table Table.
+ * @param[in] id Asset tag ID.
+ * @param[out] index Entry index.
+ *
+ * @return 1 if found, 0 otherwise.
+ ******************************************************************************/
+static inline int aoa_snapshot_find(const aoa_snapshot_table_t *table,
+                                    const char *id,
+                                    uint32_t *index)
+{
+  aoa_snapshot_shared_entry_t entry;
+
+  for (uint32_t i = 0; i < table->capacity; i++) {
+    // Compare without a consistent read first, most entries do not match.
+    if (table->entries[i].id[0] != id[0]) {
+      continue;
+    }
+    if (aoa_snapshot_read_entry(table, i, &entry) > 0
+        && strncmp(entry.id, id, AOA_SNAPSHOT_ID_SIZE) == 0) {
+      *index = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_SNAPSHOT_READER_H
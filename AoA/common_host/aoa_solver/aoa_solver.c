@@ -0,0 +1,316 @@
+/***************************************************************************//**
+ * @file
+ * @brief Least squares ray intersection position solver.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "aoa_solver.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define DEG_TO_RAD(x)      ((x) * 0.017453292519943295f)
+#define RAD_TO_DEG(x)      ((x) * 57.29577951308232f)
+
+// Relative determinant limit of a solvable problem.
+#define SINGULAR_LIMIT     1e-6f
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void ray_terms(const aoa_solver_locator_t *loc,
+                      float azimuth,
+                      float elevation,
+                      float weight,
+                      aoa_solver_problem_t *terms);
+static inline void solve(float a00, float a01, float a02,
+                         float a11, float a12, float a22,
+                         float b0, float b1, float b2,
+                         float *x, float *y, float *z);
+
+/***************************************************************************//**
+ * Calculate the pose of a locator.
+ ******************************************************************************/
+void aoa_solver_locator_init(aoa_solver_locator_t *loc,
+                             const struct sl_rtl_loc_locator_item *item)
+{
+  float sx = sinf(DEG_TO_RAD(item->orientation_x_axis_degrees));
+  float cx = cosf(DEG_TO_RAD(item->orientation_x_axis_degrees));
+  float sy = sinf(DEG_TO_RAD(item->orientation_y_axis_degrees));
+  float cy = cosf(DEG_TO_RAD(item->orientation_y_axis_degrees));
+  float sz = sinf(DEG_TO_RAD(item->orientation_z_axis_degrees));
+  float cz = cosf(DEG_TO_RAD(item->orientation_z_axis_degrees));
+
+  loc->origin[0] = item->coordinate_x;
+  loc->origin[1] = item->coordinate_y;
+  loc->origin[2] = item->coordinate_z;
+
+  // R = Rz * Ry * Rx
+  loc->rotation[0][0] = cz * cy;
+  loc->rotation[0][1] = cz * sy * sx - sz * cx;
+  loc->rotation[0][2] = cz * sy * cx + sz * sx;
+  loc->rotation[1][0] = sz * cy;
+  loc->rotation[1][1] = sz * sy * sx + cz * cx;
+  loc->rotation[1][2] = sz * sy * cx - cz * sx;
+  loc->rotation[2][0] = -sy;
+  loc->rotation[2][1] = cy * sx;
+  loc->rotation[2][2] = cy * cx;
+}
+
+/***************************************************************************//**
+ * Get the direction of an angle measurement in the site frame.
+ ******************************************************************************/
+void aoa_solver_direction(const aoa_solver_locator_t *loc,
+                          float azimuth,
+                          float elevation,
+                          float direction[3])
+{
+  float ce = cosf(DEG_TO_RAD(elevation));
+  float local[3];
+
+  local[0] = ce * cosf(DEG_TO_RAD(azimuth));
+  local[1] = ce * sinf(DEG_TO_RAD(azimuth));
+  local[2] = sinf(DEG_TO_RAD(elevation));
+
+  for (int i = 0; i < 3; i++) {
+    direction[i] = loc->rotation[i][0] * local[0]
+                   + loc->rotation[i][1] * local[1]
+                   + loc->rotation[i][2] * local[2];
+  }
+}
+
+/***************************************************************************//**
+ * Get the angles of a point as measured by a locator.
+ ******************************************************************************/
+void aoa_solver_angles(const aoa_solver_locator_t *loc,
+                       const float point[3],
+                       float *azimuth,
+                       float *elevation,
+                       float *distance)
+{
+  float diff[3];
+  float local[3];
+
+  for (int i = 0; i < 3; i++) {
+    diff[i] = point[i] - loc->origin[i];
+  }
+  // The inverse of the rotation is its transpose.
+  for (int i = 0; i < 3; i++) {
+    local[i] = loc->rotation[0][i] * diff[0]
+               + loc->rotation[1][i] * diff[1]
+               + loc->rotation[2][i] * diff[2];
+  }
+  *azimuth = RAD_TO_DEG(atan2f(local[1], local[0]));
+  *elevation = RAD_TO_DEG(atan2f(local[2], hypotf(local[0], local[1])));
+  *distance = sqrtf(local[0] * local[0] + local[1] * local[1] + local[2] * local[2]);
+}
+
+/***************************************************************************//**
+ * Get the weight of an angle measurement.
+ ******************************************************************************/
+float aoa_solver_ray_weight(float distance)
+{
+  if (!(distance > 0.0f)) {
+    return 1.0f;
+  }
+  if (distance < AOA_SOLVER_MIN_DISTANCE) {
+    distance = AOA_SOLVER_MIN_DISTANCE;
+  }
+  return 1.0f / (distance * distance);
+}
+
+/***************************************************************************//**
+ * Empty a single problem.
+ ******************************************************************************/
+void aoa_solver_init(aoa_solver_problem_t *problem)
+{
+  memset(problem, 0, sizeof(*problem));
+}
+
+/***************************************************************************//**
+ * Add an angle measurement to a single problem.
+ ******************************************************************************/
+void aoa_solver_add_ray(aoa_solver_problem_t *problem,
+                        const aoa_solver_locator_t *loc,
+                        float azimuth,
+                        float elevation,
+                        float weight)
+{
+  aoa_solver_problem_t terms;
+
+  ray_terms(loc, azimuth, elevation, weight, &terms);
+  problem->a00 += terms.a00;
+  problem->a01 += terms.a01;
+  problem->a02 += terms.a02;
+  problem->a11 += terms.a11;
+  problem->a12 += terms.a12;
+  problem->a22 += terms.a22;
+  problem->b0 += terms.b0;
+  problem->b1 += terms.b1;
+  problem->b2 += terms.b2;
+}
+
+/***************************************************************************//**
+ * Solve a single problem.
+ ******************************************************************************/
+void aoa_solver_solve(const aoa_solver_problem_t *problem, float position[3])
+{
+  solve(problem->a00, problem->a01, problem->a02,
+        problem->a11, problem->a12, problem->a22,
+        problem->b0, problem->b1, problem->b2,
+        &position[0], &position[1], &position[2]);
+}
+
+/***************************************************************************//**
+ * Empty a batch.
+ ******************************************************************************/
+void aoa_solver_batch_init(aoa_solver_batch_t *batch)
+{
+  memset(batch, 0, sizeof(*batch));
+}
+
+/***************************************************************************//**
+ * Start a new problem in a batch.
+ ******************************************************************************/
+uint32_t aoa_solver_batch_add(aoa_solver_batch_t *batch)
+{
+  uint32_t lane = batch->count;
+
+  if (lane < AOA_SOLVER_BATCH_SIZE) {
+    batch->a00[lane] = 0.0f;
+    batch->a01[lane] = 0.0f;
+    batch->a02[lane] = 0.0f;
+    batch->a11[lane] = 0.0f;
+    batch->a12[lane] = 0.0f;
+    batch->a22[lane] = 0.0f;
+    batch->b0[lane] = 0.0f;
+    batch->b1[lane] = 0.0f;
+    batch->b2[lane] = 0.0f;
+    batch->count++;
+  }
+  return lane;
+}
+
+/***************************************************************************//**
+ * Add an angle measurement to a problem.
+ ******************************************************************************/
+void aoa_solver_batch_add_ray(aoa_solver_batch_t *batch,
+                              uint32_t lane,
+                              const aoa_solver_locator_t *loc,
+                              float azimuth,
+                              float elevation,
+                              float weight)
+{
+  aoa_solver_problem_t terms;
+
+  ray_terms(loc, azimuth, elevation, weight, &terms);
+  batch->a00[lane] += terms.a00;
+  batch->a01[lane] += terms.a01;
+  batch->a02[lane] += terms.a02;
+  batch->a11[lane] += terms.a11;
+  batch->a12[lane] += terms.a12;
+  batch->a22[lane] += terms.a22;
+  batch->b0[lane] += terms.b0;
+  batch->b1[lane] += terms.b1;
+  batch->b2[lane] += terms.b2;
+}
+
+/***************************************************************************//**
+ * Solve all problems of a batch.
+ *
+ * The loop has no branches and no dependency between the lanes, so it is
+ * vectorized.
+ ******************************************************************************/
+void aoa_solver_batch_solve(aoa_solver_batch_t *batch)
+{
+  for (uint32_t i = 0; i < AOA_SOLVER_BATCH_SIZE; i++) {
+    solve(batch->a00[i], batch->a01[i], batch->a02[i],
+          batch->a11[i], batch->a12[i], batch->a22[i],
+          batch->b0[i], batch->b1[i], batch->b2[i],
+          &batch->x[i], &batch->y[i], &batch->z[i]);
+  }
+}
+
+/***************************************************************************//**
+ * Calculate the terms of the normal equations added by a ray.
+ *
+ * The squared distance of point p from the ray through c with direction d is
+ * |(I - d * d^T) * (p - c)|^2, its gradient adds (I - d * d^T) to A and
+ * (I - d * d^T) * c to b.
+ ******************************************************************************/
+static void ray_terms(const aoa_solver_locator_t *loc,
+                      float azimuth,
+                      float elevation,
+                      float weight,
+                      aoa_solver_problem_t *terms)
+{
+  float d[3];
+  const float *c = loc->origin;
+
+  aoa_solver_direction(loc, azimuth, elevation, d);
+
+  terms->a00 = weight * (1.0f - d[0] * d[0]);
+  terms->a01 = -weight * d[0] * d[1];
+  terms->a02 = -weight * d[0] * d[2];
+  terms->a11 = weight * (1.0f - d[1] * d[1]);
+  terms->a12 = -weight * d[1] * d[2];
+  terms->a22 = weight * (1.0f - d[2] * d[2]);
+  terms->b0 = terms->a00 * c[0] + terms->a01 * c[1] + terms->a02 * c[2];
+  terms->b1 = terms->a01 * c[0] + terms->a11 * c[1] + terms->a12 * c[2];
+  terms->b2 = terms->a02 * c[0] + terms->a12 * c[1] + terms->a22 * c[2];
+}
+
+/***************************************************************************//**
+ * Solve the normal equations of a problem with Cramer's rule.
+ *
+ * Branch free, so that the loop of the batch solver is vectorized.
+ ******************************************************************************/
+static inline void solve(float a00, float a01, float a02,
+                         float a11, float a12, float a22,
+                         float b0, float b1, float b2,
+                         float *x, float *y, float *z)
+{
+  // Cofactors of the symmetric matrix.
+  float c00 = a11 * a22 - a12 * a12;
+  float c01 = a02 * a12 - a01 * a22;
+  float c02 = a01 * a12 - a02 * a11;
+  float c11 = a00 * a22 - a02 * a02;
+  float c12 = a01 * a02 - a00 * a12;
+  float c22 = a00 * a11 - a01 * a01;
+  float det = a00 * c00 + a01 * c01 + a02 * c02;
+  float trace = a00 + a11 + a22;
+  float inv = 1.0f / det;
+  // Adding NAN invalidates the result, a single select keeps the solver
+  // branch free.
+  float invalid = (fabsf(det) > SINGULAR_LIMIT * trace * trace * trace) ? 0.0f : NAN;
+
+  *x = (c00 * b0 + c01 * b1 + c02 * b2) * inv + invalid;
+  *y = (c01 * b0 + c11 * b1 + c12 * b2) * inv + invalid;
+  *z = (c02 * b0 + c12 * b1 + c22 * b2) * inv + invalid;
+}
@@ -0,0 +1,219 @@
+/***************************************************************************//**
+ * @file
+ * @brief Least squares ray intersection position solver.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_SOLVER_H
+#define AOA_SOLVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sl_status.h"
+#include "sl_rtl_clib_api.h"
+
+// Number of problems solved together. The solver works on all problems of a
+// batch in the same loop, which the compiler turns into SIMD instructions.
+#define AOA_SOLVER_BATCH_SIZE  16
+
+// Distance in meters below which the weight of a ray does not grow further.
+#define AOA_SOLVER_MIN_DISTANCE  0.5f
+
+// Locator pose in the site frame.
+typedef struct {
+  float origin[3];
+  float rotation[3][3]; // locator frame to site frame
+} aoa_solver_locator_t;
+
+// Single position problem, the normal equations A * p = b of one lane.
+typedef struct {
+  float a00, a01, a02, a11, a12, a22;
+  float b0, b1, b2;
+} aoa_solver_problem_t;
+
+// Batch of position problems in structure of arrays layout, one lane per
+// problem. The normal equations of a lane are A * p = b, where A is symmetric.
+typedef struct {
+  uint32_t count; // number of lanes in use
+  float a00[AOA_SOLVER_BATCH_SIZE];
+  float a01[AOA_SOLVER_BATCH_SIZE];
+  float a02[AOA_SOLVER_BATCH_SIZE];
+  float a11[AOA_SOLVER_BATCH_SIZE];
+  float a12[AOA_SOLVER_BATCH_SIZE];
+  float a22[AOA_SOLVER_BATCH_SIZE];
+  float b0[AOA_SOLVER_BATCH_SIZE];
+  float b1[AOA_SOLVER_BATCH_SIZE];
+  float b2[AOA_SOLVER_BATCH_SIZE];
+  float x[AOA_SOLVER_BATCH_SIZE]; // results, NAN if not solvable
+  float y[AOA_SOLVER_BATCH_SIZE];
+  float z[AOA_SOLVER_BATCH_SIZE];
+} aoa_solver_batch_t;
+
+/***************************************************************************//**
+ * Calculate the pose of a locator.
+ *
+ * The locator frame is rotated around the x, then the y, then the z axis of
+ * the site frame by the orientation angles, and moved to the coordinate.
+ *
+ * @param[out] loc Locator pose.
+ * @param[in] item Locator configuration.
+ ******************************************************************************/
+void aoa_solver_locator_init(aoa_solver_locator_t *loc,
+                             const struct sl_rtl_loc_locator_item *item);
+
+/***************************************************************************//**
+ * Get the direction of an angle measurement in the site frame.
+ *
+ * Azimuth is measured in the xy plane of the locator from its x axis towards
+ * its y axis, elevation from the xy plane towards the z axis.
+ *
+ * @param[in] loc Locator pose.
+ * @param[in] azimuth Azimuth in degrees.
+ * @param[in] elevation Elevation in degrees.
+ * @param[out] direction Unit vector in the site frame.
+ ******************************************************************************/
+void aoa_solver_direction(const aoa_solver_locator_t *loc,
+                          float azimuth,
+                          float elevation,
+                          float direction[3]);
+
+/***************************************************************************//**
+ * Get the angles of a point as measured by a locator.
+ *
+ * Inverse of aoa_solver_direction.
+ *
+ * @param[in] loc Locator pose.
+ * @param[in] point Point in the site frame.
+ * @param[out] azimuth Azimuth in degrees.
+ * @param[out] elevation Elevation in degrees.
+ * @param[out] distance Distance from the locator.
+ ******************************************************************************/
+void aoa_solver_angles(const aoa_solver_locator_t *loc,
+                       const float point[3],
+                       float *azimuth,
+                       float *elevation,
+                       float *distance);
+
+/***************************************************************************//**
+ * Get the weight of an angle measurement.
+ *
+ * For a given angle error, the distance of the tag from the ray grows with
+ * its distance from the locator. The weight is the inverse of the squared
+ * distance, which makes the solution the weighted least-squares estimate.
+ *
+ * @param[in] distance Distance of the tag from the locator in meters, zero or
+ *            negative if unknown.
+ * @return Weight of the measurement, 1 if the distance is unknown.
+ ******************************************************************************/
+float aoa_solver_ray_weight(float distance);
+
+/***************************************************************************//**
+ * Empty a single problem.
+ *
+ * A single problem costs one lane, use it when the problems do not come in
+ * batches.
+ *
+ * @param[out] problem Problem.
+ ******************************************************************************/
+void aoa_solver_init(aoa_solver_problem_t *problem);
+
+/***************************************************************************//**
+ * Add an angle measurement to a single problem.
+ *
+ * @param[in,out] problem Problem.
+ * @param[in] loc Locator pose.
+ * @param[in] azimuth Azimuth in degrees.
+ * @param[in] elevation Elevation in degrees.
+ * @param[in] weight Weight of the measurement.
+ ******************************************************************************/
+void aoa_solver_add_ray(aoa_solver_problem_t *problem,
+                        const aoa_solver_locator_t *loc,
+                        float azimuth,
+                        float elevation,
+                        float weight);
+
+/***************************************************************************//**
+ * Solve a single problem.
+ *
+ * @param[in] problem Problem.
+ * @param[out] position Position, NAN if the problem has less than 2
+ *             non-parallel rays.
+ ******************************************************************************/
+void aoa_solver_solve(const aoa_solver_problem_t *problem, float position[3]);
+
+/***************************************************************************//**
+ * Empty a batch.
+ *
+ * @param[out] batch Batch.
+ ******************************************************************************/
+void aoa_solver_batch_init(aoa_solver_batch_t *batch);
+
+/***************************************************************************//**
+ * Start a new problem in a batch.
+ *
+ * @param[in,out] batch Batch.
+ * @return Lane of the problem, AOA_SOLVER_BATCH_SIZE if the batch is full.
+ ******************************************************************************/
+uint32_t aoa_solver_batch_add(aoa_solver_batch_t *batch);
+
+/***************************************************************************//**
+ * Add an angle measurement to a problem.
+ *
+ * The solution minimizes the weighted sum of the squared distances from the
+ * rays of the measurements.
+ *
+ * @param[in,out] batch Batch.
+ * @param[in] lane Lane of the problem.
+ * @param[in] loc Locator pose.
+ * @param[in] azimuth Azimuth in degrees.
+ * @param[in] elevation Elevation in degrees.
+ * @param[in] weight Weight of the measurement.
+ ******************************************************************************/
+void aoa_solver_batch_add_ray(aoa_solver_batch_t *batch,
+                              uint32_t lane,
+                              const aoa_solver_locator_t *loc,
+                              float azimuth,
+                              float elevation,
+                              float weight);
+
+/***************************************************************************//**
+ * Solve all problems of a batch.
+ *
+ * Problems with less than 2 non-parallel rays have NAN result.
+ *
+ * @param[in,out] batch Batch.
+ ******************************************************************************/
+void aoa_solver_batch_solve(aoa_solver_batch_t *batch);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_SOLVER_H
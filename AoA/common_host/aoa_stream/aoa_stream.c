@@ -0,0 +1,555 @@
+/***************************************************************************//**
+ * @file
+ * @brief Length-prefixed frame stream over TCP.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+#include "aoa_trace.h"
+#include "aoa_stream.h"
+
+/***************************************************************************//**
+ * Parse stream address.
+ ******************************************************************************/
+sl_status_t aoa_stream_parse_address(const char *str,
+                                     char **host,
+                                     uint16_t *port,
+                                     uint16_t default_port)
+{
+  const char *colon = strrchr(str, ':');
+  size_t host_len = (colon != NULL) ? (size_t)(colon - str) : strlen(str);
+  unsigned long value;
+  char *end;
+
+  if (host_len == 0) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (colon != NULL) {
+    value = strtoul(colon + 1, &end, 10);
+    if ((colon[1] == '\0') || (*end != '\0') || (value == 0) || (value > UINT16_MAX)) {
+      return SL_STATUS_INVALID_PARAMETER;
+    }
+    *port = (uint16_t)value;
+  } else {
+    *port = default_port;
+  }
+  *host = malloc(host_len + 1);
+  if (*host == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  memcpy(*host, str, host_len);
+  (*host)[host_len] = '\0';
+  return SL_STATUS_OK;
+}
+
+#ifndef _WIN32
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+// Closed connections fail with EPIPE instead of raising SIGPIPE.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL      0
+#endif
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static bool client_connect(aoa_stream_client_t *client);
+static void client_flush(aoa_stream_client_t *client);
+static void client_disconnect(aoa_stream_client_t *client);
+static void *run_server(void *arg);
+static void accept_connections(aoa_stream_server_t *server);
+static void receive_frames(aoa_stream_server_t *server,
+                           aoa_stream_connection_t *connection);
+static void close_connection(aoa_stream_connection_t *connection);
+
+/***************************************************************************//**
+ * Initialize a client.
+ ******************************************************************************/
+sl_status_t aoa_stream_client_init(aoa_stream_client_t *client,
+                                   const char *host,
+                                   uint16_t port,
+                                   size_t size)
+{
+  char port_str[6];
+
+  memset(client, 0, sizeof(*client));
+  client->fd = -1;
+  snprintf(port_str, sizeof(port_str), "%u", port);
+  client->host = strdup(host);
+  client->port = strdup(port_str);
+  client->buffer = malloc(size);
+  client->size = size;
+  if ((client->host == NULL) || (client->port == NULL) || (client->buffer == NULL)) {
+    aoa_stream_client_deinit(client);
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Send a frame.
+ ******************************************************************************/
+sl_status_t aoa_stream_client_send(aoa_stream_client_t *client,
+                                   const uint8_t *frame,
+                                   size_t len)
+{
+  if (len > AOA_STREAM_MAX_FRAME) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (!client_connect(client)
+      || (client->pending + AOA_STREAM_HEADER_SIZE + len > client->size)) {
+    client->dropped++;
+    client_flush(client);
+    return SL_STATUS_FULL;
+  }
+
+  client->buffer[client->pending] = (uint8_t)len;
+  client->buffer[client->pending + 1] = (uint8_t)(len >> 8);
+  memcpy(&client->buffer[client->pending + AOA_STREAM_HEADER_SIZE], frame, len);
+  client->pending += AOA_STREAM_HEADER_SIZE + len;
+  client->frames++;
+  client_flush(client);
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Send the buffered frames as far as possible without blocking.
+ ******************************************************************************/
+void aoa_stream_client_flush(aoa_stream_client_t *client)
+{
+  client_flush(client);
+}
+
+/***************************************************************************//**
+ * Close the connection and free the resources of a client.
+ ******************************************************************************/
+void aoa_stream_client_deinit(aoa_stream_client_t *client)
+{
+  client_disconnect(client);
+  free(client->host);
+  free(client->port);
+  free(client->buffer);
+  client->host = NULL;
+  client->port = NULL;
+  client->buffer = NULL;
+}
+
+/***************************************************************************//**
+ * Start a server.
+ ******************************************************************************/
+sl_status_t aoa_stream_server_start(aoa_stream_server_t *server,
+                                    uint16_t port,
+                                    aoa_stream_frame_cb callback,
+                                    void *context)
+{
+  struct sockaddr_in address;
+  int reuse = 1;
+
+  memset(server, 0, sizeof(*server));
+  server->listen_fd = -1;
+  server->wake_fd[0] = -1;
+  server->wake_fd[1] = -1;
+  server->callback = callback;
+  server->context = context;
+  server->started = true;
+  server->connections = malloc(AOA_STREAM_MAX_CLIENTS * sizeof(*server->connections));
+  if (server->connections == NULL) {
+    aoa_stream_server_stop(server);
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  for (uint32_t i = 0; i < AOA_STREAM_MAX_CLIENTS; i++) {
+    server->connections[i].fd = -1;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(port);
+  server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if ((server->listen_fd < 0)
+      || (setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0)
+      || (bind(server->listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+      || (listen(server->listen_fd, AOA_STREAM_MAX_CLIENTS) != 0)
+      || (fcntl(server->listen_fd, F_SETFL, O_NONBLOCK) != 0)
+      || (pipe(server->wake_fd) != 0)
+      || (pthread_create(&server->thread, NULL, run_server, server) != 0)) {
+    aoa_stream_server_stop(server);
+    return SL_STATUS_FAIL;
+  }
+  server->running = true;
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Stop a server and close its connections.
+ ******************************************************************************/
+void aoa_stream_server_stop(aoa_stream_server_t *server)
+{
+  if (!server->started) {
+    return;
+  }
+  if (server->running) {
+    if (write(server->wake_fd[1], "", 1) == 1) {
+      pthread_join(server->thread, NULL);
+    }
+    server->running = false;
+  }
+  if (server->connections != NULL) {
+    for (uint32_t i = 0; i < AOA_STREAM_MAX_CLIENTS; i++) {
+      close_connection(&server->connections[i]);
+    }
+  }
+  if (server->listen_fd >= 0) {
+    close(server->listen_fd);
+    server->listen_fd = -1;
+  }
+  for (uint32_t i = 0; i < 2; i++) {
+    if (server->wake_fd[i] >= 0) {
+      close(server->wake_fd[i]);
+      server->wake_fd[i] = -1;
+    }
+  }
+  free(server->connections);
+  server->connections = NULL;
+  server->started = false;
+}
+
+/***************************************************************************//**
+ * Make sure that the client is connected or a connection is in progress.
+ *
+ * @return true if frames can be buffered.
+ ******************************************************************************/
+static bool client_connect(aoa_stream_client_t *client)
+{
+  struct addrinfo hints, *result, *info;
+  uint64_t now;
+  int nodelay = 1;
+
+  if (client->fd >= 0) {
+    return true;
+  }
+  now = aoa_trace_timestamp();
+  if ((client->attempt != 0) && (now - client->attempt < AOA_STREAM_RETRY_US)) {
+    return false;
+  }
+  client->attempt = now;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(client->host, client->port, &hints, &result) != 0) {
+    return false;
+  }
+  for (info = result; info != NULL; info = info->ai_next) {
+    client->fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (client->fd < 0) {
+      continue;
+    }
+    // Frames are small and latency sensitive.
+    (void)setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    if ((fcntl(client->fd, F_SETFL, O_NONBLOCK) == 0)
+        && ((connect(client->fd, info->ai_addr, info->ai_addrlen) == 0)
+            || (errno == EINPROGRESS))) {
+      client->connecting = true;
+      break;
+    }
+    close(client->fd);
+    client->fd = -1;
+  }
+  freeaddrinfo(result);
+  return client->fd >= 0;
+}
+
+/***************************************************************************//**
+ * Send as much of the buffer as the connection takes without blocking.
+ ******************************************************************************/
+static void client_flush(aoa_stream_client_t *client)
+{
+  struct pollfd fds;
+  ssize_t len;
+  size_t sent = 0;
+  int error = 0;
+  socklen_t error_len = sizeof(error);
+
+  if (client->fd < 0) {
+    return;
+  }
+  if (client->connecting) {
+    fds.fd = client->fd;
+    fds.events = POLLOUT;
+    if (poll(&fds, 1, 0) <= 0) {
+      return;
+    }
+    if ((getsockopt(client->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) != 0)
+        || (error != 0)) {
+      client_disconnect(client);
+      return;
+    }
+    client->connecting = false;
+  }
+
+  while (sent < client->pending) {
+    len = send(client->fd, &client->buffer[sent], client->pending - sent, MSG_NOSIGNAL);
+    if (len < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+        break;
+      }
+      client_disconnect(client);
+      return;
+    }
+    sent += (size_t)len;
+  }
+  if (sent == client->pending) {
+    client->sent += client->frames;
+    client->frames = 0;
+  }
+  memmove(client->buffer, &client->buffer[sent], client->pending - sent);
+  client->pending -= sent;
+}
+
+/***************************************************************************//**
+ * Close the connection, the buffered frames are dropped.
+ ******************************************************************************/
+static void client_disconnect(aoa_stream_client_t *client)
+{
+  if (client->fd >= 0) {
+    close(client->fd);
+    client->fd = -1;
+  }
+  client->connecting = false;
+  client->dropped += client->frames;
+  client->frames = 0;
+  client->pending = 0;
+}
+
+/***************************************************************************//**
+ * Server thread, serves the connections until woken up to stop.
+ ******************************************************************************/
+static void *run_server(void *arg)
+{
+  aoa_stream_server_t *server = arg;
+  struct pollfd fds[AOA_STREAM_MAX_CLIENTS + 2];
+  aoa_stream_connection_t *polled[AOA_STREAM_MAX_CLIENTS];
+  nfds_t count;
+
+  for (;;) {
+    fds[0].fd = server->wake_fd[0];
+    fds[0].events = POLLIN;
+    fds[1].fd = server->listen_fd;
+    fds[1].events = POLLIN;
+    count = 2;
+    for (uint32_t i = 0; i < AOA_STREAM_MAX_CLIENTS; i++) {
+      if (server->connections[i].fd >= 0) {
+        fds[count].fd = server->connections[i].fd;
+        fds[count].events = POLLIN;
+        polled[count - 2] = &server->connections[i];
+        count++;
+      }
+    }
+    if (poll(fds, count, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[0].revents != 0) {
+      break;
+    }
+    for (nfds_t i = 2; i < count; i++) {
+      if (fds[i].revents != 0) {
+        receive_frames(server, polled[i - 2]);
+      }
+    }
+    if (fds[1].revents & POLLIN) {
+      accept_connections(server);
+    }
+  }
+  return NULL;
+}
+
+/***************************************************************************//**
+ * Accept the pending connections, refuse them when all slots are in use.
+ ******************************************************************************/
+static void accept_connections(aoa_stream_server_t *server)
+{
+  aoa_stream_connection_t *connection;
+  int fd;
+
+  while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0) {
+    connection = NULL;
+    for (uint32_t i = 0; i < AOA_STREAM_MAX_CLIENTS; i++) {
+      if (server->connections[i].fd < 0) {
+        connection = &server->connections[i];
+        break;
+      }
+    }
+    if ((connection == NULL) || (fcntl(fd, F_SETFL, O_NONBLOCK) != 0)) {
+      close(fd);
+      continue;
+    }
+    connection->fd = fd;
+    connection->received = 0;
+  }
+}
+
+/***************************************************************************//**
+ * Read from a connection and pass its complete frames to the callback.
+ ******************************************************************************/
+static void receive_frames(aoa_stream_server_t *server,
+                           aoa_stream_connection_t *connection)
+{
+  ssize_t len;
+  size_t frame_len, pos = 0;
+
+  len = recv(connection->fd,
+             &connection->buffer[connection->received],
+             sizeof(connection->buffer) - connection->received,
+             0);
+  if (len <= 0) {
+    if ((len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))) {
+      return;
+    }
+    close_connection(connection);
+    return;
+  }
+  connection->received += (size_t)len;
+
+  while (connection->received - pos >= AOA_STREAM_HEADER_SIZE) {
+    frame_len = connection->buffer[pos] | (connection->buffer[pos + 1] << 8);
+    if (frame_len > AOA_STREAM_MAX_FRAME) {
+      close_connection(connection);
+      return;
+    }
+    if (connection->received - pos < AOA_STREAM_HEADER_SIZE + frame_len) {
+      break;
+    }
+    server->callback(&connection->buffer[pos + AOA_STREAM_HEADER_SIZE],
+                     frame_len,
+                     server->context);
+    server->frames++;
+    pos += AOA_STREAM_HEADER_SIZE + frame_len;
+  }
+  memmove(connection->buffer, &connection->buffer[pos], connection->received - pos);
+  connection->received -= pos;
+}
+
+/***************************************************************************//**
+ * Close a connection.
+ ******************************************************************************/
+static void close_connection(aoa_stream_connection_t *connection)
+{
+  if (connection->fd >= 0) {
+    close(connection->fd);
+    connection->fd = -1;
+  }
+}
+
+#else // _WIN32
+
+/***************************************************************************//**
+ * Initialize a client.
+ ******************************************************************************/
+sl_status_t aoa_stream_client_init(aoa_stream_client_t *client,
+                                   const char *host,
+                                   uint16_t port,
+                                   size_t size)
+{
+  (void)host;
+  (void)port;
+  (void)size;
+  memset(client, 0, sizeof(*client));
+  client->fd = -1;
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+/***************************************************************************//**
+ * Send a frame.
+ ******************************************************************************/
+sl_status_t aoa_stream_client_send(aoa_stream_client_t *client,
+                                   const uint8_t *frame,
+                                   size_t len)
+{
+  (void)frame;
+  (void)len;
+  client->dropped++;
+  return SL_STATUS_FULL;
+}
+
+/***************************************************************************//**
+ * Send the buffered frames as far as possible without blocking.
+ ******************************************************************************/
+void aoa_stream_client_flush(aoa_stream_client_t *client)
+{
+  (void)client;
+}
+
+/***************************************************************************//**
+ * Close the connection and free the resources of a client.
+ ******************************************************************************/
+void aoa_stream_client_deinit(aoa_stream_client_t *client)
+{
+  (void)client;
+}
+
+/***************************************************************************//**
+ * Start a server.
+ ******************************************************************************/
+sl_status_t aoa_stream_server_start(aoa_stream_server_t *server,
+                                    uint16_t port,
+                                    aoa_stream_frame_cb callback,
+                                    void *context)
+{
+  (void)port;
+  (void)callback;
+  (void)context;
+  memset(server, 0, sizeof(*server));
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+/***************************************************************************//**
+ * Stop a server and close its connections.
+ ******************************************************************************/
+void aoa_stream_server_stop(aoa_stream_server_t *server)
+{
+  (void)server;
+}
+
+#endif // _WIN32
@@ -0,0 +1,202 @@
+/***************************************************************************//**
+ * @file
+ * @brief Length-prefixed frame stream over TCP.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_STREAM_H
+#define AOA_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sl_status.h"
+
+// Each frame is preceded by its length as a little endian uint16.
+#define AOA_STREAM_HEADER_SIZE    2
+
+// Maximum length of a frame.
+#define AOA_STREAM_MAX_FRAME      1024
+
+// Maximum number of simultaneous connections of a server.
+#define AOA_STREAM_MAX_CLIENTS    256
+
+// Delay between connection attempts of a client in microseconds.
+#define AOA_STREAM_RETRY_US       1000000
+
+/***************************************************************************//**
+ * Frame callback of a server.
+ *
+ * Called on the server thread.
+ *
+ * @param[in] frame Frame data.
+ * @param[in] len Length of the frame.
+ * @param[in] context Context given to aoa_stream_server_start.
+ ******************************************************************************/
+typedef void (*aoa_stream_frame_cb)(const uint8_t *frame, size_t len, void *context);
+
+typedef struct {
+  char *host;
+  char *port;
+  int fd;                   // -1 if not connected
+  bool connecting;          // connection in progress
+  uint64_t attempt;         // time of the last connection attempt
+  uint8_t *buffer;          // frames not sent yet
+  size_t size;              // size of the buffer
+  size_t pending;           // bytes in the buffer
+  uint32_t frames;          // frames in the buffer
+  uint64_t sent;            // frames handed over to the connection
+  uint64_t dropped;         // frames dropped on overflow or disconnection
+} aoa_stream_client_t;
+
+typedef struct {
+  int fd;                   // -1 if unused
+  uint8_t buffer[AOA_STREAM_HEADER_SIZE + AOA_STREAM_MAX_FRAME];
+  size_t received;
+} aoa_stream_connection_t;
+
+typedef struct {
+  aoa_stream_frame_cb callback;
+  void *context;
+  int listen_fd;
+  int wake_fd[2];           // wakes up the server thread to stop
+  pthread_t thread;
+  bool started;
+  bool running;             // server thread started
+  aoa_stream_connection_t *connections;
+  uint64_t frames;          // number of frames received
+} aoa_stream_server_t;
+
+/***************************************************************************//**
+ * Parse stream address.
+ *
+ * @param[in] str Address in "<host>[:<port>]" format.
+ * @param[out] host Host name, to be freed by the caller.
+ * @param[out] port Port, default_port if omitted.
+ * @param[in] default_port Port used if the address has none.
+ *
+ * @retval SL_STATUS_OK Address is valid.
+ * @retval SL_STATUS_INVALID_PARAMETER Invalid format.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t aoa_stream_parse_address(const char *str,
+                                     char **host,
+                                     uint16_t *port,
+                                     uint16_t default_port);
+
+/***************************************************************************//**
+ * Initialize a client.
+ *
+ * The client connects on demand and reconnects every AOA_STREAM_RETRY_US
+ * while the server is unreachable. It never blocks: frames are buffered
+ * while the connection is slow, and dropped when the buffer is full.
+ *
+ * @param[out] client Client.
+ * @param[in] host Host name or address of the server.
+ * @param[in] port Port of the server.
+ * @param[in] size Size of the send buffer in bytes.
+ *
+ * @retval SL_STATUS_OK Client initialized.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ * @retval SL_STATUS_NOT_SUPPORTED Streams are not available.
+ ******************************************************************************/
+sl_status_t aoa_stream_client_init(aoa_stream_client_t *client,
+                                   const char *host,
+                                   uint16_t port,
+                                   size_t size);
+
+/***************************************************************************//**
+ * Send a frame.
+ *
+ * @param[in] client Client.
+ * @param[in] frame Frame data.
+ * @param[in] len Length of the frame, at most AOA_STREAM_MAX_FRAME.
+ *
+ * @retval SL_STATUS_OK Frame sent or buffered.
+ * @retval SL_STATUS_INVALID_PARAMETER Frame is too long.
+ * @retval SL_STATUS_FULL Frame dropped, the buffer is full or the server is
+ *         unreachable.
+ ******************************************************************************/
+sl_status_t aoa_stream_client_send(aoa_stream_client_t *client,
+                                   const uint8_t *frame,
+                                   size_t len);
+
+/***************************************************************************//**
+ * Send the buffered frames as far as possible without blocking.
+ *
+ * Frames are also sent by aoa_stream_client_send, call this periodically to
+ * send the rest of a burst.
+ *
+ * @param[in] client Client.
+ ******************************************************************************/
+void aoa_stream_client_flush(aoa_stream_client_t *client);
+
+/***************************************************************************//**
+ * Close the connection and free the resources of a client.
+ *
+ * @param[in] client Client.
+ ******************************************************************************/
+void aoa_stream_client_deinit(aoa_stream_client_t *client);
+
+/***************************************************************************//**
+ * Start a server.
+ *
+ * The frames of all connections are passed to the callback on the server
+ * thread. Connections sending malformed frames are closed.
+ *
+ * @param[out] server Server.
+ * @param[in] port Port to listen on, on all interfaces.
+ * @param[in] callback Frame callback.
+ * @param[in] context Context passed to the callback.
+ *
+ * @retval SL_STATUS_OK Server started.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ * @retval SL_STATUS_FAIL Failed to create the socket or the thread.
+ * @retval SL_STATUS_NOT_SUPPORTED Streams are not available.
+ ******************************************************************************/
+sl_status_t aoa_stream_server_start(aoa_stream_server_t *server,
+                                    uint16_t port,
+                                    aoa_stream_frame_cb callback,
+                                    void *context);
+
+/***************************************************************************//**
+ * Stop a server and close its connections.
+ *
+ * @param[in] server Server.
+ ******************************************************************************/
+void aoa_stream_server_stop(aoa_stream_server_t *server);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_STREAM_H
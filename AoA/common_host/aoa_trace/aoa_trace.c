@@ -0,0 +1,285 @@
+/***************************************************************************//**
+ * @file
+ * @brief Capture timestamp and latency tracing.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "cJSON.h"
+#include "app_log.h"
+#include "aoa_trace.h"
+
+// -----------------------------------------------------------------------------
+// Private macros
+
+#define US_PER_SEC   1000000ULL
+#define NS_PER_US    1000ULL
+#define US_PER_MS    1000ULL
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static double get_number(cJSON *root, const char *name, double default_value);
+
+/***************************************************************************//**
+ * Get the current timestamp.
+ ******************************************************************************/
+uint64_t aoa_trace_timestamp(void)
+{
+#ifdef _WIN32
+#if (AOA_TRACE_CLOCK == AOA_TRACE_CLOCK_REALTIME)
+  FILETIME ft;
+  ULARGE_INTEGER ticks;
+  // FILETIME is given in 100 ns units since 1601-01-01.
+  GetSystemTimeAsFileTime(&ft);
+  ticks.LowPart = ft.dwLowDateTime;
+  ticks.HighPart = ft.dwHighDateTime;
+  return ticks.QuadPart / 10;
+#else
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)counter.QuadPart / frequency.QuadPart * US_PER_SEC
+         + (uint64_t)counter.QuadPart % frequency.QuadPart * US_PER_SEC / frequency.QuadPart;
+#endif
+#else
+  struct timespec ts;
+#if (AOA_TRACE_CLOCK == AOA_TRACE_CLOCK_REALTIME)
+  clock_gettime(CLOCK_REALTIME, &ts);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (uint64_t)ts.tv_sec * US_PER_SEC + (uint64_t)ts.tv_nsec / NS_PER_US;
+#endif
+}
+
+/***************************************************************************//**
+ * Reset a capture time range.
+ ******************************************************************************/
+void aoa_trace_span_init(aoa_trace_span_t *span)
+{
+  span->oldest = AOA_TRACE_TIMESTAMP_INVALID;
+  span->newest = AOA_TRACE_TIMESTAMP_INVALID;
+}
+
+/***************************************************************************//**
+ * Extend a capture time range with a new timestamp.
+ ******************************************************************************/
+void aoa_trace_span_add(aoa_trace_span_t *span, uint64_t timestamp)
+{
+  if (timestamp == AOA_TRACE_TIMESTAMP_INVALID) {
+    return;
+  }
+  if ((span->oldest == AOA_TRACE_TIMESTAMP_INVALID) || (timestamp < span->oldest)) {
+    span->oldest = timestamp;
+  }
+  if (timestamp > span->newest) {
+    span->newest = timestamp;
+  }
+}
+
+/***************************************************************************//**
+ * Add a latency sample to the histogram.
+ ******************************************************************************/
+void aoa_trace_hist_add(aoa_trace_hist_t *hist, uint64_t latency_us)
+{
+  uint64_t latency_ms = latency_us / US_PER_MS;
+  uint32_t i = 0;
+
+  while ((latency_ms > 0) && (i < AOA_TRACE_HIST_BUCKETS - 1)) {
+    latency_ms >>= 1;
+    i++;
+  }
+  hist->bucket[i]++;
+  hist->count++;
+  hist->sum_us += latency_us;
+  if (latency_us > hist->max_us) {
+    hist->max_us = latency_us;
+  }
+}
+
+/***************************************************************************//**
+ * Print the histogram to the application log.
+ ******************************************************************************/
+void aoa_trace_hist_log(aoa_trace_hist_t *hist, const char *name)
+{
+  if (hist->count == 0) {
+    app_log("%s: no samples\n", name);
+    return;
+  }
+  app_log("%s: count: %u, mean: %.3f ms, max: %.3f ms\n",
+          name,
+          hist->count,
+          (double)hist->sum_us / hist->count / US_PER_MS,
+          (double)hist->max_us / US_PER_MS);
+  for (uint32_t i = 0; i < AOA_TRACE_HIST_BUCKETS; i++) {
+    if (hist->bucket[i] == 0) {
+      continue;
+    }
+    if (i == 0) {
+      app_log("  [     0,      1) ms: %u\n", hist->bucket[i]);
+    } else if (i == AOA_TRACE_HIST_BUCKETS - 1) {
+      app_log("  [%6u,    inf) ms: %u\n", 1u << (i - 1), hist->bucket[i]);
+    } else {
+      app_log("  [%6u, %6u) ms: %u\n", 1u << (i - 1), 1u << i, hist->bucket[i]);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * Convert angle and its capture timestamp to JSON string.
+ ******************************************************************************/
+sl_status_t aoa_trace_angle_to_string(aoa_angle_t *angle,
+                                      uint64_t timestamp,
+                                      char **string)
+{
+  cJSON *root = cJSON_CreateObject();
+  if (root == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+
+  cJSON_AddNumberToObject(root, "azimuth", angle->azimuth);
+  cJSON_AddNumberToObject(root, "elevation", angle->elevation);
+  cJSON_AddNumberToObject(root, "distance", angle->distance);
+  cJSON_AddNumberToObject(root, "rssi", angle->rssi);
+  cJSON_AddNumberToObject(root, "channel", angle->channel);
+  cJSON_AddNumberToObject(root, "sequence", angle->sequence);
+  cJSON_AddNumberToObject(root, "timestamp", (double)timestamp);
+
+  *string = cJSON_Print(root);
+  cJSON_Delete(root);
+
+  return (*string != NULL) ? SL_STATUS_OK : SL_STATUS_ALLOCATION_FAILED;
+}
+
+/***************************************************************************//**
+ * Convert JSON string to angle and its capture timestamp.
+ ******************************************************************************/
+sl_status_t aoa_trace_string_to_angle(char *string,
+                                      aoa_angle_t *angle,
+                                      uint64_t *timestamp)
+{
+  cJSON *root = cJSON_Parse(string);
+  if (root == NULL) {
+    return SL_STATUS_FAIL;
+  }
+
+  angle->azimuth = (float)get_number(root, "azimuth", 0.0);
+  angle->elevation = (float)get_number(root, "elevation", 0.0);
+  angle->distance = (float)get_number(root, "distance", 0.0);
+  angle->rssi = (int8_t)get_number(root, "rssi", 0.0);
+  angle->channel = (uint8_t)get_number(root, "channel", 0.0);
+  angle->sequence = (int32_t)get_number(root, "sequence", -1.0);
+  // Locators without tracing support do not send a timestamp.
+  *timestamp = (uint64_t)get_number(root, "timestamp", AOA_TRACE_TIMESTAMP_INVALID);
+
+  cJSON_Delete(root);
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Convert position and its capture time range to JSON string.
+ ******************************************************************************/
+sl_status_t aoa_trace_position_to_string(aoa_position_t *position,
+                                         aoa_trace_span_t *span,
+                                         char **string)
+{
+  cJSON *root = cJSON_CreateObject();
+  if (root == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+
+  cJSON_AddNumberToObject(root, "x", position->x);
+  cJSON_AddNumberToObject(root, "y", position->y);
+  cJSON_AddNumberToObject(root, "z", position->z);
+  cJSON_AddNumberToObject(root, "timestamp_oldest", (double)span->oldest);
+  cJSON_AddNumberToObject(root, "timestamp_newest", (double)span->newest);
+
+  *string = cJSON_Print(root);
+  cJSON_Delete(root);
+
+  return (*string != NULL) ? SL_STATUS_OK : SL_STATUS_ALLOCATION_FAILED;
+}
+
+/***************************************************************************//**
+ * Convert ground truth position to JSON string.
+ ******************************************************************************/
+sl_status_t aoa_trace_truth_to_string(aoa_position_t *position, char **string)
+{
+  cJSON *root = cJSON_CreateObject();
+  if (root == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+
+  cJSON_AddNumberToObject(root, "x", position->x);
+  cJSON_AddNumberToObject(root, "y", position->y);
+  cJSON_AddNumberToObject(root, "z", position->z);
+  cJSON_AddNumberToObject(root, "sequence", position->sequence);
+
+  *string = cJSON_Print(root);
+  cJSON_Delete(root);
+
+  return (*string != NULL) ? SL_STATUS_OK : SL_STATUS_ALLOCATION_FAILED;
+}
+
+/***************************************************************************//**
+ * Convert JSON string to ground truth position.
+ ******************************************************************************/
+sl_status_t aoa_trace_string_to_truth(char *string, aoa_position_t *position)
+{
+  cJSON *root = cJSON_Parse(string);
+  if (root == NULL) {
+    return SL_STATUS_FAIL;
+  }
+
+  position->x = (float)get_number(root, "x", 0.0);
+  position->y = (float)get_number(root, "y", 0.0);
+  position->z = (float)get_number(root, "z", 0.0);
+  position->sequence = (int32_t)get_number(root, "sequence", -1.0);
+
+  cJSON_Delete(root);
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Get numeric member of a JSON object.
+ ******************************************************************************/
+static double get_number(cJSON *root, const char *name, double default_value)
+{
+  cJSON *item = cJSON_GetObjectItem(root, name);
+
+  if (cJSON_IsNumber(item)) {
+    return item->valuedouble;
+  }
+  return default_value;
+}
@@ -0,0 +1,175 @@
+/***************************************************************************//**
+ * @file
+ * @brief Capture timestamp and latency tracing.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_TRACE_H
+#define AOA_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "sl_status.h"
+#include "aoa_types.h"
+
+// Clock used for capture timestamps. The monotonic clock is only comparable
+// between processes running on the same host. Select the realtime clock if the
+// locators and the multilocator run on different hosts with synchronized time.
+#define AOA_TRACE_CLOCK_MONOTONIC  0
+#define AOA_TRACE_CLOCK_REALTIME   1
+
+#ifndef AOA_TRACE_CLOCK
+#define AOA_TRACE_CLOCK            AOA_TRACE_CLOCK_MONOTONIC
+#endif
+
+// Timestamp value indicating that the capture time is unknown.
+#define AOA_TRACE_TIMESTAMP_INVALID  0
+
+// Ground truth position topic of an asset tag, published by the scenario
+// generator: asset tag ID.
+#define AOA_TRACE_TOPIC_TRUTH         "silabs/aoa/truth/"
+#define AOA_TRACE_TOPIC_TRUTH_PRINT   AOA_TRACE_TOPIC_TRUTH "%s"
+
+// Number of latency histogram buckets. Bucket 0 counts latencies below 1 ms,
+// bucket i counts latencies in the [2^(i-1), 2^i) ms range, the last bucket
+// counts everything above.
+#define AOA_TRACE_HIST_BUCKETS     16
+
+// Capture time range of the measurements contributing to a result.
+typedef struct {
+  uint64_t oldest;
+  uint64_t newest;
+} aoa_trace_span_t;
+
+// Latency histogram.
+typedef struct {
+  uint32_t bucket[AOA_TRACE_HIST_BUCKETS];
+  uint32_t count;
+  uint64_t sum_us;
+  uint64_t max_us;
+} aoa_trace_hist_t;
+
+/***************************************************************************//**
+ * Get the current timestamp.
+ *
+ * @return Timestamp in microseconds.
+ ******************************************************************************/
+uint64_t aoa_trace_timestamp(void);
+
+/***************************************************************************//**
+ * Reset a capture time range.
+ *
+ * @param[out] span Capture time range.
+ ******************************************************************************/
+void aoa_trace_span_init(aoa_trace_span_t *span);
+
+/***************************************************************************//**
+ * Extend a capture time range with a new timestamp.
+ *
+ * @param[in,out] span Capture time range.
+ * @param[in] timestamp Capture timestamp, ignored if invalid.
+ ******************************************************************************/
+void aoa_trace_span_add(aoa_trace_span_t *span, uint64_t timestamp);
+
+/***************************************************************************//**
+ * Add a latency sample to the histogram.
+ *
+ * @param[in,out] hist Latency histogram.
+ * @param[in] latency_us Latency in microseconds.
+ ******************************************************************************/
+void aoa_trace_hist_add(aoa_trace_hist_t *hist, uint64_t latency_us);
+
+/***************************************************************************//**
+ * Print the histogram to the application log.
+ *
+ * @param[in] hist Latency histogram.
+ * @param[in] name Name of the histogram.
+ ******************************************************************************/
+void aoa_trace_hist_log(aoa_trace_hist_t *hist, const char *name);
+
+/***************************************************************************//**
+ * Convert angle and its capture timestamp to JSON string.
+ *
+ * @param[in] angle Angle data.
+ * @param[in] timestamp Capture timestamp.
+ * @param[out] string JSON string, has to be freed by the caller.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t aoa_trace_angle_to_string(aoa_angle_t *angle,
+                                      uint64_t timestamp,
+                                      char **string);
+
+/***************************************************************************//**
+ * Convert JSON string to angle and its capture timestamp.
+ *
+ * @param[in] string JSON string.
+ * @param[out] angle Angle data.
+ * @param[out] timestamp Capture timestamp, invalid if not present.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t aoa_trace_string_to_angle(char *string,
+                                      aoa_angle_t *angle,
+                                      uint64_t *timestamp);
+
+/***************************************************************************//**
+ * Convert position and its capture time range to JSON string.
+ *
+ * @param[in] position Position data.
+ * @param[in] span Capture time range of the contributing angles.
+ * @param[out] string JSON string, has to be freed by the caller.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t aoa_trace_position_to_string(aoa_position_t *position,
+                                         aoa_trace_span_t *span,
+                                         char **string);
+
+/***************************************************************************//**
+ * Convert ground truth position to JSON string.
+ *
+ * @param[in] position True position and the sequence number of its CTE.
+ * @param[out] string JSON string, has to be freed by the caller.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t aoa_trace_truth_to_string(aoa_position_t *position, char **string);
+
+/***************************************************************************//**
+ * Convert JSON string to ground truth position.
+ *
+ * @param[in] string JSON string.
+ * @param[out] position True position and the sequence number of its CTE.
+ * @return Status code.
+ ******************************************************************************/
+sl_status_t aoa_trace_string_to_truth(char *string, aoa_position_t *position);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_TRACE_H
@@ -0,0 +1,61 @@
+/***************************************************************************//**
+ * @file
+ * @brief LEB128 variable length integer encoding.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include "aoa_varint.h"
+
+/***************************************************************************//**
+ * Encode an unsigned LEB128 varint.
+ ******************************************************************************/
+size_t aoa_varint_encode(uint64_t value, uint8_t *buffer)
+{
+  size_t len = 0;
+
+  while (value >= 0x80) {
+    buffer[len++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  buffer[len++] = (uint8_t)value;
+  return len;
+}
+
+/***************************************************************************//**
+ * Decode an unsigned LEB128 varint.
+ ******************************************************************************/
+size_t aoa_varint_decode(const uint8_t *buffer, size_t size, uint64_t *value)
+{
+  *value = 0;
+  for (size_t i = 0; (i < size) && (i < AOA_VARINT_MAX_SIZE); i++) {
+    *value |= (uint64_t)(buffer[i] & 0x7F) << (7 * i);
+    if ((buffer[i] & 0x80) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
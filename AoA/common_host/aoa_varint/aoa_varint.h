@@ -0,0 +1,69 @@
+/***************************************************************************//**
+ * @file
+ * @brief LEB128 variable length integer encoding.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef AOA_VARINT_H
+#define AOA_VARINT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest encoding of a 64-bit value.
+#define AOA_VARINT_MAX_SIZE  10
+
+/***************************************************************************//**
+ * Encode an unsigned LEB128 varint.
+ *
+ * @param[in] value Value.
+ * @param[out] buffer At least AOA_VARINT_MAX_SIZE bytes.
+ *
+ * @return Number of bytes written, at most AOA_VARINT_MAX_SIZE.
+ ******************************************************************************/
+size_t aoa_varint_encode(uint64_t value, uint8_t *buffer);
+
+/***************************************************************************//**
+ * Decode an unsigned LEB128 varint.
+ *
+ * @param[in] buffer Encoded varint.
+ * @param[in] size Number of bytes available in the buffer.
+ * @param[out] value Value.
+ *
+ * @return Number of bytes read, 0 if the varint is truncated or too long.
+ ******************************************************************************/
+size_t aoa_varint_decode(const uint8_t *buffer, size_t size, uint64_t *value);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // AOA_VARINT_H
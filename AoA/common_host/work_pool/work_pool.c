@@ -0,0 +1,312 @@
+/***************************************************************************//**
+ * @file
+ * @brief Work-stealing thread pool.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "app_log.h"
+#include "work_pool.h"
+
+// -----------------------------------------------------------------------------
+// Private function declarations
+
+static void release_pool(work_pool_t *pool);
+static void *worker_thread(void *arg);
+static work_pool_task_t *pop_task(work_pool_worker_t *worker);
+static work_pool_task_t *steal_task(work_pool_worker_t *worker);
+static sl_status_t push_task(work_pool_worker_t *worker, work_pool_task_t *task);
+
+/***************************************************************************//**
+ * Get the number of online processors.
+ ******************************************************************************/
+uint32_t work_pool_cpu_count(void)
+{
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (info.dwNumberOfProcessors > 0) ? info.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count > 0) ? (uint32_t)count : 1;
+#endif
+}
+
+/***************************************************************************//**
+ * Start a work pool.
+ ******************************************************************************/
+sl_status_t work_pool_init(work_pool_t *pool, uint32_t count)
+{
+  uint32_t started;
+
+  pool->worker = calloc(count, sizeof(work_pool_worker_t));
+  if (pool->worker == NULL) {
+    return SL_STATUS_ALLOCATION_FAILED;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    work_pool_worker_t *worker = &pool->worker[i];
+    worker->pool = pool;
+    worker->size = WORK_POOL_QUEUE_SIZE;
+    worker->queue = malloc(worker->size * sizeof(work_pool_task_t *));
+    if (worker->queue == NULL) {
+      for (uint32_t j = 0; j < i; j++) {
+        free(pool->worker[j].queue);
+      }
+      free(pool->worker);
+      return SL_STATUS_ALLOCATION_FAILED;
+    }
+  }
+  // The workers are fully set up before any of them starts stealing.
+  pool->count = count;
+  pool->next = 0;
+  pool->pending = 0;
+  pool->stop = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wakeup, NULL);
+  for (uint32_t i = 0; i < count; i++) {
+    pthread_mutex_init(&pool->worker[i].lock, NULL);
+  }
+
+  for (started = 0; started < count; started++) {
+    work_pool_worker_t *worker = &pool->worker[started];
+    if (pthread_create(&worker->thread, NULL, worker_thread, worker) != 0) {
+      break;
+    }
+  }
+  if (started < count) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wakeup);
+    pthread_mutex_unlock(&pool->lock);
+    for (uint32_t i = 0; i < started; i++) {
+      pthread_join(pool->worker[i].thread, NULL);
+    }
+    release_pool(pool);
+    return SL_STATUS_FAIL;
+  }
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Run the queued tasks, then stop the worker threads and release resources.
+ ******************************************************************************/
+void work_pool_deinit(work_pool_t *pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->wakeup);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (uint32_t i = 0; i < pool->count; i++) {
+    pthread_join(pool->worker[i].thread, NULL);
+  }
+  release_pool(pool);
+}
+
+/***************************************************************************//**
+ * Queue a task.
+ ******************************************************************************/
+sl_status_t work_pool_submit(work_pool_t *pool, work_pool_task_t *task)
+{
+  work_pool_worker_t *worker = NULL;
+  pthread_t self = pthread_self();
+  sl_status_t sc;
+
+  for (uint32_t i = 0; i < pool->count; i++) {
+    if (pthread_equal(pool->worker[i].thread, self)) {
+      worker = &pool->worker[i];
+      break;
+    }
+  }
+  if (worker == NULL) {
+    pthread_mutex_lock(&pool->lock);
+    worker = &pool->worker[pool->next];
+    pool->next = (pool->next + 1) % pool->count;
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  sc = push_task(worker, task);
+  if (sc != SL_STATUS_OK) {
+    return sc;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->pending++;
+  pthread_cond_signal(&pool->wakeup);
+  pthread_mutex_unlock(&pool->lock);
+
+  return SL_STATUS_OK;
+}
+
+/***************************************************************************//**
+ * Log the task counters of the workers.
+ ******************************************************************************/
+void work_pool_log(work_pool_t *pool)
+{
+  for (uint32_t i = 0; i < pool->count; i++) {
+    pthread_mutex_lock(&pool->worker[i].lock);
+    app_log("Worker %u: executed %llu, stolen %llu\n",
+            i,
+            (unsigned long long)pool->worker[i].executed,
+            (unsigned long long)pool->worker[i].stolen);
+    pthread_mutex_unlock(&pool->worker[i].lock);
+  }
+}
+
+/***************************************************************************//**
+ * Release the resources of a pool with no running workers.
+ ******************************************************************************/
+static void release_pool(work_pool_t *pool)
+{
+  for (uint32_t i = 0; i < pool->count; i++) {
+    pthread_mutex_destroy(&pool->worker[i].lock);
+    free(pool->worker[i].queue);
+  }
+  pthread_cond_destroy(&pool->wakeup);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->worker);
+  pool->worker = NULL;
+  pool->count = 0;
+}
+
+/***************************************************************************//**
+ * Worker thread main loop.
+ ******************************************************************************/
+static void *worker_thread(void *arg)
+{
+  work_pool_worker_t *worker = arg;
+  work_pool_t *pool = worker->pool;
+  work_pool_task_t *task;
+
+  for (;;) {
+    task = pop_task(worker);
+    if (task == NULL) {
+      task = steal_task(worker);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (task != NULL) {
+      pool->pending--;
+    } else if (pool->pending == 0) {
+      // Run down the queues before stopping.
+      if (pool->stop) {
+        pthread_mutex_unlock(&pool->lock);
+        break;
+      }
+      pthread_cond_wait(&pool->wakeup, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (task != NULL) {
+      task->function(task);
+      pthread_mutex_lock(&worker->lock);
+      worker->executed++;
+      pthread_mutex_unlock(&worker->lock);
+    }
+  }
+  return NULL;
+}
+
+/***************************************************************************//**
+ * Take the newest task from the own queue of a worker.
+ ******************************************************************************/
+static work_pool_task_t *pop_task(work_pool_worker_t *worker)
+{
+  work_pool_task_t *task = NULL;
+
+  pthread_mutex_lock(&worker->lock);
+  if (worker->head != worker->tail) {
+    worker->tail--;
+    task = worker->queue[worker->tail & (worker->size - 1)];
+  }
+  pthread_mutex_unlock(&worker->lock);
+  return task;
+}
+
+/***************************************************************************//**
+ * Take the oldest task from the queue of another worker.
+ ******************************************************************************/
+static work_pool_task_t *steal_task(work_pool_worker_t *worker)
+{
+  work_pool_t *pool = worker->pool;
+  uint32_t self = (uint32_t)(worker - pool->worker);
+  work_pool_task_t *task = NULL;
+
+  for (uint32_t i = 1; (i < pool->count) && (task == NULL); i++) {
+    work_pool_worker_t *victim = &pool->worker[(self + i) % pool->count];
+    pthread_mutex_lock(&victim->lock);
+    if (victim->head != victim->tail) {
+      task = victim->queue[victim->head & (victim->size - 1)];
+      victim->head++;
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+  if (task != NULL) {
+    pthread_mutex_lock(&worker->lock);
+    worker->stolen++;
+    pthread_mutex_unlock(&worker->lock);
+  }
+  return task;
+}
+
+/***************************************************************************//**
+ * Add a task to the queue of a worker, grow the queue if necessary.
+ ******************************************************************************/
+static sl_status_t push_task(work_pool_worker_t *worker, work_pool_task_t *task)
+{
+  sl_status_t sc = SL_STATUS_OK;
+
+  pthread_mutex_lock(&worker->lock);
+  if (worker->tail - worker->head == worker->size) {
+    uint32_t size = 2 * worker->size;
+    work_pool_task_t **queue = malloc(size * sizeof(work_pool_task_t *));
+    if (queue == NULL) {
+      sc = SL_STATUS_ALLOCATION_FAILED;
+    } else {
+      uint32_t count = worker->tail - worker->head;
+      for (uint32_t i = 0; i < count; i++) {
+        queue[i] = worker->queue[(worker->head + i) & (worker->size - 1)];
+      }
+      free(worker->queue);
+      worker->queue = queue;
+      worker->size = size;
+      worker->head = 0;
+      worker->tail = count;
+    }
+  }
+  if (sc == SL_STATUS_OK) {
+    worker->queue[worker->tail & (worker->size - 1)] = task;
+    worker->tail++;
+  }
+  pthread_mutex_unlock(&worker->lock);
+  return sc;
+}
@@ -0,0 +1,132 @@
+/***************************************************************************//**
+ * @file
+ * @brief Work-stealing thread pool.
+ *******************************************************************************
+ * # License
+ * <b>Copyright 2021 Silicon Laboratories Inc. www.silabs.com</b>
+ *******************************************************************************
+ *
+ * SPDX-License-Identifier: Zlib
+ *
+ * The licensor of this software is Silicon Laboratories Inc.
+ *
+ * This software is provided 'as-is', without any express or implied
+ * warranty. In no event will the authors be held liable for any damages
+ * arising from the use of this software.
+ *
+ * Permission is granted to anyone to use this software for any purpose,
+ * including commercial applications, and to alter it and redistribute it
+ * freely, subject to the following restrictions:
+ *
+ * 1. The origin of this software must not be misrepresented; you must not
+ *    claim that you wrote the original software. If you use this software
+ *    in a product, an acknowledgment in the product documentation would be
+ *    appreciated but is not required.
+ * 2. Altered source versions must be plainly marked as such, and must not be
+ *    misrepresented as being the original software.
+ * 3. This notice may not be removed or altered from any source distribution.
+ *
+ ******************************************************************************/
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "sl_status.h"
+
+// Initial capacity of the per worker task queues, they grow on demand.
+#define WORK_POOL_QUEUE_SIZE  64
+
+typedef struct work_pool_task_s work_pool_task_t;
+
+typedef void (*work_pool_function_t)(work_pool_task_t *task);
+
+// Task to be embedded in the structure it belongs to. A task must not be
+// submitted again before its function has been called.
+struct work_pool_task_s {
+  work_pool_function_t function;
+  void *context;
+};
+
+typedef struct work_pool_s work_pool_t;
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;     // protects the task queue
+  work_pool_task_t **queue; // ring buffer, owner pops newest, thieves oldest
+  uint32_t size;            // power of 2
+  uint32_t head;            // oldest task
+  uint32_t tail;            // one past the newest task
+  work_pool_t *pool;
+  uint64_t executed;        // number of tasks run
+  uint64_t stolen;          // number of tasks taken from other workers
+} work_pool_worker_t;
+
+struct work_pool_s {
+  work_pool_worker_t *worker;
+  uint32_t count;           // number of workers
+  uint32_t next;            // target of the next external submission
+  pthread_mutex_t lock;     // protects pending and stop
+  pthread_cond_t wakeup;
+  uint32_t pending;         // number of queued tasks
+  bool stop;
+};
+
+/***************************************************************************//**
+ * Get the number of online processors.
+ *
+ * @return Number of online processors, at least 1.
+ ******************************************************************************/
+uint32_t work_pool_cpu_count(void);
+
+/***************************************************************************//**
+ * Start a work pool.
+ *
+ * @param[out] pool Work pool.
+ * @param[in] count Number of worker threads.
+ *
+ * @retval SL_STATUS_OK Worker threads started.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ * @retval SL_STATUS_FAIL Failed to start a worker thread.
+ ******************************************************************************/
+sl_status_t work_pool_init(work_pool_t *pool, uint32_t count);
+
+/***************************************************************************//**
+ * Run the queued tasks, then stop the worker threads and release resources.
+ *
+ * @param[in] pool Work pool.
+ ******************************************************************************/
+void work_pool_deinit(work_pool_t *pool);
+
+/***************************************************************************//**
+ * Queue a task.
+ *
+ * Tasks submitted from a worker thread go to its own queue, other tasks are
+ * distributed among the workers in turn. Idle workers steal from the others.
+ *
+ * @param[in] pool Work pool.
+ * @param[in] task Task to run.
+ *
+ * @retval SL_STATUS_OK Task queued.
+ * @retval SL_STATUS_ALLOCATION_FAILED Out of memory.
+ ******************************************************************************/
+sl_status_t work_pool_submit(work_pool_t *pool, work_pool_task_t *task);
+
+/***************************************************************************//**
+ * Log the task counters of the workers.
+ *
+ * @param[in] pool Work pool.
+ ******************************************************************************/
+void work_pool_log(work_pool_t *pool);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // WORK_POOL_H